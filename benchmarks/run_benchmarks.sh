@@ -11,44 +11,134 @@ BENCHMARK_NAME="GeForce_GTX_470"
 LOOPS=1000
 #LOOPS=1
 
+# 0: A-A pattern, 1: A-B pattern ver. 1, 2: A-B pattern ver. 2, 3: A-B pattern ver. 1 and shared memory, 5: esoteric twist
+TEST_IMPLEMENTATIONS="0"
+
 # 80 & 196 is broken
 #TEST_KERNELS="32 64 80 128 196 256"
 TEST_KERNELS="32 64 128 256"
 
 TEST_DOMAIN_SIZES="32 40 48 56 64 80 96 112 128 144 160"
 
-OUTFILE="benchmarks/benchmark_fs_""$BENCHMARK_NAME"".dat"
-OUTFILEFPS="benchmarks/benchmark_fs_ssps_""$BENCHMARK_NAME"".dat"
+#
+# builds which are compared: each variant is a list of scons options joined by '+' (default: no options).
+# the velocity checksums of the variants are compared to the first variant, a relative deviation above
+# TOLERANCE is marked with (!).
+#
+VARIANTS="default"
+# blocked layout of the density distributions
+#VARIANTS="default ddblocksize=32 ddblocksize=64"
+# half float density distributions
+#VARIANTS="default ddhalf=true"
+# bricked cell ordering
+#VARIANTS="default cellbricksize=4 cellbricksize=8"
+# flag conversions of the A-A pattern: interface worklist, fused conversion kernel (domain sizes which are
+# a multiple of 8), separate conversion kernels
+#VARIANTS="default defines=LBM_AA_INTERFACE_WORKLIST=0 defines=LBM_AA_INTERFACE_WORKLIST=0,LBM_AA_FUSED_FLAG_CONVERSION=0"
+# recorded launches of the A-A steps
+#VARIANTS="default defines=LBM_AA_RECORDED_STEPS=1"
+# velocity and density stored by the collision kernels in every step instead of the lazy fields
+#VARIANTS="default defines=LBM_LAZY_MACROSCOPIC=0"
+
+TOLERANCE="0.01"
 
-BIN="./build/lbm_opencl_fs_intel_release"
 
-echo -n "Domainsize" > $OUTFILE;
-echo -n "Domainsize" > $OUTFILEFPS;
-for k in $TEST_KERNELS; do
-	echo -n "	$k" >> $OUTFILE
-	echo -n "	$k" >> $OUTFILEFPS
+#
+# suffix of the program name of a variant (appended by SConstruct in this order)
+#
+variant_suffix()
+{
+	SUFFIX=""
+	for o in ddblocksize cellbricksize ddhalf tiled3d defines; do
+		for p in `echo "$1" | tr '+' ' '`; do
+			NAME=`echo "$p" | cut -d= -f1`
+			VALUE=`echo "$p" | cut -d= -f2-`
+			test "$NAME" != "$o" && continue
+
+			case "$NAME" in
+				ddblocksize)	test "$VALUE" != "0" && SUFFIX="$SUFFIX""_ddblock$VALUE";;
+				cellbricksize)	test "$VALUE" != "0" && SUFFIX="$SUFFIX""_cellbrick$VALUE";;
+				ddhalf)			test "$VALUE" = "true" && SUFFIX="$SUFFIX""_ddhalf";;
+				tiled3d)		test "$VALUE" = "true" && SUFFIX="$SUFFIX""_tiled3d";;
+				defines)
+					for d in `echo "$VALUE" | tr ',' ' '`; do
+						SUFFIX="$SUFFIX""_"`echo "$d" | tr 'A-Z' 'a-z' | tr -cd 'a-z0-9'`
+					done;;
+			esac
+		done
+	done
+	echo "$SUFFIX"
+}
+
+# build one binary for each variant
+for v in $VARIANTS; do
+	OPTIONS=""
+	test "$v" != "default" && OPTIONS=`echo "$v" | tr '+' '\n' | sed "s/^/--/" | tr '\n' ' '`
+	scons --compiler=intel --mode=release $OPTIONS || exit 1
 done
-echo >> $OUTFILE
-echo >> $OUTFILEFPS
-
-for r in $TEST_DOMAIN_SIZES; do
-	echo "Domainsize: $r"
-	echo -n "$r^3" >> $OUTFILE
-	echo -n "$r^3" >> $OUTFILEFPS
-	for k in $TEST_KERNELS; do
-		EXEC_="$BIN -X $r -n -c -k $k -l $LOOPS"
-		echo $EXEC_
-		OUTPUT=`$EXEC_`
-		MLUPS=`echo -n "$OUTPUT" | grep "MLUPS" | sed "s/MLUPS: //"`
-		FPS=`echo -n "$OUTPUT" | grep "FPS" | sed "s/FPS: //"`
-		CHECKSUM=`echo -n "$OUTPUT" | grep "Checksum" | sed "s/Checksum: //"`
-		test -z "$MLUPS" && MLUPS="-"
-		test -z "$FPS" && FPS="-"
-		test -z "$CHECKSUM" && CHECKSUM="-"
-		echo "$r"x"$r"x"$r - $k kernels: $FPS ssps	$MLUPS mlups	$CHECKSUM checksum"
-		echo -n "	$MLUPS" >> $OUTFILE
-		echo -n "	$FPS" >> $OUTFILEFPS
+
+for a in $TEST_IMPLEMENTATIONS; do
+	for v in $VARIANTS; do
+		SUFFIX=""
+		test "$v" != "default" && SUFFIX=`variant_suffix "$v"`
+
+		OUTFILE="benchmarks/benchmark_fs_""$BENCHMARK_NAME""_a$a$SUFFIX"".dat"
+		OUTFILEFPS="benchmarks/benchmark_fs_ssps_""$BENCHMARK_NAME""_a$a$SUFFIX"".dat"
+		OUTFILECHECKSUMS="benchmarks/benchmark_fs_checksums_""$BENCHMARK_NAME""_a$a$SUFFIX"".dat"
+
+		BIN="./build/lbm_opencl_fs_intel_release$SUFFIX"
+
+		echo -n "Domainsize" > $OUTFILE;
+		echo -n "Domainsize" > $OUTFILEFPS;
+		echo "Domainsize	Kernels	Velocity	Density	Mass" > $OUTFILECHECKSUMS;
+		for k in $TEST_KERNELS; do
+			echo -n "	$k" >> $OUTFILE
+			echo -n "	$k" >> $OUTFILEFPS
+		done
+		echo >> $OUTFILE
+		echo >> $OUTFILEFPS
+
+		for r in $TEST_DOMAIN_SIZES; do
+			echo "Domainsize: $r"
+			echo -n "$r^3" >> $OUTFILE
+			echo -n "$r^3" >> $OUTFILEFPS
+			for k in $TEST_KERNELS; do
+				EXEC_="$BIN -X $r -n -c -v -k $k -l $LOOPS -a $a"
+				echo $EXEC_
+				OUTPUT=`$EXEC_`
+				MLUPS=`echo -n "$OUTPUT" | grep "MLUPS" | sed "s/MLUPS: //"`
+				FPS=`echo -n "$OUTPUT" | grep "FPS" | sed "s/FPS: //"`
+				VELOCITY=`echo -n "$OUTPUT" | grep "velocity checksum" | sed "s/velocity checksum: //"`
+				DENSITY=`echo -n "$OUTPUT" | grep "density checksum" | sed "s/density checksum: //"`
+				MASS=`echo -n "$OUTPUT" | grep "mass checksum" | sed "s/mass checksum: //"`
+				test -z "$MLUPS" && MLUPS="-"
+				test -z "$FPS" && FPS="-"
+				test -z "$VELOCITY" && VELOCITY="-"
+				test -z "$DENSITY" && DENSITY="-"
+				test -z "$MASS" && MASS="-"
+				echo "$r"x"$r"x"$r - impl. $a - $k kernels - $v: $FPS ssps	$MLUPS mlups	$VELOCITY velocity	$DENSITY density	$MASS mass"
+				echo -n "	$MLUPS" >> $OUTFILE
+				echo -n "	$FPS" >> $OUTFILEFPS
+				echo "$r^3	$k	$VELOCITY	$DENSITY	$MASS" >> $OUTFILECHECKSUMS
+			done
+			echo >> $OUTFILE
+			echo >> $OUTFILEFPS
+		done
+	done
+
+	# relative deviation of the velocity checksums of the variants from the first variant
+	FIRST_CHECKSUMS=""
+	for v in $VARIANTS; do
+		SUFFIX=""
+		test "$v" != "default" && SUFFIX=`variant_suffix "$v"`
+		CHECKSUMS="benchmarks/benchmark_fs_checksums_""$BENCHMARK_NAME""_a$a$SUFFIX"".dat"
+
+		if [ -z "$FIRST_CHECKSUMS" ]; then
+			FIRST_CHECKSUMS="$CHECKSUMS"
+			continue
+		fi
+
+		echo "velocity checksum deviation of impl. $a - $v:"
+		paste "$FIRST_CHECKSUMS" "$CHECKSUMS" | tail -n +2 | awk -v tol=$TOLERANCE '{ if ($3 == "-" || $8 == "-") d = "-"; else { d = $3 - $8; if (d < 0) d = -d; s = ($3 < 0 ? -$3 : $3); if (s > 0) d /= s; d = sprintf("%g%s", d, (d > tol ? "(!)" : "")) } print $1 " - " $2 " kernels: " d }'
 	done
-	echo >> $OUTFILE
-	echo >> $OUTFILEFPS
 done
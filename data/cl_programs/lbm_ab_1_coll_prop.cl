@@ -1,5 +1,19 @@
 #include "data/cl_programs/lbm_inc_header.h"
 
+/**
+ * TILED_3D == 1: the kernel is launched with a 3D range and 3D work groups of TILE_SIZE_X*TILE_SIZE_Y*TILE_SIZE_Z
+ * work items. the flags and fluid fractions of the tile and a halo of one cell are loaded to local memory once,
+ * the 18 neighbors of each cell are read from there instead of global memory.
+ */
+#if TILED_3D
+	#define TILE_REGION_SIZE_X	(TILE_SIZE_X+2)
+	#define TILE_REGION_SIZE_Y	(TILE_SIZE_Y+2)
+	#define TILE_REGION_SIZE_Z	(TILE_SIZE_Z+2)
+	#define TILE_REGION_CELLS	(TILE_REGION_SIZE_X*TILE_REGION_SIZE_Y*TILE_REGION_SIZE_Z)
+
+	#define LOCAL_NEIGHBOR(dx, dy, dz)	(local_cell_id + (dx) + ((dy) + (dz)*TILE_REGION_SIZE_Y)*TILE_REGION_SIZE_X)
+#endif
+
 /**
  * this kernel is the faster version of the AB collision and propagation kernel
  *
@@ -8,28 +22,77 @@
  * then the COLLISION is computed and the dds are stored to the local cells storage
  */
 __kernel void kernel_lbm_coll_prop(
-		__global T *global_dd,				// 0) density distributions
+		__global DD_T *global_dd,			// 0) density distributions
 		__global int *flag_array,			// 1) flags
 		__global T *velocity_array,			// 2) velocities
 		__global T *density_array,			// 3) densities
-		__const T inv_tau,					// 4) "weight" for collision function
-		__const T inv_trt_tau,				// 5) "weight" for TRT collision model
-
-		__global T *fluid_mass_array,		// 6) fluid mass
-		__global T *fluid_fraction_array,	// 7) fluid fraction
-
-		__global int *new_flag_array,		// 8) NEW flags
-		__global T *new_fluid_fraction_array,	// 9) NEW fluid fraction
+		__constant T *params,				// 4) simulation parameters (PARAM_* indices)
 
-		__const T gravitation0,				// 10) gravitation
-		__const T gravitation1,
-		__const T gravitation2,
+		__global T *fluid_mass_array,		// 5) fluid mass
+		__global T *fluid_fraction_array,	// 6) fluid fraction
 
-		__const T mass_exchange_factor,		// 13) mass exchange factor
+		__global int *new_flag_array,		// 7) NEW flags
+		__global T *new_fluid_fraction_array,	// 8) NEW fluid fraction
 
-		__global T *out_global_dd			// 14) density distributions
+		__global DD_T *out_global_dd		// 9) density distributions
 )
 {
+	const T inv_tau = params[PARAM_INV_TAU];
+	const T inv_trt_tau = params[PARAM_INV_TRT_TAU];
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+#if TILED_3D
+	__local int local_flags[TILE_REGION_CELLS];
+	__local T local_fluid_fractions[TILE_REGION_CELLS];
+
+	const int x = get_global_id(0);
+	const int y = get_global_id(1);
+	const int z = get_global_id(2);
+
+	/*
+	 * load flags and fluid fractions of the tile and its halo.
+	 * work items outside of the domain (the range is padded to a multiple of the tile size) also have to help.
+	 * the tile origin is computed from the global id because the range may start at a global work offset.
+	 */
+	for (	int i = (get_local_id(2)*TILE_SIZE_Y + get_local_id(1))*TILE_SIZE_X + get_local_id(0);
+			i < TILE_REGION_CELLS;
+			i += TILE_SIZE_X*TILE_SIZE_Y*TILE_SIZE_Z
+	)
+	{
+		// add the domain size to avoid negative values for the periodic boundaries
+		int rx = ((get_global_id(0) - get_local_id(0)) + i % TILE_REGION_SIZE_X - 1 + DOMAIN_CELLS_X) % DOMAIN_CELLS_X;
+		int ry = ((get_global_id(1) - get_local_id(1)) + (i / TILE_REGION_SIZE_X) % TILE_REGION_SIZE_Y - 1 + DOMAIN_CELLS_Y) % DOMAIN_CELLS_Y;
+		int rz = ((get_global_id(2) - get_local_id(2)) + i / (TILE_REGION_SIZE_X*TILE_REGION_SIZE_Y) - 1 + DOMAIN_CELLS_Z) % DOMAIN_CELLS_Z;
+
+		size_t region_cell_id = CELL_ID(rx, ry, rz);
+		local_flags[i] = flag_array[region_cell_id];
+		local_fluid_fractions[i] = fluid_fraction_array[region_cell_id];
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	/*
+	 * all work items of the work group have to reach the barriers below. work items beyond the domain
+	 * process the periodic continuation of the domain instead (the same cells which were loaded to their
+	 * local memory slots) and gas cells run through the collision without effect. both only store their
+	 * results if store_cell is set and return after the last barrier.
+	 */
+	bool store_cell = (x < DOMAIN_CELLS_X && y < DOMAIN_CELLS_Y && z < DOMAIN_CELLS_Z);
+
+	const size_t gid = CELL_ID(x % DOMAIN_CELLS_X, y % DOMAIN_CELLS_Y, z % DOMAIN_CELLS_Z);
+	const int local_cell_id = ((get_local_id(2)+1)*TILE_REGION_SIZE_Y + get_local_id(1)+1)*TILE_REGION_SIZE_X + get_local_id(0)+1;
+
+	// load cell type flag
+	int flag = local_flags[local_cell_id];
+
+	// load fluid fraction
+	T fluid_fraction = local_fluid_fractions[local_cell_id];
+#else
+	DOMAIN_RANGE_CHECK();
+
 	const size_t gid = get_global_id(0);
 
 	// load cell type flag
@@ -38,14 +101,24 @@ __kernel void kernel_lbm_coll_prop(
 	// load fluid fraction
 	T fluid_fraction = fluid_fraction_array[gid];
 
+	const bool store_cell = true;
+#endif
+
 	if (flag == FLAG_GAS)
 	{
 		// do nothing if cell is of type gas
 		// just copy data
-		new_flag_array[gid] = FLAG_GAS;
-		new_fluid_fraction_array[gid] = 0.0f;
-		fluid_mass_array[gid] = 0.0f;
+		if (store_cell)
+		{
+			new_flag_array[gid] = FLAG_GAS;
+			new_fluid_fraction_array[gid] = 0.0f;
+			fluid_mass_array[gid] = 0.0f;
+		}
+#if TILED_3D
+		store_cell = false;
+#else
 		return;
+#endif
 	}
 
 	// density distributions
@@ -57,6 +130,9 @@ __kernel void kernel_lbm_coll_prop(
 	T out_mass0, out_mass1;		// outgoing mass
 	int index0, index1;			// array indices
 	int neighbor_flag0, neighbor_flag1;
+#if LAZY_MACROSCOPIC
+	int macroscopic_neighbor_flags = 0;	// all flags of the neighbors (see STORE_MACROSCOPIC)
+#endif
 
 	T tmp;
 
@@ -98,26 +174,51 @@ __kernel void kernel_lbm_coll_prop(
 	 * - first this reduces the number of used registers (according to profiling information)
 	 * - secondly the program runs faster
 	 */
-	__global T *current_dds = global_dd;
+	__global DD_T *current_dds = global_dd;
+	int dd_dir = 0;
+
+#if TILED_3D
+	int local_index0, local_index1;		// indices in local memory
+
+#define NEIGHBORS(dx, dy, dz)								\
+	index0 = NEIGHBOR_CELL(gid, dx, dy, dz);				\
+	index1 = NEIGHBOR_CELL(gid, -(dx), -(dy), -(dz));		\
+	local_index0 = LOCAL_NEIGHBOR(dx, dy, dz);				\
+	local_index1 = LOCAL_NEIGHBOR(-(dx), -(dy), -(dz));
+
+#define LOAD_NEIGHBOR_FF(ffa, ffb)							\
+	ffa = local_fluid_fractions[local_index0];				\
+	neighbor_flag0 = local_flags[local_index0];				\
+	ffb = local_fluid_fractions[local_index1];				\
+	neighbor_flag1 = local_flags[local_index1];
+#else
+
+#define NEIGHBORS(dx, dy, dz)								\
+	index0 = NEIGHBOR_CELL(gid, dx, dy, dz);				\
+	index1 = NEIGHBOR_CELL(gid, -(dx), -(dy), -(dz));
+
+#define LOAD_NEIGHBOR_FF(ffa, ffb)							\
+	ffa = fluid_fraction_array[index0];						\
+	neighbor_flag0 = flag_array[index0];					\
+	ffb = fluid_fraction_array[index1];						\
+	neighbor_flag1 = flag_array[index1];
+#endif
 
 #define LOAD_DD_FF(dda, ffa, ddb, ffb)			\
-	out_mass1 = current_dds[gid];				\
-	dda = current_dds[index0];					\
-	current_dds += DOMAIN_CELLS;				\
-	ffa = fluid_fraction_array[index0];			\
-	neighbor_flag0 = flag_array[index0];		\
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);	\
+	dda = DD_LOAD(current_dds, DD_CELL(index0), dd_dir);	\
+	current_dds += DD_DIR_STRIDE;	dd_dir++;	\
 												\
-	out_mass0 = current_dds[gid];				\
-	ddb = current_dds[index1];					\
-	current_dds += DOMAIN_CELLS;				\
-	ffb = fluid_fraction_array[index1];			\
-	neighbor_flag1 = flag_array[index1];
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);	\
+	ddb = DD_LOAD(current_dds, DD_CELL(index1), dd_dir);	\
+	current_dds += DD_DIR_STRIDE;	dd_dir++;	\
+												\
+	LOAD_NEIGHBOR_FF(ffa, ffb);
 
 	/*
 	 * dd 0-3: f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X);	// index for dd at adjacent cell (-1,0,0)
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X);	// index for dd at adjacent cell (1,0,0)
+	NEIGHBORS(-1, 0, 0);	// indices for dds at adjacent cells (-1,0,0) and (1,0,0)
 
 	LOAD_DD_FF(dd0, ff0, dd1, ff1);
 
@@ -132,8 +233,7 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_x -= dd1;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y);
+	NEIGHBORS(0, -1, 0);
 
 	LOAD_DD_FF(dd2, ff0, dd3, ff1);
 
@@ -150,8 +250,7 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 4-7: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y);
+	NEIGHBORS(-1, -1, 0);
 
 	LOAD_DD_FF(dd4, ff0, dd5, ff1);
 
@@ -169,8 +268,7 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_y -= dd5;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y);
+	NEIGHBORS(-1, 1, 0);
 
 	LOAD_DD_FF(dd6, ff0, dd7, ff1);
 
@@ -190,8 +288,7 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z);
+	NEIGHBORS(-1, 0, -1);
 
 	LOAD_DD_FF(dd8, ff0, dd9, ff1);
 
@@ -209,8 +306,7 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_z -= dd9;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z);
+	NEIGHBORS(-1, 0, 1);
 
 	LOAD_DD_FF(dd10, ff0, dd11, ff1);
 
@@ -230,8 +326,7 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 12-15: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z);
+	NEIGHBORS(0, -1, -1);
 
 	LOAD_DD_FF(dd12, ff0, dd13, ff1);
 
@@ -249,8 +344,7 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_z -= dd13;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z);
+	NEIGHBORS(0, -1, 1);
 
 	LOAD_DD_FF(dd14, ff0, dd15, ff1);
 
@@ -270,8 +364,7 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 16-18: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Z);
+	NEIGHBORS(0, 0, -1);
 
 	LOAD_DD_FF(dd16, ff0, dd17, ff1);
 
@@ -285,7 +378,7 @@ __kernel void kernel_lbm_coll_prop(
 	rho += dd17;
 	velocity_z -= dd17;
 
-	dd18 = current_dds[gid];
+	dd18 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
 	rho += dd18;
 
 
@@ -311,31 +404,35 @@ __kernel void kernel_lbm_coll_prop(
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	current_dds = &(out_global_dd[gid]);
-
-	*current_dds = dd0;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd1;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd2;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd3;		current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd4;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd5;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd6;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd7;		current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd8;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd9;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd10;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd11;	current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd12;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd13;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd14;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd15;	current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd16;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd17;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd18;
+	if (store_cell)
+	{
+		current_dds = &(out_global_dd[DD_CELL(gid)]);
+		dd_dir = 0;
+
+		DD_STORE(current_dds, 0, dd_dir, dd0);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd1);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd2);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd3);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd4);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd5);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd6);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd7);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd8);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd9);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd10);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd11);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd12);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd13);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd14);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd15);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd16);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd17);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd18);
+	}
 
 
 #if INTERFACE_CHANGE
@@ -370,6 +467,9 @@ __kernel void kernel_lbm_coll_prop(
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 
+	if (!store_cell)
+		return;
+
 	/*
 	 * store fluid mass
 	 */
@@ -384,16 +484,20 @@ __kernel void kernel_lbm_coll_prop(
 	new_flag_array[gid] = flag;
 
 	/*
-	 * store velocity
-	 */
-	current_dds = &velocity_array[gid];
-	*current_dds = velocity_x;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_y;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_z;
-
-	/*
-	 * store density
-	 * this is useful for recomputation of dd's from gas cells streaming to interface cells
+	 * store velocity and density
+	 * with LAZY_MACROSCOPIC only for the cells which are read by the next simulation step
 	 */
-	density_array[gid] = rho;
+	if (STORE_MACROSCOPIC(flag))
+	{
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
+
+		/*
+		 * store density
+		 * this is useful for recomputation of dd's from gas cells streaming to interface cells
+		 */
+		density_array[gid] = rho;
+	}
 }
@@ -7,7 +7,7 @@
 #include "data/cl_programs/lbm_inc_header.h"
 
 #define STD_STUFF										\
-	if (flag_array[dd_index] == FLAG_FLUID)				\
+	if (GET_CONVERTED_FLAG(flag_array[dd_index]) == FLAG_FLUID)	\
 	{													\
 		velocity_x += velocity_array[dd_index];			\
 		velocity_y += velocity_array[DOMAIN_CELLS+dd_index];		\
@@ -18,19 +18,24 @@
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 __kernel void kernel_ab_flag_gas_to_interface(
-			__global T *global_dd,				// 0: density distributions
+			__global DD_T *global_dd,			// 0: density distributions
 			__global int *flag_array,			// 1: flags
 			__global T *velocity_array,			// 2: velocities
 			__global T *density_array,			// 3: densities
 
 			__global T *fluid_mass_array,		// 4: fluid mass
 			__global T *fluid_fraction_array,	// 5: fluid fraction
-			__const T mass_exchange_factor		// 6) mass exchange factor
+			__constant T *params		// 6) simulation parameters (PARAM_* indices)
 		)
 {
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	DOMAIN_RANGE_CHECK();
+
 	const size_t gid = get_global_id(0);
 
-	int flag = flag_array[gid];
+	int flag = GET_CONVERTED_FLAG(flag_array[gid]);
+	RESOLVE_CONVERTED_FLAG(gid, flag);
 
 	if (flag == FLAG_GAS_TO_INTERFACE)
 	{
@@ -39,7 +44,8 @@ __kernel void kernel_ab_flag_gas_to_interface(
 		T count;
 
 		size_t dd_index;
-		__global T *current_dds;
+		__global DD_T *current_dds;
+		int dd_dir;
 
 		T vel2;		// vel*vel
 		T vela2;
@@ -60,29 +66,29 @@ __kernel void kernel_ab_flag_gas_to_interface(
 
 		// check neighbored cells if they are fluid cells and convert them to interface cells
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X);			STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 0);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 0);			STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y);			STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 0);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 0);			STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Z);			STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Z);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, -1);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, 1);			STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, -1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, -1, 0);	STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, -1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, -1);	STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, -1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, -1);	STD_STUFF;
 
 		if (count > 1.0f)
 		{
@@ -109,18 +115,19 @@ __kernel void kernel_ab_flag_gas_to_interface(
 		dd_param = rho - (T)(3.0f/2.0f)*(vel2);
 #endif
 
-		current_dds = &global_dd[gid];
+		current_dds = &global_dd[DD_CELL(gid)];
+		dd_dir = 0;
 
 		/***********************
 		 * DD0
 		 ***********************/
 		vela2 = velocity_x*velocity_x;
-		*current_dds = eq_dd0(velocity_x, vela2, dd_param, rho);				current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd1(velocity_x, vela2, dd_param, rho);				current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd0(velocity_x, vela2, dd_param, rho));				current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd1(velocity_x, vela2, dd_param, rho));				current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela2 = velocity_y*velocity_y;
-		*current_dds = eq_dd0(velocity_y, vela2, dd_param, rho);				current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd1(velocity_y, vela2, dd_param, rho);				current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd0(velocity_y, vela2, dd_param, rho));				current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd1(velocity_y, vela2, dd_param, rho));				current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 
 #define vela_velb_2	vela2
@@ -130,14 +137,14 @@ __kernel void kernel_ab_flag_gas_to_interface(
 		vela_velb = velocity_x+velocity_y;
 		vela_velb_2 = vela_velb*vela_velb;
 
-		*current_dds = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela_velb = velocity_x-velocity_y;
 		vela_velb_2 = vela_velb*vela_velb;
 
-		*current_dds = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		/***********************
 		 * DD2
@@ -145,14 +152,14 @@ __kernel void kernel_ab_flag_gas_to_interface(
 		vela_velb = velocity_x+velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
 
-		*current_dds = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela_velb = velocity_x-velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
 
-		*current_dds = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		/***********************
 		 * DD3
@@ -160,110 +167,111 @@ __kernel void kernel_ab_flag_gas_to_interface(
 		vela_velb = velocity_y+velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
 
-		*current_dds = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela_velb = velocity_y-velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
 
-		*current_dds = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);		current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));		current_dds += DD_DIR_STRIDE;	dd_dir++;
 #undef vela_velb_2
 
 		/***********************
 		 * DD4
 		 ***********************/
 		vela2 = velocity_z*velocity_z;
-		*current_dds = eq_dd0(velocity_z, vela2, dd_param, rho);			current_dds += DOMAIN_CELLS;
-		*current_dds = eq_dd1(velocity_z, vela2, dd_param, rho);			current_dds += DOMAIN_CELLS;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd0(velocity_z, vela2, dd_param, rho));			current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, eq_dd1(velocity_z, vela2, dd_param, rho));			current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		*current_dds = eq_dd18(dd_param, rho);
+		DD_STORE(current_dds, 0, dd_dir, eq_dd18(dd_param, rho));
 
 #if DD_FROM_OBSTACLES_TO_INTERFACE
-		current_dds = &global_dd[0];
+		current_dds = &global_dd[DD_CELL(0)];
+		dd_dir = 0;
 
 		/* f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0) */
 		vela2 = velocity_x*velocity_x;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X)] = eq_dd1(velocity_x, vela2, dd_param, rho);						current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, -1, 0, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 0)), dd_dir, eq_dd1(velocity_x, vela2, dd_param, rho));						current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_X)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_X)] = eq_dd0(velocity_x, vela2, dd_param, rho);						current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 1, 0, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 0)), dd_dir, eq_dd0(velocity_x, vela2, dd_param, rho));						current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela2 = velocity_y*velocity_y;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y)] = eq_dd1(velocity_y, vela2, dd_param, rho);						current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, -1, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 0)), dd_dir, eq_dd1(velocity_y, vela2, dd_param, rho));						current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y)] = eq_dd0(velocity_y, vela2, dd_param, rho);						current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, 1, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 0)), dd_dir, eq_dd0(velocity_y, vela2, dd_param, rho));						current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		/* f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0) */
 		vela_velb = velocity_x+velocity_y;
 		vela_velb_2 = vela_velb*vela_velb;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)] = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, -1, -1, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, -1, 0)), dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)] = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 1, 1, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 1, 0)), dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela_velb = velocity_x-velocity_y;
 		vela_velb_2 = vela_velb*vela_velb;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)] = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, -1, 1, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 1, 0)), dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)] = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 1, -1, 0)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, -1, 0)), dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		/* f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1) */
 		vela_velb = velocity_x+velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)] = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, -1, 0, -1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, -1)), dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)] = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 1, 0, 1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 1)), dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela_velb = velocity_x-velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)] = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, -1, 0, 1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 1)), dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)] = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 1, 0, -1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, -1)), dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		/* f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1) */
 		vela_velb = velocity_y+velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)] = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, -1, -1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, -1)), dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)] = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, 1, 1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 1)), dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		vela_velb = velocity_y-velocity_z;
 		vela_velb_2 = vela_velb*vela_velb;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)] = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, -1, 1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 1)), dd_dir, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)] = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);	current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, 1, -1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, -1)), dd_dir, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 		/***********************
 		 * DD4
 		 ***********************/
 		vela2 = velocity_z*velocity_z;
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Z)] = eq_dd1(velocity_z, vela2, dd_param, rho);						current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, 0, -1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, -1)), dd_dir, eq_dd1(velocity_z, vela2, dd_param, rho));						current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-		if (flag_array[DOMAIN_WRAP(gid + DELTA_POS_Z)] == FLAG_OBSTACLE)
-			current_dds[DOMAIN_WRAP(gid + DELTA_POS_Z)] = eq_dd0(velocity_z, vela2, dd_param, rho);						current_dds += DOMAIN_CELLS;
+		if (flag_array[NEIGHBOR_CELL(gid, 0, 0, 1)] == FLAG_OBSTACLE)
+			DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, 1)), dd_dir, eq_dd0(velocity_z, vela2, dd_param, rho));						current_dds += DD_DIR_STRIDE;	dd_dir++;
 #endif
 
-		current_dds = &velocity_array[gid];
-		*current_dds = velocity_x;	current_dds += DOMAIN_CELLS;
-		*current_dds = velocity_y;	current_dds += DOMAIN_CELLS;
-		*current_dds = velocity_z;
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
 
 		// GAS_TO_INTERFACE
 		flag_array[gid] = FLAG_INTERFACE;
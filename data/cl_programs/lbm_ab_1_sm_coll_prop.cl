@@ -12,29 +12,29 @@
  * then the COLLISION is computed and the dds are stored to the local cells storage
  */
 __kernel void kernel_lbm_coll_prop(
-		__global T *global_dd,				// 0) density distributions
+		__global DD_T *global_dd,			// 0) density distributions
 		__global int *flag_array,			// 1) flags
 		__global T *velocity_array,			// 2) velocities
 		__global T *density_array,			// 3) densities
-		__const T inv_tau,					// 4) "weight" for collision function
-		__const T inv_trt_tau,				// 5) "weight" for TRT collision model
+		__constant T *params,				// 4) simulation parameters (PARAM_* indices)
 
-		__global T *fluid_mass_array,		// 6) fluid mass
-		__global T *fluid_fraction_array,	// 7) fluid fraction
+		__global T *fluid_mass_array,		// 5) fluid mass
+		__global T *fluid_fraction_array,	// 6) fluid fraction
 
-		__global int *new_flag_array,		// 8) NEW flags
-		__global T *new_fluid_fraction_array,	// 9) NEW fluid fraction
+		__global int *new_flag_array,		// 7) NEW flags
+		__global T *new_fluid_fraction_array,	// 8) NEW fluid fraction
 
-		__const T gravitation0,				// 10) gravitation
-		__const T gravitation1,
-		__const T gravitation2,
-
-		__const T mass_exchange_factor,		// 13) mass exchange factor
-
-		__global T *out_global_dd			// 14) density distributions
+		__global DD_T *out_global_dd		// 9) density distributions
 )
 {
-	const size_t gid = get_global_id(0);
+	const T inv_tau = params[PARAM_INV_TAU];
+	const T inv_trt_tau = params[PARAM_INV_TRT_TAU];
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	const size_t gid = GET_PADDED_CELL_ID();
 	const size_t lid = get_local_id(0);
 
 	// load cell type flag
@@ -86,6 +86,9 @@ __kernel void kernel_lbm_coll_prop(
 	T out_mass0, out_mass1;		// outgoing mass
 	int index0, index1;			// array indices
 	int neighbor_flag0, neighbor_flag1;
+#if LAZY_MACROSCOPIC
+	int macroscopic_neighbor_flags = 0;	// all flags of the neighbors (see STORE_MACROSCOPIC)
+#endif
 
 	T tmp;
 
@@ -127,18 +130,19 @@ __kernel void kernel_lbm_coll_prop(
 	 * - first this reduces the number of used registers (according to profiling information)
 	 * - secondly the program runs faster
 	 */
-	__global T *current_dds = global_dd;
+	__global DD_T *current_dds = global_dd;
+	int dd_dir = 0;
 
 #define LOAD_DD_FF(dda, ffa, ddb, ffb)			\
-	out_mass1 = current_dds[gid];				\
-	dda = current_dds[index0];					\
-	current_dds += DOMAIN_CELLS;				\
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);	\
+	dda = DD_LOAD(current_dds, DD_CELL(index0), dd_dir);	\
+	current_dds += DD_DIR_STRIDE;	dd_dir++;	\
 	ffa = fluid_fraction_array[index0];			\
 	neighbor_flag0 = flag_array[index0];		\
 												\
-	out_mass0 = current_dds[gid];				\
-	ddb = current_dds[index1];					\
-	current_dds += DOMAIN_CELLS;				\
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);	\
+	ddb = DD_LOAD(current_dds, DD_CELL(index1), dd_dir);	\
+	current_dds += DD_DIR_STRIDE;	dd_dir++;	\
 	ffb = fluid_fraction_array[index1];			\
 	neighbor_flag1 = flag_array[index1];
 
@@ -146,21 +150,21 @@ __kernel void kernel_lbm_coll_prop(
 	 * dd 0-3: f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0)
 	 */
 #if 0
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X);	// index for dd at adjacent cell (-1,0,0)
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X);	// index for dd at adjacent cell (1,0,0)
+	index0 = NEIGHBOR_CELL(gid, -1, 0, 0);	// index for dd at adjacent cell (-1,0,0)
+	index1 = NEIGHBOR_CELL(gid, 1, 0, 0);	// index for dd at adjacent cell (1,0,0)
 
 	LOAD_DD_FF(dd0, ff0, dd1, ff1);
 #else
 	// READ FROM GLOBAL MEMORY TO LOCAL MEMORY
 	// read outgoing density distribution
-	out_mass1 = current_dds[gid];
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
 	// read incoming distribution
-	local_buf_float[0][lid] = current_dds[dd_write_delta_position_1];			current_dds += DOMAIN_CELLS;
+	local_buf_float[0][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_1), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[1][lid] = fluid_fraction_array[dd_write_delta_position_1];	// read fluid fraction
 	local_buf_int[0][lid] = flag_array[dd_write_delta_position_1];				// read flag
 
-	out_mass0 = current_dds[gid];
-	local_buf_float[2][lid] = current_dds[dd_write_delta_position_0];			current_dds += DOMAIN_CELLS;
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[2][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_0), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[3][lid] = fluid_fraction_array[dd_write_delta_position_0];
 	local_buf_int[1][lid] = flag_array[dd_write_delta_position_0];
 
@@ -187,22 +191,22 @@ __kernel void kernel_lbm_coll_prop(
 	rho += dd1;
 	velocity_x -= dd1;
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y);
+	index0 = NEIGHBOR_CELL(gid, 0, -1, 0);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, 0);
 
 #if 1
 	LOAD_DD_FF(dd2, ff0, dd3, ff1);
 #else
-	out_mass1 = current_dds[gid];
-	dd2 = current_dds[index0];
-	current_dds += DOMAIN_CELLS;
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	dd2 = DD_LOAD(current_dds, DD_CELL(index0), dd_dir);
+	current_dds += DD_DIR_STRIDE;	dd_dir++;
 	ff0 = fluid_fraction_array[index0];
 	neighbor_flag0 = flag_array[index0];
 
-	out_mass0 = current_dds[gid];
-	current_dds[gid] = dd0 + dd1 + dd2 + dd3 + out_mass0 + out_mass0 + ff0 + neighbor_flag0;	return;
-	dd3 = current_dds[index1];
-	current_dds += DOMAIN_CELLS;
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	DD_STORE(current_dds, DD_CELL(gid), dd_dir, dd0 + dd1 + dd2 + dd3 + out_mass0 + out_mass0 + ff0 + neighbor_flag0);	return;
+	dd3 = DD_LOAD(current_dds, DD_CELL(index1), dd_dir);
+	current_dds += DD_DIR_STRIDE;	dd_dir++;
 	ff1 = fluid_fraction_array[index1];
 	neighbor_flag1 = flag_array[index1];
 
@@ -221,18 +225,18 @@ __kernel void kernel_lbm_coll_prop(
 	 * dd 4-7: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
 	 */
 #if 0
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y);
+	index0 = NEIGHBOR_CELL(gid, -1, -1, 0);
+	index1 = NEIGHBOR_CELL(gid, 1, 1, 0);
 
 	LOAD_DD_FF(dd4, ff0, dd5, ff1);
 #else
-	out_mass1 = current_dds[gid];
-	local_buf_float[0][lid] = current_dds[dd_write_delta_position_5];			current_dds += DOMAIN_CELLS;
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[0][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_5), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[1][lid] = fluid_fraction_array[dd_write_delta_position_5];
 	local_buf_int[0][lid] = flag_array[dd_write_delta_position_5];
 
-	out_mass0 = current_dds[gid];
-	local_buf_float[2][lid] = current_dds[dd_write_delta_position_4];			current_dds += DOMAIN_CELLS;
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[2][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_4), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[3][lid] = fluid_fraction_array[dd_write_delta_position_4];
 	local_buf_int[1][lid] = flag_array[dd_write_delta_position_4];
 
@@ -263,18 +267,18 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_y -= dd5;
 
 #if 0
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y);
+	index0 = NEIGHBOR_CELL(gid, -1, 1, 0);
+	index1 = NEIGHBOR_CELL(gid, 1, -1, 0);
 
 	LOAD_DD_FF(dd6, ff0, dd7, ff1);
 #else
-	out_mass1 = current_dds[gid];
-	local_buf_float[0][lid] = current_dds[dd_write_delta_position_7];			current_dds += DOMAIN_CELLS;
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[0][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_7), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[1][lid] = fluid_fraction_array[dd_write_delta_position_7];
 	local_buf_int[0][lid] = flag_array[dd_write_delta_position_7];
 
-	out_mass0 = current_dds[gid];
-	local_buf_float[2][lid] = current_dds[dd_write_delta_position_6];			current_dds += DOMAIN_CELLS;
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[2][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_6), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[3][lid] = fluid_fraction_array[dd_write_delta_position_6];
 	local_buf_int[1][lid] = flag_array[dd_write_delta_position_6];
 
@@ -308,18 +312,18 @@ __kernel void kernel_lbm_coll_prop(
 	 * dd 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
 	 */
 #if 0
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z);
+	index0 = NEIGHBOR_CELL(gid, -1, 0, -1);
+	index1 = NEIGHBOR_CELL(gid, 1, 0, 1);
 
 	LOAD_DD_FF(dd8, ff0, dd9, ff1);
 #else
-	out_mass1 = current_dds[gid];
-	local_buf_float[0][lid] = current_dds[dd_write_delta_position_9];			current_dds += DOMAIN_CELLS;
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[0][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_9), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[1][lid] = fluid_fraction_array[dd_write_delta_position_9];
 	local_buf_int[0][lid] = flag_array[dd_write_delta_position_9];
 
-	out_mass0 = current_dds[gid];
-	local_buf_float[2][lid] = current_dds[dd_write_delta_position_8];			current_dds += DOMAIN_CELLS;
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[2][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_8), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[3][lid] = fluid_fraction_array[dd_write_delta_position_8];
 	local_buf_int[1][lid] = flag_array[dd_write_delta_position_8];
 
@@ -349,18 +353,18 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_z -= dd9;
 
 #if 0
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z);
+	index0 = NEIGHBOR_CELL(gid, -1, 0, 1);
+	index1 = NEIGHBOR_CELL(gid, 1, 0, -1);
 
 	LOAD_DD_FF(dd10, ff0, dd11, ff1);
 #else
-	out_mass1 = current_dds[gid];
-	local_buf_float[0][lid] = current_dds[dd_write_delta_position_11];			current_dds += DOMAIN_CELLS;
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[0][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_11), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[1][lid] = fluid_fraction_array[dd_write_delta_position_11];
 	local_buf_int[0][lid] = flag_array[dd_write_delta_position_11];
 
-	out_mass0 = current_dds[gid];
-	local_buf_float[2][lid] = current_dds[dd_write_delta_position_10];			current_dds += DOMAIN_CELLS;
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	local_buf_float[2][lid] = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_10), dd_dir);			current_dds += DD_DIR_STRIDE;	dd_dir++;
 	local_buf_float[3][lid] = fluid_fraction_array[dd_write_delta_position_10];
 	local_buf_int[1][lid] = flag_array[dd_write_delta_position_10];
 
@@ -397,8 +401,8 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 12-15: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z);
+	index0 = NEIGHBOR_CELL(gid, 0, -1, -1);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, 1);
 
 	LOAD_DD_FF(dd12, ff0, dd13, ff1);
 
@@ -416,8 +420,8 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_z -= dd13;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z);
+	index0 = NEIGHBOR_CELL(gid, 0, -1, 1);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, -1);
 
 	LOAD_DD_FF(dd14, ff0, dd15, ff1);
 
@@ -437,8 +441,8 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 16-18: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Z);
+	index0 = NEIGHBOR_CELL(gid, 0, 0, -1);
+	index1 = NEIGHBOR_CELL(gid, 0, 0, 1);
 
 	LOAD_DD_FF(dd16, ff0, dd17, ff1);
 
@@ -452,7 +456,7 @@ __kernel void kernel_lbm_coll_prop(
 	rho += dd17;
 	velocity_z -= dd17;
 
-	dd18 = current_dds[gid];
+	dd18 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
 	rho += dd18;
 
 
@@ -477,30 +481,34 @@ __kernel void kernel_lbm_coll_prop(
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	current_dds = &out_global_dd[gid];
-	*current_dds = dd0;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd1;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd2;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd3;		current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd4;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd5;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd6;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd7;		current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd8;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd9;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd10;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd11;	current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd12;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd13;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd14;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd15;	current_dds += DOMAIN_CELLS;
-
-	*current_dds = dd16;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd17;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd18;
+	if (DOMAIN_RANGE_STORE())
+	{
+		current_dds = &out_global_dd[DD_CELL(gid)];
+		dd_dir = 0;
+		DD_STORE(current_dds, 0, dd_dir, dd0);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd1);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd2);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd3);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd4);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd5);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd6);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd7);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd8);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd9);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd10);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd11);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd12);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd13);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd14);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd15);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+
+		DD_STORE(current_dds, 0, dd_dir, dd16);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd17);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		DD_STORE(current_dds, 0, dd_dir, dd18);
+	}
 
 
 
@@ -533,6 +541,10 @@ __kernel void kernel_lbm_coll_prop(
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 
+	// the work items beyond the domain are done after the last barrier
+	if (!DOMAIN_RANGE_STORE())
+		return;
+
 	/*
 	 * store fluid mass
 	 */
@@ -547,16 +559,20 @@ __kernel void kernel_lbm_coll_prop(
 	new_flag_array[gid] = flag;
 
 	/*
-	 * store velocity
+	 * store velocity and density
+	 * with LAZY_MACROSCOPIC only for the cells which are read by the next simulation step
 	 */
-	current_dds = &velocity_array[gid];
-	*current_dds = velocity_x;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_y;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_z;
+	if (STORE_MACROSCOPIC(flag))
+	{
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
 
-	/*
-	 * store density
-	 * this is useful for recomputation of dd's from gas cells streaming to interface cells
-	 */
-	density_array[gid] = rho;
+		/*
+		 * store density
+		 * this is useful for recomputation of dd's from gas cells streaming to interface cells
+		 */
+		density_array[gid] = rho;
+	}
 }
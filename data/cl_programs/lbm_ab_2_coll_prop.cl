@@ -5,28 +5,30 @@
 
 
 __kernel void kernel_lbm_coll_prop(
-		__global T *global_dd,				// 0) density distributions
+		__global DD_T *global_dd,			// 0) density distributions
 		__global int *flag_array,			// 1) flags
 		__global T *velocity_array,			// 2) velocities
 		__global T *density_array,			// 3) densities
-		__const T inv_tau,					// 4) "weight" for collision function
-		__const T inv_trt_tau,				// 5) "weight" for TRT collision model
+		__constant T *params,				// 4) simulation parameters (PARAM_* indices)
 
-		__global T *fluid_mass_array,		// 6) fluid mass
-		__global T *fluid_fraction_array,	// 7) fluid fraction
+		__global T *fluid_mass_array,		// 5) fluid mass
+		__global T *fluid_fraction_array,	// 6) fluid fraction
 
-		__global int *new_flag_array,		// 8) NEW flags
-		__global T *new_fluid_fraction_array,	// 9) NEW fluid fraction
+		__global int *new_flag_array,		// 7) NEW flags
+		__global T *new_fluid_fraction_array,	// 8) NEW fluid fraction
 
-		__const T gravitation0,				// 10) gravitation
-		__const T gravitation1,
-		__const T gravitation2,
-
-		__const T mass_exchange_factor,		// 13) mass exchange factor
-
-		__global T *out_global_dd			// 14) density distributions
+		__global DD_T *out_global_dd		// 9) density distributions
 )
 {
+	const T inv_tau = params[PARAM_INV_TAU];
+	const T inv_trt_tau = params[PARAM_INV_TRT_TAU];
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	DOMAIN_RANGE_CHECK();
+
 	const size_t gid = get_global_id(0);
 
 	// load cell type flag
@@ -53,6 +55,9 @@ __kernel void kernel_lbm_coll_prop(
 	T out_mass0, out_mass1;		// outgoing mass
 	int index0, index1;			// array indices
 	int neighbor_flag0, neighbor_flag1;
+#if LAZY_MACROSCOPIC
+	int macroscopic_neighbor_flags = 0;	// all flags of the neighbors (see STORE_MACROSCOPIC)
+#endif
 
 	T tmp;
 
@@ -94,39 +99,40 @@ __kernel void kernel_lbm_coll_prop(
 	 * - first this reduces the number of used registers (according to profiling information)
 	 * - secondly the program runs faster and we can use more threads
 	 */
-	__global T *current_dds = global_dd;
+	__global DD_T *current_dds = global_dd;
+	int dd_dir = 0;
 
 
 #define LOAD_DD_FF(dda, ffa, ddb, ffb)			\
-	dda = current_dds[gid];						\
-	out_mass1 = current_dds[index1];			\
-	current_dds += DOMAIN_CELLS;				\
+	dda = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);	\
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(index1), dd_dir);	\
+	current_dds += DD_DIR_STRIDE;	dd_dir++;	\
 	ffa = fluid_fraction_array[index0];			\
 	neighbor_flag0 = flag_array[index0];		\
 												\
-	ddb = current_dds[gid];						\
-	out_mass0 = current_dds[index0];			\
-	current_dds += DOMAIN_CELLS;				\
+	ddb = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);	\
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(index0), dd_dir);	\
+	current_dds += DD_DIR_STRIDE;	dd_dir++;	\
 	ffb = fluid_fraction_array[index1];			\
 	neighbor_flag1 = flag_array[index1];
 
 	/*
 	 * dd 0-3: f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X);	// index for dd at adjacent cell (-1,0,0)
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X);	// index for dd at adjacent cell (1,0,0)
+	index0 = NEIGHBOR_CELL(gid, -1, 0, 0);	// index for dd at adjacent cell (-1,0,0)
+	index1 = NEIGHBOR_CELL(gid, 1, 0, 0);	// index for dd at adjacent cell (1,0,0)
 
 	LOAD_DD_FF(dd0, ff0, dd1, ff1);
 /*
-	dd0 = current_dds[gid];					// load dd of current cell and increment density distribution access pointer
-	out_mass1 = current_dds[index1];		// load outgoing mass for opposite dd mass exchange computation
-	current_dds += DOMAIN_CELLS;			// and increment access pointer to old density distributions
+	dd0 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);	// load dd of current cell and increment density distribution access pointer
+	out_mass1 = DD_LOAD(current_dds, DD_CELL(index1), dd_dir);	// load outgoing mass for opposite dd mass exchange computation
+	current_dds += DD_DIR_STRIDE;	dd_dir++;	// and increment access pointer to old density distributions
 	ff0 = fluid_fraction_array[index0];		// load fluid fraction of adjacent cell (-1,0,0)
 	neighbor_flag0 = flag_array[index0];	// load neighbor flag of adjacent cell (-1,0,0)
 
-	dd1 = current_dds[gid];
-	out_mass0 = current_dds[index0];
-	current_dds += DOMAIN_CELLS;
+	dd1 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
+	out_mass0 = DD_LOAD(current_dds, DD_CELL(index0), dd_dir);
+	current_dds += DD_DIR_STRIDE;	dd_dir++;
 	ff1 = fluid_fraction_array[index1];
 	neighbor_flag1 = flag_array[index1];
 */
@@ -141,8 +147,8 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_x -= dd1;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y);
+	index0 = NEIGHBOR_CELL(gid, 0, -1, 0);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, 0);
 
 	LOAD_DD_FF(dd2, ff0, dd3, ff1);
 
@@ -159,8 +165,8 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 4-7: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y);
+	index0 = NEIGHBOR_CELL(gid, -1, -1, 0);
+	index1 = NEIGHBOR_CELL(gid, 1, 1, 0);
 
 	LOAD_DD_FF(dd4, ff0, dd5, ff1);
 
@@ -178,8 +184,8 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_y -= dd5;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y);
+	index0 = NEIGHBOR_CELL(gid, -1, 1, 0);
+	index1 = NEIGHBOR_CELL(gid, 1, -1, 0);
 
 	LOAD_DD_FF(dd6, ff0, dd7, ff1);
 
@@ -199,8 +205,8 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z);
+	index0 = NEIGHBOR_CELL(gid, -1, 0, -1);
+	index1 = NEIGHBOR_CELL(gid, 1, 0, 1);
 
 	LOAD_DD_FF(dd8, ff0, dd9, ff1);
 
@@ -218,8 +224,8 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_z -= dd9;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z);
+	index0 = NEIGHBOR_CELL(gid, -1, 0, 1);
+	index1 = NEIGHBOR_CELL(gid, 1, 0, -1);
 
 	LOAD_DD_FF(dd10, ff0, dd11, ff1);
 
@@ -239,8 +245,8 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 12-15: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z);
+	index0 = NEIGHBOR_CELL(gid, 0, -1, -1);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, 1);
 
 	LOAD_DD_FF(dd12, ff0, dd13, ff1);
 
@@ -258,8 +264,8 @@ __kernel void kernel_lbm_coll_prop(
 	velocity_z -= dd13;
 
 
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z);
+	index0 = NEIGHBOR_CELL(gid, 0, -1, 1);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, -1);
 
 	LOAD_DD_FF(dd14, ff0, dd15, ff1);
 
@@ -279,8 +285,8 @@ __kernel void kernel_lbm_coll_prop(
 	/*
 	 * dd 16-18: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
 	 */
-	index0 = DOMAIN_WRAP(gid + DELTA_NEG_Z);
-	index1 = DOMAIN_WRAP(gid + DELTA_POS_Z);
+	index0 = NEIGHBOR_CELL(gid, 0, 0, -1);
+	index1 = NEIGHBOR_CELL(gid, 0, 0, 1);
 
 	LOAD_DD_FF(dd16, ff0, dd17, ff1);
 
@@ -294,7 +300,7 @@ __kernel void kernel_lbm_coll_prop(
 	rho += dd17;
 	velocity_z -= dd17;
 
-	dd18 = current_dds[gid];
+	dd18 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
 	rho += dd18;
 
 
@@ -338,36 +344,37 @@ __kernel void kernel_lbm_coll_prop(
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 	current_dds = out_global_dd;
+	dd_dir = 0;
 
 
 	/* f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X)] = dd0;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X)] = dd1;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y)] = dd2;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y)] = dd3;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 0)), dd_dir, dd0);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 0)), dd_dir, dd1);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 0)), dd_dir, dd2);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 0)), dd_dir, dd3);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)] = dd4;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)] = dd5;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)] = dd6;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)] = dd7;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 1, 0)), dd_dir, dd4);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, -1, 0)), dd_dir, dd5);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, -1, 0)), dd_dir, dd6);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 1, 0)), dd_dir, dd7);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)] = dd8;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)] = dd9;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)] = dd10;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)] = dd11;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 1)), dd_dir, dd8);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, -1)), dd_dir, dd9);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, -1)), dd_dir, dd10);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 1)), dd_dir, dd11);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)] = dd12;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)] = dd13;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)] = dd14;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)] = dd15;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 1)), dd_dir, dd12);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, -1)), dd_dir, dd13);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, -1)), dd_dir, dd14);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 1)), dd_dir, dd15);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(0,0,1), f(0,0,-1),  f(0,0,0) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Z)] = dd16;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Z)] = dd17;	current_dds += DOMAIN_CELLS;
-	current_dds[gid] = dd18;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, 1)), dd_dir, dd16);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, -1)), dd_dir, dd17);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(gid), dd_dir, dd18);
 
 
 
@@ -415,16 +422,20 @@ __kernel void kernel_lbm_coll_prop(
 	new_flag_array[gid] = flag;
 
 	/*
-	 * store velocity
+	 * store velocity and density
+	 * with LAZY_MACROSCOPIC only for the cells which are read by the next simulation step
 	 */
-	current_dds = &velocity_array[gid];
-	*current_dds = velocity_x;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_y;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_z;
-
-	/*
-	 * store density
-	 * this is useful for recomputation of dd's from gas cells streaming to interface cells
-	 */
-	density_array[gid] = rho;
+	if (STORE_MACROSCOPIC(flag))
+	{
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
+
+		/*
+		 * store density
+		 * this is useful for recomputation of dd's from gas cells streaming to interface cells
+		 */
+		density_array[gid] = rho;
+	}
 }
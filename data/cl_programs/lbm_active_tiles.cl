@@ -0,0 +1,91 @@
+/**
+ * update the list of active tiles
+ *
+ * a tile is active if at least one of it's cells is a fluid or interface cell (or a cell
+ * in a conversion state) in the current or the new flag array. the active tiles and the
+ * tiles at most ACTIVE_TILE_DILATION tiles away are stored to the active tile list to process
+ * also cells which are converted from gas to interface until the list is replaced.
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+
+/**
+ * mark tiles with non-gas and non-obstacle cells
+ *
+ * this kernel is launched for all domain cells. to avoid an additional kernel to reset the
+ * markers, an active tile is marked with the (unique) id of the update.
+ */
+__kernel void kernel_active_tiles_mark(
+		__global int *flag_array,			// 0) flags
+		__global int *new_flag_array,		// 1) NEW flags
+		__global int *active_tiles,			// 2) marker for each tile
+		__global int *active_tile_list,		// 3) active tile list
+		int update_id						// 4) id of this update
+)
+{
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	// reset counter of active tile list
+	if (gid == 0)
+		active_tile_list[0] = 0;
+
+	if (((flag_array[gid] | new_flag_array[gid]) & ~FLAGS_GAS_OBSTACLE) == 0)
+		return;
+
+	int x = CELL_X(gid);
+	int y = CELL_Y(gid);
+	int z = CELL_Z(gid);
+
+	int tile =		(z / ACTIVE_TILE_SIZE)*(ACTIVE_TILES_X*ACTIVE_TILES_Y) +
+					(y / ACTIVE_TILE_SIZE)*ACTIVE_TILES_X +
+					(x / ACTIVE_TILE_SIZE);
+
+	// all threads write the same value
+	active_tiles[tile] = update_id;
+}
+
+
+/**
+ * append each tile which is at most ACTIVE_TILE_DILATION tiles away from a marked tile (or marked itself)
+ * to the active tile list
+ */
+__kernel void kernel_active_tiles_compact(
+		__global int *active_tiles,			// 0) marker for each tile
+		__global int *active_tile_list,		// 1) active tile list
+		int update_id						// 2) id of this update
+)
+{
+	const int tile = get_global_id(0);
+
+	if (tile >= ACTIVE_TILES_COUNT)
+		return;
+
+	int tx = tile % ACTIVE_TILES_X;
+	int ty = (tile / ACTIVE_TILES_X) % ACTIVE_TILES_Y;
+	int tz = tile / (ACTIVE_TILES_X*ACTIVE_TILES_Y);
+
+	for (int dz = -ACTIVE_TILE_DILATION; dz <= ACTIVE_TILE_DILATION; dz++)
+	{
+		// periodic boundaries
+		int nz = (tz + dz + ACTIVE_TILE_DILATION*ACTIVE_TILES_Z) % ACTIVE_TILES_Z;
+
+		for (int dy = -ACTIVE_TILE_DILATION; dy <= ACTIVE_TILE_DILATION; dy++)
+		{
+			int ny = (ty + dy + ACTIVE_TILE_DILATION*ACTIVE_TILES_Y) % ACTIVE_TILES_Y;
+
+			for (int dx = -ACTIVE_TILE_DILATION; dx <= ACTIVE_TILE_DILATION; dx++)
+			{
+				int nx = (tx + dx + ACTIVE_TILE_DILATION*ACTIVE_TILES_X) % ACTIVE_TILES_X;
+
+				if (active_tiles[(nz*ACTIVE_TILES_Y + ny)*ACTIVE_TILES_X + nx] == update_id)
+				{
+					int pos = atomic_inc(&active_tile_list[0]);
+					active_tile_list[pos+1] = tile;
+					return;
+				}
+			}
+		}
+	}
+}
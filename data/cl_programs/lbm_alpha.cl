@@ -5,39 +5,43 @@
 
 
 __kernel void kernel_lbm_alpha(
-		__global T *global_dd,			// 0) density distributions
+		__global DD_T *global_dd,		// 0) density distributions
 		__global int *flag_array,		// 1) flags
 		__global T *velocity_array,		// 2) velocities
 		__global T *density_array,		// 3) densities
-		__const T inv_tau,								// 4) "weight" for collision function
-		__const T inv_trt_tau,							// 5) "weight" for TRT collision model
+		__constant T *params,				// 4) simulation parameters (PARAM_* indices)
 
-		__global T *fluid_mass_array,		// 6) fluid mass
-		__global T *fluid_fraction_array,	// 7) fluid fraction
+		__global T *fluid_mass_array,		// 5) fluid mass
+		__global T *fluid_fraction_array,	// 6) fluid fraction
 
-		__global int *new_flag_array,		// 8) NEW flags
-		__global T *new_fluid_fraction_array,	// 9) NEW fluid fraction
-
-		__const T gravitation0,							// 10) gravitation
-		__const T gravitation1,
-		__const T gravitation2,
-
-		__const T mass_exchange_factor					// 13) mass exchange factor
+		__global int *new_flag_array,		// 7) NEW flags
+		__global T *new_fluid_fraction_array	// 8) NEW fluid fraction
+		ACTIVE_TILES_KERNEL_ARG			// 9) active tile list (only with ACTIVE_TILES)
+		CELL_STATE_KERNEL_ARG			// 10) packed cell state, 11) NEW packed cell state (only with CELL_STATE)
 )
 {
-	const size_t gid = get_global_id(0);
+	const T inv_tau = params[PARAM_INV_TAU];
+	const T inv_trt_tau = params[PARAM_INV_TRT_TAU];
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	DOMAIN_RANGE_CHECK();
 
-	// load cell type flag
-	int flag = flag_array[gid];
+	const size_t gid = GET_CELL_ID();
 
-	// load fluid fraction
-	T fluid_fraction = fluid_fraction_array[gid];
+	// load cell type flag and fluid fraction
+	int flag;
+	T fluid_fraction;
+	LOAD_CELL_STATE(gid, fluid_fraction, flag);
 
 	if (flag == FLAG_GAS)
 	{
 		// do nothing if cell is of type gas
 		new_flag_array[gid] = FLAG_GAS;
 		new_fluid_fraction_array[gid] = 0.0f;
+		STORE_NEW_CELL_STATE(gid, FLAG_GAS, 0.0f);
 		return;
 	}
 
@@ -82,6 +86,9 @@ __kernel void kernel_lbm_alpha(
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 	int neighbor_flag0, neighbor_flag1;
+#if LAZY_MACROSCOPIC
+	int macroscopic_neighbor_flags = 0;	// all flags of the neighbors (see STORE_MACROSCOPIC)
+#endif
 
 	/*
 	 * pointer to density distributions
@@ -89,18 +96,17 @@ __kernel void kernel_lbm_alpha(
 	 * - first this reduces the number of used registers (according to profiling information)
 	 * - secondly the program runs faster and
 	 */
-	__global T *current_dds = &global_dd[gid];
+	__global DD_T *current_dds = &global_dd[DD_CELL(gid)];
+	int dd_dir = 0;
 
 	/*
 	 * dd 0-3: f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0)
 	 */
-	dd0 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
+	dd0 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 0, 0), ff0, neighbor_flag0);
 
-	dd1 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
+	dd1 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 0, 0), ff1, neighbor_flag1);
 
 	reconstruct_dd_01(flag, fluid_fraction, dd0, neighbor_flag0, ff0, dd1, neighbor_flag1, ff1, old_velocity_x, dd_param, dd_rho);
 
@@ -112,13 +118,11 @@ __kernel void kernel_lbm_alpha(
 	T rhob = dd1;
 	velocity_x -= dd1;
 
-	dd2 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
+	dd2 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, -1, 0), ff0, neighbor_flag0);
 
-	dd3 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
+	dd3 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 1, 0), ff1, neighbor_flag1);
 
 	reconstruct_dd_01(flag, fluid_fraction, dd2, neighbor_flag0, ff0, dd3, neighbor_flag1, ff1, old_velocity_y, dd_param, dd_rho);
 
@@ -133,13 +137,11 @@ __kernel void kernel_lbm_alpha(
 	/*
 	 * dd 4-7: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
 	 */
-	dd4 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
+	dd4 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, -1, 0), ff0, neighbor_flag0);
 
-	dd5 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
+	dd5 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 1, 0), ff1, neighbor_flag1);
 
 	tmp = old_velocity_x+old_velocity_y;
 	reconstruct_dd_45(flag, fluid_fraction, dd4, neighbor_flag0, ff0, dd5, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -154,13 +156,11 @@ __kernel void kernel_lbm_alpha(
 	velocity_x -= dd5;
 	velocity_y -= dd5;
 
-	dd6 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
+	dd6 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 1, 0), ff0, neighbor_flag0);
 
-	dd7 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
+	dd7 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, -1, 0), ff1, neighbor_flag1);
 
 	tmp = old_velocity_x-old_velocity_y;
 	reconstruct_dd_45(flag, fluid_fraction, dd6, neighbor_flag0, ff0, dd7, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -178,13 +178,11 @@ __kernel void kernel_lbm_alpha(
 	/*
 	 * dd 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
 	 */
-	dd8 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
+	dd8 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 0, -1), ff0, neighbor_flag0);
 
-	dd9 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
+	dd9 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 0, 1), ff1, neighbor_flag1);
 
 	tmp = old_velocity_x+old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd8, neighbor_flag0, ff0, dd9, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -199,13 +197,11 @@ __kernel void kernel_lbm_alpha(
 	velocity_x -= dd9;
 	velocity_z -= dd9;
 
-	dd10 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
+	dd10 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 0, 1), ff0, neighbor_flag0);
 
-	dd11 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
+	dd11 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 0, -1), ff1, neighbor_flag1);
 
 	tmp = old_velocity_x-old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd10, neighbor_flag0, ff0, dd11, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -223,13 +219,11 @@ __kernel void kernel_lbm_alpha(
 	/*
 	 * dd 12-15: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
 	 */
-	dd12 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
+	dd12 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, -1, -1), ff0, neighbor_flag0);
 
-	dd13 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
+	dd13 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 1, 1), ff1, neighbor_flag1);
 
 	tmp = old_velocity_y+old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd12, neighbor_flag0, ff0, dd13, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -244,13 +238,11 @@ __kernel void kernel_lbm_alpha(
 	velocity_y -= dd13;
 	velocity_z -= dd13;
 
-	dd14 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
+	dd14 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, -1, 1), ff0, neighbor_flag0);
 
-	dd15 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
+	dd15 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 1, -1), ff1, neighbor_flag1);
 
 	tmp = old_velocity_y-old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd14, neighbor_flag0, ff0, dd15, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -268,13 +260,11 @@ __kernel void kernel_lbm_alpha(
 	/*
 	 * dd 16-18: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
 	 */
-	dd16 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
+	dd16 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 0, -1), ff0, neighbor_flag0);
 
-	dd17 = *current_dds;		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
+	dd17 = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 0, 1), ff1, neighbor_flag1);
 
 	reconstruct_dd_01(flag, fluid_fraction, dd16, neighbor_flag0, ff0, dd17, neighbor_flag1, ff1, old_velocity_z, dd_param, dd_rho);
 
@@ -286,7 +276,7 @@ __kernel void kernel_lbm_alpha(
 	rhob += dd17;
 	velocity_z -= dd17;
 
-	dd18 = *current_dds;
+	dd18 = DD_LOAD(current_dds, 0, dd_dir);
 	rhoc += dd18;
 
 	// sum up density
@@ -336,31 +326,32 @@ __kernel void kernel_lbm_alpha(
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	current_dds = &(global_dd[gid]);
+	current_dds = &(global_dd[DD_CELL(gid)]);
+	dd_dir = 0;
 
-	*current_dds = dd1;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd0;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd3;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd2;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd1);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd0);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd3);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd2);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd5;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd4;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd7;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd6;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd5);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd4);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd7);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd6);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd9;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd8;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd11;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd10;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd9);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd8);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd11);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd10);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd13;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd12;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd15;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd14;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd13);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd12);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd15);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd14);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd17;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd16;	current_dds += DOMAIN_CELLS;
-	*current_dds = dd18;
+	DD_STORE(current_dds, 0, dd_dir, dd17);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd16);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd18);
 
 
 
@@ -406,18 +397,23 @@ __kernel void kernel_lbm_alpha(
 
 	new_fluid_fraction_array[gid] = fluid_fraction;
 	new_flag_array[gid] = flag;
+	STORE_NEW_CELL_STATE(gid, flag, fluid_fraction);
 
 	/*
-	 * store velocity
+	 * store velocity and density
+	 * with LAZY_MACROSCOPIC only for the cells which are read by the next simulation step
 	 */
-	current_dds = &velocity_array[gid];
-	*current_dds = velocity_x;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_y;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_z;
-
-	/*
-	 * store density
-	 * this is useful for recomputation of dd's from gas cells streaming to interface cells
-	 */
-	density_array[gid] = rho;
+	if (STORE_MACROSCOPIC(flag))
+	{
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
+
+		/*
+		 * store density
+		 * this is useful for recomputation of dd's from gas cells streaming to interface cells
+		 */
+		density_array[gid] = rho;
+	}
 }
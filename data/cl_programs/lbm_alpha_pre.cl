@@ -13,7 +13,7 @@
 
 
 __kernel void kernel_lbm_alpha_pre(
-			__global T *global_dd,			// 0) density distributions
+			__global DD_T *global_dd,		// 0) density distributions
 			__global int *flag_array,		// 1) flags
 			__global T *velocity_array,		// 2) velocities
 			__global T *density_array,		// 3) densities
@@ -21,10 +21,13 @@ __kernel void kernel_lbm_alpha_pre(
 			__global T *fluid_mass_array,	// 4) fluid mass
 			__global T *fluid_fraction_array,	// 5) fluid fraction
 
-			__const T mass_exchange_factor
+			__constant T *params					// 6) simulation parameters (PARAM_* indices)
+			ACTIVE_TILES_KERNEL_ARG			// 7) active tile list (only with ACTIVE_TILES)
 		)
 {
-	const size_t gid = get_global_id(0);
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	const size_t gid = GET_PADDED_CELL_ID();
 	const size_t lid = get_local_id(0);
 
 	int flag = flag_array[gid];
@@ -39,7 +42,19 @@ __kernel void kernel_lbm_alpha_pre(
 // EVEN GAS THREADS HAVE TO LOAD DATA FOR ADJACENT THREADS
 //	if (flag & (FLAG_INTERFACE | FLAG_FLUID))
 	{
-#if (LOCAL_WORK_GROUP_SIZE/DOMAIN_CELLS_X)*DOMAIN_CELLS_X == LOCAL_WORK_GROUP_SIZE
+#if ACTIVE_TILES || CELL_BRICK_SIZE
+		/*
+		 * the work items of a work group are not adjacent in x direction if the kernel
+		 * is launched over the active tile list or if the cells are stored in bricks.
+		 * thus each work item loads the dds from it's own x-neighbors and the local
+		 * buffer is accessed only at lid.
+		 */
+		int pos_x_wrap = lid;
+		int neg_x_wrap = lid;
+
+		int read_delta_neg_x = NEIGHBOR_CELL(gid, -1, 0, 0);
+		int read_delta_pos_x = NEIGHBOR_CELL(gid, 1, 0, 0);
+#elif (LOCAL_WORK_GROUP_SIZE/DOMAIN_CELLS_X)*DOMAIN_CELLS_X == LOCAL_WORK_GROUP_SIZE
 		/*
 		 * handle domain x-sizes specially if LOCAL_WORK_GROUP_SIZE is a multiple of DOMAIN_CELLS_X
 		 * in this case, we dont have to read any unaligned data!!!
@@ -68,6 +83,7 @@ __kernel void kernel_lbm_alpha_pre(
 		int neighbor_flag;
 
 		T fluid_fraction = fluid_fraction_array[gid];
+		fluid_fraction = QUANTIZE_CELL_FRACTION(fluid_fraction);
 
 		/*
 		 * +++++++++++
@@ -79,38 +95,39 @@ __kernel void kernel_lbm_alpha_pre(
 		 * preload to alignment buffer
 		 */
 
-		__global T *current_dds = global_dd;
+		__global DD_T *current_dds = global_dd;
+		int dd_dir = 0;
 		dd_buf_lid = &dd_buf[0][lid];
 
 		/*
 		 * pointer to current dd buf entry with index lid
 		 */
 
-		*dd_buf_lid = current_dds[dd_write_delta_position_0];		current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-		*dd_buf_lid = current_dds[dd_write_delta_position_1];	current_dds += DOMAIN_CELLS;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_0), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_1), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 		barrier(CLK_LOCAL_MEM_FENCE);
 
 		ddx = dd_buf[0][pos_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 0, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		T fluid_mass = -ddx*ffx;
 
 		ddx = dd_buf[1][neg_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 0, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
-		ddx = current_dds[dd_write_delta_position_2];		current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_2), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 1, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
-		ddx = current_dds[dd_write_delta_position_3];		current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_3), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, -1, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
@@ -123,33 +140,33 @@ __kernel void kernel_lbm_alpha_pre(
 		 */
 		dd_buf_lid = &dd_buf[0][lid];
 
-		*dd_buf_lid = current_dds[dd_write_delta_position_4];	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-		*dd_buf_lid = current_dds[dd_write_delta_position_5];	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-		*dd_buf_lid = current_dds[dd_write_delta_position_6];	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-		*dd_buf_lid = current_dds[dd_write_delta_position_7];	current_dds += DOMAIN_CELLS;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_4), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_5), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_6), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_7), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 		barrier(CLK_LOCAL_MEM_FENCE);
 
 		ddx = dd_buf[0][pos_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 1, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 1, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
 		ddx = dd_buf[1][neg_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, -1, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, -1, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
 		ddx = dd_buf[2][pos_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, -1, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, -1, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
 		ddx = dd_buf[3][neg_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 1, 0)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 1, 0)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
@@ -162,33 +179,33 @@ __kernel void kernel_lbm_alpha_pre(
 		 */
 		dd_buf_lid = &dd_buf[0][lid];
 
-		*dd_buf_lid = current_dds[dd_write_delta_position_8];	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-		*dd_buf_lid = current_dds[dd_write_delta_position_9];	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-		*dd_buf_lid = current_dds[dd_write_delta_position_10];	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-		*dd_buf_lid = current_dds[dd_write_delta_position_11];	current_dds += DOMAIN_CELLS;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_8), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_9), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_10), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+		*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_11), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 		barrier(CLK_LOCAL_MEM_FENCE);
 
 		ddx = dd_buf[0][pos_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, 1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 0, 1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
 		ddx = dd_buf[1][neg_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, -1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 0, -1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
 		ddx = dd_buf[2][pos_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, -1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 0, -1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
 		ddx = dd_buf[3][neg_x_wrap];
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, 1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 0, 1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
@@ -201,27 +218,27 @@ __kernel void kernel_lbm_alpha_pre(
 		 * dd3: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
 		 */
 
-		ddx = current_dds[dd_write_delta_position_12];	current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_12), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, 1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 1, 1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
-		ddx = current_dds[dd_write_delta_position_13];	current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_13), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, -1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, -1, -1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
-		ddx = current_dds[dd_write_delta_position_14];	current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_14), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, -1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 1, -1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
-		ddx = current_dds[dd_write_delta_position_15];	current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_15), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, 1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, -1, 1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
@@ -233,24 +250,27 @@ __kernel void kernel_lbm_alpha_pre(
 		 *
 		 * dd4: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
 		 */
-		ddx = current_dds[dd_write_delta_position_16];	current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_16), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 0, 1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 0, 1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
-		ddx = current_dds[dd_write_delta_position_17];	current_dds += DOMAIN_CELLS;
-		ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
-		neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
+		ddx = DD_LOAD(current_dds, DD_CELL(dd_write_delta_position_17), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+		ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 0, -1)]);
+		neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 0, -1)];
 		GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 		fluid_mass -= ddx*ffx;
 
 		// compute new fluid mass
+		if (DOMAIN_RANGE_STORE())
+		{
 #if ACTIVATE_INCREASED_MASS_EXCHANGE
-		fluid_mass_array[gid] = fluid_mass_array[gid] + mass_exchange_factor*fluid_mass;
+			fluid_mass_array[gid] = fluid_mass_array[gid] + mass_exchange_factor*fluid_mass;
 #else
-		fluid_mass_array[gid] = fluid_mass_array[gid] + fluid_mass;
+			fluid_mass_array[gid] = fluid_mass_array[gid] + fluid_mass;
 #endif
+		}
 
 	}
 }
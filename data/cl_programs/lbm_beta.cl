@@ -7,34 +7,37 @@
 
 
 __kernel void kernel_beta(
-		__global T *global_dd,			// 0) density distributions
+		__global DD_T *global_dd,		// 0) density distributions
 		__global int *flag_array,		// 1) flags
 		__global T *velocity_array,		// 2) velocities
 		__global T *density_array,		// 3) densities
-		__const T inv_tau,								// 4) "weight" for collision function
-		__const T inv_trt_tau,							// 5) "weight" for TRT collision model
+		__constant T *params,				// 4) simulation parameters (PARAM_* indices)
 
-		__global T *fluid_mass_array,		// 6) fluid mass
-		__global T *fluid_fraction_array,	// 7) fluid fraction
+		__global T *fluid_mass_array,		// 5) fluid mass
+		__global T *fluid_fraction_array,	// 6) fluid fraction
 
-		__global int *new_flag_array,		// 8) NEW flags
-		__global T *new_fluid_fraction_array,	// 9) NEW fluid fraction
-
-		__const T gravitation0,							// 10) gravitation
-		__const T gravitation1,
-		__const T gravitation2,
-
-		__const T mass_exchange_factor					// 13) mass exchange factor
+		__global int *new_flag_array,		// 7) NEW flags
+		__global T *new_fluid_fraction_array	// 8) NEW fluid fraction
+		ACTIVE_TILES_KERNEL_ARG			// 9) active tile list (only with ACTIVE_TILES)
+		CELL_STATE_KERNEL_ARG			// 10) packed cell state, 11) NEW packed cell state (only with CELL_STATE)
 )
 {
-	const size_t gid = get_global_id(0);
-	const size_t lid = get_local_id(0);
+	const T inv_tau = params[PARAM_INV_TAU];
+	const T inv_trt_tau = params[PARAM_INV_TRT_TAU];
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
 
-	// load cell type flag
-	int flag = flag_array[gid];
+	DOMAIN_RANGE_CHECK();
 
-	// load fluid fraction
-	T fluid_fraction = fluid_fraction_array[gid];
+	const size_t gid = GET_CELL_ID();
+	const size_t lid = get_local_id(0);
+
+	// load cell type flag and fluid fraction
+	int flag;
+	T fluid_fraction;
+	LOAD_CELL_STATE(gid, fluid_fraction, flag);
 
 #if !USE_SHARED_MEMORY
 //	we must not return for gas cells because those threads may load the data for another thread!!!
@@ -44,6 +47,7 @@ __kernel void kernel_beta(
 		new_flag_array[gid] = FLAG_GAS;
 //		new_fluid_fraction_array[gid] = fluid_fraction;
 		new_fluid_fraction_array[gid] = 0.0f;
+		STORE_NEW_CELL_STATE(gid, FLAG_GAS, 0.0f);
 		return;
 	}
 #endif
@@ -92,6 +96,9 @@ __kernel void kernel_beta(
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 	int neighbor_flag0, neighbor_flag1;
+#if LAZY_MACROSCOPIC
+	int macroscopic_neighbor_flags = 0;	// all flags of the neighbors (see STORE_MACROSCOPIC)
+#endif
 
 
 #if !USE_SHARED_MEMORY
@@ -99,18 +106,17 @@ __kernel void kernel_beta(
 	/*
 	 * pointer to density distributions
 	 */
-	__global T *current_dds = &global_dd[0];
+	__global DD_T *current_dds = &global_dd[DD_CELL(0)];
+	int dd_dir = 0;
 
 	/*
 	 * dd 0-3: f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0)
 	 */
-	dd1 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X)];	current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
+	dd1 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 0, 0), ff1, neighbor_flag1);
 
-	dd0 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X)];	current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
+	dd0 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 0, 0), ff0, neighbor_flag0);
 
 	reconstruct_dd_01(flag, fluid_fraction, dd0, neighbor_flag0, ff0, dd1, neighbor_flag1, ff1, old_velocity_x, dd_param, dd_rho);
 
@@ -126,13 +132,11 @@ __kernel void kernel_beta(
 	T rhob = dd1;
 	velocity_x -= dd1;
 
-	dd3 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y)];		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
+	dd3 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 0)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 1, 0), ff1, neighbor_flag1);
 
-	dd2 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y)];		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
+	dd2 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 0)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, -1, 0), ff0, neighbor_flag0);
 
 	reconstruct_dd_01(flag, fluid_fraction, dd2, neighbor_flag0, ff0, dd3, neighbor_flag1, ff1, old_velocity_y, dd_param, dd_rho);
 
@@ -149,13 +153,11 @@ __kernel void kernel_beta(
 	 */
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	dd5 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
+	dd5 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 1, 0)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 1, 0), ff1, neighbor_flag1);
 
-	dd4 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
+	dd4 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, -1, 0)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, -1, 0), ff0, neighbor_flag0);
 
 	tmp = old_velocity_x+old_velocity_y;
 	reconstruct_dd_45(flag, fluid_fraction, dd4, neighbor_flag0, ff0, dd5, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -170,13 +172,11 @@ __kernel void kernel_beta(
 	velocity_x -= dd5;
 	velocity_y -= dd5;
 
-	dd7 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
+	dd7 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, -1, 0)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, -1, 0), ff1, neighbor_flag1);
 
-	dd6 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
+	dd6 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 1, 0)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 1, 0), ff0, neighbor_flag0);
 
 	tmp = old_velocity_x-old_velocity_y;
 	reconstruct_dd_45(flag, fluid_fraction, dd6, neighbor_flag0, ff0, dd7, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -194,13 +194,11 @@ __kernel void kernel_beta(
 	/*
 	 * dd 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
 	 */
-	dd9 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
+	dd9 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 1)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 0, 1), ff1, neighbor_flag1);
 
-	dd8 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
+	dd8 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, -1)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 0, -1), ff0, neighbor_flag0);
 
 	tmp = old_velocity_x+old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd8, neighbor_flag0, ff0, dd9, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -215,13 +213,11 @@ __kernel void kernel_beta(
 	velocity_x -= dd9;
 	velocity_z -= dd9;
 
-	dd11 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
+	dd11 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, -1)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 1, 0, -1), ff1, neighbor_flag1);
 
-	dd10 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
+	dd10 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 1)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, -1, 0, 1), ff0, neighbor_flag0);
 
 	tmp = old_velocity_x-old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd10, neighbor_flag0, ff0, dd11, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -239,13 +235,11 @@ __kernel void kernel_beta(
 	/*
 	 * dd 12-15: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
 	 */
-	dd13 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];	current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
+	dd13 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 1, 1), ff1, neighbor_flag1);
 
-	dd12 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];	current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
+	dd12 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, -1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, -1, -1), ff0, neighbor_flag0);
 
 	tmp = old_velocity_y+old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd12, neighbor_flag0, ff0, dd13, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -260,13 +254,11 @@ __kernel void kernel_beta(
 	velocity_y -= dd13;
 	velocity_z -= dd13;
 
-	dd15 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];	current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
+	dd15 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, -1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 1, -1), ff1, neighbor_flag1);
 
-	dd14 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];	current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
+	dd14 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, -1, 1), ff0, neighbor_flag0);
 
 	tmp = old_velocity_y-old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd14, neighbor_flag0, ff0, dd15, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -284,13 +276,11 @@ __kernel void kernel_beta(
 	/*
 	 * dd 16-18: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
 	 */
-	dd17 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Z)];		current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
-	neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
+	dd17 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, 1)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 0, 1), ff1, neighbor_flag1);
 
-	dd16 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Z)];		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
-	neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
+	dd16 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, -1)), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	LOAD_CELL_STATE(NEIGHBOR_CELL(gid, 0, 0, -1), ff0, neighbor_flag0);
 
 	reconstruct_dd_01(flag, fluid_fraction, dd16, neighbor_flag0, ff0, dd17, neighbor_flag1, ff1, old_velocity_z, dd_param, dd_rho);
 
@@ -302,7 +292,7 @@ __kernel void kernel_beta(
 	rhob += dd17;
 	velocity_z -= dd17;
 
-	dd18 = current_dds[gid];
+	dd18 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
 	rhoc += dd18;
 
 #else
@@ -403,25 +393,26 @@ __kernel void kernel_beta(
 	/*
 	 * pointer to density distributions
 	 */
-	__global T *current_dds = &(global_dd[0][0]);
+	__global DD_T *current_dds = &(global_dd[0][0]);
+	int dd_dir = 0;
 	// DD0 STUFF
-	*dd_buf_lid = current_dds[read_delta_pos_x];		current_dds += DOMAIN_CELLS;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
-	*dd_buf_lid = current_dds[read_delta_neg_x];		current_dds += DOMAIN_CELLS;	dd_buf_lid += 5*LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(read_delta_pos_x), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(read_delta_neg_x), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += 5*LOCAL_WORK_GROUP_SIZE;
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 	dd0 = dd_buf[0][neg_x_wrap];
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, 0)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, -1, 0, 0)];
 
 	dd1 = dd_buf[1][pos_x_wrap];
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, 0)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 1, 0, 0)];
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 	reconstruct_dd_01(flag, fluid_fraction, dd0, neighbor_flag0, ff0, dd1, neighbor_flag1, ff1, old_velocity_x, dd_param, dd_rho);
@@ -442,23 +433,23 @@ __kernel void kernel_beta(
 #if CACHED_ACCESS
 	dd_read_delta_position_3 = dd_read_delta_position_3x;
 #endif
-	dd3 = current_dds[dd_read_delta_position_3];		current_dds += DOMAIN_CELLS;
+	dd3 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_3), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, 0)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 0, 1, 0)];
 
 #if CACHED_ACCESS
 	dd_read_delta_position_2 = dd_read_delta_position_2x;
 #endif
-	dd2 = current_dds[dd_read_delta_position_2];		current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
+	dd2 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_2), dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, 0)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, 0, -1, 0)];
 
 	reconstruct_dd_01(flag, fluid_fraction, dd2, neighbor_flag0, ff0, dd3, neighbor_flag1, ff1, old_velocity_y, dd_param, dd_rho);
 
@@ -476,38 +467,38 @@ __kernel void kernel_beta(
 #if CACHED_ACCESS
 	dd_read_delta_position_5 = dd_read_delta_position_5x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_5];	current_dds += DOMAIN_CELLS;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_5), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
 
 #if CACHED_ACCESS
 	dd_read_delta_position_4 = dd_read_delta_position_4x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_4];	current_dds += DOMAIN_CELLS;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_4), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
 
 #if CACHED_ACCESS
 	dd_read_delta_position_7 = dd_read_delta_position_7x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_7];	current_dds += DOMAIN_CELLS;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_7), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
 
 #if CACHED_ACCESS
 	dd_read_delta_position_6 = dd_read_delta_position_6x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_6];	current_dds += DOMAIN_CELLS;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_6), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 	dd4 = dd_buf[4][neg_x_wrap];
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, -1, -1, 0)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, -1, -1, 0)];
 
 	dd5 = dd_buf[5][pos_x_wrap];
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 1, 0)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 1, 1, 0)];
 
 	tmp = old_velocity_x+old_velocity_y;
 	reconstruct_dd_45(flag, fluid_fraction, dd4, neighbor_flag0, ff0, dd5, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -523,18 +514,18 @@ __kernel void kernel_beta(
 	velocity_y -= dd5;
 
 	dd6 = dd_buf[6][neg_x_wrap];
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 1, 0)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, -1, 1, 0)];
 
 	dd7 = dd_buf[7][pos_x_wrap];
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 1, -1, 0)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 1, -1, 0)];
 
 	tmp = old_velocity_x-old_velocity_y;
 	reconstruct_dd_45(flag, fluid_fraction, dd6, neighbor_flag0, ff0, dd7, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -556,38 +547,38 @@ __kernel void kernel_beta(
 #if CACHED_ACCESS
 	dd_read_delta_position_9 = dd_read_delta_position_9x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_9];	current_dds += DOMAIN_CELLS;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_9), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
 
 #if CACHED_ACCESS
 	dd_read_delta_position_8 = dd_read_delta_position_8x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_8];	current_dds += DOMAIN_CELLS;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_8), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
 
 #if CACHED_ACCESS
 	dd_read_delta_position_11 = dd_read_delta_position_11x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_11];	current_dds += DOMAIN_CELLS;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_11), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid -= LOCAL_WORK_GROUP_SIZE;
 
 #if CACHED_ACCESS
 	dd_read_delta_position_10 = dd_read_delta_position_10x;
 #endif
-	*dd_buf_lid = current_dds[dd_read_delta_position_10];	current_dds += DOMAIN_CELLS;
+	*dd_buf_lid = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_10), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 	dd8 = dd_buf[8][neg_x_wrap];
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, -1)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, -1, 0, -1)];
 
 	dd9 = dd_buf[9][pos_x_wrap];
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, 1)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 1, 0, 1)];
 
 	tmp = old_velocity_x+old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd8, neighbor_flag0, ff0, dd9, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -603,18 +594,18 @@ __kernel void kernel_beta(
 	velocity_z -= dd9;
 
 	dd10 = dd_buf[10][neg_x_wrap];
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, 1)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, -1, 0, 1)];
 
 	dd11 = dd_buf[11][pos_x_wrap];
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, -1)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 1, 0, -1)];
 
 	tmp = old_velocity_x-old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd10, neighbor_flag0, ff0, dd11, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -638,22 +629,22 @@ __kernel void kernel_beta(
 #if CACHED_ACCESS
 	dd_read_delta_position_13 = dd_read_delta_position_13x;
 #endif
-	dd13 = current_dds[dd_read_delta_position_13];	current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
+	dd13 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_13), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, 1)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 0, 1, 1)];
 
 #if CACHED_ACCESS
 	dd_read_delta_position_12 = dd_read_delta_position_12x;
 #endif
-	dd12 = current_dds[dd_read_delta_position_12];	current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
+	dd12 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_12), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, -1)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, 0, -1, -1)];
 
 	tmp = old_velocity_y+old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd12, neighbor_flag0, ff0, dd13, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -672,22 +663,22 @@ __kernel void kernel_beta(
 #if CACHED_ACCESS
 	dd_read_delta_position_15 = dd_read_delta_position_15x;
 #endif
-	dd15 = current_dds[dd_read_delta_position_15];	current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
+	dd15 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_15), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, -1)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 0, 1, -1)];
 
 #if CACHED_ACCESS
 	dd_read_delta_position_14 = dd_read_delta_position_14x;
 #endif
-	dd14 = current_dds[dd_read_delta_position_14];	current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
+	dd14 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_14), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, 1)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, 0, -1, 1)];
 
 	tmp = old_velocity_y-old_velocity_z;
 	reconstruct_dd_45(flag, fluid_fraction, dd14, neighbor_flag0, ff0, dd15, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
@@ -708,22 +699,22 @@ __kernel void kernel_beta(
 #if CACHED_ACCESS
 	dd_read_delta_position_17 = dd_read_delta_position_17x;
 #endif
-	dd17 = current_dds[dd_read_delta_position_17];	current_dds += DOMAIN_CELLS;
-	ff1 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
+	dd17 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_17), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ff1 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 0, 1)];
 //	if (ff1 == -1024.0f)
 //		neighbor_flag1 = FLAG_GAS;
 //	else
-		neighbor_flag1 = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
+		neighbor_flag1 = flag_array[NEIGHBOR_CELL(gid, 0, 0, 1)];
 
 #if CACHED_ACCESS
 	dd_read_delta_position_16 = dd_read_delta_position_16x;
 #endif
-	dd16 = current_dds[dd_read_delta_position_16];	current_dds += DOMAIN_CELLS;
-	ff0 = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
+	dd16 = DD_LOAD(current_dds, DD_CELL(dd_read_delta_position_16), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ff0 = fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 0, -1)];
 //	if (ff0 == -1024.0f)
 //		neighbor_flag0 = FLAG_GAS;
 //	else
-		neighbor_flag0 = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
+		neighbor_flag0 = flag_array[NEIGHBOR_CELL(gid, 0, 0, -1)];
 
 	reconstruct_dd_01(flag, fluid_fraction, dd16, neighbor_flag0, ff0, dd17, neighbor_flag1, ff1, old_velocity_z, dd_param, dd_rho);
 
@@ -735,7 +726,7 @@ __kernel void kernel_beta(
 	rhob += dd17;
 	velocity_z -= dd17;
 
-	dd18 = current_dds[gid];
+	dd18 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
 	rhoc += dd18;
 
 #endif
@@ -788,7 +779,8 @@ __kernel void kernel_beta(
 
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	current_dds = &global_dd[0];
+	current_dds = &global_dd[DD_CELL(0)];
+	dd_dir = 0;
 #if USE_SHARED_MEMORY
 	dd_buf_lid = &dd_buf[0][lid];
 
@@ -797,10 +789,10 @@ __kernel void kernel_beta(
 	dd_buf[1][neg_x_wrap] = dd1;
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	current_dds[dd_write_delta_position_0] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_1] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_2] = dd2;	current_dds += DOMAIN_CELLS;
-	current_dds[dd_write_delta_position_3] = dd3;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_0), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_1), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += 3*LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_2), dd_dir, dd2);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_3), dd_dir, dd3);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0) */
 	dd_buf_lid = &dd_buf[0][lid];
@@ -810,10 +802,10 @@ __kernel void kernel_beta(
 	dd_buf[3][neg_x_wrap] = dd7;
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	current_dds[dd_write_delta_position_4] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_5] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_6] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_7] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_4), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_5), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_6), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_7), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
 
 	/* f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1) */
 	dd_buf_lid = &dd_buf[0][lid];
@@ -823,51 +815,51 @@ __kernel void kernel_beta(
 	dd_buf[3][neg_x_wrap] = dd11;
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	current_dds[dd_write_delta_position_8] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_9] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_10] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
-	current_dds[dd_write_delta_position_11] = *dd_buf_lid;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_8), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_9), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_10), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;	dd_buf_lid += LOCAL_WORK_GROUP_SIZE;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_11), dd_dir, *dd_buf_lid);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1) */
-	current_dds[dd_write_delta_position_12] = dd12;	current_dds += DOMAIN_CELLS;
-	current_dds[dd_write_delta_position_13] = dd13;	current_dds += DOMAIN_CELLS;
-	current_dds[dd_write_delta_position_14] = dd14;	current_dds += DOMAIN_CELLS;
-	current_dds[dd_write_delta_position_15] = dd15;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_12), dd_dir, dd12);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_13), dd_dir, dd13);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_14), dd_dir, dd14);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_15), dd_dir, dd15);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(0,0,1), f(0,0,-1),  f(0,0,0) */
-	current_dds[dd_write_delta_position_16] = dd16;	current_dds += DOMAIN_CELLS;
-	current_dds[dd_write_delta_position_17] = dd17;	current_dds += DOMAIN_CELLS;
-	current_dds[gid] = dd18;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_16), dd_dir, dd16);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(dd_write_delta_position_17), dd_dir, dd17);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(gid), dd_dir, dd18);
 #else
 
 	/* f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X)] = dd0;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X)] = dd1;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y)] = dd2;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y)] = dd3;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 0)), dd_dir, dd0);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 0)), dd_dir, dd1);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 0)), dd_dir, dd2);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 0)), dd_dir, dd3);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)] = dd4;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)] = dd5;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)] = dd6;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)] = dd7;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 1, 0)), dd_dir, dd4);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, -1, 0)), dd_dir, dd5);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, -1, 0)), dd_dir, dd6);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 1, 0)), dd_dir, dd7);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)] = dd8;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)] = dd9;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)] = dd10;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)] = dd11;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 1)), dd_dir, dd8);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, -1)), dd_dir, dd9);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, -1)), dd_dir, dd10);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 1)), dd_dir, dd11);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)] = dd12;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)] = dd13;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)] = dd14;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)] = dd15;	current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 1)), dd_dir, dd12);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, -1)), dd_dir, dd13);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, -1)), dd_dir, dd14);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 1)), dd_dir, dd15);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* f(0,0,1), f(0,0,-1),  f(0,0,0) */
-	current_dds[DOMAIN_WRAP(gid + DELTA_POS_Z)] = dd16;	current_dds += DOMAIN_CELLS;
-	current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Z)] = dd17;	current_dds += DOMAIN_CELLS;
-	current_dds[gid] = dd18;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, 1)), dd_dir, dd16);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, -1)), dd_dir, dd17);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, DD_CELL(gid), dd_dir, dd18);
 #endif
 
 
@@ -913,18 +905,23 @@ __kernel void kernel_beta(
 
 	new_fluid_fraction_array[gid] = fluid_fraction;
 	new_flag_array[gid] = flag;
+	STORE_NEW_CELL_STATE(gid, flag, fluid_fraction);
 
 	/*
-	 * store velocity
+	 * store velocity and density
+	 * with LAZY_MACROSCOPIC only for the cells which are read by the next simulation step
 	 */
-	current_dds = &velocity_array[gid];
-	*current_dds = velocity_x;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_y;	current_dds += DOMAIN_CELLS;
-	*current_dds = velocity_z;
-
-	/*
-	 * store density
-	 * this is useful for recomputation of dd's from gas cells streaming to interface cells
-	 */
-	density_array[gid] = rho;
+	if (STORE_MACROSCOPIC(flag))
+	{
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
+
+		/*
+		 * store density
+		 * this is useful for recomputation of dd's from gas cells streaming to interface cells
+		 */
+		density_array[gid] = rho;
+	}
 }
@@ -2,7 +2,7 @@
 
 
 __kernel void kernel_beta_pre(
-			__global T *global_dd,			// 0) density distributions
+			__global DD_T *global_dd,		// 0) density distributions
 			__global int *flag_array,		// 1) flags
 			__global T *velocity_array,		// 2) velocities
 			__global T *density_array,		// 3) densities
@@ -10,18 +10,24 @@ __kernel void kernel_beta_pre(
 			__global T *fluid_mass_array,	// 4) fluid mass
 			__global T *fluid_fraction_array,	// 5) fluid fraction
 
-			__const T mass_exchange_factor
+			__constant T *params					// 6) simulation parameters (PARAM_* indices)
+			ACTIVE_TILES_KERNEL_ARG			// 7) active tile list (only with ACTIVE_TILES)
 		)
 {
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
 
-	const size_t gid = get_global_id(0);
+
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = GET_CELL_ID();
 
 	int flag = flag_array[gid];
 
 	T velocity_x, velocity_y, velocity_z;
 	T count;
 	size_t dd_index;
-	__global T *current_dds;
+	__global DD_T *current_dds;
+	int dd_dir;
 	T fluid_fraction;
 
 	T ffx;
@@ -35,9 +41,11 @@ __kernel void kernel_beta_pre(
 	 * MASS EXCHANGE (outgoing mass)
 	 */
 	// pointer to density distributions
-	current_dds = &global_dd[gid];
+	current_dds = &global_dd[DD_CELL(gid)];
+	dd_dir = 0;
 
 	fluid_fraction = fluid_fraction_array[gid];
+	fluid_fraction = QUANTIZE_CELL_FRACTION(fluid_fraction);
 
 	// +++++++++++
 	// +++ DD0 +++
@@ -51,27 +59,27 @@ __kernel void kernel_beta_pre(
 	 * dd0 and the cell flag of the right cell
 	 */
 	// dd0
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 0, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	T fluid_mass = -ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 0, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, -1, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 1, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
@@ -81,27 +89,27 @@ __kernel void kernel_beta_pre(
 	//
 
 	// 4-7: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, -1, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, -1, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 1, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 1, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 1, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 1, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, -1, 0)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, -1, 0)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
@@ -111,27 +119,27 @@ __kernel void kernel_beta_pre(
 	//
 
 	// 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, -1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 0, -1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, 1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 0, 1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, -1, 0, 1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, -1, 0, 1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 1, 0, -1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 1, 0, -1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
@@ -141,28 +149,28 @@ __kernel void kernel_beta_pre(
 
 
 	// dd3: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, -1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, -1, -1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, 1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 1, 1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, -1, 1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, -1, 1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 1, -1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 1, -1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
@@ -171,15 +179,15 @@ __kernel void kernel_beta_pre(
 	// +++++++++++
 	//
 	// dd4: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_NEG_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 0, -1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 0, -1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
-	ddx = *current_dds;		current_dds += DOMAIN_CELLS;
-	ffx = fluid_fraction_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
-	neighbor_flag = flag_array[DOMAIN_WRAP(gid + DELTA_POS_Z)];
+	ddx = DD_LOAD(current_dds, 0, dd_dir);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	ffx = QUANTIZE_CELL_FRACTION(fluid_fraction_array[NEIGHBOR_CELL(gid, 0, 0, 1)]);
+	neighbor_flag = flag_array[NEIGHBOR_CELL(gid, 0, 0, 1)];
 	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);
 	fluid_mass -= ddx*ffx;
 
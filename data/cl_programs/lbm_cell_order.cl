@@ -0,0 +1,29 @@
+/**
+ * conversion of the cell buffers to the linear cell ordering
+ *
+ * used with CELL_BRICK_SIZE > 0 to hand out linear data to the host and to the visualization.
+ * the values are copied as words of 32 bits, thus the kernel can be used for any value type.
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+__kernel void kernel_cell_order_to_linear(
+		__global const uint *values,		// 0) values in cell ordering (components are stored with a stride of DOMAIN_CELLS)
+		__global uint *linear_values,		// 1) values in linear ordering
+		const int components,				// 2) number of components of each value
+		const int words						// 3) number of 32 bit words of each component
+)
+{
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	const size_t x = gid % DOMAIN_CELLS_X;
+	const size_t y = (gid / DOMAIN_CELLS_X) % DOMAIN_CELLS_Y;
+	const size_t z = gid / DOMAIN_SLICE_CELLS;
+
+	const size_t cell_id = CELL_ID(x, y, z);
+
+	for (int c = 0; c < components; c++)
+		for (int w = 0; w < words; w++)
+			linear_values[(gid + c*DOMAIN_CELLS)*words + w] = values[(cell_id + c*DOMAIN_CELLS)*words + w];
+}
@@ -11,10 +11,13 @@
 #include "data/cl_programs/lbm_inc_header.h"
 
 __kernel void kernel_debug_alpha_propagation(
-			__global T global_dd[19*DOMAIN_CELLS],
-			__global T new_global_dd[19*DOMAIN_CELLS]
+			__global DD_T global_dd[19*DOMAIN_CELLS],
+			__global DD_T new_global_dd[19*DOMAIN_CELLS]
 		)
 {
+	// no data is exchanged in local memory, thus the work items beyond the domain return immediately
+	DOMAIN_RANGE_CHECK();
+
 	const size_t gid = get_global_id(0);
 	const size_t lid = get_local_id(0);
 
@@ -44,13 +47,14 @@ __kernel void kernel_debug_alpha_propagation(
 	/*
 	 * pointer to density distributions
 	 */
-	__global T *current_dds = &global_dd[0];
+	__global DD_T *current_dds = &global_dd[DD_CELL(0)];
+	int dd_dir = 0;
 
 	// DD0 STUFF
-	dd1 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X)];	current_dds += DOMAIN_CELLS;
-	dd0 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X)];	current_dds += DOMAIN_CELLS;
-	dd3 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y)];	current_dds += DOMAIN_CELLS;
-	dd2 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y)];	current_dds += DOMAIN_CELLS;
+	dd1 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd0 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd3 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd2 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* +++++++++++
 	 * +++ DD1 +++
@@ -59,10 +63,10 @@ __kernel void kernel_debug_alpha_propagation(
 	 * dd1: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
 	 */
 
-	dd5 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y)];	current_dds += DOMAIN_CELLS;
-	dd4 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y)];	current_dds += DOMAIN_CELLS;
-	dd7 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y)];	current_dds += DOMAIN_CELLS;
-	dd6 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y)];	current_dds += DOMAIN_CELLS;
+	dd5 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 1, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd4 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, -1, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd7 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, -1, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd6 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 1, 0)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/* +++++++++++
 	 * +++ DD2 +++
@@ -71,10 +75,10 @@ __kernel void kernel_debug_alpha_propagation(
 	 * dd2: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
 	 */
 
-	dd9 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z)];	current_dds += DOMAIN_CELLS;
-	dd8 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z)];	current_dds += DOMAIN_CELLS;
-	dd11 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z)];	current_dds += DOMAIN_CELLS;
-	dd10 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z)];	current_dds += DOMAIN_CELLS;
+	dd9 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, 1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd8 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, -1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd11 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 1, 0, -1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd10 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, -1, 0, 1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	// +++++++++++
 	// +++ DD3 +++
@@ -82,10 +86,10 @@ __kernel void kernel_debug_alpha_propagation(
 
 	// dd3: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
 
-	dd13 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)];	current_dds += DOMAIN_CELLS;
-	dd12 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)];	current_dds += DOMAIN_CELLS;
-	dd15 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)];	current_dds += DOMAIN_CELLS;
-	dd14 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)];	current_dds += DOMAIN_CELLS;
+	dd13 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, 1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd12 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, -1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd15 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 1, -1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd14 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, -1, 1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/*
 	 * +++++++++++
@@ -95,36 +99,37 @@ __kernel void kernel_debug_alpha_propagation(
 	 * dd4: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
 	 */
 
-	dd17 = current_dds[DOMAIN_WRAP(gid + DELTA_POS_Z)];	current_dds += DOMAIN_CELLS;
-	dd16 = current_dds[DOMAIN_WRAP(gid + DELTA_NEG_Z)];	current_dds += DOMAIN_CELLS;
+	dd17 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, 1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
+	dd16 = DD_LOAD(current_dds, DD_CELL(NEIGHBOR_CELL(gid, 0, 0, -1)), dd_dir);	current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	dd18 = current_dds[gid];
+	dd18 = DD_LOAD(current_dds, DD_CELL(gid), dd_dir);
 
 ////////////////////////////////////////////////////////
 
-	current_dds = &new_global_dd[gid];
+	current_dds = &new_global_dd[DD_CELL(gid)];
+	dd_dir = 0;
 
-	*current_dds = dd0;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd1;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd2;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd3;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd0);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd1);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd2);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd3);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd4;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd5;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd6;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd7;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd4);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd5);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd6);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd7);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd8;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd9;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd10;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd11;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd8);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd9);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd10);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd11);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd12;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd13;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd14;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd15;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, 0, dd_dir, dd12);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd13);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd14);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd15);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
-	*current_dds = dd16;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd17;		current_dds += DOMAIN_CELLS;
-	*current_dds = dd18;
+	DD_STORE(current_dds, 0, dd_dir, dd16);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd17);		current_dds += DD_DIR_STRIDE;	dd_dir++;
+	DD_STORE(current_dds, 0, dd_dir, dd18);
 }
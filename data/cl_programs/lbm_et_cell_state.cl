@@ -0,0 +1,66 @@
+#include "data/cl_programs/lbm_inc_header.h"
+
+#if !IN_PLACE_CELL_STATE
+	#error "this kernel requires IN_PLACE_CELL_STATE"
+#endif
+
+#if DISTRIBUTE_MASS_OF_GAS_CELLS
+	// the fluid fraction buffer of the next timestep is used as temporary buffer to distribute the mass
+	#error "DISTRIBUTE_MASS_OF_GAS_CELLS is not supported with IN_PLACE_CELL_STATE"
+#endif
+
+/**
+ * update the flag and the fluid fraction of each cell in place
+ *
+ * the collision kernel (lbm_et_coll_prop.cl) reads the flags and fluid fractions of the adjacent
+ * cells, thus it does not overwrite them with IN_PLACE_CELL_STATE. after the collision kernel
+ * finished, this kernel computes the new values from the fluid mass and density of the same
+ * cell. only the cell itself is read and written, therefore no new buffers are necessary.
+ */
+__kernel void kernel_lbm_et_cell_state(
+		__global int *flag_array,			// 0) flags
+		__global T *density_array,			// 1) densities
+		__constant T *params,				// 2) simulation parameters (PARAM_* indices)
+		__global T *fluid_mass_array,		// 3) fluid mass
+		__global T *fluid_fraction_array	// 4) fluid fraction
+)
+{
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	int flag = flag_array[gid];
+	T fluid_fraction;
+
+	if (flag == FLAG_INTERFACE)
+	{
+#if INTERFACE_CHANGE
+		// the density of interface cells is always stored (see STORE_MACROSCOPIC)
+		fluid_fraction = fluid_mass_array[gid]/density_array[gid];
+
+		if (fluid_fraction >= 1.0f + EXTRA_OFFSET)
+		{
+			// switch to fluid
+			flag_array[gid] = FLAG_INTERFACE_TO_FLUID;
+		}
+
+		// limit fluid fraction for further computations
+		fluid_fraction = max(min(fluid_fraction, (T)(1.0f+EXTRA_OFFSET)), (T)(0.0f-EXTRA_OFFSET));
+#else
+		// without interface changes, the fluid fraction of interface cells is kept
+		fluid_fraction = fluid_fraction_array[gid];
+#endif
+	}
+	else if (flag == FLAG_FLUID)
+	{
+		fluid_fraction = 1.0f;
+	}
+	else	// gas or obstacle
+	{
+		fluid_fraction = 0.0f;
+	}
+
+	fluid_fraction_array[gid] = fluid_fraction;
+}
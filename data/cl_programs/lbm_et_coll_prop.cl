@@ -0,0 +1,421 @@
+#include "data/cl_programs/lbm_inc_header.h"
+
+#if !ESOTERIC_TWIST
+	#error "this kernel requires ESOTERIC_TWIST"
+#endif
+
+/**
+ * collision and propagation kernel for the esoteric twist storage of the density distributions
+ *
+ * the incoming density distributions are loaded from the cells given by ET_CELL_i. after the
+ * COLLISION, the outgoing density distributions are stored to the same memory locations with
+ * the storage of the opposite direction. therefore only a single density distribution buffer
+ * is necessary and the same kernel is used for each timestep, only et_swap alternates.
+ *
+ * the outgoing mass of interface cells is computed by the pre kernel (lbm_et_pre.cl) since it
+ * is overwritten by the adjacent cells during this kernel.
+ */
+__kernel void kernel_lbm_et_coll_prop(
+		__global DD_T *global_dd,			// 0) density distributions
+		__global int *flag_array,			// 1) flags
+		__global T *velocity_array,			// 2) velocities
+		__global T *density_array,			// 3) densities
+		__constant T *params,				// 4) simulation parameters (PARAM_* indices)
+
+		__global T *fluid_mass_array,		// 5) fluid mass
+		__global T *fluid_fraction_array,	// 6) fluid fraction
+
+		__global int *new_flag_array,		// 7) NEW flags
+		__global T *new_fluid_fraction_array,	// 8) NEW fluid fraction
+
+		__const int et_swap					// 9) storage swap of opposite directions (0 or 1)
+)
+{
+	const T inv_tau = params[PARAM_INV_TAU];
+	const T inv_trt_tau = params[PARAM_INV_TRT_TAU];
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	// load cell type flag
+	int flag = flag_array[gid];
+
+	// load fluid fraction
+	T fluid_fraction = fluid_fraction_array[gid];
+
+	if (flag == FLAG_GAS)
+	{
+		// do nothing if cell is of type gas
+#if !IN_PLACE_CELL_STATE
+		new_flag_array[gid] = FLAG_GAS;
+		new_fluid_fraction_array[gid] = 0.0f;
+#endif
+		return;
+	}
+
+	// density distributions
+	T dd0, dd1, dd2, dd3, dd4, dd5, dd6, dd7, dd8, dd9, dd10, dd11, dd12, dd13, dd14, dd15, dd16, dd17, dd18;
+
+	// fluid fractions
+	T ff0, ff1;
+
+	int index0, index1;			// array indices of adjacent cells
+	int neighbor_flag0, neighbor_flag1;
+#if LAZY_MACROSCOPIC
+	int macroscopic_neighbor_flags = 0;	// all flags of the neighbors (see STORE_MACROSCOPIC)
+#endif
+
+	T tmp;
+
+	// helper variables
+	T vel2;			// vel*vel
+	T vela2;
+	T vela_velb;
+
+	T dd_param;		// modified rho as temporary variable
+
+	// old velocity of cell to reconstruct incoming density distributions
+	T old_velocity_x, old_velocity_y, old_velocity_z;
+#if COMPRESSIBLE_EQUILIBRIUM_DISTRIBUTION
+	T dd_rho;
+#endif
+
+	if (flag == FLAG_INTERFACE)
+	{
+		// read velocity to reconstruct density distributions
+		old_velocity_x = velocity_array[gid];
+		old_velocity_y = velocity_array[DOMAIN_CELLS+gid];
+		old_velocity_z = velocity_array[2*DOMAIN_CELLS+gid];
+
+		vel2 = old_velocity_x*old_velocity_x + old_velocity_y*old_velocity_y + old_velocity_z*old_velocity_z;
+#if COMPRESSIBLE_EQUILIBRIUM_DISTRIBUTION
+		dd_rho = (T)GAS_PRESSURE;
+		dd_param = (T)(3.0f/2.0f)*(vel2);
+#else
+		// use 1.0f as density for gas pressure
+		dd_param = (T)GAS_PRESSURE - (T)(3.0f/2.0f)*(vel2);
+#endif
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+/**
+ * load the incoming density distributions a and b as well as the fluid fraction and the flag
+ * of the adjacent cells index0 and index1 from which the density distributions are streamed
+ */
+#define LOAD_DD_FF(a, b)															\
+	dd##a = DD_LOAD(global_dd, ET_DD_INDEX(ET_CELL_##a(gid), a, et_swap), a);		\
+	ff0 = fluid_fraction_array[index0];												\
+	neighbor_flag0 = flag_array[index0];											\
+																					\
+	dd##b = DD_LOAD(global_dd, ET_DD_INDEX(ET_CELL_##b(gid), b, et_swap), b);		\
+	ff1 = fluid_fraction_array[index1];												\
+	neighbor_flag1 = flag_array[index1];
+
+	/*
+	 * dd 0-3: f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0)
+	 */
+	index0 = NEIGHBOR_CELL(gid, -1, 0, 0);	// index for dd at adjacent cell (-1,0,0)
+	index1 = NEIGHBOR_CELL(gid, 1, 0, 0);	// index for dd at adjacent cell (1,0,0)
+
+	LOAD_DD_FF(0, 1);
+
+	reconstruct_dd_01(flag, fluid_fraction, dd0, neighbor_flag0, ff0, dd1, neighbor_flag1, ff1, old_velocity_x, dd_param, dd_rho);
+
+	T fluid_mass = dd0*ff0;
+	T rho = dd0;
+	T velocity_x = dd0;
+
+	fluid_mass += dd1*ff1;
+	rho += dd1;
+	velocity_x -= dd1;
+
+
+	index0 = NEIGHBOR_CELL(gid, 0, -1, 0);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, 0);
+
+	LOAD_DD_FF(2, 3);
+
+	reconstruct_dd_01(flag, fluid_fraction, dd2, neighbor_flag0, ff0, dd3, neighbor_flag1, ff1, old_velocity_y, dd_param, dd_rho);
+
+	fluid_mass += dd2*ff0;
+	rho += dd2;
+	T velocity_y = dd2;
+
+	fluid_mass += dd3*ff1;
+	rho += dd3;
+	velocity_y -= dd3;
+
+	/*
+	 * dd 4-7: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
+	 */
+	index0 = NEIGHBOR_CELL(gid, -1, -1, 0);
+	index1 = NEIGHBOR_CELL(gid, 1, 1, 0);
+
+	LOAD_DD_FF(4, 5);
+
+	tmp = old_velocity_x+old_velocity_y;
+	reconstruct_dd_45(flag, fluid_fraction, dd4, neighbor_flag0, ff0, dd5, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
+
+	fluid_mass += dd4*ff0;
+	rho += dd4;
+	velocity_x += dd4;
+	velocity_y += dd4;
+
+	fluid_mass += dd5*ff1;
+	rho += dd5;
+	velocity_x -= dd5;
+	velocity_y -= dd5;
+
+
+	index0 = NEIGHBOR_CELL(gid, -1, 1, 0);
+	index1 = NEIGHBOR_CELL(gid, 1, -1, 0);
+
+	LOAD_DD_FF(6, 7);
+
+	tmp = old_velocity_x-old_velocity_y;
+	reconstruct_dd_45(flag, fluid_fraction, dd6, neighbor_flag0, ff0, dd7, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
+
+	fluid_mass += dd6*ff0;
+	rho += dd6;
+	velocity_x += dd6;
+	velocity_y -= dd6;
+
+	fluid_mass += dd7*ff1;
+	rho += dd7;
+	velocity_x -= dd7;
+	velocity_y += dd7;
+
+	/*
+	 * dd 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
+	 */
+	index0 = NEIGHBOR_CELL(gid, -1, 0, -1);
+	index1 = NEIGHBOR_CELL(gid, 1, 0, 1);
+
+	LOAD_DD_FF(8, 9);
+
+	tmp = old_velocity_x+old_velocity_z;
+	reconstruct_dd_45(flag, fluid_fraction, dd8, neighbor_flag0, ff0, dd9, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
+
+	fluid_mass += dd8*ff0;
+	rho += dd8;
+	velocity_x += dd8;
+	T velocity_z = dd8;
+
+	fluid_mass += dd9*ff1;
+	rho += dd9;
+	velocity_x -= dd9;
+	velocity_z -= dd9;
+
+
+	index0 = NEIGHBOR_CELL(gid, -1, 0, 1);
+	index1 = NEIGHBOR_CELL(gid, 1, 0, -1);
+
+	LOAD_DD_FF(10, 11);
+
+	tmp = old_velocity_x-old_velocity_z;
+	reconstruct_dd_45(flag, fluid_fraction, dd10, neighbor_flag0, ff0, dd11, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
+
+	fluid_mass += dd10*ff0;
+	rho += dd10;
+	velocity_x += dd10;
+	velocity_z -= dd10;
+
+	fluid_mass += dd11*ff1;
+	rho += dd11;
+	velocity_x -= dd11;
+	velocity_z += dd11;
+
+	/*
+	 * dd 12-15: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
+	 */
+	index0 = NEIGHBOR_CELL(gid, 0, -1, -1);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, 1);
+
+	LOAD_DD_FF(12, 13);
+
+	tmp = old_velocity_y+old_velocity_z;
+	reconstruct_dd_45(flag, fluid_fraction, dd12, neighbor_flag0, ff0, dd13, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
+
+	fluid_mass += dd12*ff0;
+	rho += dd12;
+	velocity_y += dd12;
+	velocity_z += dd12;
+
+	fluid_mass += dd13*ff1;
+	rho += dd13;
+	velocity_y -= dd13;
+	velocity_z -= dd13;
+
+
+	index0 = NEIGHBOR_CELL(gid, 0, -1, 1);
+	index1 = NEIGHBOR_CELL(gid, 0, 1, -1);
+
+	LOAD_DD_FF(14, 15);
+
+	tmp = old_velocity_y-old_velocity_z;
+	reconstruct_dd_45(flag, fluid_fraction, dd14, neighbor_flag0, ff0, dd15, neighbor_flag1, ff1, tmp, dd_param, dd_rho);
+
+	fluid_mass += dd14*ff0;
+	rho += dd14;
+	velocity_y += dd14;
+	velocity_z -= dd14;
+
+	fluid_mass += dd15*ff1;
+	rho += dd15;
+	velocity_y -= dd15;
+	velocity_z += dd15;
+
+	/*
+	 * dd 16-18: f(0,0,1), f(0,0,-1),  f(0,0,0),  (not used)
+	 */
+	index0 = NEIGHBOR_CELL(gid, 0, 0, -1);
+	index1 = NEIGHBOR_CELL(gid, 0, 0, 1);
+
+	LOAD_DD_FF(16, 17);
+
+	reconstruct_dd_01(flag, fluid_fraction, dd16, neighbor_flag0, ff0, dd17, neighbor_flag1, ff1, old_velocity_z, dd_param, dd_rho);
+
+	fluid_mass += dd16*ff0;
+	rho += dd16;
+	velocity_z += dd16;
+
+	fluid_mass += dd17*ff1;
+	rho += dd17;
+	velocity_z -= dd17;
+
+#undef LOAD_DD_FF
+
+	dd18 = DD_LOAD(global_dd, ET_DD_INDEX_18(gid), 18);
+	rho += dd18;
+
+
+#if COMPRESSIBLE_EQUILIBRIUM_DISTRIBUTION
+	velocity_x /= rho;
+	velocity_y /= rho;
+	velocity_z /= rho;
+#endif
+
+	// compute new fluid mass (the outgoing mass was already subtracted by the pre kernel)
+#if ACTIVATE_INCREASED_MASS_EXCHANGE
+	fluid_mass = mass_exchange_factor*fluid_mass + fluid_mass_array[gid];
+#else
+	fluid_mass = fluid_mass + fluid_mass_array[gid];
+#endif
+
+	// compute fluid fraction
+	if (flag == FLAG_INTERFACE)
+		fluid_fraction = fluid_mass/rho;
+	else if (flag == FLAG_FLUID)
+		fluid_fraction = 1.0f;
+	else
+		fluid_fraction = 0.0f;
+
+	/**
+	 * collision operator
+	 */
+	#include "data/cl_programs/lbm_inc_collision_operator.h"
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+/**
+ * store the outgoing density distribution a to the storage of the opposite direction b
+ */
+#define STORE_DD(a, b)	DD_STORE(global_dd, ET_DD_INDEX(ET_CELL_##b(gid), b, et_swap), a, dd##a);
+
+	STORE_DD(0, 1);
+	STORE_DD(1, 0);
+	STORE_DD(2, 3);
+	STORE_DD(3, 2);
+
+	STORE_DD(4, 5);
+	STORE_DD(5, 4);
+	STORE_DD(6, 7);
+	STORE_DD(7, 6);
+
+	STORE_DD(8, 9);
+	STORE_DD(9, 8);
+	STORE_DD(10, 11);
+	STORE_DD(11, 10);
+
+	STORE_DD(12, 13);
+	STORE_DD(13, 12);
+	STORE_DD(14, 15);
+	STORE_DD(15, 14);
+
+	STORE_DD(16, 17);
+	STORE_DD(17, 16);
+#undef STORE_DD
+
+	DD_STORE(global_dd, ET_DD_INDEX_18(gid), 18, dd18);
+
+
+#if INTERFACE_CHANGE
+
+	fluid_fraction = fluid_mass/rho;
+
+	if (flag == FLAG_INTERFACE)
+	{
+		if (fluid_fraction >= 1.0f + EXTRA_OFFSET)
+		{
+			// switch to fluid
+			flag = FLAG_INTERFACE_TO_FLUID;
+			/*
+			 * leave fluid mass unchanged because we have to distribute that values to the neighbors
+			 */
+		}
+	}
+	else if (flag == FLAG_FLUID)
+	{
+		fluid_mass = rho;
+	}
+	else	// gas or obstacle
+	{
+		fluid_mass = 0.0;
+	}
+
+	// limit fluid fraction for further computations
+	fluid_fraction = max(min(fluid_fraction, (T)(1.0f+EXTRA_OFFSET)), (T)(0.0f-EXTRA_OFFSET));
+#endif
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	/*
+	 * store fluid mass
+	 */
+	fluid_mass_array[gid] = fluid_mass;
+
+#if !IN_PLACE_CELL_STATE
+	/*
+	 * store fluid fractions and flags to new arrays to avoid disturbance of mass conservation
+	 * as well as race conditions!!!
+	 *
+	 * with IN_PLACE_CELL_STATE, the new values are stored by lbm_et_cell_state.cl
+	 */
+	new_fluid_fraction_array[gid] = fluid_fraction;
+	new_flag_array[gid] = flag;
+#endif
+
+	/*
+	 * store velocity and density
+	 * with LAZY_MACROSCOPIC only for the cells which are read by the next simulation step
+	 */
+	if (STORE_MACROSCOPIC(flag))
+	{
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
+
+		/*
+		 * store density
+		 * this is useful for recomputation of dd's from gas cells streaming to interface cells
+		 */
+		density_array[gid] = rho;
+	}
+}
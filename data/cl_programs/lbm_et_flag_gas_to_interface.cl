@@ -0,0 +1,210 @@
+/**
+ * this kernel is responsible to handle cells tagged with 'GAS_TO_INTERFACE'
+ *
+ * the density distributions are reconstructed and also the density and
+ * velocity is innitialized with average data from adjacent fluid cells
+ *
+ * with the esoteric twist storage, the equilibrium density distributions overwrite the
+ * outgoing density distributions which were stored by the preceding collision and
+ * propagation kernel with the same et_swap value.
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+#if !ESOTERIC_TWIST
+	#error "this kernel requires ESOTERIC_TWIST"
+#endif
+
+#define STD_STUFF										\
+	if (GET_CONVERTED_FLAG(flag_array[dd_index]) == FLAG_FLUID)	\
+	{													\
+		velocity_x += velocity_array[dd_index];			\
+		velocity_y += velocity_array[DOMAIN_CELLS+dd_index];		\
+		velocity_z += velocity_array[2*DOMAIN_CELLS+dd_index];		\
+		rho += density_array[dd_index];					\
+		count+=1.0f;										\
+	}													\
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+__kernel void kernel_lbm_et_flag_gas_to_interface(
+			__global DD_T *global_dd,			// 0: density distributions
+			__global int *flag_array,			// 1: flags
+			__global T *velocity_array,			// 2: velocities
+			__global T *density_array,			// 3: densities
+
+			__global T *fluid_mass_array,		// 4: fluid mass
+			__global T *fluid_fraction_array,	// 5: fluid fraction
+			__constant T *params,		// 6) simulation parameters (PARAM_* indices)
+			__const int et_swap					// 7) storage swap of opposite directions (0 or 1)
+		)
+{
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	int flag = GET_CONVERTED_FLAG(flag_array[gid]);
+	RESOLVE_CONVERTED_FLAG(gid, flag);
+
+	if (flag == FLAG_GAS_TO_INTERFACE)
+	{
+		T velocity_x, velocity_y, velocity_z;
+		T rho;
+		T count;
+
+		size_t dd_index;
+
+		T vel2;		// vel*vel
+		T vela2;
+		T vela_velb;
+		T vela_velb_2;
+		T dd_param;
+
+		// reconstruct density distribution
+		// we leave the fluid mass and fluid fraction unchanged cz. those should be already around 1.0
+
+		// compute average velocity of neighboring cells
+		velocity_x = 0.0f;
+		velocity_y = 0.0f;
+		velocity_z = 0.0f;
+		rho = 0.0f;
+
+		count = 0.0f;
+
+		// check neighbored cells if they are fluid cells and convert them to interface cells
+
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 0);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 0);			STD_STUFF;
+
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 0);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 0);			STD_STUFF;
+
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, -1);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, 1);			STD_STUFF;
+
+		dd_index = NEIGHBOR_CELL(gid, -1, -1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, -1, 0);	STD_STUFF;
+
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, -1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, -1);	STD_STUFF;
+
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, -1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, -1);	STD_STUFF;
+
+		if (count > 1.0f)
+		{
+			T inv_count = 1.0f/count;
+
+			velocity_x *= inv_count;	// average velocity
+			velocity_y *= inv_count;
+			velocity_z *= inv_count;
+
+			rho *= inv_count;			// average rho
+		}
+		else if (count < 1.0f)
+		{
+			rho = 1.0f;
+		}
+//		rho += (float)(count < 1.0f);
+
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		vel2 = velocity_x*velocity_x + velocity_y*velocity_y + velocity_z*velocity_z;
+#if COMPRESSIBLE_EQUILIBRIUM_DISTRIBUTION
+		dd_param = (T)(3.0/2.0)*(vel2);
+#else
+		dd_param = rho - (T)(3.0f/2.0f)*(vel2);
+#endif
+
+/**
+ * store the equilibrium density distribution a to the storage of the opposite direction b
+ */
+#define STORE_EQ_DD(a, b, value)	DD_STORE(global_dd, ET_DD_INDEX(ET_CELL_##b(gid), b, et_swap), a, value)
+
+		/***********************
+		 * DD0
+		 ***********************/
+		vela2 = velocity_x*velocity_x;
+		STORE_EQ_DD(0, 1, eq_dd0(velocity_x, vela2, dd_param, rho));
+		STORE_EQ_DD(1, 0, eq_dd1(velocity_x, vela2, dd_param, rho));
+
+		vela2 = velocity_y*velocity_y;
+		STORE_EQ_DD(2, 3, eq_dd0(velocity_y, vela2, dd_param, rho));
+		STORE_EQ_DD(3, 2, eq_dd1(velocity_y, vela2, dd_param, rho));
+
+
+#define vela_velb_2	vela2
+		/***********************
+		 * DD1
+		 ***********************/
+		vela_velb = velocity_x+velocity_y;
+		vela_velb_2 = vela_velb*vela_velb;
+
+		STORE_EQ_DD(4, 5, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));
+		STORE_EQ_DD(5, 4, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));
+
+		vela_velb = velocity_x-velocity_y;
+		vela_velb_2 = vela_velb*vela_velb;
+
+		STORE_EQ_DD(6, 7, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));
+		STORE_EQ_DD(7, 6, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));
+
+		/***********************
+		 * DD2
+		 ***********************/
+		vela_velb = velocity_x+velocity_z;
+		vela_velb_2 = vela_velb*vela_velb;
+
+		STORE_EQ_DD(8, 9, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));
+		STORE_EQ_DD(9, 8, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));
+
+		vela_velb = velocity_x-velocity_z;
+		vela_velb_2 = vela_velb*vela_velb;
+
+		STORE_EQ_DD(10, 11, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));
+		STORE_EQ_DD(11, 10, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));
+
+		/***********************
+		 * DD3
+		 ***********************/
+		vela_velb = velocity_y+velocity_z;
+		vela_velb_2 = vela_velb*vela_velb;
+
+		STORE_EQ_DD(12, 13, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));
+		STORE_EQ_DD(13, 12, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));
+
+		vela_velb = velocity_y-velocity_z;
+		vela_velb_2 = vela_velb*vela_velb;
+
+		STORE_EQ_DD(14, 15, eq_dd4(vela_velb, vela_velb_2, dd_param, rho));
+		STORE_EQ_DD(15, 14, eq_dd5(vela_velb, vela_velb_2, dd_param, rho));
+#undef vela_velb_2
+
+		/***********************
+		 * DD4
+		 ***********************/
+		vela2 = velocity_z*velocity_z;
+		STORE_EQ_DD(16, 17, eq_dd0(velocity_z, vela2, dd_param, rho));
+		STORE_EQ_DD(17, 16, eq_dd1(velocity_z, vela2, dd_param, rho));
+#undef STORE_EQ_DD
+
+		DD_STORE(global_dd, ET_DD_INDEX_18(gid), 18, eq_dd18(dd_param, rho));
+
+		__global T *current_velocity = &velocity_array[gid];
+		*current_velocity = velocity_x;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_y;	current_velocity += DOMAIN_CELLS;
+		*current_velocity = velocity_z;
+
+		// GAS_TO_INTERFACE
+		flag_array[gid] = FLAG_INTERFACE;
+		density_array[gid] = rho;
+		fluid_mass_array[gid] = 0.0f;
+		fluid_fraction_array[gid] = 0.0f;
+	}
+}
@@ -0,0 +1,96 @@
+/*
+ * the pre kernel cares about the mass which is going out of the cell
+ *
+ * with the esoteric twist storage, the outgoing density distributions of the last timestep
+ * are stored at the locations which are overwritten by the adjacent cells during the
+ * collision and propagation kernel. therefore the outgoing mass is computed before.
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+#if !ESOTERIC_TWIST
+	#error "this kernel requires ESOTERIC_TWIST"
+#endif
+
+
+__kernel void kernel_lbm_et_pre(
+			__global DD_T *global_dd,		// 0) density distributions
+			__global int *flag_array,		// 1) flags
+			__global T *velocity_array,		// 2) velocities
+			__global T *density_array,		// 3) densities
+
+			__global T *fluid_mass_array,	// 4) fluid mass
+			__global T *fluid_fraction_array,	// 5) fluid fraction
+
+			__constant T *params,	// 6) simulation parameters (PARAM_* indices)
+			__const int et_swap				// 7) storage swap of opposite directions (0 or 1)
+		)
+{
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	int flag = flag_array[gid];
+
+	// no work-group communication is used, thus gas and obstacle cells can return
+	if (!(flag & FLAGS_FLUID_INTERFACE))
+		return;
+
+	T fluid_fraction = fluid_fraction_array[gid];
+
+	T ffx;
+	T ddx;
+	int neighbor_flag;
+	size_t neighbor_index;
+
+/**
+ * subtract the outgoing density distribution a which was stored to the storage of the
+ * opposite direction b during the last timestep and which streams to the cell at delta
+ */
+#define OUTGOING_MASS(a, b, dx, dy, dz)											\
+	ddx = DD_LOAD(global_dd, ET_DD_INDEX(ET_CELL_##b(gid), a, et_swap), a);	\
+	neighbor_index = NEIGHBOR_CELL(gid, dx, dy, dz);					\
+	ffx = fluid_fraction_array[neighbor_index];								\
+	neighbor_flag = flag_array[neighbor_index];								\
+	GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ffx, neighbor_flag);		\
+	fluid_mass -= ddx*ffx;
+
+	T fluid_mass = 0.0f;
+
+	/* f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0) */
+	OUTGOING_MASS(0, 1, 1, 0, 0);
+	OUTGOING_MASS(1, 0, -1, 0, 0);
+	OUTGOING_MASS(2, 3, 0, 1, 0);
+	OUTGOING_MASS(3, 2, 0, -1, 0);
+
+	/* f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0) */
+	OUTGOING_MASS(4, 5, 1, 1, 0);
+	OUTGOING_MASS(5, 4, -1, -1, 0);
+	OUTGOING_MASS(6, 7, 1, -1, 0);
+	OUTGOING_MASS(7, 6, -1, 1, 0);
+
+	/* f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1) */
+	OUTGOING_MASS(8, 9, 1, 0, 1);
+	OUTGOING_MASS(9, 8, -1, 0, -1);
+	OUTGOING_MASS(10, 11, 1, 0, -1);
+	OUTGOING_MASS(11, 10, -1, 0, 1);
+
+	/* f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1) */
+	OUTGOING_MASS(12, 13, 0, 1, 1);
+	OUTGOING_MASS(13, 12, 0, -1, -1);
+	OUTGOING_MASS(14, 15, 0, 1, -1);
+	OUTGOING_MASS(15, 14, 0, -1, 1);
+
+	/* f(0,0,1), f(0,0,-1) */
+	OUTGOING_MASS(16, 17, 0, 0, 1);
+	OUTGOING_MASS(17, 16, 0, 0, -1);
+#undef OUTGOING_MASS
+
+	// compute new fluid mass
+#if ACTIVATE_INCREASED_MASS_EXCHANGE
+	fluid_mass_array[gid] = fluid_mass_array[gid] + mass_exchange_factor*fluid_mass;
+#else
+	fluid_mass_array[gid] = fluid_mass_array[gid] + fluid_mass;
+#endif
+}
@@ -0,0 +1,232 @@
+/**
+ * fused flag conversion
+ *
+ * this kernel replaces the interface to fluid neighbors, interface to gas and interface to gas
+ * neighbors kernels. each work group handles one tile of FLAG_CONVERSION_TILE_SIZE^3 cells.
+ *
+ * the flags of the tile and a halo of FLAG_CONVERSION_HALO cells are loaded to local memory once.
+ * then the conversions are computed in two phases by gathering the flags of the neighbor cells:
+ *
+ * 1) interface to fluid neighbors and interface to gas conversions for the tile and one halo layer
+ * 2) interface to gas neighbors conversion for the cells of the tile
+ *
+ * since phase 2 reads the results of phase 1 of the neighbor cells and phase 1 reads the flags of
+ * the neighbor cells, a halo of 2 cells is necessary to compute the conversions without a global
+ * synchronization.
+ *
+ * the converted flags are stored to the upper bits of the flag array (see FUSED_FLAG_CONVERSION in
+ * lbm_inc_header.h) and resolved by the gas to interface kernel which has to be launched afterwards.
+ * with INTERFACE_WORKLIST, the converted cells are pushed to the list of the gas to interface kernel.
+ *
+ * the loneley interface removers read the flags of the neighbor cells before the conversion of the
+ * current phase. this is one of the possible results of the removers used by the separate kernels.
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+#define FLAG_CONVERSION_HALO		(2)
+#define FLAG_CONVERSION_REGION_SIZE	(FLAG_CONVERSION_TILE_SIZE + 2*FLAG_CONVERSION_HALO)
+#define FLAG_CONVERSION_REGION_CELLS	(FLAG_CONVERSION_REGION_SIZE*FLAG_CONVERSION_REGION_SIZE*FLAG_CONVERSION_REGION_SIZE)
+
+#define FLAG_CONVERSION_TILES_X		(DOMAIN_CELLS_X/FLAG_CONVERSION_TILE_SIZE)
+#define FLAG_CONVERSION_TILES_Y		(DOMAIN_CELLS_Y/FLAG_CONVERSION_TILE_SIZE)
+
+#if ACTIVE_TILES && (FLAG_CONVERSION_TILE_SIZE != ACTIVE_TILE_SIZE)
+	#error "FLAG_CONVERSION_TILE_SIZE has to be equal to ACTIVE_TILE_SIZE"
+#endif
+
+// deltas of the neighbor cells in local memory
+#define LOCAL_DELTA_X	(1)
+#define LOCAL_DELTA_Y	(FLAG_CONVERSION_REGION_SIZE)
+#define LOCAL_DELTA_Z	(FLAG_CONVERSION_REGION_SIZE*FLAG_CONVERSION_REGION_SIZE)
+
+/**
+ * return the flags of all 18 neighbor cells combined with a bitwise or
+ */
+inline int getLocalNeighborFlags(__local const uchar *local_flags, int i)
+{
+	int neighbor_flags = 0;
+
+#define STD_STUFF(delta)	neighbor_flags |= local_flags[i + (delta)];
+
+	STD_STUFF(-LOCAL_DELTA_X);
+	STD_STUFF(+LOCAL_DELTA_X);
+
+	STD_STUFF(-LOCAL_DELTA_Y);
+	STD_STUFF(+LOCAL_DELTA_Y);
+
+	STD_STUFF(-LOCAL_DELTA_Z);
+	STD_STUFF(+LOCAL_DELTA_Z);
+
+	STD_STUFF(-LOCAL_DELTA_X - LOCAL_DELTA_Y);
+	STD_STUFF(+LOCAL_DELTA_X + LOCAL_DELTA_Y);
+	STD_STUFF(-LOCAL_DELTA_X + LOCAL_DELTA_Y);
+	STD_STUFF(+LOCAL_DELTA_X - LOCAL_DELTA_Y);
+
+	STD_STUFF(-LOCAL_DELTA_Y - LOCAL_DELTA_Z);
+	STD_STUFF(+LOCAL_DELTA_Y + LOCAL_DELTA_Z);
+	STD_STUFF(-LOCAL_DELTA_Y + LOCAL_DELTA_Z);
+	STD_STUFF(+LOCAL_DELTA_Y - LOCAL_DELTA_Z);
+
+	STD_STUFF(-LOCAL_DELTA_X - LOCAL_DELTA_Z);
+	STD_STUFF(+LOCAL_DELTA_X + LOCAL_DELTA_Z);
+	STD_STUFF(-LOCAL_DELTA_X + LOCAL_DELTA_Z);
+	STD_STUFF(+LOCAL_DELTA_X - LOCAL_DELTA_Z);
+#undef STD_STUFF
+
+	return neighbor_flags;
+}
+
+/**
+ * return the cell id of the cell at the local position (x, y, z) within the region of the tile
+ */
+inline size_t getRegionCellId(size_t tile_cell_id, int x, int y, int z)
+{
+#if CELL_BRICK_SIZE
+	// add the domain size to avoid negative values for the periodic boundaries
+	return CELL_ID(	(CELL_X(tile_cell_id) + x - FLAG_CONVERSION_HALO + DOMAIN_CELLS_X) % DOMAIN_CELLS_X,
+					(CELL_Y(tile_cell_id) + y - FLAG_CONVERSION_HALO + DOMAIN_CELLS_Y) % DOMAIN_CELLS_Y,
+					(CELL_Z(tile_cell_id) + z - FLAG_CONVERSION_HALO + DOMAIN_CELLS_Z) % DOMAIN_CELLS_Z
+				);
+#else
+#if GHOST_LAYER
+	// the halo of the tiles at the domain boundaries is stored in the ghost cells
+	return DOMAIN_WRAP(	tile_cell_id +
+#else
+	// add the domain cells to avoid negative values for the periodic boundaries
+	return DOMAIN_WRAP(	tile_cell_id + (size_t)FLAG_CONVERSION_HALO*DOMAIN_CELLS +
+#endif
+						(z - FLAG_CONVERSION_HALO)*DOMAIN_SLICE_CELLS +
+						(y - FLAG_CONVERSION_HALO)*DOMAIN_CELLS_X +
+						(x - FLAG_CONVERSION_HALO)
+					);
+#endif
+}
+
+__kernel void kernel_flag_conversion(
+			__global int *flag_array,			// 0) flags
+			__global T *fluid_fraction_array,	// 1) fluid fraction
+			__constant T *params		// 2) simulation parameters (PARAM_* indices)
+			ACTIVE_TILES_KERNEL_ARG			// 3) active tile list (only with ACTIVE_TILES)
+			CONVERSION_PUSH_KERNEL_ARG		// 3/4) list of converted cells (only with INTERFACE_WORKLIST)
+		)
+{
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	__local uchar local_flags[FLAG_CONVERSION_REGION_CELLS];			// flags before the conversions
+	__local uchar local_converted_flags[FLAG_CONVERSION_REGION_CELLS];	// flags after phase 1
+
+#if ACTIVE_TILES
+	const int tile = active_tile_list[1 + get_group_id(0)];
+#else
+	const int tile = get_group_id(0);
+#endif
+
+	const size_t tile_cell_id = CELL_ID(
+			(tile % FLAG_CONVERSION_TILES_X)*FLAG_CONVERSION_TILE_SIZE,
+			((tile / FLAG_CONVERSION_TILES_X) % FLAG_CONVERSION_TILES_Y)*FLAG_CONVERSION_TILE_SIZE,
+			(tile / (FLAG_CONVERSION_TILES_X*FLAG_CONVERSION_TILES_Y))*FLAG_CONVERSION_TILE_SIZE
+		);
+
+	int i;
+
+	/*
+	 * load flags of tile and halo
+	 */
+	for (i = get_local_id(0); i < FLAG_CONVERSION_REGION_CELLS; i += get_local_size(0))
+	{
+		int x = i % FLAG_CONVERSION_REGION_SIZE;
+		int y = (i / FLAG_CONVERSION_REGION_SIZE) % FLAG_CONVERSION_REGION_SIZE;
+		int z = i / (FLAG_CONVERSION_REGION_SIZE*FLAG_CONVERSION_REGION_SIZE);
+
+		local_flags[i] = GET_ORIGINAL_FLAG(flag_array[getRegionCellId(tile_cell_id, x, y, z)]);
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	/*
+	 * PHASE 1: interface to fluid neighbors and interface to gas for the tile and one halo layer
+	 */
+	for (i = get_local_id(0); i < FLAG_CONVERSION_REGION_CELLS; i += get_local_size(0))
+	{
+		int x = i % FLAG_CONVERSION_REGION_SIZE;
+		int y = (i / FLAG_CONVERSION_REGION_SIZE) % FLAG_CONVERSION_REGION_SIZE;
+		int z = i / (FLAG_CONVERSION_REGION_SIZE*FLAG_CONVERSION_REGION_SIZE);
+
+		// the outer halo layer is only read
+		if (	x == 0 || x == FLAG_CONVERSION_REGION_SIZE-1 ||
+				y == 0 || y == FLAG_CONVERSION_REGION_SIZE-1 ||
+				z == 0 || z == FLAG_CONVERSION_REGION_SIZE-1
+		)
+			continue;
+
+		int flag = local_flags[i];
+		int neighbor_flags = getLocalNeighborFlags(local_flags, i);
+
+		if (flag == FLAG_INTERFACE_TO_FLUID)
+		{
+			flag = FLAG_FLUID;
+		}
+		else if (flag == FLAG_GAS)
+		{
+			// gas cells adjacent to a new fluid cell are converted to interface cells
+			if (neighbor_flags & FLAG_INTERFACE_TO_FLUID)
+				flag = FLAG_GAS_TO_INTERFACE;
+		}
+		else if (flag == FLAG_INTERFACE)
+		{
+#if LONELEY_INTERFACE_REMOVER
+			// interface cells which are not connected to a gas cell are converted to fluid cells
+			if ((neighbor_flags & (FLAG_FLUID | FLAG_GAS)) == FLAG_FLUID)
+				flag = FLAG_FLUID;
+#endif
+
+#if INTERFACE_CHANGE
+			if (flag == FLAG_INTERFACE)
+				if (fluid_fraction_array[getRegionCellId(tile_cell_id, x, y, z)] <= -EXTRA_OFFSET)
+					flag = FLAG_INTERFACE_TO_GAS;
+#endif
+		}
+
+		local_converted_flags[i] = flag;
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	/*
+	 * PHASE 2: interface to gas neighbors for the cells of the tile
+	 */
+	for (i = get_local_id(0); i < FLAG_CONVERSION_TILE_SIZE*FLAG_CONVERSION_TILE_SIZE*FLAG_CONVERSION_TILE_SIZE; i += get_local_size(0))
+	{
+		int x = i % FLAG_CONVERSION_TILE_SIZE + FLAG_CONVERSION_HALO;
+		int y = (i / FLAG_CONVERSION_TILE_SIZE) % FLAG_CONVERSION_TILE_SIZE + FLAG_CONVERSION_HALO;
+		int z = i / (FLAG_CONVERSION_TILE_SIZE*FLAG_CONVERSION_TILE_SIZE) + FLAG_CONVERSION_HALO;
+
+		int local_id = (z*FLAG_CONVERSION_REGION_SIZE + y)*FLAG_CONVERSION_REGION_SIZE + x;
+
+		int flag = local_converted_flags[local_id];
+		int neighbor_flags = getLocalNeighborFlags(local_converted_flags, local_id);
+
+		if (flag == FLAG_FLUID)
+		{
+			// fluid cells adjacent to a new gas cell are converted to interface cells
+			if (neighbor_flags & FLAG_INTERFACE_TO_GAS)
+				flag = FLAG_INTERFACE;
+		}
+#if LONELEY_INTERFACE_REMOVER
+		else if (flag == FLAG_INTERFACE)
+		{
+			// interface cells which are not connected to a fluid cell are converted to gas cells
+			if ((neighbor_flags & (FLAG_FLUID | FLAG_GAS)) == FLAG_GAS)
+				flag = FLAG_GAS;
+		}
+#endif
+
+		// store converted flag without modifying the flag read by other work groups
+		if (flag != local_flags[local_id])
+		{
+			size_t gid = getRegionCellId(tile_cell_id, x, y, z);
+			flag_array[gid] = local_flags[local_id] | (flag << CONVERTED_FLAG_SHIFT);
+			PUSH_CONVERTED_CELL(gid);
+		}
+	}
+}
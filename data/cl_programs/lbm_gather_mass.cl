@@ -4,13 +4,16 @@ __kernel void kernel_gather_mass(
 			__global int fluid_flag_array[DOMAIN_CELLS],
 			__global T fluid_mass_array[DOMAIN_CELLS],
 		    __global T gather_mass_array[DOMAIN_CELLS]
+		    ACTIVE_TILES_KERNEL_ARG			// 3) active tile list (only with ACTIVE_TILES)
 )
 {
 #if !DISTRIBUTE_MASS_OF_GAS_CELLS
 	return;
 #endif
 
-	const size_t gid = get_global_id(0);
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = GET_CELL_ID();
 
 	// only gather mass for cells which are fluid or interface cells
 	if (!(fluid_flag_array[gid] & (FLAG_INTERFACE | FLAG_FLUID)))
@@ -23,29 +26,29 @@ __kernel void kernel_gather_mass(
 #define STD_STUFF(i)	gathered_mass += gather_mass_array[i];
 
 	// check neighbored cells if they are fluid cells and convert them to interface cells
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_X));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_X));
+	STD_STUFF(NEIGHBOR_CELL(gid, -1, 0, 0));
+	STD_STUFF(NEIGHBOR_CELL(gid, 1, 0, 0));
 
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_Y));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_Y));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, -1, 0));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, 1, 0));
 
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_Z));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_Z));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, 0, -1));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, 0, 1));
 
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y));
+	STD_STUFF(NEIGHBOR_CELL(gid, -1, -1, 0));
+	STD_STUFF(NEIGHBOR_CELL(gid, 1, 1, 0));
+	STD_STUFF(NEIGHBOR_CELL(gid, -1, 1, 0));
+	STD_STUFF(NEIGHBOR_CELL(gid, 1, -1, 0));
 
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, -1, -1));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, 1, 1));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, -1, 1));
+	STD_STUFF(NEIGHBOR_CELL(gid, 0, 1, -1));
 
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z));
-	STD_STUFF(DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z));
+	STD_STUFF(NEIGHBOR_CELL(gid, -1, 0, -1));
+	STD_STUFF(NEIGHBOR_CELL(gid, 1, 0, 1));
+	STD_STUFF(NEIGHBOR_CELL(gid, -1, 0, 1));
+	STD_STUFF(NEIGHBOR_CELL(gid, 1, 0, -1));
 #undef STD_STUFF
 
 	if (gathered_mass != 0.0)
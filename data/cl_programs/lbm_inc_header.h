@@ -13,6 +13,310 @@
 #define DOMAIN_CELLS		(DOMAIN_CELLS_X*DOMAIN_CELLS_Y*DOMAIN_CELLS_Z)
 #define DOMAIN_SLICE_CELLS	(DOMAIN_CELLS_X*DOMAIN_CELLS_Y)
 
+/**
+ * layout of the density distributions
+ *
+ * DD_BLOCK_SIZE == 0: structure of arrays, all cells of one direction are stored contiguously.
+ * DD_BLOCK_SIZE > 0: blocks of DD_BLOCK_SIZE cells store all 19 directions contiguously
+ * (array of structures of arrays). the buffer size is padded to a multiple of DD_BLOCK_SIZE cells.
+ *
+ * DD_CELL(cell_id) returns the offset of the first density distribution of the cell,
+ * the next direction is stored DD_DIR_STRIDE entries later.
+ *
+ * GHOST_LAYER == 1: GHOST_CELLS ghost cells are stored before and after the domain cells of each direction.
+ */
+#if GHOST_LAYER
+	#define DD_GHOST_CELL(cell_id)	((cell_id) + GHOST_CELLS)
+#else
+	#define DD_GHOST_CELL(cell_id)	(cell_id)
+#endif
+
+#if DD_BLOCK_SIZE
+	#define DD_CELL(cell_id)	((DD_GHOST_CELL(cell_id)/DD_BLOCK_SIZE)*(DD_BLOCK_SIZE*19) + (DD_GHOST_CELL(cell_id)%DD_BLOCK_SIZE))
+	#define DD_DIR_STRIDE		(DD_BLOCK_SIZE)
+#else
+	#define DD_CELL(cell_id)	DD_GHOST_CELL(cell_id)
+	#define DD_DIR_STRIDE		(DD_BUFFER_CELLS)
+#endif
+
+/**
+ * storage type of the density distributions
+ *
+ * DD_HALF == 0: the density distributions are stored with the precision of T.
+ * DD_HALF == 1: the density distributions are stored as half floats. to keep the accuracy, the
+ * deviation from the lattice weight of the direction is stored. the computations are still done with T.
+ *
+ * the direction (0-18) of the accessed density distribution has to be given to DD_LOAD and DD_STORE.
+ */
+#define DD_WEIGHT(dd_dir)	((dd_dir) == 18 ? (T)(1.0/3.0) : (((dd_dir) < 4 || (dd_dir) > 15) ? (T)(1.0/18.0) : (T)(1.0/36.0)))
+
+#if DD_HALF
+	typedef half DD_T;
+
+	#define DD_LOAD(ptr, index, dd_dir)			(vload_half((index), (ptr)) + DD_WEIGHT(dd_dir))
+	#define DD_STORE(ptr, index, dd_dir, value)	vstore_half((value) - DD_WEIGHT(dd_dir), (index), (ptr))
+#else
+	typedef T DD_T;
+
+	#define DD_LOAD(ptr, index, dd_dir)			((ptr)[index])
+	#define DD_STORE(ptr, index, dd_dir, value)	((ptr)[index] = (value))
+#endif
+
+/**
+ * ordering of the cells in the cell buffers
+ *
+ * CELL_BRICK_SIZE == 0: linear ordering with x running fastest, followed by y and z.
+ * CELL_BRICK_SIZE > 0: the domain is split into bricks of CELL_BRICK_SIZE^3 cells. the cells of a brick are
+ * stored contiguously (x running fastest within the brick) and the bricks are ordered linearly. this keeps the
+ * neighbors in z and the diagonal neighbors close in memory. CELL_BRICK_SIZE has to be a power of two and the
+ * domain size has to be a multiple of CELL_BRICK_SIZE in each dimension.
+ *
+ * CELL_ID(x, y, z) returns the index of the cell at position (x, y, z) and CELL_X/Y/Z(cell_id) its position.
+ * NEIGHBOR_CELL(cell_id, dx, dy, dz) returns the index of the adjacent cell with dx, dy, dz in {-1, 0, 1}.
+ */
+#if CELL_BRICK_SIZE
+	#define CELL_BRICK_CELLS	(CELL_BRICK_SIZE*CELL_BRICK_SIZE*CELL_BRICK_SIZE)
+	#define CELL_BRICKS_X		(DOMAIN_CELLS_X/CELL_BRICK_SIZE)
+	#define CELL_BRICKS_Y		(DOMAIN_CELLS_Y/CELL_BRICK_SIZE)
+
+	#define CELL_ID(x, y, z)	(	((((size_t)(z)/CELL_BRICK_SIZE)*CELL_BRICKS_Y + (y)/CELL_BRICK_SIZE)*CELL_BRICKS_X + (x)/CELL_BRICK_SIZE)*CELL_BRICK_CELLS +	\
+									(((z)%CELL_BRICK_SIZE)*CELL_BRICK_SIZE + (y)%CELL_BRICK_SIZE)*CELL_BRICK_SIZE + (x)%CELL_BRICK_SIZE	)
+
+	#define CELL_LOCAL_X(cell_id)	((cell_id)%CELL_BRICK_SIZE)
+	#define CELL_LOCAL_Y(cell_id)	(((cell_id)/CELL_BRICK_SIZE)%CELL_BRICK_SIZE)
+	#define CELL_LOCAL_Z(cell_id)	(((cell_id)/(CELL_BRICK_SIZE*CELL_BRICK_SIZE))%CELL_BRICK_SIZE)
+
+	#define CELL_X(cell_id)		((((cell_id)/CELL_BRICK_CELLS)%CELL_BRICKS_X)*CELL_BRICK_SIZE + CELL_LOCAL_X(cell_id))
+	#define CELL_Y(cell_id)		((((cell_id)/(CELL_BRICK_CELLS*CELL_BRICKS_X))%CELL_BRICKS_Y)*CELL_BRICK_SIZE + CELL_LOCAL_Y(cell_id))
+	#define CELL_Z(cell_id)		(((cell_id)/(CELL_BRICK_CELLS*CELL_BRICKS_X*CELL_BRICKS_Y))*CELL_BRICK_SIZE + CELL_LOCAL_Z(cell_id))
+
+	/*
+	 * deltas to step from the last cell of a brick in positive direction to the first cell of the next brick.
+	 * the neighbors only depend on the position within the brick, thus no division by the domain size is necessary.
+	 */
+	#define CELL_BRICK_DELTA_X	(CELL_BRICK_CELLS - (CELL_BRICK_SIZE-1))
+	#define CELL_BRICK_DELTA_Y	(CELL_BRICK_CELLS*CELL_BRICKS_X - (CELL_BRICK_SIZE-1)*CELL_BRICK_SIZE)
+	#define CELL_BRICK_DELTA_Z	(CELL_BRICK_CELLS*CELL_BRICKS_X*CELL_BRICKS_Y - (CELL_BRICK_SIZE-1)*CELL_BRICK_SIZE*CELL_BRICK_SIZE)
+
+	#define NEIGHBOR_DELTA(local, d, inner_delta, brick_delta)											\
+				((d) > 0 ? ((local) == CELL_BRICK_SIZE-1 ? (brick_delta) : (inner_delta)) :				\
+				((d) < 0 ? ((local) == 0 ? DOMAIN_CELLS-(brick_delta) : DOMAIN_CELLS-(inner_delta)) : 0))
+
+	#define NEIGHBOR_DELTA_X(cell_id, d)	NEIGHBOR_DELTA(CELL_LOCAL_X(cell_id), d, 1, CELL_BRICK_DELTA_X)
+	#define NEIGHBOR_DELTA_Y(cell_id, d)	NEIGHBOR_DELTA(CELL_LOCAL_Y(cell_id), d, CELL_BRICK_SIZE, CELL_BRICK_DELTA_Y)
+	#define NEIGHBOR_DELTA_Z(cell_id, d)	NEIGHBOR_DELTA(CELL_LOCAL_Z(cell_id), d, CELL_BRICK_SIZE*CELL_BRICK_SIZE, CELL_BRICK_DELTA_Z)
+#else
+	#define CELL_ID(x, y, z)	((size_t)(z)*DOMAIN_SLICE_CELLS + (size_t)(y)*DOMAIN_CELLS_X + (x))
+
+	#define CELL_X(cell_id)		((cell_id)%DOMAIN_CELLS_X)
+	#define CELL_Y(cell_id)		(((cell_id)/DOMAIN_CELLS_X)%DOMAIN_CELLS_Y)
+	#define CELL_Z(cell_id)		((cell_id)/DOMAIN_SLICE_CELLS)
+
+	#define NEIGHBOR_DELTA_X(cell_id, d)	((d) > 0 ? DELTA_POS_X : ((d) < 0 ? DELTA_NEG_X : 0))
+	#define NEIGHBOR_DELTA_Y(cell_id, d)	((d) > 0 ? DELTA_POS_Y : ((d) < 0 ? DELTA_NEG_Y : 0))
+	#define NEIGHBOR_DELTA_Z(cell_id, d)	((d) > 0 ? DELTA_POS_Z : ((d) < 0 ? DELTA_NEG_Z : 0))
+#endif
+
+#define NEIGHBOR_CELL(cell_id, dx, dy, dz)	\
+			DOMAIN_WRAP((cell_id) + NEIGHBOR_DELTA_X(cell_id, dx) + NEIGHBOR_DELTA_Y(cell_id, dy) + NEIGHBOR_DELTA_Z(cell_id, dz))
+
+/**
+ * active tiles
+ *
+ * if ACTIVE_TILES is enabled, the kernels are launched only over the cells of the tiles stored in the
+ * active tile list. the first entry of the list stores the number of tiles, the tile ids follow.
+ *
+ * the domain size has to be a multiple of ACTIVE_TILE_SIZE in each dimension.
+ */
+#if ACTIVE_TILES
+	#define ACTIVE_TILE_CELLS	(ACTIVE_TILE_SIZE*ACTIVE_TILE_SIZE*ACTIVE_TILE_SIZE)
+
+	#define ACTIVE_TILES_X		(DOMAIN_CELLS_X/ACTIVE_TILE_SIZE)
+	#define ACTIVE_TILES_Y		(DOMAIN_CELLS_Y/ACTIVE_TILE_SIZE)
+	#define ACTIVE_TILES_Z		(DOMAIN_CELLS_Z/ACTIVE_TILE_SIZE)
+	#define ACTIVE_TILES_COUNT	(ACTIVE_TILES_X*ACTIVE_TILES_Y*ACTIVE_TILES_Z)
+
+	/**
+	 * compute the cell id for the current work item
+	 *
+	 * the cells within a tile are ordered in x, y, z direction
+	 */
+	inline size_t getActiveTileCellId(__global const int *active_tile_list)
+	{
+		const size_t id = get_global_id(0);
+
+		const int tile = active_tile_list[1 + id/ACTIVE_TILE_CELLS];
+		const int cell = id % ACTIVE_TILE_CELLS;
+
+		const int x = (tile % ACTIVE_TILES_X)*ACTIVE_TILE_SIZE + cell % ACTIVE_TILE_SIZE;
+		const int y = ((tile / ACTIVE_TILES_X) % ACTIVE_TILES_Y)*ACTIVE_TILE_SIZE + (cell / ACTIVE_TILE_SIZE) % ACTIVE_TILE_SIZE;
+		const int z = (tile / (ACTIVE_TILES_X*ACTIVE_TILES_Y))*ACTIVE_TILE_SIZE + cell / (ACTIVE_TILE_SIZE*ACTIVE_TILE_SIZE);
+
+		return CELL_ID(x, y, z);
+	}
+
+	#define ACTIVE_TILES_KERNEL_ARG		, __global const int *active_tile_list
+	#define GET_CELL_ID()				getActiveTileCellId(active_tile_list)
+#else
+	#define ACTIVE_TILES_KERNEL_ARG
+	#define GET_CELL_ID()				get_global_id(0)
+#endif
+
+/**
+ * the global range of the kernels which are launched for all domain cells is rounded up to a multiple
+ * of the local work group size. work items beyond the domain return before accessing any data.
+ */
+#define DOMAIN_RANGE_CHECK()	if (get_global_id(0) >= DOMAIN_CELLS)	return;
+
+/**
+ * kernels which exchange data between the work items in local memory cannot return early because all
+ * work items of a work group have to reach the barriers. the work items beyond the domain process the
+ * periodic continuation of the domain instead (the ghost cells with GHOST_LAYER), thus the data shifted
+ * in local memory stays valid. only DOMAIN_RANGE_STORE() work items store their results.
+ *
+ * with ACTIVE_TILES, the local work group size is a divisor of the tile cells, thus no padding exists.
+ */
+#if ACTIVE_TILES || GHOST_LAYER
+	#define GET_PADDED_CELL_ID()	GET_CELL_ID()
+#else
+	#define GET_PADDED_CELL_ID()	(get_global_id(0) < DOMAIN_CELLS ? get_global_id(0) : get_global_id(0) - DOMAIN_CELLS)
+#endif
+
+#define DOMAIN_RANGE_STORE()	(get_global_id(0) < DOMAIN_CELLS)
+
+/**
+ * interface worklist
+ *
+ * if INTERFACE_WORKLIST is enabled, the flag conversion kernels are launched only for the cells
+ * stored in a cell list (first entry: number of cells, followed by the cell ids).
+ * cells which are converted to interface or gas-to-interface cells are pushed to a second list.
+ */
+#if INTERFACE_WORKLIST
+	#if DISTRIBUTE_MASS_OF_GAS_CELLS
+		#error "INTERFACE_WORKLIST does not support DISTRIBUTE_MASS_OF_GAS_CELLS"
+	#endif
+
+	#define CONVERSION_KERNEL_ARG			, __global const int *cell_list
+	#define CONVERSION_PUSH_KERNEL_ARG		, __global int *push_cell_list
+	#define CONVERSION_KERNEL_RANGE_CHECK()	if (get_global_id(0) >= cell_list[0])	return;
+	#define GET_CONVERSION_CELL_ID()		((size_t)cell_list[1 + get_global_id(0)])
+
+	#define PUSH_CONVERTED_CELL(cell_id)	push_cell_list[1 + atomic_inc(&push_cell_list[0])] = cell_id
+
+	/*
+	 * only one work item succeeds to convert the cell and pushes it to the list
+	 */
+	#define CONVERT_CELL_FLAG(cell_id, old_flag, new_flag)											\
+		if (atomic_cmpxchg(&flag_array[cell_id], old_flag, new_flag) == old_flag)					\
+			PUSH_CONVERTED_CELL(cell_id);
+#else
+	#define CONVERSION_KERNEL_ARG			ACTIVE_TILES_KERNEL_ARG
+	#define CONVERSION_PUSH_KERNEL_ARG
+	#define CONVERSION_KERNEL_RANGE_CHECK()	DOMAIN_RANGE_CHECK()
+	#define GET_CONVERSION_CELL_ID()		GET_CELL_ID()
+	#define PUSH_CONVERTED_CELL(cell_id)
+
+	#define CONVERT_CELL_FLAG(cell_id, old_flag, new_flag)											\
+		if (flag_array[cell_id] == old_flag)														\
+			flag_array[cell_id] = new_flag;
+#endif
+
+/**
+ * fused flag conversion
+ *
+ * if FUSED_FLAG_CONVERSION is enabled, the interface to fluid neighbors, interface to gas and
+ * interface to gas neighbors conversions are computed by a single kernel (lbm_flag_conversion.cl).
+ * since other work groups still read the flags before the conversion, the converted flag is stored
+ * to the upper bits of the flag (CONVERTED_FLAG_SHIFT) and the flag before the conversion is kept in
+ * the lower bits. the gas to interface kernels read the converted flags and store them to the
+ * flag array (RESOLVE_CONVERTED_FLAG).
+ *
+ * interface cells converted to gas cells are tagged with FLAG_INTERFACE_TO_GAS to reset their fluid fraction.
+ *
+ * with INTERFACE_WORKLIST, the gas to interface kernels are launched for the converted cells only,
+ * thus every cell whose flag is changed by the fused kernel is pushed to the list of converted cells.
+ */
+#if FUSED_FLAG_CONVERSION
+	#if DISTRIBUTE_MASS_OF_GAS_CELLS
+		#error "FUSED_FLAG_CONVERSION does not support DISTRIBUTE_MASS_OF_GAS_CELLS"
+	#endif
+
+	#define CONVERTED_FLAG_SHIFT			(16)
+	#define GET_ORIGINAL_FLAG(flag)			((flag) & ((1 << CONVERTED_FLAG_SHIFT)-1))
+	#define GET_CONVERTED_FLAG(flag)		((flag) >> CONVERTED_FLAG_SHIFT ? (flag) >> CONVERTED_FLAG_SHIFT : (flag))
+
+	#define RESOLVE_CONVERTED_FLAG(cell_id, flag)						\
+		if (flag_array[cell_id] != flag)								\
+		{																\
+			if (flag == FLAG_INTERFACE_TO_GAS)							\
+			{															\
+				flag = FLAG_GAS;										\
+				fluid_fraction_array[cell_id] = 0.0f;					\
+			}															\
+			flag_array[cell_id] = flag;									\
+		}
+#else
+	#define GET_CONVERTED_FLAG(flag)		(flag)
+
+	#define RESOLVE_CONVERTED_FLAG(cell_id, flag)
+#endif
+
+/**
+ * packed cell state
+ *
+ * if CELL_STATE is enabled, the flag (lower 8 bits) and the fluid fraction (upper 24 bits, fixed point
+ * in the range [CELL_STATE_FRACTION_MIN, CELL_STATE_FRACTION_MAX]) of each cell are additionally stored
+ * to one 32 bit word. the collision kernels load the flags and fluid fractions of all neighbor cells
+ * with a single read and store the state of their own cell to the new state array. the states of the
+ * cells modified by the flag conversions are updated by the interface list kernels.
+ *
+ * the pre kernels and the collision kernels have to use the same fluid fractions to compute the mass
+ * exchange between two cells. otherwise the mass is not conserved. therefore the pre kernels use the
+ * quantized fluid fractions, too.
+ */
+#if CELL_STATE
+	#define CELL_STATE_FRACTION_MIN		(-1.0f)
+	#define CELL_STATE_FRACTION_MAX		(2.0f)
+	#define CELL_STATE_FRACTION_SCALE	((float)0xffffff/(CELL_STATE_FRACTION_MAX - CELL_STATE_FRACTION_MIN))
+
+	#define PACK_CELL_STATE(flag, ff)																\
+		(((uint)(flag) & 0xff) |																	\
+		(convert_uint_rte(clamp(((float)(ff) - CELL_STATE_FRACTION_MIN)*CELL_STATE_FRACTION_SCALE,	\
+								0.0f, (float)0xffffff)) << 8))
+
+	#define UNPACK_CELL_FLAG(state)			((int)((state) & 0xff))
+	#define UNPACK_CELL_FRACTION(state)		((T)((float)((state) >> 8)/CELL_STATE_FRACTION_SCALE + CELL_STATE_FRACTION_MIN))
+
+	#define QUANTIZE_CELL_FRACTION(ff)		UNPACK_CELL_FRACTION(PACK_CELL_STATE(0, ff))
+
+	#define CELL_STATE_KERNEL_ARG			, __global const uint *cell_state_array, __global uint *new_cell_state_array
+	#define CELL_STATE_STORE_KERNEL_ARG		, __global uint *cell_state_array
+
+	#define STORE_CELL_STATE(cell_id, flag, ff)		cell_state_array[cell_id] = PACK_CELL_STATE(flag, ff);
+	#define STORE_NEW_CELL_STATE(cell_id, flag, ff)	new_cell_state_array[cell_id] = PACK_CELL_STATE(flag, ff);
+
+	#define LOAD_CELL_STATE(cell_id, ff, flag)				\
+	{														\
+		uint cell_state = cell_state_array[cell_id];		\
+		flag = UNPACK_CELL_FLAG(cell_state);				\
+		ff = UNPACK_CELL_FRACTION(cell_state);				\
+	}
+#else
+	#define QUANTIZE_CELL_FRACTION(ff)		(ff)
+
+	#define CELL_STATE_KERNEL_ARG
+	#define CELL_STATE_STORE_KERNEL_ARG
+
+	#define STORE_CELL_STATE(cell_id, flag, ff)
+	#define STORE_NEW_CELL_STATE(cell_id, flag, ff)
+
+	#define LOAD_CELL_STATE(cell_id, ff, flag)				\
+	{														\
+		ff = fluid_fraction_array[cell_id];					\
+		flag = flag_array[cell_id];							\
+	}
+#endif
+
 /**
  * Next we define the delta values for the neighbor cells.
  *
@@ -23,13 +327,26 @@
  * Otherwise we would run into more computations due to the modulo computations of negative numbers.
  */
 #define DELTA_POS_X		(1)
-#define DELTA_NEG_X		(DOMAIN_CELLS-1)
-
 #define DELTA_POS_Y		(DOMAIN_CELLS_X)
-#define DELTA_NEG_Y		(DOMAIN_CELLS-DOMAIN_CELLS_X)
-
 #define DELTA_POS_Z		(DOMAIN_SLICE_CELLS)
-#define DELTA_NEG_Z		(DOMAIN_CELLS-DOMAIN_SLICE_CELLS)
+
+#if GHOST_LAYER && CELL_BRICK_SIZE
+	#error "the ghost layer is only supported with the linear cell ordering"
+#endif
+
+#if GHOST_LAYER
+/*
+ * with the ghost layer, the neighbors are accessed with linear offsets which never wrap around.
+ * the outermost cells of the domain are obstacles, thus only they access the ghost cells.
+ */
+	#define DELTA_NEG_X		(-1)
+	#define DELTA_NEG_Y		(-DOMAIN_CELLS_X)
+	#define DELTA_NEG_Z		(-DOMAIN_SLICE_CELLS)
+#else
+	#define DELTA_NEG_X		(DOMAIN_CELLS-1)
+	#define DELTA_NEG_Y		(DOMAIN_CELLS-DOMAIN_CELLS_X)
+	#define DELTA_NEG_Z		(DOMAIN_CELLS-DOMAIN_SLICE_CELLS)
+#endif
 
 /**
  * include the wrapping stuff
@@ -37,6 +354,58 @@
 #include "data/cl_programs/wrap.h"
 
 
+/**
+ * esoteric twist storage of the density distributions (ESOTERIC_TWIST == 1)
+ *
+ * every simulation step reads and writes the density distributions of a cell in place with
+ * the same kernel. the incoming density distribution of direction i is read from the cell
+ * ET_CELL_i(cell_id) which is the cell itself or the neighbor in the positive components of
+ * the opposite lattice vector. the outgoing density distribution of direction i is written to
+ * ET_CELL_j(cell_id) with j being the opposite direction of i. thus each cell accesses its own
+ * set of density distributions only.
+ *
+ * after each step the density distributions of opposite directions (i, i^1) exchange their
+ * storage, therefore direction i is stored at (i ^ et_swap) with et_swap alternating between
+ * 0 and 1. the rest direction (18) is always stored at the cell itself.
+ */
+#if ESOTERIC_TWIST
+	#define ET_CELL_0(cell_id)	(cell_id)
+	#define ET_CELL_1(cell_id)	NEIGHBOR_CELL(cell_id, 1, 0, 0)
+	#define ET_CELL_2(cell_id)	(cell_id)
+	#define ET_CELL_3(cell_id)	NEIGHBOR_CELL(cell_id, 0, 1, 0)
+
+	#define ET_CELL_4(cell_id)	(cell_id)
+	#define ET_CELL_5(cell_id)	NEIGHBOR_CELL(cell_id, 1, 1, 0)
+	#define ET_CELL_6(cell_id)	NEIGHBOR_CELL(cell_id, 0, 1, 0)
+	#define ET_CELL_7(cell_id)	NEIGHBOR_CELL(cell_id, 1, 0, 0)
+
+	#define ET_CELL_8(cell_id)	(cell_id)
+	#define ET_CELL_9(cell_id)	NEIGHBOR_CELL(cell_id, 1, 0, 1)
+	#define ET_CELL_10(cell_id)	NEIGHBOR_CELL(cell_id, 0, 0, 1)
+	#define ET_CELL_11(cell_id)	NEIGHBOR_CELL(cell_id, 1, 0, 0)
+
+	#define ET_CELL_12(cell_id)	(cell_id)
+	#define ET_CELL_13(cell_id)	NEIGHBOR_CELL(cell_id, 0, 1, 1)
+	#define ET_CELL_14(cell_id)	NEIGHBOR_CELL(cell_id, 0, 0, 1)
+	#define ET_CELL_15(cell_id)	NEIGHBOR_CELL(cell_id, 0, 1, 0)
+
+	#define ET_CELL_16(cell_id)	(cell_id)
+	#define ET_CELL_17(cell_id)	NEIGHBOR_CELL(cell_id, 0, 0, 1)
+
+	#define ET_CELL_18(cell_id)	(cell_id)
+
+	/**
+	 * index of the density distribution of direction dd_dir stored at cell_id (dd_dir < 18)
+	 */
+	#define ET_DD_INDEX(cell_id, dd_dir, et_swap)	(DD_CELL(cell_id) + ((dd_dir) ^ (et_swap))*DD_DIR_STRIDE)
+
+	/**
+	 * index of the density distribution of the rest direction
+	 */
+	#define ET_DD_INDEX_18(cell_id)		(DD_CELL(cell_id) + 18*DD_DIR_STRIDE)
+#endif
+
+
 /***********************************************************************
  * equilibrium distributions f_eq for incompressible fluids (not used in this simulation)
  ***********************************************************************/
@@ -121,26 +490,26 @@
 // READ FROM LOCAL STORE
 #define dd_read_delta_position_0x	(read_delta_neg_x)
 #define dd_read_delta_position_1x	(read_delta_pos_x)
-#define dd_read_delta_position_2x	DOMAIN_WRAP(gid + DELTA_NEG_Y)
-#define dd_read_delta_position_3x	DOMAIN_WRAP(gid + DELTA_POS_Y)
+#define dd_read_delta_position_2x	NEIGHBOR_CELL(gid, 0, -1, 0)
+#define dd_read_delta_position_3x	NEIGHBOR_CELL(gid, 0, 1, 0)
 
-#define dd_read_delta_position_4x	DOMAIN_WRAP(read_delta_neg_x + DELTA_NEG_Y)
-#define dd_read_delta_position_5x	DOMAIN_WRAP(read_delta_pos_x + DELTA_POS_Y)
-#define dd_read_delta_position_6x	DOMAIN_WRAP(read_delta_neg_x + DELTA_POS_Y)
-#define dd_read_delta_position_7x	DOMAIN_WRAP(read_delta_pos_x + DELTA_NEG_Y)
+#define dd_read_delta_position_4x	NEIGHBOR_CELL(read_delta_neg_x, 0, -1, 0)
+#define dd_read_delta_position_5x	NEIGHBOR_CELL(read_delta_pos_x, 0, 1, 0)
+#define dd_read_delta_position_6x	NEIGHBOR_CELL(read_delta_neg_x, 0, 1, 0)
+#define dd_read_delta_position_7x	NEIGHBOR_CELL(read_delta_pos_x, 0, -1, 0)
 
-#define	dd_read_delta_position_8x	DOMAIN_WRAP(read_delta_neg_x + DELTA_NEG_Z)
-#define dd_read_delta_position_9x	DOMAIN_WRAP(read_delta_pos_x + DELTA_POS_Z)
-#define dd_read_delta_position_10x	DOMAIN_WRAP(read_delta_neg_x + DELTA_POS_Z)
-#define dd_read_delta_position_11x	DOMAIN_WRAP(read_delta_pos_x + DELTA_NEG_Z)
+#define	dd_read_delta_position_8x	NEIGHBOR_CELL(read_delta_neg_x, 0, 0, -1)
+#define dd_read_delta_position_9x	NEIGHBOR_CELL(read_delta_pos_x, 0, 0, 1)
+#define dd_read_delta_position_10x	NEIGHBOR_CELL(read_delta_neg_x, 0, 0, 1)
+#define dd_read_delta_position_11x	NEIGHBOR_CELL(read_delta_pos_x, 0, 0, -1)
 
-#define dd_read_delta_position_12x	DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z)
-#define dd_read_delta_position_13x	DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z)
-#define dd_read_delta_position_14x	DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z)
-#define dd_read_delta_position_15x	DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z)
+#define dd_read_delta_position_12x	NEIGHBOR_CELL(gid, 0, -1, -1)
+#define dd_read_delta_position_13x	NEIGHBOR_CELL(gid, 0, 1, 1)
+#define dd_read_delta_position_14x	NEIGHBOR_CELL(gid, 0, -1, 1)
+#define dd_read_delta_position_15x	NEIGHBOR_CELL(gid, 0, 1, -1)
 
-#define dd_read_delta_position_16x	DOMAIN_WRAP(gid + DELTA_NEG_Z)
-#define dd_read_delta_position_17x	DOMAIN_WRAP(gid + DELTA_POS_Z)
+#define dd_read_delta_position_16x	NEIGHBOR_CELL(gid, 0, 0, -1)
+#define dd_read_delta_position_17x	NEIGHBOR_CELL(gid, 0, 0, 1)
 
 #define dd_read_delta_position_0	dd_read_delta_position_0x
 #define dd_read_delta_position_1	dd_read_delta_position_1x
@@ -234,6 +603,25 @@
 #define GET_MX_FACTOR_OUTGOING(fluid_fraction, flag, ff, neighbor_flag)		\
 			GET_MX_FACTOR_INCOMING(fluid_fraction, flag, ff, neighbor_flag)
 
+/********************************************************************
+ * lazy storage of the velocity and density (LAZY_MACROSCOPIC)
+ *
+ * the simulation only reads the velocity and density of interface cells (reconstruction
+ * below) and of the cells next to gas cells which are converted to interface cells.
+ * fluid cells may only become interface cells if a neighbor is a gas or interface cell.
+ * therefore the collision kernels store the velocity and density of a fluid cell only if
+ * such a neighbor exists or if the host requested the values of all cells with
+ * PARAM_STORE_MACROSCOPIC. the flags of the neighbors are collected by the reconstruction
+ * in macroscopic_neighbor_flags.
+ ********************************************************************/
+#if LAZY_MACROSCOPIC
+	#define MACROSCOPIC_NEIGHBOR_FLAGS(flag0, flag1)	macroscopic_neighbor_flags |= (flag0) | (flag1);
+	#define STORE_MACROSCOPIC(flag)		((flag) != FLAG_FLUID || (macroscopic_neighbor_flags & (FLAG_GAS | FLAG_INTERFACE)) || params[PARAM_STORE_MACROSCOPIC] != (T)0)
+#else
+	#define MACROSCOPIC_NEIGHBOR_FLAGS(flag0, flag1)
+	#define STORE_MACROSCOPIC(flag)		(1)
+#endif
+
 /********************************************************************
  * reconstruction of dds streaming to interface cells from gas cells
  ********************************************************************/
@@ -460,6 +848,7 @@
 								p_dda, p_ddb											\
 			)																			\
 	{																					\
+		MACROSCOPIC_NEIGHBOR_FLAGS(p_neighbor_flag0, p_neighbor_flag1)				\
 		if (p_flag != FLAG_INTERFACE)													\
 		{																				\
 			GET_MX_FACTOR_INCOMING(p_fluid_fraction, p_flag, p_ff0, p_neighbor_flag0);	\
@@ -509,6 +898,7 @@
 								p_dda, p_ddb											\
 			)																			\
 	{																					\
+		MACROSCOPIC_NEIGHBOR_FLAGS(p_neighbor_flag0, p_neighbor_flag1)				\
 		if (p_flag != FLAG_INTERFACE)													\
 		{																				\
 			GET_MX_FACTOR_INCOMING(p_fluid_fraction, p_flag, p_ff0, p_neighbor_flag0);	\
@@ -591,6 +981,7 @@
 							p_dda, p_ddb											\
 		)																			\
 {																					\
+	MACROSCOPIC_NEIGHBOR_FLAGS(p_neighbor_flag0, p_neighbor_flag1)					\
 	float aa0 = (float)(p_flag == FLAG_INTERFACE);	\
 	float aa1 = ((p_neighbor_flag0 & FLAGS_GAS_OBSTACLE) && (p_neighbor_flag1 & FLAGS_GAS_OBSTACLE));	\
 	float aa2 = ((p_neighbor_flag0 & FLAGS_GAS_OBSTACLE) > 0);	\
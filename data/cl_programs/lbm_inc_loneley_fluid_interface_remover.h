@@ -9,29 +9,29 @@
 		// we leave the fluid mass and fluid fraction unchanged cz. those should be already around 1.0
 
 		// check neighbored cells if they are fluid cells and convert them to interface cells
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X);			STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X);			STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 0);			STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 0);			STD_STUFF2;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y);			STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y);			STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 0);			STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 0);			STD_STUFF2;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Z);			STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Z);			STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, -1);			STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, 1);			STD_STUFF2;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, -1, -1, 0);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 1, 1, 0);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, -1, 1, 0);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 1, -1, 0);	STD_STUFF2;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, -1);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 1);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 1);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, -1);	STD_STUFF2;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z);	STD_STUFF2;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, -1);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 1);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 1);	STD_STUFF2;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, -1);	STD_STUFF2;
 
 	#undef STD_STUFF2
 
@@ -17,22 +17,20 @@ enum
 
 /**
  * return 3D position
- * \input linear_position	linear position in 3D cube (ordering: X,Y,Z)
+ * \input cell_id	index of the cell in the cell buffers (ordering: see CELL_ID)
  * \return	Vector with 3D position in cube
+ *
+ * for a subdomain, the z coordinate in the global domain is returned. the halo layers
+ * beyond the global domain are wrapped around.
  */
-inline int4 getCubePosition(int linear_position)
+inline int4 getCubePosition(int cell_id)
 {
 	int4 pos;
 
-	// TODO: use AND operation to speed up
-	// (but this function is only used during initialization)
-	pos.x = (T)((int)linear_position % (int)DOMAIN_CELLS_X);
-	linear_position /= DOMAIN_CELLS_X;
-
-	pos.y = (T)((int)linear_position % (int)DOMAIN_CELLS_Y);
-	linear_position /= DOMAIN_CELLS_Y;
-
-	pos.z = linear_position;
+	// (this function is only used during initialization)
+	pos.x = CELL_X(cell_id);
+	pos.y = CELL_Y(cell_id);
+	pos.z = ((int)CELL_Z(cell_id) + SUBDOMAIN_OFFSET_Z + GLOBAL_DOMAIN_CELLS_Z) % GLOBAL_DOMAIN_CELLS_Z;
 	return pos;
 }
 
@@ -43,7 +41,7 @@ int getFlag(int x, int y, int z, int init_fluid_flags)
 	int flag = FLAG_GAS;
 
 	if (	x <= 0 || y <= 0 || z <= 0 ||
-			x >= DOMAIN_CELLS_X-1 || y >= DOMAIN_CELLS_Y-1 || z >= DOMAIN_CELLS_Z-1
+			x >= DOMAIN_CELLS_X-1 || y >= DOMAIN_CELLS_Y-1 || z >= GLOBAL_DOMAIN_CELLS_Z-1
 	)
 	{
 		return FLAG_OBSTACLE;
@@ -51,11 +49,11 @@ int getFlag(int x, int y, int z, int init_fluid_flags)
 
 	if (init_fluid_flags & INIT_CREATE_FLUID_WITH_GAS_SPHERE)
 	{
-		T radius = ((float)min(min(DOMAIN_CELLS_X, DOMAIN_CELLS_Y), DOMAIN_CELLS_Z))*0.35*gas_sphere_radius;
+		T radius = ((float)min(min(DOMAIN_CELLS_X, DOMAIN_CELLS_Y), GLOBAL_DOMAIN_CELLS_Z))*0.35*gas_sphere_radius;
 
 		T dx = x - DOMAIN_CELLS_X/2;
 		T dy = y - radius-2;
-		T dz = z - DOMAIN_CELLS_Z/2;
+		T dz = z - GLOBAL_DOMAIN_CELLS_Z/2;
 
 		T dist = sqrt(dx*dx + dy*dy + dz*dz);
 
@@ -91,13 +89,13 @@ int getFlag(int x, int y, int z, int init_fluid_flags)
 	if (init_fluid_flags & INIT_CREATE_SPHERE)
 	{
 		T min = (DOMAIN_CELLS_X < DOMAIN_CELLS_Y ? DOMAIN_CELLS_X : DOMAIN_CELLS_Y);
-		min = (min < DOMAIN_CELLS_Z ? min : DOMAIN_CELLS_Z)/2;
+		min = (min < GLOBAL_DOMAIN_CELLS_Z ? min : GLOBAL_DOMAIN_CELLS_Z)/2;
 
 		T radius = min*2/3;
 
 		T dx = x - DOMAIN_CELLS_X/2;
 		T dy = DOMAIN_CELLS_Y - y - radius-3;
-		T dz = z - DOMAIN_CELLS_Z/2;
+		T dz = z - GLOBAL_DOMAIN_CELLS_Z/2;
 
 		T dist = sqrt(dx*dx + dy*dy + dz*dz);
 
@@ -111,13 +109,13 @@ int getFlag(int x, int y, int z, int init_fluid_flags)
 	if (init_fluid_flags & INIT_CREATE_OBSTACLE_HALF_SPHERE)
 	{
 		T min = (DOMAIN_CELLS_X < DOMAIN_CELLS_Y ? DOMAIN_CELLS_X : DOMAIN_CELLS_Y);
-		min = (min < DOMAIN_CELLS_Z ? min : DOMAIN_CELLS_Z)/2;
+		min = (min < GLOBAL_DOMAIN_CELLS_Z ? min : GLOBAL_DOMAIN_CELLS_Z)/2;
 
 		T radius = min*2/3;
 
 		T dx = x - DOMAIN_CELLS_X/2;
 		T dy = y;
-		T dz = z - DOMAIN_CELLS_Z/2;
+		T dz = z - GLOBAL_DOMAIN_CELLS_Z/2;
 
 		T dist = sqrt(dx*dx + dy*dy + dz*dz);
 
@@ -131,13 +129,13 @@ int getFlag(int x, int y, int z, int init_fluid_flags)
 	if (init_fluid_flags & INIT_CREATE_OBSTACLE_VERTICAL_BAR)
 	{
 		T min = (DOMAIN_CELLS_X < DOMAIN_CELLS_Y ? DOMAIN_CELLS_X : DOMAIN_CELLS_Y);
-		min = (min < DOMAIN_CELLS_Z ? min : DOMAIN_CELLS_Z)/2;
+		min = (min < GLOBAL_DOMAIN_CELLS_Z ? min : GLOBAL_DOMAIN_CELLS_Z)/2;
 
 		T radius = min*1/5;
 
 		T dx = x - DOMAIN_CELLS_X/2;
 		T dy = y - DOMAIN_CELLS_Y/2;
-		T dz = z - DOMAIN_CELLS_Z/2;
+		T dz = z - GLOBAL_DOMAIN_CELLS_Z/2;
 
 		T dist = sqrt(dx*dx + dz*dz);
 
@@ -207,28 +205,32 @@ bool checkNeighborFlag(int x, int y, int z, int flag, int init_fluid_flags)
  * INIT KERNEL
  */
 __kernel void kernel_lbm_init(
-		__global T *global_dd,			// 0) density distributions
+		__global DD_T *global_dd,		// 0) density distributions
 		__global int flag_array[DOMAIN_CELLS],			// 1) flags
 		__global T *velocity_array,		// 2) velocities
 		__global T density_array[DOMAIN_CELLS],			// 3) densities
-		__const T inv_tau,								// 4) "weight" for collision function
-		__const T inv_trt_tau,							// 5) "weight" for TRT collision model
-
-		__global T fluid_mass_array[DOMAIN_CELLS],		// 6) fluid mass
-		__global T fluid_fraction_array[DOMAIN_CELLS],	// 7) fluid fraction
+		__constant T *params,				// 4) simulation parameters (PARAM_* indices)
 
-		__global int new_flag_array[DOMAIN_CELLS],		// 8) NEW flags
-		__global T new_fluid_fraction_array[DOMAIN_CELLS],	// 9) NEW fluid fraction
+		__global T fluid_mass_array[DOMAIN_CELLS],		// 5) fluid mass
+		__global T fluid_fraction_array[DOMAIN_CELLS],	// 6) fluid fraction
 
-		__const T gravitation0,							// 10) gravitation
-		__const T gravitation1,
-		__const T gravitation2,
+		__global int new_flag_array[DOMAIN_CELLS],		// 7) NEW flags
+		__global T new_fluid_fraction_array[DOMAIN_CELLS],	// 8) NEW fluid fraction
 
-		int init_fluid_flags							// 13) init flags
+		int init_fluid_flags							// 9) init flags
+		CELL_STATE_STORE_KERNEL_ARG						// 10) packed cell state (only with CELL_STATE)
 )
 {
+	const T inv_tau = params[PARAM_INV_TAU];
+	const T inv_trt_tau = params[PARAM_INV_TRT_TAU];
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+
 //	init_fluid_flags = p_init_fluid_flags;
 
+	DOMAIN_RANGE_CHECK();
+
 	const size_t gid = get_global_id(0);
 
 
@@ -292,7 +294,18 @@ __kernel void kernel_lbm_init(
 			break;
 	}
 
-	__global T *current_dds = &global_dd[gid];
+	/*
+	 * with the esoteric twist, the density distributions are stored to the cells
+	 * from which they are read by the first simulation step
+	 */
+#if ESOTERIC_TWIST
+	#define INIT_DD_CELL(dd_id)	DD_CELL(ET_CELL_##dd_id(gid))
+#else
+	#define INIT_DD_CELL(dd_id)	DD_CELL(gid)
+#endif
+
+	__global DD_T *current_dds = global_dd;
+	int dd_dir = 0;
 
 	// compute and store velocity
 #if COMPRESSIBLE_EQUILIBRIUM_DISTRIBUTION
@@ -303,16 +316,16 @@ __kernel void kernel_lbm_init(
 
 	vela2 = velocity_x*velocity_x;
 	dd0 = eq_dd0(velocity_x, vela2, dd_param, rho);
-	*current_dds = dd0;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(0), dd_dir, dd0);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd1 = eq_dd1(velocity_x, vela2, dd_param, rho);
-	*current_dds = dd1;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(1), dd_dir, dd1);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	vela2 = velocity_y*velocity_y;
 
 	dd2 = eq_dd0(velocity_y, vela2, dd_param, rho);
-	*current_dds = dd2;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(2), dd_dir, dd2);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd3 = eq_dd1(velocity_y, vela2, dd_param, rho);
-	*current_dds = dd3;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(3), dd_dir, dd3);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 
 #define vela_velb_2	vela2
@@ -323,17 +336,17 @@ __kernel void kernel_lbm_init(
 	vela_velb_2 = vela_velb*vela_velb;
 
 	dd4 = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd4;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(4), dd_dir, dd4);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd5 = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd5;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(5), dd_dir, dd5);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	vela_velb = velocity_x-velocity_y;
 	vela_velb_2 = vela_velb*vela_velb;
 
 	dd6 = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd6;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(6), dd_dir, dd6);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd7 = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd7;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(7), dd_dir, dd7);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/***********************
 	 * DD2
@@ -342,17 +355,17 @@ __kernel void kernel_lbm_init(
 	vela_velb_2 = vela_velb*vela_velb;
 
 	dd8 = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd8;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(8), dd_dir, dd8);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd9 = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd9;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(9), dd_dir, dd9);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	vela_velb = velocity_x-velocity_z;
 	vela_velb_2 = vela_velb*vela_velb;
 
 	dd10 = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd10;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(10), dd_dir, dd10);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd11 = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd11;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(11), dd_dir, dd11);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	/***********************
 	 * DD3
@@ -362,17 +375,17 @@ __kernel void kernel_lbm_init(
 
 
 	dd12 = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd12;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(12), dd_dir, dd12);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd13 = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd13;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(13), dd_dir, dd13);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	vela_velb = velocity_y-velocity_z;
 	vela_velb_2 = vela_velb*vela_velb;
 
 	dd14 = eq_dd4(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd14;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(14), dd_dir, dd14);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd15 = eq_dd5(vela_velb, vela_velb_2, dd_param, rho);
-	*current_dds = dd15;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(15), dd_dir, dd15);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 
 #undef vela_velb_2
@@ -382,12 +395,13 @@ __kernel void kernel_lbm_init(
 	vela2 = velocity_z*velocity_z;
 
 	dd16 = eq_dd0(velocity_z, vela2, dd_param, rho);
-	*current_dds = dd16;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(16), dd_dir, dd16);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 	dd17 = eq_dd1(velocity_z, vela2, dd_param, rho);
-	*current_dds = dd17;		current_dds += DOMAIN_CELLS;
+	DD_STORE(current_dds, INIT_DD_CELL(17), dd_dir, dd17);		current_dds += DD_DIR_STRIDE;	dd_dir++;
 
 	dd18 = eq_dd18(dd_param, rho);
-	*current_dds = dd18;
+	DD_STORE(current_dds, INIT_DD_CELL(18), dd_dir, dd18);
+#undef INIT_DD_CELL
 
 	// update flags, fraction and mass
 	flag_array[gid] = flag;
@@ -397,6 +411,8 @@ __kernel void kernel_lbm_init(
 	new_flag_array[gid] = flag;
 	new_fluid_fraction_array[gid] = p_fluid_fraction;
 
+	STORE_CELL_STATE(gid, flag, p_fluid_fraction);
+
 	// store velocity
 	velocity_array[gid] = velocity_x;
 	velocity_array[DOMAIN_CELLS+gid] = velocity_y;
@@ -0,0 +1,117 @@
+/**
+ * compaction of the interface lists of the A-A implementation
+ *
+ * the kernels are launched at the end of each simulation step for the interface cells before
+ * the flag conversions and the converted cells (see stack.cl for the layout of the lists).
+ * besides compacting the list, the packed state of the visited cells is updated to the flags and
+ * fluid fractions after the flag conversions (CELL_STATE).
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+
+/**
+ * return the cell of the work item or -1 if there is nothing to do
+ *
+ * the items of 'stack' are the interface cells before the flag conversions, the items of
+ * 'stack_new' are the cells which were converted to (gas-to-)interface cells during the flag conversions
+ * (all converted cells with FUSED_FLAG_CONVERSION). a cell which was an interface cell before the
+ * conversions can be stored on both stacks. in this case, the item of 'stack' is used.
+ *
+ * the kernels are launched for at least (items on 'stack' + items on 'stack_new') work items.
+ */
+inline int getInterfaceListCellId(
+		__global const int *old_flag_array,
+		__global const int *stack,
+		__global const int *stack_new
+)
+{
+	const int gid = get_global_id(0);
+
+	const int items_on_stack = stack[0];
+
+	if (gid < items_on_stack)
+		return stack[1 + gid];
+
+	int id = gid - items_on_stack;
+
+	if (id >= stack_new[0])
+		return -1;
+
+	int cell_id = stack_new[1 + id];
+
+	// this cell is already stored on the other stack
+	if (old_flag_array[cell_id] == FLAG_INTERFACE)
+		return -1;
+
+	return cell_id;
+}
+
+
+/**
+ * compact the interface list after the alpha step
+ *
+ * all items which are still interface cells are pushed to 'stack_push', the remaining ones are deleted.
+ */
+__kernel void kernel_lbm_alpha_interface_list(
+		__global const int *flag_array,			// 0) flags after the flag conversions
+		__global const int *old_flag_array,		// 1) flags before the flag conversions
+		__global const T *fluid_fraction_array,	// 2) fluid fraction after the flag conversions
+		__global const int *stack,				// 3) interface cells before the flag conversions
+		__global const int *stack_new,			// 4) converted cells
+		__global int *stack_push,				// 5) destination stack
+		__constant T *params			// 6) simulation parameters (PARAM_* indices)
+		CELL_STATE_STORE_KERNEL_ARG				// 7) packed cell state (only with CELL_STATE)
+)
+{
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	const int cell_id = getInterfaceListCellId(old_flag_array, stack, stack_new);
+
+	if (cell_id < 0)
+		return;
+
+	int flag = flag_array[cell_id];
+
+	STORE_CELL_STATE(cell_id, flag, fluid_fraction_array[cell_id]);
+
+	// delete item
+	if (flag != FLAG_INTERFACE)
+		return;
+
+	stack_push[1 + atomic_inc(&stack_push[0])] = cell_id;
+}
+
+
+/**
+ * compact the interface list after the beta step
+ *
+ * all items which are still interface cells are pushed to 'stack_push', the remaining ones are deleted.
+ */
+__kernel void kernel_lbm_beta_interface_list(
+		__global const int *flag_array,			// 0) flags after the flag conversions
+		__global const int *old_flag_array,		// 1) flags before the flag conversions
+		__global const T *fluid_fraction_array,	// 2) fluid fraction after the flag conversions
+		__global const int *stack,				// 3) interface cells before the flag conversions
+		__global const int *stack_new,			// 4) converted cells
+		__global int *stack_push,				// 5) destination stack
+		__constant T *params			// 6) simulation parameters (PARAM_* indices)
+		CELL_STATE_STORE_KERNEL_ARG				// 7) packed cell state (only with CELL_STATE)
+)
+{
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
+	const int cell_id = getInterfaceListCellId(old_flag_array, stack, stack_new);
+
+	if (cell_id < 0)
+		return;
+
+	int flag = flag_array[cell_id];
+
+	STORE_CELL_STATE(cell_id, flag, fluid_fraction_array[cell_id]);
+
+	// delete item
+	if (flag != FLAG_INTERFACE)
+		return;
+
+	stack_push[1 + atomic_inc(&stack_push[0])] = cell_id;
+}
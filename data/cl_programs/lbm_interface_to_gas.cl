@@ -1,7 +1,7 @@
 #include "data/cl_programs/lbm_inc_header.h"
 
 __kernel void kernel_interface_to_gas(
-			__global T *x_global_dd,		// 0) density distributions
+			__global DD_T *x_global_dd,		// 0) density distributions
 			__global int *flag_array,		// 1) flags
 			__global T *x_velocity_array,	// 2) velocities
 			__global T *x_density_array,		// 3) densities
@@ -9,14 +9,19 @@ __kernel void kernel_interface_to_gas(
 			__global T *fluid_mass_array,	// 4) fluid mass
 			__global T *fluid_fraction_array,	// 5) fluid fraction
 
-			__const T mass_exchange_factor	// 6) mass exchange factor
+			__constant T *params	// 6) simulation parameters (PARAM_* indices)
+			CONVERSION_KERNEL_ARG			// 7) active tile list or cell list (only with ACTIVE_TILES or INTERFACE_WORKLIST)
 		)
 {
+	const T mass_exchange_factor = params[PARAM_MASS_EXCHANGE_FACTOR];
+
 #if !INTERFACE_CHANGE
 	return;
 #endif
 
-	const size_t gid = get_global_id(0);
+	CONVERSION_KERNEL_RANGE_CHECK();
+
+	const size_t gid = GET_CONVERSION_CELL_ID();
 
 	// load cell type flag
 	const int flag = flag_array[gid];
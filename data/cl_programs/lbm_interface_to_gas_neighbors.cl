@@ -10,7 +10,7 @@
  * distributed mass directly to it's own mass
  */
 __kernel void kernel_interface_to_gas_neighbors(
-			__global T *x_global_dd,			// 0) density distributions
+			__global DD_T *x_global_dd,			// 0) density distributions
 			__global int *flag_array,			// 1) flags
 			__global T *x_velocity_array,		// 2) velocities
 			__global T *x_density_array,			// 3) densities
@@ -18,9 +18,13 @@ __kernel void kernel_interface_to_gas_neighbors(
 			__global T *fluid_mass_array,		// 4) fluid mass
 			__global T *x_fluid_fraction_array,	// 5) fluid fraction
 			__global T *distribute_fluid_mass	// 6) fluid mass to be distributed
+			CONVERSION_KERNEL_ARG			// 7) active tile list or cell list (only with ACTIVE_TILES or INTERFACE_WORKLIST)
+			CONVERSION_PUSH_KERNEL_ARG		// 8) list of converted cells (only with INTERFACE_WORKLIST)
 )
 {
-	const size_t gid = get_global_id(0);
+	CONVERSION_KERNEL_RANGE_CHECK();
+
+	const size_t gid = GET_CONVERSION_CELL_ID();
 
 	int flag = flag_array[gid];
 	int neighbor_flag;
@@ -37,40 +41,39 @@ __kernel void kernel_interface_to_gas_neighbors(
 	#define STD_STUFF												\
 		neighbor_flag = flag_array[dd_index];						\
 		if (neighbor_flag == FLAG_FLUID)							\
-			flag_array[dd_index] = FLAG_INTERFACE;					\
+			CONVERT_CELL_FLAG(dd_index, FLAG_FLUID, FLAG_INTERFACE)	\
 		if (neighbor_flag & (FLAG_FLUID | FLAG_INTERFACE))			\
 			neighbored_fluid_interface_cells += 1.0;
 #else
 	#define STD_STUFF										\
-		if (flag_array[dd_index] == FLAG_FLUID)				\
-			flag_array[dd_index] = FLAG_INTERFACE;
+		CONVERT_CELL_FLAG(dd_index, FLAG_FLUID, FLAG_INTERFACE)
 #endif
 		// we leave the fluid mass and fluid fraction unchanged cz. those should be already around 1.0
 
 		// check neighbored cells if they are fluid cells and convert them to interface cells
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X);			STD_STUFF
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 0);			STD_STUFF
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 0);			STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y);			STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 0);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 0);			STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Z);			STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Z);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, -1);			STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 0, 1);			STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Y);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Y);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Y);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Y);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, -1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 1, 0);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, -1, 0);	STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_NEG_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_Y + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_Y + DELTA_NEG_Z);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, -1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, -1, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 0, 1, -1);	STD_STUFF;
 
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_NEG_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_NEG_X + DELTA_POS_Z);	STD_STUFF;
-		dd_index = DOMAIN_WRAP(gid + DELTA_POS_X + DELTA_NEG_Z);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, -1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, -1, 0, 1);	STD_STUFF;
+		dd_index = NEIGHBOR_CELL(gid, 1, 0, -1);	STD_STUFF;
 	#undef STD_STUFF
 
 		// convert to gas cell
@@ -0,0 +1,221 @@
+#include "data/cl_programs/lbm_inc_header.h"
+
+/**
+ * recompute the velocity and density of the fluid cells from the density distributions
+ *
+ * with LAZY_MACROSCOPIC, the collision kernels only store the velocity and density of the
+ * cells read by the next simulation step (see STORE_MACROSCOPIC). this kernel computes the
+ * values of the remaining fluid cells on demand. the cells which are read by the simulation
+ * are left unchanged, thus the simulation does not depend on the execution of this kernel.
+ *
+ * without ESOTERIC_TWIST, the density distributions stored at the cell are used. if dd_swap
+ * is set, the opposite directions are exchanged in the storage (AA pattern after the alpha
+ * step). with ESOTERIC_TWIST, the incoming density distributions of the next step are used
+ * and dd_swap is the storage swap of the next step.
+ *
+ * the collision kernels store the limited velocity of the incoming density distributions plus
+ * one third of the gravitation (see lbm_inc_collision_operator.h), this kernel stores the same.
+ * after the alpha step of the AA pattern, the density distributions at the cell are the outgoing
+ * ones, thus the gravitation added by the collision is subtracted first. the limit of the relaxed
+ * momentum is the limited incoming velocity unless the momentum is over-relaxed beyond the limit.
+ * with the incoming density distributions of the next step, the values differ from the stored ones
+ * by one simulation step. the checksums with and without LAZY_MACROSCOPIC are compared by the
+ * LBM_LAZY_MACROSCOPIC variant of benchmarks/run_benchmarks.sh.
+ */
+__kernel void kernel_lbm_macroscopic(
+		__global DD_T *global_dd,		// 0) density distributions
+		__global int *flag_array,		// 1) flags
+		__global T *velocity_array,		// 2) velocities
+		__global T *density_array,		// 3) densities
+		__const int dd_swap,			// 4) storage swap of opposite directions (0 or 1)
+		__constant T *params			// 5) simulation parameters (PARAM_* indices)
+)
+{
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	if (flag_array[gid] != FLAG_FLUID)
+		return;
+
+	// skip the cells which were stored by the collision kernel
+	int neighbor_flags =
+		flag_array[NEIGHBOR_CELL(gid, -1, 0, 0)] | flag_array[NEIGHBOR_CELL(gid, 1, 0, 0)] |
+		flag_array[NEIGHBOR_CELL(gid, 0, -1, 0)] | flag_array[NEIGHBOR_CELL(gid, 0, 1, 0)] |
+		flag_array[NEIGHBOR_CELL(gid, -1, -1, 0)] | flag_array[NEIGHBOR_CELL(gid, 1, 1, 0)] |
+		flag_array[NEIGHBOR_CELL(gid, -1, 1, 0)] | flag_array[NEIGHBOR_CELL(gid, 1, -1, 0)] |
+		flag_array[NEIGHBOR_CELL(gid, -1, 0, -1)] | flag_array[NEIGHBOR_CELL(gid, 1, 0, 1)] |
+		flag_array[NEIGHBOR_CELL(gid, -1, 0, 1)] | flag_array[NEIGHBOR_CELL(gid, 1, 0, -1)] |
+		flag_array[NEIGHBOR_CELL(gid, 0, -1, -1)] | flag_array[NEIGHBOR_CELL(gid, 0, 1, 1)] |
+		flag_array[NEIGHBOR_CELL(gid, 0, -1, 1)] | flag_array[NEIGHBOR_CELL(gid, 0, 1, -1)] |
+		flag_array[NEIGHBOR_CELL(gid, 0, 0, -1)] | flag_array[NEIGHBOR_CELL(gid, 0, 0, 1)];
+
+	if (neighbor_flags & (FLAG_GAS | FLAG_INTERFACE))
+		return;
+
+#if ESOTERIC_TWIST
+	#define LOAD_DD(i)	T dd##i = DD_LOAD(global_dd, ET_DD_INDEX(ET_CELL_##i(gid), i, dd_swap), i);
+#else
+	#define LOAD_DD(i)	T dd##i = DD_LOAD(global_dd, DD_CELL(gid) + ((i) ^ dd_swap)*DD_DIR_STRIDE, i);
+#endif
+
+	/*
+	 * dd 0-3: f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0)
+	 * dd 4-7: f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0)
+	 * dd 8-11: f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1)
+	 * dd 12-15: f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1)
+	 * dd 16-18: f(0,0,1), f(0,0,-1),  f(0,0,0)
+	 */
+	LOAD_DD(0)	LOAD_DD(1)	LOAD_DD(2)	LOAD_DD(3)
+	LOAD_DD(4)	LOAD_DD(5)	LOAD_DD(6)	LOAD_DD(7)
+	LOAD_DD(8)	LOAD_DD(9)	LOAD_DD(10)	LOAD_DD(11)
+	LOAD_DD(12)	LOAD_DD(13)	LOAD_DD(14)	LOAD_DD(15)
+	LOAD_DD(16)	LOAD_DD(17)
+#undef LOAD_DD
+
+#if ESOTERIC_TWIST
+	T dd18 = DD_LOAD(global_dd, ET_DD_INDEX_18(gid), 18);
+#else
+	T dd18 = DD_LOAD(global_dd, DD_CELL(gid) + 18*DD_DIR_STRIDE, 18);
+#endif
+
+	T rho = dd0 + dd1 + dd2 + dd3 + dd4 + dd5 + dd6 + dd7 + dd8 + dd9 + dd10 + dd11 + dd12 + dd13 + dd14 + dd15 + dd16 + dd17 + dd18;
+
+	T velocity_x = (dd0 - dd1) + (dd4 - dd5) + (dd6 - dd7) + (dd8 - dd9) + (dd10 - dd11);
+	T velocity_y = (dd2 - dd3) + (dd4 - dd5) - (dd6 - dd7) + (dd12 - dd13) + (dd14 - dd15);
+	T velocity_z = (dd8 - dd9) - (dd10 - dd11) + (dd12 - dd13) - (dd14 - dd15) + (dd16 - dd17);
+
+#if GRAVITATION
+	const T gravitation0 = params[PARAM_GRAVITATION0];
+	const T gravitation1 = params[PARAM_GRAVITATION1];
+	const T gravitation2 = params[PARAM_GRAVITATION2];
+
+#if !ESOTERIC_TWIST
+	if (dd_swap)
+	{
+		// outgoing density distributions: remove the momentum of the gravitation (fluid fraction 1)
+		velocity_x -= (T)(1.0f/3.0f)*gravitation0*rho;
+		velocity_y -= (T)(1.0f/3.0f)*gravitation1*rho;
+		velocity_z -= (T)(1.0f/3.0f)*gravitation2*rho;
+	}
+#endif
+#endif
+
+#if COMPRESSIBLE_EQUILIBRIUM_DISTRIBUTION
+	velocity_x /= rho;
+	velocity_y /= rho;
+	velocity_z /= rho;
+#endif
+
+#if LIMIT_VELOCITY
+	T a = velocity_x*velocity_x + velocity_y*velocity_y + velocity_z*velocity_z;
+	if (a > LIMIT_VELOCITY_SPEED*LIMIT_VELOCITY_SPEED)
+	{
+		a = LIMIT_VELOCITY_SPEED/sqrt(a);
+		velocity_x *= a;
+		velocity_y *= a;
+		velocity_z *= a;
+	}
+#endif
+
+#if GRAVITATION
+	velocity_x += (T)(1.0f/3.0f)*gravitation0;
+	velocity_y += (T)(1.0f/3.0f)*gravitation1;
+	velocity_z += (T)(1.0f/3.0f)*gravitation2;
+#endif
+
+	velocity_array[gid] = velocity_x;
+	velocity_array[DOMAIN_CELLS+gid] = velocity_y;
+	velocity_array[2*DOMAIN_CELLS+gid] = velocity_z;
+
+	density_array[gid] = rho;
+}
+
+/**
+ * rescale the density distributions of the fluid and interface cells after a change of the timestep
+ *
+ * the lattice velocity is proportional to the timestep, thus the equilibrium part is recomputed for
+ * the velocity scaled by velocity_scale (new timestep / old timestep). the non-equilibrium part is
+ * scaled by non_equilibrium_scale, (new timestep * new tau) / (old timestep * old tau). the density
+ * is kept. the stored velocities are scaled as well since they are read by the flag conversions.
+ *
+ * the storage of the density distributions is the same as for kernel_lbm_macroscopic. each cell
+ * only writes back its own density distributions, thus the kernel can be executed in place.
+ */
+__kernel void kernel_lbm_timestep_rescale(
+		__global DD_T *global_dd,		// 0) density distributions
+		__global int *flag_array,		// 1) flags
+		__global T *velocity_array,		// 2) velocities
+		__const int dd_swap,			// 3) storage swap of opposite directions (0 or 1)
+		T velocity_scale,				// 4) scale factor of the velocity
+		T non_equilibrium_scale			// 5) scale factor of the non-equilibrium part
+)
+{
+	DOMAIN_RANGE_CHECK();
+
+	const size_t gid = get_global_id(0);
+
+	if (!(flag_array[gid] & (FLAG_FLUID | FLAG_INTERFACE)))
+		return;
+
+#if ESOTERIC_TWIST
+	#define DD_INDEX(i)		ET_DD_INDEX(ET_CELL_##i(gid), i, dd_swap)
+	#define DD_INDEX_18		ET_DD_INDEX_18(gid)
+#else
+	#define DD_INDEX(i)		(DD_CELL(gid) + ((i) ^ dd_swap)*DD_DIR_STRIDE)
+	#define DD_INDEX_18		(DD_CELL(gid) + 18*DD_DIR_STRIDE)
+#endif
+
+#define LOAD_DD(i)	T dd##i = DD_LOAD(global_dd, DD_INDEX(i), i);
+	LOAD_DD(0)	LOAD_DD(1)	LOAD_DD(2)	LOAD_DD(3)
+	LOAD_DD(4)	LOAD_DD(5)	LOAD_DD(6)	LOAD_DD(7)
+	LOAD_DD(8)	LOAD_DD(9)	LOAD_DD(10)	LOAD_DD(11)
+	LOAD_DD(12)	LOAD_DD(13)	LOAD_DD(14)	LOAD_DD(15)
+	LOAD_DD(16)	LOAD_DD(17)
+#undef LOAD_DD
+	T dd18 = DD_LOAD(global_dd, DD_INDEX_18, 18);
+
+	T rho = dd0 + dd1 + dd2 + dd3 + dd4 + dd5 + dd6 + dd7 + dd8 + dd9 + dd10 + dd11 + dd12 + dd13 + dd14 + dd15 + dd16 + dd17 + dd18;
+
+	T velocity_x = (dd0 - dd1) + (dd4 - dd5) + (dd6 - dd7) + (dd8 - dd9) + (dd10 - dd11);
+	T velocity_y = (dd2 - dd3) + (dd4 - dd5) - (dd6 - dd7) + (dd12 - dd13) + (dd14 - dd15);
+	T velocity_z = (dd8 - dd9) - (dd10 - dd11) + (dd12 - dd13) - (dd14 - dd15) + (dd16 - dd17);
+
+#if COMPRESSIBLE_EQUILIBRIUM_DISTRIBUTION
+	velocity_x /= rho;
+	velocity_y /= rho;
+	velocity_z /= rho;
+	#define EQ(i, e_u, vel2)	(DD_WEIGHT(i)*rho*((T)1.0f + (T)3.0f*(e_u) + (T)(9.0f/2.0f)*(e_u)*(e_u) - (T)(3.0f/2.0f)*(vel2)))
+#else
+	#define EQ(i, e_u, vel2)	(DD_WEIGHT(i)*(rho + (T)3.0f*(e_u) + (T)(9.0f/2.0f)*(e_u)*(e_u) - (T)(3.0f/2.0f)*(vel2)))
+#endif
+
+	T vel2 = velocity_x*velocity_x + velocity_y*velocity_y + velocity_z*velocity_z;
+	T vel2_new = vel2*velocity_scale*velocity_scale;
+
+	// f' = f_eq(rho, u') + (f - f_eq(rho, u))*non_equilibrium_scale for the lattice vector (ex, ey, ez)
+#define RESCALE_DD(i, ex, ey, ez)																\
+	{																							\
+		T e_u = (T)(ex)*velocity_x + (T)(ey)*velocity_y + (T)(ez)*velocity_z;					\
+		T dd_new = EQ(i, e_u*velocity_scale, vel2_new) + (dd##i - EQ(i, e_u, vel2))*non_equilibrium_scale;	\
+		DD_STORE(global_dd, DD_INDEX(i), i, dd_new);											\
+	}
+
+	RESCALE_DD(0, 1, 0, 0)		RESCALE_DD(1, -1, 0, 0)		RESCALE_DD(2, 0, 1, 0)		RESCALE_DD(3, 0, -1, 0)
+	RESCALE_DD(4, 1, 1, 0)		RESCALE_DD(5, -1, -1, 0)	RESCALE_DD(6, 1, -1, 0)		RESCALE_DD(7, -1, 1, 0)
+	RESCALE_DD(8, 1, 0, 1)		RESCALE_DD(9, -1, 0, -1)	RESCALE_DD(10, 1, 0, -1)	RESCALE_DD(11, -1, 0, 1)
+	RESCALE_DD(12, 0, 1, 1)		RESCALE_DD(13, 0, -1, -1)	RESCALE_DD(14, 0, 1, -1)	RESCALE_DD(15, 0, -1, 1)
+	RESCALE_DD(16, 0, 0, 1)		RESCALE_DD(17, 0, 0, -1)
+#undef RESCALE_DD
+
+	dd18 = EQ(18, (T)0.0f, vel2_new) + (dd18 - EQ(18, (T)0.0f, vel2))*non_equilibrium_scale;
+	DD_STORE(global_dd, DD_INDEX_18, 18, dd18);
+
+#undef EQ
+#undef DD_INDEX
+#undef DD_INDEX_18
+
+	velocity_array[gid] *= velocity_scale;
+	velocity_array[DOMAIN_CELLS+gid] *= velocity_scale;
+	velocity_array[2*DOMAIN_CELLS+gid] *= velocity_scale;
+}
@@ -6,6 +6,8 @@ __kernel void kernel_lbm_mass_scale(
 		T mass_scale_factor
 )
 {
+	DOMAIN_RANGE_CHECK();
+
 	const size_t gid = get_global_id(0);
 
 	fluid_mass_array[gid] *= mass_scale_factor;
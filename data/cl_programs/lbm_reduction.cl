@@ -0,0 +1,132 @@
+/**
+ * reductions over the domain cells
+ *
+ * each work item accumulates the values of the cells (gid, gid + global_size, ...) in a register.
+ * afterwards the values of the work items are reduced with a tree in local memory and the result
+ * of each work group is stored to partial_results[group_id]. only these partial results have to be
+ * read back and accumulated by the host.
+ *
+ * LOCAL_WORK_GROUP_SIZE has to be a power of two.
+ *
+ * the halo layers of a subdomain (SUBDOMAIN_HALO_LAYERS) are skipped, these cells are reduced by the neighboring subdomains.
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+#define IS_FLUID_OR_INTERFACE(flag)	((flag) == FLAG_FLUID || (flag) == FLAG_INTERFACE)
+
+#define REDUCTION_FIRST_CELL	(SUBDOMAIN_HALO_LAYERS*DOMAIN_SLICE_CELLS)
+#define REDUCTION_END_CELL		(DOMAIN_CELLS - SUBDOMAIN_HALO_LAYERS*DOMAIN_SLICE_CELLS)
+
+/**
+ * reduce the values of the work items of a work group by summation
+ */
+inline void reduceLocalSum(__local T *local_values, T value, __global T *partial_results)
+{
+	const size_t lid = get_local_id(0);
+
+	local_values[lid] = value;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (size_t i = LOCAL_WORK_GROUP_SIZE/2; i > 0; i >>= 1)
+	{
+		if (lid < i)
+			local_values[lid] += local_values[lid + i];
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if (lid == 0)
+		partial_results[get_group_id(0)] = local_values[0];
+}
+
+/**
+ * reduce the values of the work items of a work group to the maximum value
+ */
+inline void reduceLocalMax(__local T *local_values, T value, __global T *partial_results)
+{
+	const size_t lid = get_local_id(0);
+
+	local_values[lid] = value;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (size_t i = LOCAL_WORK_GROUP_SIZE/2; i > 0; i >>= 1)
+	{
+		if (lid < i)
+			local_values[lid] = max(local_values[lid], local_values[lid + i]);
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if (lid == 0)
+		partial_results[get_group_id(0)] = local_values[0];
+}
+
+
+/**
+ * sum of all values
+ */
+__kernel void kernel_reduction_sum(
+		__global const T *values,			// 0) values (one for each cell)
+		__global T *partial_results			// 1) result of each work group
+)
+{
+	__local T local_values[LOCAL_WORK_GROUP_SIZE];
+
+	T sum = 0.0f;
+	for (size_t gid = REDUCTION_FIRST_CELL + get_global_id(0); gid < REDUCTION_END_CELL; gid += get_global_size(0))
+		sum += values[gid];
+
+	reduceLocalSum(local_values, sum, partial_results);
+}
+
+
+/**
+ * sum of all components of the values of the fluid and interface cells
+ */
+__kernel void kernel_reduction_masked_sum(
+		__global const T *values,			// 0) values (components are stored with a stride of DOMAIN_CELLS)
+		__global const int *flag_array,		// 1) flags
+		__global T *partial_results,		// 2) result of each work group
+		const int components				// 3) number of components of each value
+)
+{
+	__local T local_values[LOCAL_WORK_GROUP_SIZE];
+
+	T sum = 0.0f;
+	for (size_t gid = REDUCTION_FIRST_CELL + get_global_id(0); gid < REDUCTION_END_CELL; gid += get_global_size(0))
+	{
+		if (!IS_FLUID_OR_INTERFACE(flag_array[gid]))
+			continue;
+
+		for (int c = 0; c < components; c++)
+			sum += values[gid + c*DOMAIN_CELLS];
+	}
+
+	reduceLocalSum(local_values, sum, partial_results);
+}
+
+
+/**
+ * maximum squared length of the velocities of the fluid and interface cells
+ */
+__kernel void kernel_reduction_masked_max_length2(
+		__global const T *velocity_array,	// 0) velocities
+		__global const int *flag_array,		// 1) flags
+		__global T *partial_results			// 2) result of each work group
+)
+{
+	__local T local_values[LOCAL_WORK_GROUP_SIZE];
+
+	T max_length2 = 0.0f;
+	for (size_t gid = REDUCTION_FIRST_CELL + get_global_id(0); gid < REDUCTION_END_CELL; gid += get_global_size(0))
+	{
+		if (!IS_FLUID_OR_INTERFACE(flag_array[gid]))
+			continue;
+
+		T velocity_x = velocity_array[gid];
+		T velocity_y = velocity_array[DOMAIN_CELLS+gid];
+		T velocity_z = velocity_array[2*DOMAIN_CELLS+gid];
+
+		max_length2 = max(max_length2, velocity_x*velocity_x + velocity_y*velocity_y + velocity_z*velocity_z);
+	}
+
+	reduceLocalMax(local_values, max_length2, partial_results);
+}
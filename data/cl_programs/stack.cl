@@ -1,58 +1,31 @@
-__kernel void main(
-		__global int stack_push[MAX_STACK_SIZE],
-		__global int stack_delete[MAX_STACK_SIZE]
-		)
+/**
+ * stacks of cell ids
+ *
+ * the first entry of each stack stores the number of items on the stack, the cell ids follow.
+ * new items are pushed with an atomic increment of the counter, thus the order of the items
+ * is not deterministic.
+ *
+ * the counter of the destination stack has to be reset before each kernel is launched.
+ */
+#include "data/cl_programs/lbm_inc_header.h"
+
+
+/**
+ * push each cell with the given flag to the stack
+ *
+ * this kernel is launched for all domain cells
+ */
+__kernel void kernel_stack_push_flag(
+		__global const int *flag_array,		// 0) flags
+		__global int *stack_push,			// 1) destination stack
+		int flag							// 2) flag of cells to push
+)
 {
-	const size_t gid = get_global_id(0);
-
-	int items_on_stack_delete = stack_delete[0];
-
-	// load the index of the item on stack_push which was deleted
-	int deleted_item_on_stack_push = stack_delete[gid];
-
-	/*
-	 * the deletable items are one less since the first element is
-	 * the counter for the items on the stack
-	 */
-	int deletable_items = items_on_stack_delete-1;
-
-	/*
-	 * immediately return if this thread is not intended to fill any gaps
-	 */
-	if (gid > deletable_items)
-		return;
-
-	int items_on_stack_push = stack_push[0];
+	DOMAIN_RANGE_CHECK();
 
-	/*
-	 * there are at most deletable_items on the top of the stack.
-	 * this also means, that there have to be at least deletable_items
-	 * undeleted items within the "2*deletable_items" topmost items.
-	 */
-	int lower_limit = items_on_stack_push - deletable_items;
-
-	int i = items_on_stack_push-1;
-	int found_items = 0;
-	for (; i >= lower_limit; i--)
-	{
-		/*
-		 * increment 'found_items' for each valid item which state was
-		 * not set to deleted
-		 */
-		if (stack_push[i] != -1)
-			found_items++;
-
-		/*
-		 * if we found 'gid' valid items, we are happy and use this
-		 * to fill the gap which index is stored at stack_delete[gid]
-		 */
-		if (found_items == gid)
-			break;
-	}
-
-#if 1
-	if (i < lower_limit)	{/*ERROR*/}
-#endif
+	const size_t gid = get_global_id(0);
 
-	stack_push[stack_delete[gid]] = stack_push[i];
+	if (flag_array[gid] == flag)
+		stack_push[1 + atomic_inc(&stack_push[0])] = gid;
 }
+
@@ -109,7 +109,16 @@
 #endif
 
 
-#ifdef DOMAIN_CELLS_POW2
+#if GHOST_LAYER
+	/**
+	 * the cell buffers are padded with ghost cells before and after the domain cells.
+	 * neighbor indices never wrap around, negative deltas are restored by the conversion to int.
+	 */
+	inline int DOMAIN_WRAP(size_t A)
+	{
+		return (int)(A);
+	}
+#elif defined(DOMAIN_CELLS_POW2)
 	/**
 	 * it's REALLY IMPORTANT (!!!) that A is a positive number!!!
 	 */
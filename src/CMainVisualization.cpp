@@ -678,11 +678,15 @@ void CMainVisualization<T>::renderLoop()
 
 //							std::cout << lbm_simulation_timesteps_to_do << std::endl;
 						for (int i = 0; i < lbm_simulation_timesteps_to_do; i++)
+						{
 							cLbmOpenCl_ptr->simulationStep();
+							cLbmOpenCl_ptr->updateAdaptiveTimestep();
+						}
 					}
 					else
 					{
 						cLbmOpenCl_ptr->simulationStep();
+						cLbmOpenCl_ptr->updateAdaptiveTimestep();
 					}
 #endif
 				}
@@ -0,0 +1,473 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CLBMAUTOTUNER_HPP
+#define CLBMAUTOTUNER_HPP
+
+#include "lbm/CLbmOpenClAA.hpp"
+#include "lbm/CLbmOpenClAB_1.hpp"
+#include "lbm/CLbmOpenClAB_2.hpp"
+#include "lbm/CLbmOpenClAB_1_shared_memory.hpp"
+#include "lbm/CLbmOpenClET.hpp"
+#include "libopencl/CCLSkeleton.hpp"
+#include "lib/CStopwatch.hpp"
+#include "lib/CError.hpp"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <list>
+
+/**
+ * text file storing the tuning results. each line contains the key (device, domain and program options), the
+ * implementation number and the comma separated list of work group sizes.
+ */
+#ifndef LBM_AUTOTUNE_DATABASE
+	#define LBM_AUTOTUNE_DATABASE	LBM_PROGRAM_CACHE_DIR "/autotune.txt"
+#endif
+
+/**
+ * number of simulation steps to run before and during the time measurement of each configuration
+ */
+#define LBM_AUTOTUNE_WARMUP_STEPS	4
+#define LBM_AUTOTUNE_STEPS			32
+
+/**
+ * range of the work group sizes (powers of two) which are tested
+ */
+#define LBM_AUTOTUNE_MIN_WORK_GROUP_SIZE	32
+#define LBM_AUTOTUNE_MAX_WORK_GROUP_SIZE	1024
+
+/**
+ * tune the work group size of each kernel separately after the fastest implementation was found
+ */
+#ifndef LBM_AUTOTUNE_REFINE_KERNELS
+	#define LBM_AUTOTUNE_REFINE_KERNELS	1
+#endif
+
+
+/**
+ * \brief select the fastest OpenCL implementation and work group sizes for the current device and domain
+ *
+ * the tuning is done in two phases:
+ *
+ * 1) each OpenCL implementation is timed with the same work group size for all kernels
+ * 2) starting with the fastest combination, the work group size of each kernel is changed
+ *    separately and kept if the simulation step gets faster
+ *
+ * the result is stored to LBM_AUTOTUNE_DATABASE and reused by later runs with the same device,
+ * domain size and build configuration.
+ */
+template <typename T>
+class CLbmAutotuner
+{
+	CCLSkeleton &cl;
+	bool verbose;
+
+	/*
+	 * simulation parameters used for the time measurements
+	 */
+	CVector<3,int> domain_cells;
+	T domain_length_x;
+	T viscosity;
+	CVector<3,T> gravitation;
+	T max_sim_gravitation_length;
+	T timestep;
+	T mass_exchange_factor;
+	int init_flags;
+	std::list<int> number_of_registers_list;
+
+public:
+	CError error;		///< error handler
+
+	int implementation_nr;						///< selected implementation
+	std::list<int> number_of_threads_list;		///< selected work group size for each kernel
+
+	CLbmAutotuner(	CCLSkeleton &p_cl,
+					bool p_verbose = false
+	)	:
+		cl(p_cl),
+		verbose(p_verbose),
+		implementation_nr(0)
+	{
+	}
+
+	/**
+	 * create one of the OpenCL implementations (see -a parameter)
+	 */
+	static CLbmOpenClInterface<T> *createImplementation(	int p_implementation_nr,
+															CCLSkeleton &p_cl,
+															bool p_verbose
+	)
+	{
+		switch(p_implementation_nr)
+		{
+			case 1:	return new CLbmOpenClAB_1<T>(p_cl, p_verbose);
+			case 2:	return new CLbmOpenClAB_2<T>(p_cl, p_verbose);
+			case 3:	return new CLbmOpenClAB_1_shared_memory<T>(p_cl, p_verbose);
+			case 5:	return new CLbmOpenClET<T>(p_cl, p_verbose);
+			default:	return new CLbmOpenClAA<T>(p_cl, p_verbose);
+		}
+	}
+
+private:
+	/**
+	 * return the compile time options which change the program defines of the implementations
+	 */
+	static std::string getProgramOptions()
+	{
+		std::ostringstream s;
+
+#define LBM_AUTOTUNE_OPTION(option)	s << #option << "=" << (option) << ";"
+		LBM_AUTOTUNE_OPTION(LBM_DD_BLOCK_SIZE);
+		LBM_AUTOTUNE_OPTION(LBM_CELL_BRICK_SIZE);
+		LBM_AUTOTUNE_OPTION(LBM_GHOST_LAYER);
+		LBM_AUTOTUNE_OPTION(LBM_LAZY_MACROSCOPIC);
+
+		LBM_AUTOTUNE_OPTION(LBM_AA_DD_HALF);
+		LBM_AUTOTUNE_OPTION(LBM_AA_ACTIVE_TILES);
+		LBM_AUTOTUNE_OPTION(LBM_AA_ACTIVE_TILE_SIZE);
+		LBM_AUTOTUNE_OPTION(LBM_AA_INTERFACE_WORKLIST);
+		LBM_AUTOTUNE_OPTION(LBM_AA_FUSED_FLAG_CONVERSION);
+		LBM_AUTOTUNE_OPTION(LBM_AA_RECORDED_STEPS);
+
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_DD_HALF);
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_FUSED_FLAG_CONVERSION);
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_TILED_3D);
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_TILE_SIZE_X);
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_TILE_SIZE_Y);
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_TILE_SIZE_Z);
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_OUT_OF_ORDER_QUEUE);
+
+		LBM_AUTOTUNE_OPTION(LBM_AB_2_DD_HALF);
+		LBM_AUTOTUNE_OPTION(LBM_AB_2_FUSED_FLAG_CONVERSION);
+
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_SHARED_MEMORY_DD_HALF);
+		LBM_AUTOTUNE_OPTION(LBM_AB_1_SHARED_MEMORY_FUSED_FLAG_CONVERSION);
+
+		LBM_AUTOTUNE_OPTION(LBM_ET_DD_HALF);
+		LBM_AUTOTUNE_OPTION(LBM_ET_FUSED_FLAG_CONVERSION);
+		LBM_AUTOTUNE_OPTION(LBM_ET_IN_PLACE_CELL_STATE);
+#undef LBM_AUTOTUNE_OPTION
+
+		return s.str();
+	}
+
+	/**
+	 * return the key of the device, domain size and program options for the tuning database
+	 *
+	 * the program options are stored as hash, results of a different build configuration are not reused.
+	 */
+	std::string getKey()
+	{
+		std::ostringstream key;
+		key << cl.cDevice.getInfo<CL_DEVICE_NAME>() << "|" << cl.cDevice.getInfo<CL_DRIVER_VERSION>() << "|";
+		key << domain_cells[0] << "x" << domain_cells[1] << "x" << domain_cells[2] << "|" << sizeof(T) << "|";
+		key << std::hex << CLbmOpenClInterface<T>::hashString(getProgramOptions());
+
+		// the database is whitespace separated
+		std::string s = key.str();
+		for (size_t i = 0; i < s.size(); i++)
+			if (s[i] == ' ' || s[i] == '\t')
+				s[i] = '_';
+		return s;
+	}
+
+	static std::string threadsListToString(const std::list<int> &list)
+	{
+		std::ostringstream s;
+		for (std::list<int>::const_iterator i = list.begin(); i != list.end(); i++)
+		{
+			if (i != list.begin())
+				s << ",";
+			s << *i;
+		}
+		return s.str();
+	}
+
+	/**
+	 * load the tuning result for the key from the database
+	 *
+	 * \return true, if a result was found
+	 */
+	bool loadResult(const std::string &key)
+	{
+		std::ifstream file(LBM_AUTOTUNE_DATABASE);
+		if (!file.is_open())
+			return false;
+
+		bool found = false;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream s(line);
+			std::string line_key, threads;
+			int nr;
+
+			if (!(s >> line_key >> nr >> threads) || line_key != key)
+				continue;
+
+			implementation_nr = nr;
+			number_of_threads_list.clear();
+
+			std::istringstream t(threads);
+			std::string value;
+			while (std::getline(t, value, ','))
+				number_of_threads_list.push_back(atoi(value.c_str()));
+
+			found = true;
+		}
+
+		return found;
+	}
+
+	/**
+	 * store the tuning result for the key to the database and remove previous results for the key
+	 */
+	void storeResult(const std::string &key)
+	{
+		std::vector<std::string> lines;
+
+		std::ifstream in_file(LBM_AUTOTUNE_DATABASE);
+		std::string line;
+		while (std::getline(in_file, line))
+		{
+			std::istringstream s(line);
+			std::string line_key;
+			if ((s >> line_key) && line_key != key)
+				lines.push_back(line);
+		}
+		in_file.close();
+
+		std::ostringstream new_line;
+		new_line << key << " " << implementation_nr << " " << threadsListToString(number_of_threads_list);
+		lines.push_back(new_line.str());
+
+		mkdir(LBM_PROGRAM_CACHE_DIR, 0755);
+
+		std::ofstream out_file(LBM_AUTOTUNE_DATABASE, std::ios::out | std::ios::trunc);
+		if (!out_file.is_open())
+		{
+			std::cerr << "Warning: unable to store autotuning result to " << LBM_AUTOTUNE_DATABASE << std::endl;
+			return;
+		}
+
+		for (size_t i = 0; i < lines.size(); i++)
+			out_file << lines[i] << std::endl;
+	}
+
+	/**
+	 * measure the time of one simulation step for the configuration
+	 *
+	 * \return seconds per simulation step or -1 if the configuration failed
+	 */
+	double timeConfiguration(	int p_implementation_nr,				///< implementation to test
+								size_t p_work_group_size,				///< default work group size
+								std::list<int> &p_number_of_threads_list,	///< work group sizes of the kernels
+								size_t &o_work_group_size_count			///< number of work group sizes used by the implementation
+	)
+	{
+		CLbmOpenClInterface<T> *lbm = createImplementation(p_implementation_nr, cl, false);
+
+		lbm->init(	domain_cells,
+					domain_length_x,
+					viscosity,
+					gravitation,
+					max_sim_gravitation_length,
+					timestep,
+					mass_exchange_factor,
+					p_work_group_size,
+					init_flags,
+					p_number_of_threads_list,
+					number_of_registers_list
+				);
+
+		double seconds = -1;
+
+		if (!lbm->error())
+		{
+			o_work_group_size_count = lbm->work_group_size_count;
+
+			for (int i = 0; i < LBM_AUTOTUNE_WARMUP_STEPS; i++)
+				lbm->simulationStep();
+			lbm->wait();
+
+			CStopwatch cStopwatch;
+			cStopwatch.start();
+
+			for (int i = 0; i < LBM_AUTOTUNE_STEPS; i++)
+				lbm->simulationStep();
+			lbm->wait();
+
+			cStopwatch.stop();
+
+			// kernels which failed to launch leave the fluid at rest
+			float velocity_checksum = lbm->getVelocityChecksum();
+			if (velocity_checksum > 0 && velocity_checksum == velocity_checksum)
+				seconds = cStopwatch()/(double)LBM_AUTOTUNE_STEPS;
+		}
+
+		delete lbm;
+
+		if (verbose)
+		{
+			std::cout << "autotune: implementation " << p_implementation_nr << ", work group sizes (" << threadsListToString(p_number_of_threads_list) << "), default " << p_work_group_size << ": ";
+			if (seconds < 0)
+				std::cout << "failed" << std::endl;
+			else
+				std::cout << seconds*1000.0 << " ms" << std::endl;
+		}
+
+		return seconds;
+	}
+
+	/**
+	 * run the time measurements to find the fastest implementation and work group sizes
+	 */
+	void tune()
+	{
+		size_t max_work_group_size = cl.cDevice.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+
+		std::vector<size_t> candidates;
+		for (size_t s = LBM_AUTOTUNE_MIN_WORK_GROUP_SIZE; s <= LBM_AUTOTUNE_MAX_WORK_GROUP_SIZE && s <= max_work_group_size; s <<= 1)
+			candidates.push_back(s);
+
+		if (candidates.empty())
+		{
+			error << "autotune: maximum work group size of device is smaller than " << LBM_AUTOTUNE_MIN_WORK_GROUP_SIZE << CError::endl;
+			return;
+		}
+
+		static const int implementations[] = {0, 1, 2, 3, 5};
+
+		double best_seconds = -1;
+		size_t best_work_group_size = 0;
+		size_t best_work_group_size_count = 0;
+
+		/*
+		 * PHASE 1: same work group size for all kernels
+		 */
+		for (size_t i = 0; i < sizeof(implementations)/sizeof(implementations[0]); i++)
+		{
+			for (size_t c = 0; c < candidates.size(); c++)
+			{
+				std::list<int> empty_list;
+				size_t work_group_size_count = 0;
+
+				double seconds = timeConfiguration(implementations[i], candidates[c], empty_list, work_group_size_count);
+				if (seconds < 0)
+					continue;
+
+				if (best_seconds < 0 || seconds < best_seconds)
+				{
+					best_seconds = seconds;
+					implementation_nr = implementations[i];
+					best_work_group_size = candidates[c];
+					best_work_group_size_count = work_group_size_count;
+				}
+			}
+		}
+
+		if (best_seconds < 0)
+		{
+			error << "autotune: all configurations failed" << CError::endl;
+			return;
+		}
+
+		std::vector<int> best_sizes(best_work_group_size_count, (int)best_work_group_size);
+
+#if LBM_AUTOTUNE_REFINE_KERNELS
+		/*
+		 * PHASE 2: work group size of each kernel separately.
+		 * the first entry belongs to the initialization kernel which is not part of the simulation step.
+		 */
+		for (size_t k = 1; k < best_sizes.size(); k++)
+		{
+			for (size_t c = 0; c < candidates.size(); c++)
+			{
+				if ((int)candidates[c] == best_sizes[k])
+					continue;
+
+				std::vector<int> sizes = best_sizes;
+				sizes[k] = candidates[c];
+
+				std::list<int> list(sizes.begin(), sizes.end());
+				size_t work_group_size_count = 0;
+
+				double seconds = timeConfiguration(implementation_nr, best_work_group_size, list, work_group_size_count);
+				if (seconds >= 0 && seconds < best_seconds)
+				{
+					best_seconds = seconds;
+					best_sizes = sizes;
+				}
+			}
+		}
+#endif
+
+		number_of_threads_list.assign(best_sizes.begin(), best_sizes.end());
+	}
+
+public:
+	/**
+	 * load the tuning result for the current device and domain from the database or run the
+	 * time measurements if no result exists.
+	 *
+	 * the parameters are the same as for CLbmOpenClInterface::init().
+	 */
+	void setup(	CVector<3,int> &p_domain_cells,
+				T p_domain_length_x,
+				T p_viscosity,
+				CVector<3,T> &p_gravitation,
+				T p_max_sim_gravitation_length,
+				T p_timestep,
+				T p_mass_exchange_factor,
+				int p_init_flags,
+				std::list<int> &p_number_of_registers_list
+	)
+	{
+		domain_cells = p_domain_cells;
+		domain_length_x = p_domain_length_x;
+		viscosity = p_viscosity;
+		gravitation = p_gravitation;
+		max_sim_gravitation_length = p_max_sim_gravitation_length;
+		timestep = p_timestep;
+		mass_exchange_factor = p_mass_exchange_factor;
+		init_flags = p_init_flags;
+		number_of_registers_list = p_number_of_registers_list;
+
+		std::string key = getKey();
+
+		if (loadResult(key))
+		{
+			if (verbose)
+				std::cout << "autotune: using stored result for " << key << std::endl;
+		}
+		else
+		{
+			std::cout << "autotune: no stored result for " << key << ", running time measurements" << std::endl;
+
+			tune();
+			if (error())
+				return;
+
+			storeResult(key);
+		}
+
+		std::cout << "autotune: implementation " << implementation_nr << ", work group sizes (" << threadsListToString(number_of_threads_list) << ")" << std::endl;
+	}
+};
+
+#endif
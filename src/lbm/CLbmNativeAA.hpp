@@ -0,0 +1,1280 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLBM_NATIVE_AA_HPP
+#define CLBM_NATIVE_AA_HPP
+
+#include "CLbmParameters.hpp"
+#include "CLbmOpenClInterface.hpp"
+#include "libopencl/CCLSkeleton.hpp"
+#include "lib/CError.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+#if __linux
+	#include <sched.h>
+#endif
+
+/**
+ * pin each OpenMP thread to one of the cpus available to the process
+ *
+ * the pinning is skipped if the affinity is already controlled via the environment
+ */
+#define LBM_NATIVE_AA_PIN_THREADS	1
+
+/**
+ * alignment of host buffers in bytes (cache line)
+ */
+#define LBM_NATIVE_AA_ALIGNMENT		64
+
+
+/**
+ * native CPU implementation of the lattice boltzmann free surface simulation using the A-A pattern
+ *
+ * this is a host port of CLbmOpenClAA with the default settings from data/cl_programs/lbm_config.cl
+ * (compressible BGK, gravitation, increased mass exchange, velocity limitation, loneley interface remover).
+ *
+ * no OpenCL program is compiled. all data is stored in host memory with the same layout
+ * as the OpenCL buffers (SoA, density distribution i of cell gid at dd[gid + i*DOMAIN_CELLS]).
+ *
+ * the domain is split along the z and y axis among the OpenMP threads with a static schedule.
+ * the buffers are initialized with the same schedule (first touch) to place each slab on the
+ * NUMA node of the thread which is working on it.
+ */
+template <typename T>
+class CLbmNativeAA	:
+	public CLbmOpenClInterface<T>
+{
+	using CLbmOpenClInterface<T>::initInterface;
+
+	enum
+	{
+		FLAG_OBSTACLE			= CLbmOpenClInterface<T>::LBM_FLAG_OBSTACLE,
+		FLAG_FLUID				= CLbmOpenClInterface<T>::LBM_FLAG_FLUID,
+		FLAG_INTERFACE			= CLbmOpenClInterface<T>::LBM_FLAG_INTERFACE,
+		FLAG_GAS				= CLbmOpenClInterface<T>::LBM_FLAG_GAS,
+
+		FLAG_INTERFACE_TO_FLUID	= CLbmOpenClInterface<T>::LBM_FLAG_INTERFACE_TO_FLUID,
+		FLAG_INTERFACE_TO_GAS	= CLbmOpenClInterface<T>::LBM_FLAG_INTERFACE_TO_GAS,
+		FLAG_GAS_TO_INTERFACE	= CLbmOpenClInterface<T>::LBM_FLAG_GAS_TO_INTERFACE,
+
+		FLAGS_GAS_OBSTACLE		= FLAG_GAS | FLAG_OBSTACLE
+	};
+
+	int cells_x;				///< domain cells in x direction
+	int cells_y;				///< domain cells in y direction
+	int cells_z;				///< domain cells in z direction
+
+	T *dd;						///< density distributions
+	T *velocity;				///< velocity (3 components, SoA)
+	T *density;					///< density
+	T *fluid_mass;				///< fluid mass
+	T *fluid_fraction;			///< fluid fraction
+	T *new_fluid_fraction;		///< new fluid fraction
+	int *flags;					///< flags
+	int *new_flags;				///< new flags
+	int *tmp_flags;				///< temporary flags for race free flag conversions
+
+	int threads;				///< number of threads used for computations
+
+public:
+	/**
+	 * Setup class with OpenCL skeleton.
+	 *
+	 * the skeleton is not used for computations, an uninitialized skeleton is sufficient.
+	 */
+	CLbmNativeAA(	const CCLSkeleton &cClSkeleton,
+					bool p_verbose = false
+	)	:
+		CLbmOpenClInterface<T>(cClSkeleton, p_verbose),
+		dd(NULL),
+		velocity(NULL),
+		density(NULL),
+		fluid_mass(NULL),
+		fluid_fraction(NULL),
+		new_fluid_fraction(NULL),
+		flags(NULL),
+		new_flags(NULL),
+		tmp_flags(NULL),
+		threads(1)
+	{
+	}
+
+	~CLbmNativeAA()
+	{
+		freeBuffers();
+	}
+
+
+	/**
+	 * initialize simulation with given parameters
+	 */
+	void init(	CVector<3,int> &p_domain_cells,			///< domain cells in each dimension
+				T p_d_domain_x_length,					///< domain length in x direction
+				T p_d_viscosity,						///< viscocity of fluid
+				CVector<3,T> &p_d_gravitation,			///< gravitation
+				T p_max_sim_gravitation_length,			///< maximum length of gravitation to limit timestep
+				T p_d_timestep,							///< timestep for one simulation step - computed automagically
+				T p_mass_exchange_factor,				///< mass exchange
+
+				size_t p_max_local_work_group_size,		///< unused (no OpenCL kernels)
+
+				int init_flags,							///< flags for first initialization
+
+				std::list<int> &p_lbm_opencl_number_of_threads_list,		///< unused (no OpenCL kernels)
+				std::list<int> &p_lbm_opencl_number_of_registers_list		///< unused (no OpenCL kernels)
+		)
+	{
+		initInterface(		p_domain_cells,
+							p_d_domain_x_length,
+							p_d_viscosity,
+							p_d_gravitation,
+							p_max_sim_gravitation_length,
+							p_d_timestep,
+							p_mass_exchange_factor,
+							p_lbm_opencl_number_of_threads_list,
+							p_lbm_opencl_number_of_registers_list
+						);
+
+		if (this->error())
+			return;
+
+		pinThreads();
+
+		reload();
+
+		this->setupInitFlags(init_flags);
+		resetFluid();
+	}
+
+
+	/**
+	 * the parameters are read directly from this->params during each simulation step
+	 */
+	void setKernelArguments()
+	{
+	}
+
+
+	/**
+	 * allocate the host buffers
+	 */
+	void reload()
+	{
+		if (this->error())
+			return;
+
+		cells_x = this->params.domain_cells[0];
+		cells_y = this->params.domain_cells[1];
+		cells_z = this->params.domain_cells[2];
+
+		this->domain_cells_count = this->params.domain_cells.elements();
+
+		freeBuffers();
+
+		dd = allocBuffer<T>(this->SIZE_DD_HOST);
+		velocity = allocBuffer<T>(3);
+		density = allocBuffer<T>(1);
+		fluid_mass = allocBuffer<T>(1);
+		fluid_fraction = allocBuffer<T>(1);
+		new_fluid_fraction = allocBuffer<T>(1);
+		flags = allocBuffer<int>(1);
+		new_flags = allocBuffer<int>(1);
+		tmp_flags = allocBuffer<int>(1);
+
+		if (this->error())
+			return;
+
+		if (this->verbose)
+			std::cout << "native A-A: " << threads << " threads, " << this->domain_cells_count << " cells" << std::endl;
+	}
+
+
+	/**
+	 * reset the fluid to it's initial state
+	 */
+	void resetFluid()
+	{
+		if (this->error())
+			return;
+
+		if (this->verbose)
+			std::cout << "Init Simulation: " << std::flush;
+
+#pragma omp parallel for collapse(2) schedule(static)
+		for (int z = 0; z < cells_z; z++)
+			for (int y = 0; y < cells_y; y++)
+				for (int x = 0; x < cells_x; x++)
+					initCell(x, y, z);
+
+		this->resetFluid_Interface();
+
+		if (this->verbose)
+			std::cout << "OK" << std::endl;
+	}
+
+
+	/**
+	 * scale the mass in each cell to stabilize the overall amount of mass in the simulation
+	 */
+	void scaleMass(T mass_scale_factor)
+	{
+#pragma omp parallel for collapse(2) schedule(static)
+		for (int z = 0; z < cells_z; z++)
+			for (int y = 0; y < cells_y; y++)
+			{
+				size_t gid = ((size_t)z*cells_y + y)*cells_x;
+				for (int x = 0; x < cells_x; x++)
+					fluid_mass[gid+x] *= mass_scale_factor;
+			}
+	}
+
+
+	/**
+	 * rescale the density distributions after a change of the timestep (kernel_lbm_timestep_rescale)
+	 *
+	 * the alpha step stores the density distributions of the opposite directions exchanged.
+	 */
+	void rescaleDensityDistributions(T velocity_scale, T non_equilibrium_scale)
+	{
+		const size_t N = this->domain_cells_count;
+		const int dd_swap = (this->simulation_step_counter & 1);
+		const int *cur_flags = (this->simulation_step_counter & 1 ? new_flags : flags);
+
+#pragma omp parallel for collapse(2) schedule(static)
+		for (int z = 0; z < cells_z; z++)
+			for (int y = 0; y < cells_y; y++)
+			{
+				T d[19];
+				T p[9];
+
+				for (int x = 0; x < cells_x; x++)
+				{
+					size_t gid = ((size_t)z*cells_y + y)*cells_x + x;
+
+					if (!(cur_flags[gid] & (FLAG_FLUID | FLAG_INTERFACE)))
+						continue;
+
+					for (int i = 0; i < 18; i++)
+						d[i] = dd[gid + (i^dd_swap)*N];
+					d[18] = dd[gid + 18*N];
+
+					T rho = 0;
+					for (int i = 0; i < 19; i++)
+						rho += d[i];
+
+					T inv_rho = (T)1.0/rho;
+					T vx = (d[0]-d[1] + d[4]-d[5] + d[6]-d[7] + d[8]-d[9] + d[10]-d[11])*inv_rho;
+					T vy = (d[2]-d[3] + d[4]-d[5] - d[6]+d[7] + d[12]-d[13] + d[14]-d[15])*inv_rho;
+					T vz = (d[8]-d[9] - d[10]+d[11] + d[12]-d[13] - d[14]+d[15] + d[16]-d[17])*inv_rho;
+
+					T dd_param = (T)(3.0/2.0)*(vx*vx + vy*vy + vz*vz);
+					T new_dd_param = dd_param*velocity_scale*velocity_scale;
+					project(vx, vy, vz, p);
+
+					for (int k = 0; k < 9; k++)
+					{
+						T w = weight(2*k);
+						d[2*k] = eq(w, rho, p[k]*velocity_scale, new_dd_param) + (d[2*k] - eq(w, rho, p[k], dd_param))*non_equilibrium_scale;
+						d[2*k+1] = eq(w, rho, -p[k]*velocity_scale, new_dd_param) + (d[2*k+1] - eq(w, rho, -p[k], dd_param))*non_equilibrium_scale;
+					}
+					d[18] = eq((T)(1.0/3.0), rho, 0, new_dd_param) + (d[18] - eq((T)(1.0/3.0), rho, 0, dd_param))*non_equilibrium_scale;
+
+					for (int i = 0; i < 18; i++)
+						dd[gid + (i^dd_swap)*N] = d[i];
+					dd[gid + 18*N] = d[18];
+
+					velocity[gid] *= velocity_scale;
+					velocity[N+gid] *= velocity_scale;
+					velocity[2*N+gid] *= velocity_scale;
+				}
+			}
+	}
+
+
+	/**
+	 * run one simulation step
+	 *
+	 * the alpha step is executed for even, the beta step for odd simulation steps.
+	 * flags and fluid fractions are exchanged between the "new" and the regular buffers
+	 * in the same way as done by CLbmOpenClAA.
+	 */
+	void simulationStep()
+	{
+		if (this->simulation_step_counter & 1)
+		{
+			massExchange<false>(new_flags, new_fluid_fraction);
+			collision<false>(new_flags, new_fluid_fraction, flags, fluid_fraction);
+			flagConversion<false>(flags, fluid_fraction);
+		}
+		else
+		{
+			massExchange<true>(flags, fluid_fraction);
+			collision<true>(flags, fluid_fraction, new_flags, new_fluid_fraction);
+			flagConversion<true>(new_flags, new_fluid_fraction);
+		}
+
+		this->simulation_step_counter++;
+	}
+
+
+	/**
+	 * all computations are finished when simulationStep() returns
+	 */
+	void wait()
+	{
+	}
+
+	void storeVelocity(T *dst)
+	{
+		memcpy(dst, velocity, sizeof(T)*this->domain_cells_count*3);
+	}
+
+	void storeDensity(T *dst)
+	{
+		memcpy(dst, density, sizeof(T)*this->domain_cells_count);
+	}
+
+	void storeDensityDistributions(T *dst)
+	{
+		memcpy(dst, dd, sizeof(T)*this->domain_cells_count*this->SIZE_DD_HOST);
+	}
+
+	void storeMass(T *dst)
+	{
+		memcpy(dst, fluid_mass, sizeof(T)*this->domain_cells_count);
+	}
+
+	void storeFraction(T *dst)
+	{
+		memcpy(dst, (this->simulation_step_counter & 1 ? new_fluid_fraction : fluid_fraction), sizeof(T)*this->domain_cells_count);
+	}
+
+	void storeFlags(cl_int *dst)
+	{
+		memcpy(dst, (this->simulation_step_counter & 1 ? new_flags : flags), sizeof(cl_int)*this->domain_cells_count);
+	}
+
+
+private:
+	/**
+	 * allocate aligned buffer with 'components' values per cell
+	 *
+	 * the memory is touched with the same thread schedule as used for the computations
+	 */
+	template <typename D>
+	D *allocBuffer(size_t components)
+	{
+		void *ptr;
+		if (posix_memalign(&ptr, LBM_NATIVE_AA_ALIGNMENT, sizeof(D)*this->domain_cells_count*components) != 0)
+		{
+			this->error << "failed to allocate " << sizeof(D)*this->domain_cells_count*components << " bytes" << std::endl;
+			return NULL;
+		}
+
+		D *buffer = (D*)ptr;
+
+		for (size_t c = 0; c < components; c++)
+		{
+			D *component = buffer + c*this->domain_cells_count;
+
+#pragma omp parallel for collapse(2) schedule(static)
+			for (int z = 0; z < cells_z; z++)
+				for (int y = 0; y < cells_y; y++)
+				{
+					size_t gid = ((size_t)z*cells_y + y)*cells_x;
+					for (int x = 0; x < cells_x; x++)
+						component[gid+x] = 0;
+				}
+		}
+
+		return buffer;
+	}
+
+	void freeBuffers()
+	{
+		free(dd);					dd = NULL;
+		free(velocity);				velocity = NULL;
+		free(density);				density = NULL;
+		free(fluid_mass);			fluid_mass = NULL;
+		free(fluid_fraction);		fluid_fraction = NULL;
+		free(new_fluid_fraction);	new_fluid_fraction = NULL;
+		free(flags);				flags = NULL;
+		free(new_flags);			new_flags = NULL;
+		free(tmp_flags);			tmp_flags = NULL;
+	}
+
+
+	/**
+	 * pin the OpenMP threads to distinct cpus to keep the first touch placement valid
+	 */
+	void pinThreads()
+	{
+#ifdef _OPENMP
+		threads = omp_get_max_threads();
+
+#if LBM_NATIVE_AA_PIN_THREADS && __linux
+		if (getenv("OMP_PROC_BIND") != NULL || getenv("GOMP_CPU_AFFINITY") != NULL || getenv("KMP_AFFINITY") != NULL)
+			return;
+
+		cpu_set_t process_cpus;
+		if (sched_getaffinity(0, sizeof(process_cpus), &process_cpus) != 0)
+			return;
+
+		int cpu_count = CPU_COUNT(&process_cpus);
+		if (cpu_count < threads)
+			return;
+
+#pragma omp parallel
+		{
+			int n = omp_get_thread_num();
+
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			{
+				if (!CPU_ISSET(cpu, &process_cpus))
+					continue;
+
+				if (n-- > 0)
+					continue;
+
+				cpu_set_t thread_cpu;
+				CPU_ZERO(&thread_cpu);
+				CPU_SET(cpu, &thread_cpu);
+				sched_setaffinity(0, sizeof(thread_cpu), &thread_cpu);
+				break;
+			}
+		}
+#endif
+#endif
+	}
+
+
+	/**
+	 * compute the linear indices of all 19 neighbors with periodic boundaries
+	 *
+	 * neighbor[i] is the cell at position (cell + lattice vector i), neighbor[18] is the cell itself
+	 */
+	inline void getNeighbors(int x, int y, int z, size_t neighbor[19])
+	{
+		size_t sx = cells_x;
+		size_t sxy = sx*cells_y;
+
+		size_t x0 = x;
+		size_t xp = (x+1 == cells_x ? 0 : x+1);
+		size_t xn = (x == 0 ? cells_x-1 : x-1);
+
+		size_t y0 = (size_t)y*sx;
+		size_t yp = (size_t)(y+1 == cells_y ? 0 : y+1)*sx;
+		size_t yn = (size_t)(y == 0 ? cells_y-1 : y-1)*sx;
+
+		size_t z0 = (size_t)z*sxy;
+		size_t zp = (size_t)(z+1 == cells_z ? 0 : z+1)*sxy;
+		size_t zn = (size_t)(z == 0 ? cells_z-1 : z-1)*sxy;
+
+		/* f(1,0,0), f(-1,0,0),  f(0,1,0),  f(0,-1,0) */
+		neighbor[0] = xp+y0+z0;		neighbor[1] = xn+y0+z0;
+		neighbor[2] = x0+yp+z0;		neighbor[3] = x0+yn+z0;
+
+		/* f(1,1,0), f(-1,-1,0), f(1,-1,0), f(-1,1,0) */
+		neighbor[4] = xp+yp+z0;		neighbor[5] = xn+yn+z0;
+		neighbor[6] = xp+yn+z0;		neighbor[7] = xn+yp+z0;
+
+		/* f(1,0,1), f(-1,0,-1), f(1,0,-1), f(-1,0,1) */
+		neighbor[8] = xp+y0+zp;		neighbor[9] = xn+y0+zn;
+		neighbor[10] = xp+y0+zn;	neighbor[11] = xn+y0+zp;
+
+		/* f(0,1,1), f(0,-1,-1), f(0,1,-1), f(0,-1,1) */
+		neighbor[12] = x0+yp+zp;	neighbor[13] = x0+yn+zn;
+		neighbor[14] = x0+yp+zn;	neighbor[15] = x0+yn+zp;
+
+		/* f(0,0,1), f(0,0,-1),  f(0,0,0) */
+		neighbor[16] = x0+y0+zp;	neighbor[17] = x0+y0+zn;
+		neighbor[18] = x0+y0+z0;
+	}
+
+	/**
+	 * lattice weight for density distribution i
+	 */
+	static inline T weight(int i)
+	{
+		if (i < 4 || i == 16 || i == 17)
+			return (T)(1.0/18.0);
+		if (i < 16)
+			return (T)(1.0/36.0);
+		return (T)(1.0/3.0);
+	}
+
+	/**
+	 * project vector v onto the lattice vectors with even index (0, 2, 4, ..., 16)
+	 *
+	 * the projection for the opposite lattice vector (odd index) is the negated value
+	 */
+	static inline void project(T vx, T vy, T vz, T p[9])
+	{
+		p[0] = vx;			p[1] = vy;
+		p[2] = vx+vy;		p[3] = vx-vy;
+		p[4] = vx+vz;		p[5] = vx-vz;
+		p[6] = vy+vz;		p[7] = vy-vz;
+		p[8] = vz;
+	}
+
+	/**
+	 * compressible equilibrium distribution
+	 *
+	 * \param e_u		projection of velocity onto lattice vector
+	 * \param dd_param	3/2*u^2
+	 */
+	static inline T eq(T w, T rho, T e_u, T dd_param)
+	{
+		return w*rho*((T)1.0 + (T)3.0*e_u + (T)(9.0/2.0)*e_u*e_u - dd_param);
+	}
+
+	/**
+	 * sum of the equilibrium distributions of two opposite lattice vectors
+	 */
+	static inline T eqPlus(T w, T rho, T e_u, T dd_param)
+	{
+		return (T)2.0*w*rho*((T)1.0 + (T)(9.0/2.0)*e_u*e_u - dd_param);
+	}
+
+	/**
+	 * factor for the mass exchange (GET_MX_FACTOR_INCOMING)
+	 */
+	static inline T mxFactor(T p_fluid_fraction, int flag, T ff, int neighbor_flag)
+	{
+		if ((flag | neighbor_flag) & FLAGS_GAS_OBSTACLE)
+			return 0;
+
+		if ((flag & neighbor_flag) == FLAG_INTERFACE)
+			return (ff + p_fluid_fraction)*(T)0.5;
+
+		return 1;
+	}
+
+
+	/**
+	 * outgoing mass (kernel_lbm_alpha_pre, kernel_beta_pre)
+	 */
+	template <bool alpha>
+	void massExchange(const int *flags_in, const T *ff_in)
+	{
+		const size_t N = this->domain_cells_count;
+		const T mass_exchange_factor = this->params.mass_exchange_factor;
+
+#pragma omp parallel for collapse(2) schedule(static)
+		for (int z = 0; z < cells_z; z++)
+			for (int y = 0; y < cells_y; y++)
+			{
+				size_t neighbor[19];
+
+				for (int x = 0; x < cells_x; x++)
+				{
+					size_t gid = ((size_t)z*cells_y + y)*cells_x + x;
+
+					int flag = flags_in[gid];
+					if (flag & FLAGS_GAS_OBSTACLE)
+						continue;
+
+					getNeighbors(x, y, z, neighbor);
+
+					T ff = ff_in[gid];
+					T mass = 0;
+
+					for (int i = 0; i < 18; i++)
+					{
+						/*
+						 * alpha: dd i streamed to cell+e_i during the last beta step
+						 * beta: dd i stored in the opposite slot during the alpha step
+						 */
+						size_t n = neighbor[alpha ? i : (i^1)];
+						T ddx = (alpha ? dd[n + i*N] : dd[gid + i*N]);
+						mass -= ddx*mxFactor(ff, flag, ff_in[n], flags_in[n]);
+					}
+
+					fluid_mass[gid] += mass_exchange_factor*mass;
+				}
+			}
+	}
+
+
+	/**
+	 * collision and propagation (kernel_lbm_alpha, kernel_beta)
+	 */
+	template <bool alpha>
+	void collision(const int *flags_in, const T *ff_in, int *flags_out, T *ff_out)
+	{
+		const size_t N = this->domain_cells_count;
+		const T inv_tau = this->params.inv_tau;
+		const T mass_exchange_factor = this->params.mass_exchange_factor;
+		const T extra_offset = mass_exchange_factor*(T)0.001;
+
+		T gp[9];
+		project(this->params.gravitation[0], this->params.gravitation[1], this->params.gravitation[2], gp);
+
+		const T g0 = this->params.gravitation[0]*(T)(1.0/3.0);
+		const T g1 = this->params.gravitation[1]*(T)(1.0/3.0);
+		const T g2 = this->params.gravitation[2]*(T)(1.0/3.0);
+
+#pragma omp parallel for collapse(2) schedule(static)
+		for (int z = 0; z < cells_z; z++)
+			for (int y = 0; y < cells_y; y++)
+			{
+				size_t neighbor[19];
+				T d[19];
+				T p[9];
+
+				for (int x = 0; x < cells_x; x++)
+				{
+					size_t gid = ((size_t)z*cells_y + y)*cells_x + x;
+
+					int flag = flags_in[gid];
+					T ff = ff_in[gid];
+
+					if (flag == FLAG_GAS)
+					{
+						flags_out[gid] = FLAG_GAS;
+						ff_out[gid] = 0;
+						continue;
+					}
+
+					getNeighbors(x, y, z, neighbor);
+
+					/*
+					 * load incoming density distributions
+					 */
+					if (alpha)
+					{
+						for (int i = 0; i < 19; i++)
+							d[i] = dd[gid + i*N];
+					}
+					else
+					{
+						for (int i = 0; i < 18; i++)
+							d[i] = dd[neighbor[i^1] + (i^1)*N];
+						d[18] = dd[gid + 18*N];
+					}
+
+					/*
+					 * reconstruct dds from gas cells and gather incoming mass
+					 */
+					T old_dd_param = 0;
+					if (flag == FLAG_INTERFACE)
+					{
+						T vx = velocity[gid];
+						T vy = velocity[N+gid];
+						T vz = velocity[2*N+gid];
+
+						old_dd_param = (T)(3.0/2.0)*(vx*vx + vy*vy + vz*vz);
+						project(vx, vy, vz, p);
+					}
+
+					T mass = 0;
+					for (int k = 0; k < 9; k++)
+					{
+						int a = 2*k;
+						int b = 2*k+1;
+
+						// the dd with lattice vector e_i is streamed from cell-e_i
+						size_t na = neighbor[b];
+						size_t nb = neighbor[a];
+
+						int neighbor_flag_a = flags_in[na];
+						int neighbor_flag_b = flags_in[nb];
+
+						T ffa, ffb;
+
+						if (flag != FLAG_INTERFACE)
+						{
+							ffa = mxFactor(ff, flag, ff_in[na], neighbor_flag_a);
+							ffb = mxFactor(ff, flag, ff_in[nb], neighbor_flag_b);
+						}
+						else if ((neighbor_flag_a & FLAGS_GAS_OBSTACLE) && (neighbor_flag_b & FLAGS_GAS_OBSTACLE))
+						{
+							d[a] = eq(weight(a), (T)1.0, p[k], old_dd_param);
+							d[b] = eq(weight(b), (T)1.0, -p[k], old_dd_param);
+							ffa = 0;
+							ffb = 0;
+						}
+						else if (neighbor_flag_a & FLAGS_GAS_OBSTACLE)
+						{
+							d[a] = eqPlus(weight(a), (T)1.0, p[k], old_dd_param) - d[b];
+							ffa = 0;
+							ffb = mxFactor(ff, flag, ff_in[nb], neighbor_flag_b);
+						}
+						else if (neighbor_flag_b & FLAGS_GAS_OBSTACLE)
+						{
+							d[b] = eqPlus(weight(b), (T)1.0, p[k], old_dd_param) - d[a];
+							ffa = mxFactor(ff, flag, ff_in[na], neighbor_flag_a);
+							ffb = 0;
+						}
+						else
+						{
+							ffa = mxFactor(ff, flag, ff_in[na], neighbor_flag_a);
+							ffb = mxFactor(ff, flag, ff_in[nb], neighbor_flag_b);
+						}
+
+						mass += d[a]*ffa + d[b]*ffb;
+					}
+
+					T rho = 0;
+					for (int i = 0; i < 19; i++)
+						rho += d[i];
+
+					T vx = d[0]-d[1] + d[4]-d[5] + d[6]-d[7] + d[8]-d[9] + d[10]-d[11];
+					T vy = d[2]-d[3] + d[4]-d[5] - d[6]+d[7] + d[12]-d[13] + d[14]-d[15];
+					T vz = d[8]-d[9] - d[10]+d[11] + d[12]-d[13] - d[14]+d[15] + d[16]-d[17];
+
+					// compressible equilibrium
+					T inv_rho = (T)1.0/rho;
+					vx *= inv_rho;
+					vy *= inv_rho;
+					vz *= inv_rho;
+
+					mass = mass_exchange_factor*mass + fluid_mass[gid];
+
+					if (flag == FLAG_INTERFACE)
+						ff = mass/rho;
+					else if (flag == FLAG_FLUID)
+						ff = 1.0;
+					else
+						ff = 0.0;
+
+					/*
+					 * collision operator (lbm_inc_collision_operator.h)
+					 */
+					T vel2 = vx*vx + vy*vy + vz*vz;
+					if (vel2 > (T)(0.25*0.25))
+					{
+						T s = (T)0.25/std::sqrt(vel2);
+						vx *= s;
+						vy *= s;
+						vz *= s;
+					}
+
+					if (flag & (FLAG_INTERFACE | FLAG_FLUID))
+					{
+						T dd_param = (T)(3.0/2.0)*(vx*vx + vy*vy + vz*vz);
+						project(vx, vy, vz, p);
+
+						for (int k = 0; k < 9; k++)
+						{
+							T w = weight(2*k);
+							d[2*k] += inv_tau*(eq(w, rho, p[k], dd_param) - d[2*k]);
+							d[2*k+1] += inv_tau*(eq(w, rho, -p[k], dd_param) - d[2*k+1]);
+						}
+						d[18] += inv_tau*((T)(1.0/3.0)*rho*((T)1.0 - dd_param) - d[18]);
+
+						// gravitation
+						vx += g0;
+						vy += g1;
+						vz += g2;
+
+						T rho_ff = rho*ff;
+						for (int k = 0; k < 9; k++)
+						{
+							T tmp = gp[k]*weight(2*k)*rho_ff;
+							d[2*k] += tmp;
+							d[2*k+1] -= tmp;
+						}
+					}
+					else if (flag == FLAG_OBSTACLE)
+					{
+						// simple bounce back
+						for (int k = 0; k < 9; k++)
+						{
+							T tmp = d[2*k];
+							d[2*k] = d[2*k+1];
+							d[2*k+1] = tmp;
+						}
+					}
+
+					/*
+					 * store density distributions
+					 */
+					if (alpha)
+					{
+						// store to opposite slot of the same cell
+						for (int i = 0; i < 18; i++)
+							dd[gid + i*N] = d[i^1];
+					}
+					else
+					{
+						// stream to adjacent cells
+						for (int i = 0; i < 18; i++)
+							dd[neighbor[i] + i*N] = d[i];
+					}
+					dd[gid + 18*N] = d[18];
+
+					/*
+					 * interface change
+					 */
+					ff = mass/rho;
+
+					if (flag == FLAG_INTERFACE)
+					{
+						if (ff >= (T)1.0 + extra_offset)
+							flag = FLAG_INTERFACE_TO_FLUID;
+					}
+					else if (flag == FLAG_FLUID)
+					{
+						mass = rho;
+					}
+					else
+					{
+						mass = 0;
+					}
+
+					if (ff > (T)1.0 + extra_offset)
+						ff = (T)1.0 + extra_offset;
+					else if (ff < -extra_offset)
+						ff = -extra_offset;
+
+					fluid_mass[gid] = mass;
+					ff_out[gid] = ff;
+					flags_out[gid] = flag;
+
+					velocity[gid] = vx;
+					velocity[N+gid] = vy;
+					velocity[2*N+gid] = vz;
+
+					density[gid] = rho;
+				}
+			}
+	}
+
+
+	/**
+	 * flag conversions
+	 *
+	 * the OpenCL kernels modify the flags of adjacent cells concurrently. here, every cell
+	 * gathers the state of its neighbors instead and writes its new flag to tmp_flags which
+	 * is copied back in a second sweep. this avoids data races between the threads.
+	 *
+	 * 1) kernel_interface_to_fluid_neighbors (+ loneley fluid interface remover)
+	 * 2) kernel_interface_to_gas
+	 * 3) kernel_interface_to_gas_neighbors (+ loneley gas interface remover)
+	 * 4) kernel_lbm_alpha_flag_gas_to_interface / lbm_beta_flag_gas_to_interface
+	 */
+	template <bool alpha>
+	void flagConversion(int *p_flags, T *p_ff)
+	{
+		const size_t N = this->domain_cells_count;
+		const T extra_offset = this->params.mass_exchange_factor*(T)0.001;
+
+#pragma omp parallel
+		{
+			/*
+			 * INTERFACE TO FLUID NEIGHBORS
+			 */
+#pragma omp for collapse(2) schedule(static)
+			for (int z = 0; z < cells_z; z++)
+				for (int y = 0; y < cells_y; y++)
+				{
+					size_t neighbor[19];
+
+					for (int x = 0; x < cells_x; x++)
+					{
+						size_t gid = ((size_t)z*cells_y + y)*cells_x + x;
+						int flag = p_flags[gid];
+
+						if (flag == FLAG_INTERFACE_TO_FLUID)
+						{
+							flag = FLAG_FLUID;
+						}
+						else if (flag == FLAG_GAS)
+						{
+							getNeighbors(x, y, z, neighbor);
+							for (int i = 0; i < 18; i++)
+							{
+								if (p_flags[neighbor[i]] == FLAG_INTERFACE_TO_FLUID)
+								{
+									flag = FLAG_GAS_TO_INTERFACE;
+									break;
+								}
+							}
+						}
+						else if (flag == FLAG_INTERFACE)
+						{
+							getNeighbors(x, y, z, neighbor);
+							int neighbor_flags = 0;
+							for (int i = 0; i < 18; i++)
+								neighbor_flags |= p_flags[neighbor[i]];
+
+							// interface connected to fluid cells only
+							if ((neighbor_flags & (FLAG_FLUID | FLAG_GAS)) == FLAG_FLUID)
+								flag = FLAG_FLUID;
+						}
+
+						tmp_flags[gid] = flag;
+					}
+				}
+
+			/*
+			 * INTERFACE TO GAS
+			 */
+#pragma omp for collapse(2) schedule(static)
+			for (int z = 0; z < cells_z; z++)
+				for (int y = 0; y < cells_y; y++)
+				{
+					size_t gid = ((size_t)z*cells_y + y)*cells_x;
+					for (int x = 0; x < cells_x; x++, gid++)
+					{
+						int flag = tmp_flags[gid];
+
+						if (flag == FLAG_INTERFACE && p_ff[gid] <= -extra_offset)
+						{
+							flag = FLAG_INTERFACE_TO_GAS;
+							p_ff[gid] = 0;
+						}
+
+						p_flags[gid] = flag;
+					}
+				}
+
+			/*
+			 * INTERFACE TO GAS NEIGHBORS
+			 */
+#pragma omp for collapse(2) schedule(static)
+			for (int z = 0; z < cells_z; z++)
+				for (int y = 0; y < cells_y; y++)
+				{
+					size_t neighbor[19];
+
+					for (int x = 0; x < cells_x; x++)
+					{
+						size_t gid = ((size_t)z*cells_y + y)*cells_x + x;
+						int flag = p_flags[gid];
+
+						if (flag == FLAG_INTERFACE_TO_GAS)
+						{
+							flag = FLAG_GAS;
+						}
+						else if (flag == FLAG_FLUID)
+						{
+							getNeighbors(x, y, z, neighbor);
+							for (int i = 0; i < 18; i++)
+							{
+								if (p_flags[neighbor[i]] == FLAG_INTERFACE_TO_GAS)
+								{
+									flag = FLAG_INTERFACE;
+									break;
+								}
+							}
+						}
+						else if (flag == FLAG_INTERFACE)
+						{
+							getNeighbors(x, y, z, neighbor);
+							int neighbor_flags = 0;
+							for (int i = 0; i < 18; i++)
+								neighbor_flags |= p_flags[neighbor[i]];
+
+							// interface connected to gas cells only
+							if ((neighbor_flags & (FLAG_FLUID | FLAG_GAS)) == FLAG_GAS)
+								flag = FLAG_GAS;
+						}
+
+						tmp_flags[gid] = flag;
+					}
+				}
+
+			/*
+			 * GAS TO INTERFACE
+			 */
+#pragma omp for collapse(2) schedule(static)
+			for (int z = 0; z < cells_z; z++)
+				for (int y = 0; y < cells_y; y++)
+				{
+					size_t neighbor[19];
+					T p[9];
+
+					for (int x = 0; x < cells_x; x++)
+					{
+						size_t gid = ((size_t)z*cells_y + y)*cells_x + x;
+						int flag = tmp_flags[gid];
+
+						if (flag != FLAG_GAS_TO_INTERFACE)
+						{
+							p_flags[gid] = flag;
+							continue;
+						}
+
+						getNeighbors(x, y, z, neighbor);
+
+						// average velocity and density of adjacent fluid cells
+						T vx = 0, vy = 0, vz = 0;
+						T rho = 0;
+						T count = 0;
+
+						for (int i = 0; i < 18; i++)
+						{
+							size_t n = neighbor[i];
+							if (tmp_flags[n] & FLAG_FLUID)
+							{
+								vx += velocity[n];
+								vy += velocity[N+n];
+								vz += velocity[2*N+n];
+								rho += density[n];
+								count += (T)1.0;
+							}
+						}
+
+						if (count > (T)1.0)
+						{
+							T inv_count = (T)1.0/count;
+							vx *= inv_count;
+							vy *= inv_count;
+							vz *= inv_count;
+							rho *= inv_count;
+						}
+						else if (count == (T)0.0)
+						{
+							rho = 1.0;
+						}
+
+						T dd_param = (T)(3.0/2.0)*(vx*vx + vy*vy + vz*vz);
+						project(vx, vy, vz, p);
+
+						for (int k = 0; k < 9; k++)
+						{
+							int a = 2*k;
+							int b = 2*k+1;
+							T eq_a = eq(weight(a), rho, p[k], dd_param);
+							T eq_b = eq(weight(b), rho, -p[k], dd_param);
+
+							if (alpha)
+							{
+								dd[gid + a*N] = eq_b;
+								dd[gid + b*N] = eq_a;
+							}
+							else
+							{
+								dd[neighbor[a] + a*N] = eq_a;
+								dd[neighbor[b] + b*N] = eq_b;
+							}
+						}
+						dd[gid + 18*N] = (T)(1.0/3.0)*rho*((T)1.0 - dd_param);
+
+						velocity[gid] = vx;
+						velocity[N+gid] = vy;
+						velocity[2*N+gid] = vz;
+
+						p_flags[gid] = FLAG_INTERFACE;
+						density[gid] = rho;
+						fluid_mass[gid] = 0;
+						p_ff[gid] = 0;
+					}
+				}
+		}
+	}
+
+
+	/**
+	 * initial flag of a cell (getFlag in lbm_init.cl)
+	 */
+	int getInitFlag(int x, int y, int z)
+	{
+		const int init_flags = this->fluid_init_flags;
+		int flag = FLAG_GAS;
+
+		if (	x <= 0 || y <= 0 || z <= 0 ||
+				x >= cells_x-1 || y >= cells_y-1 || z >= cells_z-1
+		)
+		{
+			return FLAG_OBSTACLE;
+		}
+
+		if (init_flags & CLbmOpenClInterface<T>::INIT_CREATE_FLUID_WITH_GAS_SPHERE)
+		{
+			T radius = (T)std::min(std::min(cells_x, cells_y), cells_z)*(T)0.35*(T)(2.0/3.0);
+
+			T dx = x - cells_x/2;
+			T dy = y - radius-2;
+			T dz = z - cells_z/2;
+
+			if (std::sqrt(dx*dx + dy*dy + dz*dz) < radius)
+				return FLAG_GAS;
+
+			if (cells_y*2/3 < y)
+				return FLAG_GAS;
+			else
+				return FLAG_FLUID;
+		}
+
+		/*
+		 * setup FLUIDs
+		 */
+		if (init_flags & CLbmOpenClInterface<T>::INIT_CREATE_BREAKING_DAM)
+		{
+			if (x >= cells_x*2/3)
+				flag = FLAG_FLUID;
+		}
+
+		if (init_flags & CLbmOpenClInterface<T>::INIT_CREATE_POOL)
+		{
+			if (y < cells_y/4)
+				flag = FLAG_FLUID;
+		}
+
+		T min_half = (T)std::min(std::min(cells_x, cells_y), cells_z)/(T)2.0;
+
+		if (init_flags & CLbmOpenClInterface<T>::INIT_CREATE_SPHERE)
+		{
+			T radius = min_half*2/3;
+
+			T dx = x - cells_x/2;
+			T dy = cells_y - y - radius-3;
+			T dz = z - cells_z/2;
+
+			if (std::sqrt(dx*dx + dy*dy + dz*dz) < radius-std::sqrt((T)3.0)*(T)0.5)
+				flag = FLAG_FLUID;
+		}
+
+		/*
+		 * SETUP OBSTACLES
+		 */
+		if (init_flags & CLbmOpenClInterface<T>::INIT_CREATE_OBSTACLE_HALF_SPHERE)
+		{
+			T radius = min_half*2/3;
+
+			T dx = x - cells_x/2;
+			T dy = y;
+			T dz = z - cells_z/2;
+
+			if (std::sqrt(dx*dx + dy*dy + dz*dz) < radius)
+				flag = FLAG_OBSTACLE;
+		}
+
+		if (init_flags & CLbmOpenClInterface<T>::INIT_CREATE_OBSTACLE_VERTICAL_BAR)
+		{
+			T radius = min_half*1/5;
+
+			T dx = x - cells_x/2;
+			T dz = z - cells_z/2;
+
+			if (std::sqrt(dx*dx + dz*dz) < radius)
+				flag = FLAG_OBSTACLE;
+		}
+
+		if (init_flags & CLbmOpenClInterface<T>::INIT_CREATE_FILLED_CUBE)
+			return FLAG_FLUID;
+
+		return flag;
+	}
+
+	/**
+	 * initial fluid fraction of interface cells (getInterfaceFluidFraction in lbm_init.cl)
+	 *
+	 * the OpenCL version evaluates the flags around the domain origin instead of the cell
+	 * position. this is kept to get the same initial state as the OpenCL implementations.
+	 */
+	T getInitInterfaceFluidFraction()
+	{
+		T ff = 0;
+
+		for (int pz = -1; pz <= 1; pz++)
+			for (int py = -1; py <= 1; py++)
+				for (int px = -1; px <= 1; px++)
+					if (getInitFlag(px, py, pz) == FLAG_FLUID)
+						ff += (T)1.0/std::sqrt((T)(px*px + py*py + pz*pz));
+
+		ff *= (T)10.0;
+		return ff / (T)(8.0/std::sqrt(3.0) + 12.0/std::sqrt(2.0) + 6.0);
+	}
+
+	/**
+	 * initialize a single cell (kernel_lbm_init)
+	 */
+	void initCell(int x, int y, int z)
+	{
+		const size_t N = this->domain_cells_count;
+		size_t gid = ((size_t)z*cells_y + y)*cells_x + x;
+
+		int flag = getInitFlag(x, y, z);
+
+		T vx = 0, vy = 0, vz = 0;
+		T rho = 1.0;
+		T ff = 1.0;
+
+		if (flag == FLAG_GAS)
+		{
+			static const int d[18][3] = {
+					{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0},
+					{1,1,0}, {-1,-1,0}, {1,-1,0}, {-1,1,0},
+					{1,0,1}, {-1,0,-1}, {1,0,-1}, {-1,0,1},
+					{0,1,1}, {0,-1,-1}, {0,1,-1}, {0,-1,1},
+					{0,0,1}, {0,0,-1}
+				};
+
+			for (int i = 0; i < 18; i++)
+			{
+				if (getInitFlag(x+d[i][0], y+d[i][1], z+d[i][2]) == FLAG_FLUID)
+				{
+					flag = FLAG_INTERFACE;
+					break;
+				}
+			}
+		}
+
+		switch(flag)
+		{
+			case FLAG_GAS:
+				// large velocity to detect values streamed from gas cells (SETUP_LARGE_VELOCITY)
+				vx = 999.999;
+				vy = -999.999;
+				vz = 999.999;
+				ff = 0;
+				break;
+
+			case FLAG_INTERFACE:
+				ff = getInitInterfaceFluidFraction();
+				break;
+
+			case FLAG_OBSTACLE:
+				ff = 0;
+				break;
+		}
+
+		T p[9];
+		T dd_param = (T)(3.0/2.0)*(vx*vx + vy*vy + vz*vz);
+		project(vx, vy, vz, p);
+
+		for (int k = 0; k < 9; k++)
+		{
+			dd[gid + (2*k)*N] = eq(weight(2*k), rho, p[k], dd_param);
+			dd[gid + (2*k+1)*N] = eq(weight(2*k+1), rho, -p[k], dd_param);
+		}
+		dd[gid + 18*N] = (T)(1.0/3.0)*rho*((T)1.0 - dd_param);
+
+		flags[gid] = flag;
+		new_flags[gid] = flag;
+		fluid_fraction[gid] = ff;
+		new_fluid_fraction[gid] = ff;
+		fluid_mass[gid] = ff;
+
+		velocity[gid] = vx;
+		velocity[N+gid] = vy;
+		velocity[2*N+gid] = vz;
+
+		density[gid] = rho;
+	}
+};
+
+#endif
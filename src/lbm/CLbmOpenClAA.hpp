@@ -20,9 +20,11 @@
 #include "CLbmParameters.hpp"
 #include "CLbmOpenClInterface.hpp"
 #include "libopencl/CCLSkeleton.hpp"
+#include "libopencl/CCLCommandSequence.hpp"
 #include "lib/CError.hpp"
 #include <typeinfo>
 #include <iomanip>
+#include <vector>
 
 #include "lib/CStopwatch.hpp"
 
@@ -35,6 +37,76 @@
 
 #define AA_TIMING	0
 
+/**
+ * set to 1 to launch the simulation kernels only for the cells of active tiles
+ *
+ * a tile is active if it contains fluid or interface cells or if it's at most LBM_AA_ACTIVE_TILE_DILATION
+ * tiles away from such a tile. the list of active tiles is computed every LBM_AA_ACTIVE_TILES_REFRESH_INTERVAL
+ * simulation steps and used from the next computation on (see updateActiveTiles()).
+ */
+#define LBM_AA_ACTIVE_TILES		1
+#define LBM_AA_ACTIVE_TILE_SIZE	8
+#define LBM_AA_ACTIVE_TILE_DILATION	2
+#define LBM_AA_ACTIVE_TILES_REFRESH_INTERVAL	7
+
+#if 2*LBM_AA_ACTIVE_TILES_REFRESH_INTERVAL > LBM_AA_ACTIVE_TILE_DILATION*LBM_AA_ACTIVE_TILE_SIZE
+	#error "the dilation of the active tiles does not cover the cells modified until the next but one refresh"
+#endif
+
+/**
+ * set to 1 to launch the flag conversion kernels only for the interface cells and the converted cells
+ *
+ * the list of interface cells is compacted after each simulation step.
+ */
+#ifndef LBM_AA_INTERFACE_WORKLIST
+	#define LBM_AA_INTERFACE_WORKLIST	1
+#endif
+
+/**
+ * set to 1 to load the flags and fluid fractions of the neighbor cells in the collision kernels
+ * from a packed 32 bit state word (flag and quantized fluid fraction)
+ *
+ * the states are written by the collision kernels and updated by the interface list kernels,
+ * thus LBM_AA_INTERFACE_WORKLIST is required.
+ */
+#define LBM_AA_CELL_STATE	1
+
+/**
+ * set to 1 to compute the interface to fluid neighbors, interface to gas and interface to gas neighbors
+ * conversions with a single kernel which loads the flags of a tile and its halo to local memory
+ *
+ * with LBM_AA_INTERFACE_WORKLIST, the fused kernel pushes the converted cells to the list of the gas
+ * to interface kernels instead of the separate conversion kernels.
+ */
+#ifndef LBM_AA_FUSED_FLAG_CONVERSION
+	#define LBM_AA_FUSED_FLAG_CONVERSION	1
+#endif
+#define LBM_AA_FLAG_CONVERSION_TILE_SIZE	LBM_AA_ACTIVE_TILE_SIZE
+
+/**
+ * set to 1 to record the kernel launches of the alpha and beta steps once and to replay them
+ *
+ * this is only possible if the global work group sizes do not depend on values read back from
+ * the device, thus domains with up to LBM_AA_RECORDED_STEPS_MAX_CELLS cells are simulated without
+ * active tiles and interface worklist. the launches are recorded to a command buffer if the
+ * runtime supports cl_khr_command_buffer.
+ *
+ * disabled by default: the recording also disables the packed cell state which depends on the
+ * interface worklist. the MLUPS of both are compared for the small domains by the
+ * LBM_AA_RECORDED_STEPS variant of benchmarks/run_benchmarks.sh.
+ */
+#ifndef LBM_AA_RECORDED_STEPS
+	#define LBM_AA_RECORDED_STEPS	0
+#endif
+#define LBM_AA_RECORDED_STEPS_MAX_CELLS	(64*64*64)
+
+/**
+ * set to 1 to store the density distributions as half floats (deviation from the lattice weights)
+ */
+#ifndef LBM_AA_DD_HALF
+	#define LBM_AA_DD_HALF	0
+#endif
+
 /**
  * OpenCL implementation for lattice boltzmann method using the A-A pattern with a single density distribution buffer
  */
@@ -119,6 +191,19 @@ private:
 
 	cl::Kernel cKernelLbmMassScale;
 
+	// active tiles
+	cl::Kernel cKernelActiveTiles_Mark;
+	cl::Kernel cKernelActiveTiles_Compact;
+
+	// interface worklist
+	cl::Kernel cKernelInterfaceList_Init;
+	cl::Kernel cKernelLbmAlpha_InterfaceList;
+	cl::Kernel cKernelLbmBeta_InterfaceList;
+
+	// fused flag conversion
+	cl::Kernel cKernelLbmAlpha_FlagConversion;
+	cl::Kernel cKernelLbmBeta_FlagConversion;
+
 	/**
 	 * work group sizes
 	 */
@@ -126,6 +211,16 @@ private:
 
 	cl::NDRange cKernelLbmMassScale_WorkGroupSize;
 
+	cl::NDRange cKernelActiveTiles_Mark_WorkGroupSize;
+	cl::NDRange cKernelActiveTiles_Compact_WorkGroupSize;
+
+	cl::NDRange cKernelInterfaceList_Init_WorkGroupSize;
+	cl::NDRange cKernelLbmAlpha_InterfaceList_WorkGroupSize;
+	cl::NDRange cKernelLbmBeta_InterfaceList_WorkGroupSize;
+
+	cl::NDRange cKernelLbmAlpha_FlagConversion_WorkGroupSize;
+	cl::NDRange cKernelLbmBeta_FlagConversion_WorkGroupSize;
+
 	cl::NDRange cKernelLbmAlpha_Pre_WorkGroupSize;
 	cl::NDRange cKernelLbmAlpha_Main_WorkGroupSize;
 	cl::NDRange cKernelLbmAlpha_GasToInterface_WorkGroupSize;
@@ -158,6 +253,16 @@ private:
 
 	size_t cKernelLbmMassScale_MaxRegisters;
 
+	size_t cKernelActiveTiles_Mark_MaxRegisters;
+	size_t cKernelActiveTiles_Compact_MaxRegisters;
+
+	size_t cKernelInterfaceList_Init_MaxRegisters;
+	size_t cKernelLbmAlpha_InterfaceList_MaxRegisters;
+	size_t cKernelLbmBeta_InterfaceList_MaxRegisters;
+
+	size_t cKernelLbmAlpha_FlagConversion_MaxRegisters;
+	size_t cKernelLbmBeta_FlagConversion_MaxRegisters;
+
 	size_t cKernelLbmAlpha_Pre_MaxRegisters;
 	size_t cKernelLbmAlpha_Main_MaxRegisters;
 	size_t cKernelLbmAlpha_GasToInterface_MaxRegisters;
@@ -190,6 +295,40 @@ private:
 
 	size_t max_local_work_group_size;
 
+	bool active_tiles;						///< true, if the simulation kernels are launched only for active tiles
+	size_t active_tiles_count;				///< number of tiles in domain
+	cl_int active_tiles_list_count;			///< number of tiles in active tile list
+	cl_int active_tiles_update_id;			///< id of last active tiles update to mark tiles
+
+	cl::Buffer cMemActiveTiles;				///< marker for each tile
+	cl::Buffer cMemActiveTileList;			///< number of active tiles followed by the active tile ids
+	cl::Buffer cMemNewActiveTileList;		///< active tile list which is used from the next update on (see updateActiveTiles())
+	cl_int new_active_tiles_list_count;		///< number of tiles in the new active tile list (read back without blocking)
+	cl::Event new_active_tiles_list_count_event;	///< event of the read of new_active_tiles_list_count
+	bool new_active_tiles_list_valid;		///< true, if the new active tile list was computed since the last reset
+
+	cl::NDRange simulation_global_work_group_size;	///< global work group size for the simulation kernels
+
+	bool interface_worklist;				///< true, if the flag conversion kernels are launched only for the cells in the interface list
+	cl_int interface_cells_count;			///< upper bound of the number of cells in the current interface list
+	cl_int interface_cells_count_read[2];	///< number of cells in the interface lists of the last two steps (read back without blocking)
+	cl::Event interface_cells_count_event[2];	///< events of the reads of interface_cells_count_read
+
+	cl::Buffer cMemInterfaceCells;			///< interface cells for alpha kernels
+	cl::Buffer cMemNewInterfaceCells;		///< interface cells for beta kernels
+	cl::Buffer cMemConvertedCells;			///< cells converted during the current step (processed by the gas to interface kernels)
+
+	bool cell_state;						///< true, if the collision kernels load the packed cell state of the neighbor cells
+	cl::Buffer cMemCellState;				///< packed flag and fluid fraction of each cell for alpha kernels
+	cl::Buffer cMemNewCellState;			///< packed flag and fluid fraction of each cell for beta kernels
+
+	bool fused_flag_conversion;				///< true, if the flag conversions are computed by a single kernel
+	size_t flag_conversion_tiles_count;		///< number of tiles in domain for the fused flag conversion
+
+	bool recorded_steps;					///< true, if the recorded launches of the steps are replayed
+	CCLCommandSequence cAlphaSequence;		///< recorded launches of the alpha step
+	CCLCommandSequence cBetaSequence;		///< recorded launches of the beta step
+
 
 public:
 
@@ -254,48 +393,7 @@ public:
     {
 		CError_AppendReturnThis(this->params);
 
-		CL_CHECK_ERROR(cKernelLbmInit.setArg(4, this->params.inv_tau));
-		CL_CHECK_ERROR(cKernelLbmInit.setArg(5, this->params.inv_trt_tau));
-
-		CL_CHECK_ERROR(cKernelLbmInit.setArg(10, this->params.gravitation[0]));
-		CL_CHECK_ERROR(cKernelLbmInit.setArg(11, this->params.gravitation[1]));
-		CL_CHECK_ERROR(cKernelLbmInit.setArg(12, this->params.gravitation[2]));
-
-//		std::cout << params.inv_tau << " " << params.gravitation << std::endl;
-
-#if !LBM_AA_ALPHA_KERNEL_AS_PROPAGATION
-		CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(4, this->params.inv_tau));
-		CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(5, this->params.inv_trt_tau));
-
-		CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(10, this->params.gravitation[0]));
-		CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(11, this->params.gravitation[1]));
-		CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(12, this->params.gravitation[2]));
-
-		CL_CHECK_ERROR(cKernelLbmAlpha_Pre.setArg(6, this->params.mass_exchange_factor));
-		CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(13, this->params.mass_exchange_factor));
-
-		CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToFluidNeighbors.setArg(6, this->params.mass_exchange_factor));
-		CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToGas.setArg(6, this->params.mass_exchange_factor));
-//		CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToGasNeighbors.setArg(6, this->params.mass_exchange_factor));
-		CL_CHECK_ERROR(cKernelLbmAlpha_GasToInterface.setArg(6, this->params.mass_exchange_factor));
-#endif
-
-#if !LBM_BETA_AA_KERNEL_AS_PROPAGATION
-		CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(4, this->params.inv_tau));
-		CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(5, this->params.inv_trt_tau));
-
-		CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(10, this->params.gravitation[0]));
-		CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(11, this->params.gravitation[1]));
-		CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(12, this->params.gravitation[2]));
-
-		CL_CHECK_ERROR(cKernelLbmBeta_Pre.setArg(6, this->params.mass_exchange_factor));
-		CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(13, this->params.mass_exchange_factor));
-
-		CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToFluidNeighbors.setArg(6, this->params.mass_exchange_factor));
-		CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToGas.setArg(6, this->params.mass_exchange_factor));
-//		CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToGasNeighbors.setArg(6, this->params.mass_exchange_factor));
-		CL_CHECK_ERROR(cKernelLbmBeta_GasToInterface.setArg(6, this->params.mass_exchange_factor));
-#endif
+		this->updateParamsBuffer();
     }
 
 
@@ -305,16 +403,23 @@ public:
 	 */
 	void reload()
 	{
+		this->dd_half = LBM_AA_DD_HALF;
 		this->reloadInterface();
 
 		/*
 		 * ALLOCATE BUFFERS
 		 */
 #if LBM_AA_ALPHA_KERNEL_AS_PROPAGATION || LBM_BETA_AA_KERNEL_AS_PROPAGATION
-		cMemNewDensityDistributions = cl::Buffer(this->cl.cContext, CL_MEM_READ_WRITE, sizeof(T)*this->domain_cells_count*this->SIZE_DD_HOST);
+		cMemNewDensityDistributions = this->createDDBuffer();
 #endif
 
 		global_work_group_size = cl::NDRange(this->domain_cells_count);
+		simulation_global_work_group_size = global_work_group_size;
+		active_tiles = false;
+		interface_worklist = false;
+		cell_state = false;
+		fused_flag_conversion = false;
+		setupRecordedSteps();
 
 		if (max_local_work_group_size == 0)
 		{
@@ -340,6 +445,20 @@ public:
 			cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize = 0;
 			cKernelLbmBeta_GatherMass_WorkGroupSize = 0;
 
+			cKernelActiveTiles_Mark_WorkGroupSize = 0;
+			cKernelActiveTiles_Compact_WorkGroupSize = 0;
+
+			// active tiles and interface worklist need known work group sizes
+			active_tiles = false;
+			interface_worklist = false;
+
+			cKernelInterfaceList_Init_WorkGroupSize = 0;
+			cKernelLbmAlpha_InterfaceList_WorkGroupSize = 0;
+			cKernelLbmBeta_InterfaceList_WorkGroupSize = 0;
+
+			cKernelLbmAlpha_FlagConversion_WorkGroupSize = 0;
+			cKernelLbmBeta_FlagConversion_WorkGroupSize = 0;
+
 			if (this->verbose)
 				std::cout << "loading kernels with test value for local_work_group_size (highly experimental, most probably wont work)" << std::endl;
 
@@ -359,6 +478,7 @@ public:
 			 * with either the standard value (max_local_work_group_size) or with the value from the list
 			 */
 #define INIT_WORK_GROUP_SIZE(variable)										\
+			this->work_group_size_count++;									\
 			if (it != this->lbm_opencl_number_of_threads_list.end())		\
 			{																\
 				variable##_WorkGroupSize = cl::NDRange(*it != 0 ? *it : max_local_work_group_size);	\
@@ -379,6 +499,7 @@ public:
 				variable##_MaxRegisters  = 0;								\
 			}
 
+			this->work_group_size_count = 0;
 			std::list<int>::iterator it = this->lbm_opencl_number_of_threads_list.begin();
 			std::list<int>::iterator ir = this->lbm_opencl_number_of_registers_list.begin();
 
@@ -413,15 +534,469 @@ public:
 
 			INIT_WORK_GROUP_SIZE(cKernelLbmMassScale);
 
+			INIT_WORK_GROUP_SIZE(cKernelActiveTiles_Mark);
+			INIT_WORK_GROUP_SIZE(cKernelActiveTiles_Compact);
+
+			INIT_WORK_GROUP_SIZE(cKernelInterfaceList_Init);
+			INIT_WORK_GROUP_SIZE(cKernelLbmAlpha_InterfaceList);
+			INIT_WORK_GROUP_SIZE(cKernelLbmBeta_InterfaceList);
+
+			INIT_WORK_GROUP_SIZE(cKernelLbmAlpha_FlagConversion);
+			INIT_WORK_GROUP_SIZE(cKernelLbmBeta_FlagConversion);
 
 #undef to_str
 #undef INIT_WORK_GROUP_SIZE
+
+			// kernels which exchange data between the work items in local memory
+			this->checkPaddedWorkGroupSize(cKernelLbmAlpha_Pre_WorkGroupSize, "kernel_lbm_alpha_pre");
+			if (this->error())
+				return;
+
+			setupActiveTiles();
+			setupInterfaceWorklist();
+			setupCellState();
+			setupFusedFlagConversion();
+
 			createKernels(false);
 		}
 
+		// the global work group sizes depend on the number of active tiles or interface cells
+		if (active_tiles || interface_worklist)
+			recorded_steps = false;
+
 		resetTimings();
 	}
 
+	/**
+	 * check whether the simulation kernels can be launched for active tiles only.
+	 *
+	 * the domain size has to be a multiple of the tile size and each work group has to be
+	 * located within a single tile.
+	 * if this is possible, the program defines are extended and the buffers for the active tiles are allocated.
+	 */
+	void setupActiveTiles()
+	{
+		active_tiles = false;
+		new_active_tiles_list_valid = false;
+		simulation_global_work_group_size = global_work_group_size;
+
+#if LBM_AA_ACTIVE_TILES && !LBM_AA_ALPHA_KERNEL_AS_PROPAGATION && !LBM_BETA_AA_KERNEL_AS_PROPAGATION
+		if (recorded_steps && this->domain_cells_count <= LBM_AA_RECORDED_STEPS_MAX_CELLS)
+		{
+			if (this->verbose)
+				std::cout << "active tiles disabled: small domains are simulated with recorded steps" << std::endl;
+			return;
+		}
+
+		const size_t tile_cells = LBM_AA_ACTIVE_TILE_SIZE*LBM_AA_ACTIVE_TILE_SIZE*LBM_AA_ACTIVE_TILE_SIZE;
+
+		if (	this->params.domain_cells[0] % LBM_AA_ACTIVE_TILE_SIZE != 0 ||
+				this->params.domain_cells[1] % LBM_AA_ACTIVE_TILE_SIZE != 0 ||
+				this->params.domain_cells[2] % LBM_AA_ACTIVE_TILE_SIZE != 0
+		)
+		{
+			if (this->verbose)
+				std::cout << "active tiles disabled: domain size is not a multiple of " << LBM_AA_ACTIVE_TILE_SIZE << std::endl;
+			return;
+		}
+
+		const cl::NDRange *work_group_sizes[] = {
+				&cKernelLbmAlpha_Pre_WorkGroupSize,
+				&cKernelLbmAlpha_Main_WorkGroupSize,
+				&cKernelLbmAlpha_GasToInterface_WorkGroupSize,
+				&cKernelLbmAlpha_InterfaceToGas_WorkGroupSize,
+				&cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize,
+				&cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize,
+				&cKernelLbmAlpha_GatherMass_WorkGroupSize,
+				&cKernelLbmBeta_Pre_WorkGroupSize,
+				&cKernelLbmBeta_Main_WorkGroupSize,
+				&cKernelLbmBeta_GasToInterface_WorkGroupSize,
+				&cKernelLbmBeta_InterfaceToGas_WorkGroupSize,
+				&cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize,
+				&cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize,
+				&cKernelLbmBeta_GatherMass_WorkGroupSize
+		};
+
+		for (size_t i = 0; i < sizeof(work_group_sizes)/sizeof(*work_group_sizes); i++)
+		{
+			size_t work_group_size = (*work_group_sizes[i])[0];
+			if (work_group_size == 0 || tile_cells % work_group_size != 0)
+			{
+				if (this->verbose)
+					std::cout << "active tiles disabled: work group size " << work_group_size << " is not a divisor of " << tile_cells << std::endl;
+				return;
+			}
+		}
+
+		active_tiles = true;
+		active_tiles_count = this->domain_cells_count / tile_cells;
+		active_tiles_list_count = active_tiles_count;
+		active_tiles_update_id = 0;
+
+		this->cl_interface_program_defines << "#define ACTIVE_TILES	(1)" << std::endl;
+		this->cl_interface_program_defines << "#define ACTIVE_TILE_SIZE	(" << LBM_AA_ACTIVE_TILE_SIZE << ")" << std::endl;
+		this->cl_interface_program_defines << "#define ACTIVE_TILE_DILATION	(" << LBM_AA_ACTIVE_TILE_DILATION << ")" << std::endl;
+
+		// initialize markers with an invalid update id
+		std::vector<cl_int> zero_buffer(active_tiles_count, 0);
+		cMemActiveTiles = this->createBuffer(CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_int)*active_tiles_count, &zero_buffer[0]);
+		cMemActiveTileList = this->createBuffer(CL_MEM_READ_WRITE, sizeof(cl_int)*(active_tiles_count+1));
+		cMemNewActiveTileList = this->createBuffer(CL_MEM_READ_WRITE, sizeof(cl_int)*(active_tiles_count+1));
+
+		if (this->verbose)
+			std::cout << "active tiles enabled: " << active_tiles_count << " tiles with " << tile_cells << " cells" << std::endl;
+#endif
+	}
+
+	/**
+	 * compute the list of active tiles from the current flags to cMemNewActiveTileList
+	 */
+	void computeActiveTiles()
+	{
+		active_tiles_update_id++;
+
+		CL_CHECK_ERROR(cKernelActiveTiles_Mark.setArg(0, this->cMemCellFlags));
+		CL_CHECK_ERROR(cKernelActiveTiles_Mark.setArg(1, this->cMemNewCellFlags));
+		CL_CHECK_ERROR(cKernelActiveTiles_Mark.setArg(4, active_tiles_update_id));
+		CL_CHECK_ERROR(cKernelActiveTiles_Compact.setArg(2, active_tiles_update_id));
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelActiveTiles_Mark,	// kernel
+														cl::NullRange,				// global work offset
+														this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelActiveTiles_Mark_WorkGroupSize),
+														cl::NDRange(cKernelActiveTiles_Mark_WorkGroupSize)
+						);
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		// round up to multiple of work group size (the kernel checks the range)
+		size_t compact_work_group_size = cKernelActiveTiles_Compact_WorkGroupSize[0];
+		size_t compact_global_size = ((active_tiles_count + compact_work_group_size - 1) / compact_work_group_size) * compact_work_group_size;
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelActiveTiles_Compact,	// kernel
+														cl::NullRange,				// global work offset
+														cl::NDRange(compact_global_size),
+														cl::NDRange(cKernelActiveTiles_Compact_WorkGroupSize)
+						);
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+	}
+
+	/**
+	 * update the list of active tiles and the global work group size of the simulation kernels
+	 *
+	 * the list computed at an update is used only from the next update on. therefore the number of its
+	 * tiles is read back without blocking the command queue: the read is finished when it's required.
+	 *
+	 * a list computed at step t is used up to step t+2*R-1 (R: LBM_AA_ACTIVE_TILES_REFRESH_INTERVAL).
+	 * the interface moves at most one cell per step and the flag conversions of a step modify the cells
+	 * adjacent to the interface. thus the cells modified until step t+2*R-1 are at most 2*R cells away
+	 * from a cell which is a fluid or interface cell at step t. for the last cell of a marked tile, this
+	 * is the cell (S-1)+2*R (S: LBM_AA_ACTIVE_TILE_SIZE) which is covered by the dilation D as long as
+	 * (S-1)+2*R <= (D+1)*S-1, i.e. 2*R <= D*S. with R=7, D=2 and S=8, 2 cells are left as slack.
+	 *
+	 * after a reset, the list for the first steps is computed with a blocking read.
+	 */
+	void updateActiveTiles()
+	{
+		if (!new_active_tiles_list_valid)
+		{
+			if (new_active_tiles_list_count_event() != NULL)
+			{
+				CL_CHECK_ERROR(new_active_tiles_list_count_event.wait());
+			}
+
+			computeActiveTiles();
+
+			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(cMemNewActiveTileList, CL_TRUE, 0, sizeof(cl_int), &new_active_tiles_list_count));
+			new_active_tiles_list_count_event = cl::Event();
+		}
+		else if (new_active_tiles_list_count_event() != NULL)
+		{
+			// the read was enqueued at the last update
+			CL_CHECK_ERROR(new_active_tiles_list_count_event.wait());
+		}
+
+		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueCopyBuffer(cMemNewActiveTileList, cMemActiveTileList, 0, 0, sizeof(cl_int)*(active_tiles_count+1)));
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		active_tiles_list_count = new_active_tiles_list_count;
+		simulation_global_work_group_size = cl::NDRange(active_tiles_list_count*LBM_AA_ACTIVE_TILE_SIZE*LBM_AA_ACTIVE_TILE_SIZE*LBM_AA_ACTIVE_TILE_SIZE);
+
+		// the list computed after the reset is also used for the steps after the next update
+		if (!new_active_tiles_list_valid)
+		{
+			new_active_tiles_list_valid = true;
+			return;
+		}
+
+		computeActiveTiles();
+
+		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(cMemNewActiveTileList, CL_FALSE, 0, sizeof(cl_int), &new_active_tiles_list_count, NULL, &new_active_tiles_list_count_event));
+	}
+
+	/**
+	 * setup the buffers for the lists of interface cells
+	 */
+	void setupInterfaceWorklist()
+	{
+		interface_worklist = false;
+		interface_cells_count = 0;
+
+#if LBM_AA_INTERFACE_WORKLIST && !LBM_AA_ALPHA_KERNEL_AS_PROPAGATION && !LBM_BETA_AA_KERNEL_AS_PROPAGATION
+		if (recorded_steps && this->domain_cells_count <= LBM_AA_RECORDED_STEPS_MAX_CELLS)
+		{
+			if (this->verbose)
+				std::cout << "interface worklist disabled: small domains are simulated with recorded steps" << std::endl;
+			return;
+		}
+
+		interface_worklist = true;
+
+		this->cl_interface_program_defines << "#define INTERFACE_WORKLIST	(1)" << std::endl;
+
+		cMemInterfaceCells = this->createBuffer(CL_MEM_READ_WRITE, sizeof(cl_int)*(this->domain_cells_count+1));
+		cMemNewInterfaceCells = this->createBuffer(CL_MEM_READ_WRITE, sizeof(cl_int)*(this->domain_cells_count+1));
+		cMemConvertedCells = this->createBuffer(CL_MEM_READ_WRITE, sizeof(cl_int)*(this->domain_cells_count+1));
+#endif
+	}
+
+	/**
+	 * setup the buffers for the packed cell states
+	 */
+	void setupCellState()
+	{
+		cell_state = false;
+
+#if LBM_AA_CELL_STATE
+		// the cells modified by the flag conversions are updated by the interface list kernels
+		if (!interface_worklist)
+			return;
+
+		cell_state = true;
+
+		this->cl_interface_program_defines << "#define CELL_STATE	(1)" << std::endl;
+
+		cMemCellState = this->createCellBuffer(sizeof(cl_uint), this->domain_cells_count);
+		cMemNewCellState = this->createCellBuffer(sizeof(cl_uint), this->domain_cells_count);
+#endif
+	}
+
+	/**
+	 * check whether the flag conversions can be computed by the fused flag conversion kernel.
+	 *
+	 * the domain size has to be a multiple of the tile size.
+	 */
+	void setupFusedFlagConversion()
+	{
+		fused_flag_conversion = false;
+
+#if LBM_AA_FUSED_FLAG_CONVERSION && !LBM_AA_ALPHA_KERNEL_AS_PROPAGATION && !LBM_BETA_AA_KERNEL_AS_PROPAGATION
+		if (	this->params.domain_cells[0] % LBM_AA_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[1] % LBM_AA_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[2] % LBM_AA_FLAG_CONVERSION_TILE_SIZE != 0
+		)
+		{
+			if (this->verbose)
+				std::cout << "fused flag conversion disabled: domain size is not a multiple of " << LBM_AA_FLAG_CONVERSION_TILE_SIZE << std::endl;
+			return;
+		}
+
+		fused_flag_conversion = true;
+		flag_conversion_tiles_count = this->domain_cells_count / (LBM_AA_FLAG_CONVERSION_TILE_SIZE*LBM_AA_FLAG_CONVERSION_TILE_SIZE*LBM_AA_FLAG_CONVERSION_TILE_SIZE);
+
+		this->cl_interface_program_defines << "#define FUSED_FLAG_CONVERSION	(1)" << std::endl;
+		this->cl_interface_program_defines << "#define FLAG_CONVERSION_TILE_SIZE	(" << LBM_AA_FLAG_CONVERSION_TILE_SIZE << ")" << std::endl;
+#endif
+	}
+
+	/**
+	 * enable the replay of recorded steps
+	 *
+	 * the recording is disabled again at the end of reload() if the active tiles or the interface worklist are used.
+	 */
+	void setupRecordedSteps()
+	{
+		recorded_steps = false;
+		cAlphaSequence.clear();
+		cBetaSequence.clear();
+
+#if LBM_AA_RECORDED_STEPS && !LBM_AA_ALPHA_KERNEL_AS_PROPAGATION && !LBM_BETA_AA_KERNEL_AS_PROPAGATION
+		recorded_steps = true;
+#endif
+	}
+
+	/**
+	 * record the launches of the alpha and the beta step
+	 *
+	 * the launches are the same as in simulationStep() without active tiles and interface worklist.
+	 * the barriers are not necessary since the launches are replayed in order.
+	 */
+	void recordSteps()
+	{
+		cAlphaSequence.clear();
+		cBetaSequence.clear();
+
+#if !LBM_AA_ALPHA_KERNEL_AS_PROPAGATION && !LBM_BETA_AA_KERNEL_AS_PROPAGATION
+		cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_Pre, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_Pre_WorkGroupSize), cKernelLbmAlpha_Pre_WorkGroupSize);
+		cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_Main, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_Main_WorkGroupSize), cKernelLbmAlpha_Main_WorkGroupSize);
+
+		if (fused_flag_conversion)
+		{
+			cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_FlagConversion, getFlagConversionWorkGroupSize(cKernelLbmAlpha_FlagConversion_WorkGroupSize), cKernelLbmAlpha_FlagConversion_WorkGroupSize);
+		}
+		else
+		{
+			cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_InterfaceToFluidNeighbors, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize), cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize);
+			cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_InterfaceToGas, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_InterfaceToGas_WorkGroupSize), cKernelLbmAlpha_InterfaceToGas_WorkGroupSize);
+			cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_InterfaceToGasNeighbors, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize), cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize);
+			cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_GatherMass, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_GatherMass_WorkGroupSize), cKernelLbmAlpha_GatherMass_WorkGroupSize);
+		}
+
+		cAlphaSequence.appendNDRangeKernel(cKernelLbmAlpha_GasToInterface, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_GasToInterface_WorkGroupSize), cKernelLbmAlpha_GasToInterface_WorkGroupSize);
+
+		cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_Pre, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_Pre_WorkGroupSize), cKernelLbmBeta_Pre_WorkGroupSize);
+		cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_Main, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_Main_WorkGroupSize), cKernelLbmBeta_Main_WorkGroupSize);
+
+		if (fused_flag_conversion)
+		{
+			cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_FlagConversion, getFlagConversionWorkGroupSize(cKernelLbmBeta_FlagConversion_WorkGroupSize), cKernelLbmBeta_FlagConversion_WorkGroupSize);
+		}
+		else
+		{
+			cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_InterfaceToFluidNeighbors, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize), cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize);
+			cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_InterfaceToGas, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_InterfaceToGas_WorkGroupSize), cKernelLbmBeta_InterfaceToGas_WorkGroupSize);
+			cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_InterfaceToGasNeighbors, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize), cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize);
+			cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_GatherMass, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_GatherMass_WorkGroupSize), cKernelLbmBeta_GatherMass_WorkGroupSize);
+		}
+
+		cBetaSequence.appendNDRangeKernel(cKernelLbmBeta_GasToInterface, this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_GasToInterface_WorkGroupSize), cKernelLbmBeta_GasToInterface_WorkGroupSize);
+
+		cAlphaSequence.finalize(this->cl, true);
+		cBetaSequence.finalize(this->cl, true);
+
+		if (this->verbose)
+			std::cout << "recorded steps: " << (cAlphaSequence.isCommandBuffer() ? "command buffer" : "dispatch list") << std::endl;
+#endif
+	}
+
+	/**
+	 * return the global work group size of the fused flag conversion kernel (one work group for each tile)
+	 */
+	cl::NDRange getFlagConversionWorkGroupSize(const cl::NDRange &work_group_size)
+	{
+		size_t tiles = (active_tiles ? (size_t)active_tiles_list_count : flag_conversion_tiles_count);
+		return cl::NDRange(tiles*work_group_size[0]);
+	}
+
+	/**
+	 * return the global work group size of a flag conversion kernel which is launched for 'items' cells
+	 */
+	cl::NDRange getConversionWorkGroupSize(	const cl::NDRange &work_group_size,	///< local work group size of kernel
+											size_t items						///< number of items in list
+	)
+	{
+		if (!interface_worklist)
+			return this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, work_group_size);
+
+		// launch at least one work group to avoid empty ranges
+		if (items == 0)
+			items = 1;
+
+		// round up to multiple of work group size (the kernels check the range)
+		size_t local_size = work_group_size[0];
+		return cl::NDRange(((items + local_size - 1) / local_size) * local_size);
+	}
+
+	/**
+	 * maximum number of converted cells during one simulation step
+	 *
+	 * each interface cell converts at most all 18 neighbors. the fused flag conversion also pushes
+	 * the interface cells which changed their flag.
+	 */
+	size_t getMaxConvertedCells()
+	{
+		size_t cells_per_interface_cell = (fused_flag_conversion ? 19 : 18);
+		return std::min<size_t>((size_t)interface_cells_count*cells_per_interface_cell, this->domain_cells_count);
+	}
+
+	/**
+	 * create the list of interface cells for the first alpha step from the flags
+	 */
+	void initInterfaceWorklist()
+	{
+		const cl_int zero = 0;
+
+		this->cl.cCommandQueue.enqueueFillBuffer(cMemInterfaceCells, zero, 0, sizeof(cl_int));
+		this->cl.cCommandQueue.enqueueFillBuffer(cMemConvertedCells, zero, 0, sizeof(cl_int));
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelInterfaceList_Init,	// kernel
+														cl::NullRange,				// global work offset
+														this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelInterfaceList_Init_WorkGroupSize),
+														cl::NDRange(cKernelInterfaceList_Init_WorkGroupSize)
+						);
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		for (int i = 0; i < 2; i++)
+		{
+			if (interface_cells_count_event[i]() != NULL)
+			{
+				CL_CHECK_ERROR(interface_cells_count_event[i].wait());
+			}
+			interface_cells_count_event[i] = cl::Event();
+		}
+
+		this->cl.cCommandQueue.enqueueReadBuffer(cMemInterfaceCells, CL_TRUE, 0, sizeof(cl_int), &interface_cells_count);
+	}
+
+	/**
+	 * compact the list of interface cells after the flag conversions
+	 *
+	 * the cells which are no interface cells anymore are removed and the converted cells are added.
+	 *
+	 * the number of cells in the new list is read back without blocking and used one step later. the
+	 * global work group sizes of the next step are computed from the number of cells in the list of
+	 * the current step: each interface cell converts at most its 18 neighbors, thus the new list has
+	 * at most 19 times as many cells. the kernels check the range with the number of cells stored on
+	 * the device. waiting for the read of the previous step keeps the current step in the queue.
+	 */
+	void updateInterfaceWorklist(	cl::Kernel &cKernelInterfaceList,					///< compaction kernel for current step
+									const cl::NDRange &cKernelInterfaceList_WorkGroupSize,	///< work group size of compaction kernel
+									cl::Buffer &cMemNextInterfaceCells					///< interface list for next step
+	)
+	{
+		const cl_int zero = 0;
+
+		this->cl.cCommandQueue.enqueueFillBuffer(cMemNextInterfaceCells, zero, 0, sizeof(cl_int));
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelInterfaceList,	// kernel
+														cl::NullRange,			// global work offset
+														getConversionWorkGroupSize(cKernelInterfaceList_WorkGroupSize, interface_cells_count + getMaxConvertedCells()),
+														cl::NDRange(cKernelInterfaceList_WorkGroupSize)
+						);
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		// reset list of converted cells for the next step
+		this->cl.cCommandQueue.enqueueFillBuffer(cMemConvertedCells, zero, 0, sizeof(cl_int));
+
+		// number of cells in the list of the current step, read back at the end of the previous step
+		int current = (this->simulation_step_counter & 1);
+		if (interface_cells_count_event[current]() != NULL)
+		{
+			CL_CHECK_ERROR(interface_cells_count_event[current].wait());
+			interface_cells_count = interface_cells_count_read[current];
+		}
+
+		int next = current ^ 1;
+		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(cMemNextInterfaceCells, CL_FALSE, 0, sizeof(cl_int), &interface_cells_count_read[next], NULL, &interface_cells_count_event[next]));
+
+		interface_cells_count = (cl_int)std::min<size_t>((size_t)interface_cells_count*19, this->domain_cells_count);
+	}
+
 	/**
 	 * reset the performance counters
 	 */
@@ -509,6 +1084,29 @@ public:
 
 		CLBM_LOAD_PROGRAM(cProgramMassScale, cKernelLbmMassScale_WorkGroupSize, cKernelLbmMassScale_MaxRegisters, "data/cl_programs/lbm_mass_scale.cl");
 
+		// optional programs
+		cl::Program cProgramActiveTiles, cProgramInterfaceList, cProgramInterfaceListUpdate, cProgramFlagConversion;
+
+		if (active_tiles)
+			loadProgram(cProgramActiveTiles, cKernelActiveTiles_Mark_WorkGroupSize, cKernelActiveTiles_Mark_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/lbm_active_tiles.cl", test_local_work_group_size);
+
+		if (interface_worklist)
+		{
+			loadProgram(cProgramInterfaceList, cKernelInterfaceList_Init_WorkGroupSize, cKernelInterfaceList_Init_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/stack.cl", test_local_work_group_size);
+			loadProgram(cProgramInterfaceListUpdate, cKernelLbmAlpha_InterfaceList_WorkGroupSize, cKernelLbmAlpha_InterfaceList_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/lbm_interface_list.cl", test_local_work_group_size);
+		}
+
+		if (fused_flag_conversion)
+			loadProgram(cProgramFlagConversion, cKernelLbmAlpha_FlagConversion_WorkGroupSize, cKernelLbmAlpha_FlagConversion_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/lbm_flag_conversion.cl", test_local_work_group_size);
+
+		// the velocity and density recomputation and the rescaling depend on the defines of the implementation
+		this->loadMacroscopicProgram();
+
+		// build all programs loaded so far at once before any kernel is created
+		this->finishProgramBuilds();
+		if (this->error())
+			return;
+
 
 		/**********************************************************
 		 * mass scaling kernel
@@ -516,24 +1114,104 @@ public:
 		CLBM_CREATE_KERNEL_(	cKernelLbmMassScale, cProgramMassScale, "kernel_lbm_mass_scale");
 		cKernelLbmMassScale.setArg(0, this->cMemFluidMass);
 
+		/**********************************************************
+		 * active tiles kernels
+		 **********************************************************/
+		if (active_tiles)
+		{
+			CLBM_CREATE_KERNEL_5(	cKernelActiveTiles_Mark, cProgramActiveTiles, "kernel_active_tiles_mark",
+							this->cMemCellFlags,
+							this->cMemNewCellFlags,
+							cMemActiveTiles,
+							cMemNewActiveTileList,
+							active_tiles_update_id
+			);
+
+			CLBM_CREATE_KERNEL_3(	cKernelActiveTiles_Compact, cProgramActiveTiles, "kernel_active_tiles_compact",
+							cMemActiveTiles,
+							cMemNewActiveTileList,
+							active_tiles_update_id
+			);
+		}
+
+		/**********************************************************
+		 * interface worklist kernels
+		 **********************************************************/
+		if (interface_worklist)
+		{
+			CLBM_CREATE_KERNEL_3(	cKernelInterfaceList_Init, cProgramInterfaceList, "kernel_stack_push_flag",
+							this->cMemCellFlags,
+							cMemInterfaceCells,
+							(cl_int)CLbmOpenClInterface<T>::LBM_FLAG_INTERFACE
+			);
+
+			// the new flags of the alpha step are the flags after the conversions
+			CLBM_CREATE_KERNEL_7(	cKernelLbmAlpha_InterfaceList, cProgramInterfaceListUpdate, "kernel_lbm_alpha_interface_list",
+							this->cMemNewCellFlags,
+							this->cMemCellFlags,
+							this->cMemNewFluidFraction,
+							cMemInterfaceCells,
+							cMemConvertedCells,
+							cMemNewInterfaceCells,
+							this->cMemParams
+			);
+
+			CLBM_CREATE_KERNEL_7(	cKernelLbmBeta_InterfaceList, cProgramInterfaceListUpdate, "kernel_lbm_beta_interface_list",
+							this->cMemCellFlags,
+							this->cMemNewCellFlags,
+							this->cMemFluidFraction,
+							cMemNewInterfaceCells,
+							cMemConvertedCells,
+							cMemInterfaceCells,
+							this->cMemParams
+			);
+		}
+
+		/**********************************************************
+		 * fused flag conversion kernels
+		 **********************************************************/
+		if (fused_flag_conversion)
+		{
+			CLBM_CREATE_KERNEL_3(	cKernelLbmAlpha_FlagConversion, cProgramFlagConversion, "kernel_flag_conversion",
+							this->cMemNewCellFlags,
+							this->cMemNewFluidFraction,
+							this->cMemParams
+			);
+
+			CLBM_CREATE_KERNEL_3(	cKernelLbmBeta_FlagConversion, cProgramFlagConversion, "kernel_flag_conversion",
+							this->cMemCellFlags,
+							this->cMemFluidFraction,
+							this->cMemParams
+			);
+
+			if (active_tiles)
+			{
+				CL_CHECK_ERROR(cKernelLbmAlpha_FlagConversion.setArg(3, cMemActiveTileList));
+				CL_CHECK_ERROR(cKernelLbmBeta_FlagConversion.setArg(3, cMemActiveTileList));
+			}
+
+			// the converted cells are resolved by the gas to interface kernels
+			if (interface_worklist)
+			{
+				cl_uint push_arg = (active_tiles ? 4 : 3);
+				CL_CHECK_ERROR(cKernelLbmAlpha_FlagConversion.setArg(push_arg, cMemConvertedCells));
+				CL_CHECK_ERROR(cKernelLbmBeta_FlagConversion.setArg(push_arg, cMemConvertedCells));
+			}
+		}
+
 		/**********************************************************
 		 * initialization kernel
 		 **********************************************************/
-		CLBM_CREATE_KERNEL_13(	cKernelLbmInit, cProgramInit, "kernel_lbm_init",
+		CLBM_CREATE_KERNEL_9(	cKernelLbmInit, cProgramInit, "kernel_lbm_init",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
-						this->cMemNewFluidFraction,
-
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2]
+						this->cMemNewFluidFraction
 		);
 
 
@@ -549,27 +1227,20 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// ALPHA MAIN
-		CLBM_CREATE_KERNEL_14(	cKernelLbmAlpha_Main, cProgramAlpha_Main, "kernel_lbm_alpha",
+		CLBM_CREATE_KERNEL_9(	cKernelLbmAlpha_Main, cProgramAlpha_Main, "kernel_lbm_alpha",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
-						this->cMemNewFluidFraction,
-
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2],
-
-						this->params.mass_exchange_factor
+						this->cMemNewFluidFraction
 		);
 
 		// INTERFACE TO FLUID NEIGHBORS
@@ -580,7 +1251,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS
@@ -591,7 +1262,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS NEIGHBORS
@@ -620,7 +1291,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 #else
@@ -650,27 +1321,20 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// BETA MAIN
-		CLBM_CREATE_KERNEL_14(	cKernelLbmBeta_Main, cProgramBeta_Main, "kernel_beta",
+		CLBM_CREATE_KERNEL_9(	cKernelLbmBeta_Main, cProgramBeta_Main, "kernel_beta",
 						this->cMemDensityDistributions,
 						this->cMemNewCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
 						this->cMemCellFlags,
-						this->cMemFluidFraction,
-
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2],
-
-						this->params.mass_exchange_factor
+						this->cMemFluidFraction
 		);
 
 		// INTERFACE TO FLUID NEIGHBORS
@@ -681,7 +1345,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS
@@ -692,7 +1356,7 @@ public:
 				this->cMemDensity,
 				this->cMemFluidMass,
 				this->cMemFluidFraction,
-				this->params.mass_exchange_factor
+				this->cMemParams
 		);
 
 		// INTERFACE TO GAS NEIGHBORS
@@ -714,7 +1378,7 @@ public:
 				this->cMemDensity,
 				this->cMemFluidMass,
 				this->cMemFluidFraction,
-				this->params.mass_exchange_factor
+				this->cMemParams
 		);
 
 		// GATHER MASS
@@ -734,6 +1398,75 @@ public:
 		);
 #endif
 
+#if !LBM_AA_ALPHA_KERNEL_AS_PROPAGATION && !LBM_BETA_AA_KERNEL_AS_PROPAGATION
+		if (active_tiles)
+		{
+			// the active tile list is the last argument of each simulation kernel
+			CL_CHECK_ERROR(cKernelLbmAlpha_Pre.setArg(7, cMemActiveTileList));
+			CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(9, cMemActiveTileList));
+			CL_CHECK_ERROR(cKernelLbmAlpha_GatherMass.setArg(3, cMemActiveTileList));
+
+			CL_CHECK_ERROR(cKernelLbmBeta_Pre.setArg(7, cMemActiveTileList));
+			CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(9, cMemActiveTileList));
+			CL_CHECK_ERROR(cKernelLbmBeta_GatherMass.setArg(3, cMemActiveTileList));
+
+			// the flag conversion kernels are launched for the interface list if available
+			if (!interface_worklist)
+			{
+				CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToFluidNeighbors.setArg(7, cMemActiveTileList));
+				CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToGas.setArg(7, cMemActiveTileList));
+				CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToGasNeighbors.setArg(7, cMemActiveTileList));
+				CL_CHECK_ERROR(cKernelLbmAlpha_GasToInterface.setArg(7, cMemActiveTileList));
+
+				CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToFluidNeighbors.setArg(7, cMemActiveTileList));
+				CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToGas.setArg(7, cMemActiveTileList));
+				CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToGasNeighbors.setArg(7, cMemActiveTileList));
+				CL_CHECK_ERROR(cKernelLbmBeta_GasToInterface.setArg(7, cMemActiveTileList));
+			}
+		}
+
+		if (interface_worklist)
+		{
+			/*
+			 * the conversion kernels are launched for the interface cells, the gas to interface
+			 * kernels are launched for the converted cells.
+			 */
+			CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToFluidNeighbors.setArg(7, cMemInterfaceCells));
+			CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToFluidNeighbors.setArg(8, cMemConvertedCells));
+			CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToGas.setArg(7, cMemInterfaceCells));
+			CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToGasNeighbors.setArg(7, cMemInterfaceCells));
+			CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceToGasNeighbors.setArg(8, cMemConvertedCells));
+			CL_CHECK_ERROR(cKernelLbmAlpha_GasToInterface.setArg(7, cMemConvertedCells));
+
+			CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToFluidNeighbors.setArg(7, cMemNewInterfaceCells));
+			CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToFluidNeighbors.setArg(8, cMemConvertedCells));
+			CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToGas.setArg(7, cMemNewInterfaceCells));
+			CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToGasNeighbors.setArg(7, cMemNewInterfaceCells));
+			CL_CHECK_ERROR(cKernelLbmBeta_InterfaceToGasNeighbors.setArg(8, cMemConvertedCells));
+			CL_CHECK_ERROR(cKernelLbmBeta_GasToInterface.setArg(7, cMemConvertedCells));
+		}
+
+		if (cell_state)
+		{
+			// the packed cell states follow the active tile list
+			cl_uint cell_state_arg_offset = (active_tiles ? 1 : 0);
+
+			CL_CHECK_ERROR(cKernelLbmInit.setArg(10, cMemCellState));
+
+			CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(9+cell_state_arg_offset, cMemCellState));
+			CL_CHECK_ERROR(cKernelLbmAlpha_Main.setArg(10+cell_state_arg_offset, cMemNewCellState));
+			CL_CHECK_ERROR(cKernelLbmAlpha_InterfaceList.setArg(7, cMemNewCellState));
+
+			CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(9+cell_state_arg_offset, cMemNewCellState));
+			CL_CHECK_ERROR(cKernelLbmBeta_Main.setArg(10+cell_state_arg_offset, cMemCellState));
+			CL_CHECK_ERROR(cKernelLbmBeta_InterfaceList.setArg(7, cMemCellState));
+		}
+#endif
+
+		/**********************************************************
+		 * recomputation of the velocity and density (LBM_LAZY_MACROSCOPIC)
+		 **********************************************************/
+		this->createInterfaceKernels();
 	}
 
 	/**
@@ -748,15 +1481,27 @@ public:
 		if (this->verbose)
 			std::cout << "Init Simulation: " << std::flush;
 
-		cKernelLbmInit.setArg(13, this->fluid_init_flags);
+		cKernelLbmInit.setArg(9, this->fluid_init_flags);
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmInit,	// kernel
 														cl::NullRange,			// global work offset
-														global_work_group_size,
+														this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmInit_WorkGroupSize),
 														cKernelLbmInit_WorkGroupSize
 						);
 
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
+		if (cell_state)
+		{
+			this->cl.cCommandQueue.enqueueCopyBuffer(cMemCellState, cMemNewCellState, 0, 0, sizeof(cl_uint)*this->domain_cells_count);
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		}
+
+		if (interface_worklist)
+			initInterfaceWorklist();
+
+		// the active tiles are computed from the new flags at the next step
+		new_active_tiles_list_valid = false;
+
 		this->resetFluid_Interface();
 
 		if (this->verbose)
@@ -783,7 +1528,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_Pre,	// kernel
 													cl::NullRange,				// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_Pre_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_Pre_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -792,7 +1537,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_Main,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_Main_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_Main_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -801,7 +1546,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToFluidNeighbors,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -810,7 +1555,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToGas,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_InterfaceToGas_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_InterfaceToGas_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -819,7 +1564,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToGasNeighbors,	// kernel
 													cl::NullRange,									// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize)
 							);
 
@@ -829,7 +1574,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_GasToInterface,	// kernel
 													cl::NullRange,							// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_GasToInterface_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_GasToInterface_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -838,7 +1583,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_GatherMass,	// kernel
 													cl::NullRange,							// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_GatherMass_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_GatherMass_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -847,7 +1592,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_GatherMass,	// kernel
 													cl::NullRange,							// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_GatherMass_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_GatherMass_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -868,7 +1613,7 @@ public:
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_Propagation,     // kernel
                                                     0,                              // global work offset
 
-														global_work_group_size,
+														this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmBeta_Propagation_WorkGroupSize),
 														cl::NDRange(cKernelLbmBeta_Propagation_WorkGroupSize)
                                             );
 			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -877,7 +1622,7 @@ public:
 													this->cMemDensityDistributions,
                                                     0,
                                                     0,
-                                                    this->domain_cells_count*sizeof(T)*19
+                                                    this->dd_buffer_bytes
                                             );
 
 			this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemNewFluidFraction,
@@ -905,7 +1650,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_Pre,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_Pre_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_Pre_WorkGroupSize)
 							);
 
@@ -915,7 +1660,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_Main,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_Main_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_Main_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -924,7 +1669,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToFluidNeighbors,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -933,7 +1678,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToGas,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_InterfaceToGas_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_InterfaceToGas_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -942,7 +1687,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToGasNeighbors,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize)
 							);
 
@@ -953,7 +1698,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_GasToInterface,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_GasToInterface_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_GasToInterface_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -962,7 +1707,7 @@ public:
 			cStopwatch.start();
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_GatherMass,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmAlpha_GatherMass_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_GatherMass_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.finish();
@@ -994,7 +1739,7 @@ public:
 												this->cMemDensityDistributions,
 												0,
 												0,
-												this->domain_cells_count*sizeof(T)*19
+												this->dd_buffer_bytes
                                             );
 
 			this->cl.cCommandQueue.enqueueCopyBuffer(	this->cMemFluidFraction,
@@ -1029,22 +1774,81 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmMassScale,	// kernel
 														cl::NullRange,				// global work offset
-														global_work_group_size,
+														this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbmMassScale_WorkGroupSize),
 														cl::NDRange(cKernelLbmMassScale_WorkGroupSize)
 						);
 
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 	}
 
+	/**
+	 * the alpha step stores the density distributions of the opposite directions exchanged
+	 */
+	cl_int getDDStorageSwap()
+	{
+		return (this->simulation_step_counter & 1);
+	}
+
+	/**
+	 * enqueue 'steps' simulation steps
+	 *
+	 * with recorded steps, the launches are replayed without any kernel setup.
+	 */
+	void simulationSteps(int steps)
+	{
+		if (!recorded_steps)
+		{
+			for (int i = 0; i < steps; i++)
+				simulationStep();
+			return;
+		}
+
+		if (!cAlphaSequence.finalized)
+			recordSteps();
+
+		for (int i = 0; i < steps; i++)
+		{
+			if (this->simulation_step_counter & 1)
+				cBetaSequence.enqueue(this->cl.cCommandQueue);
+			else
+				cAlphaSequence.enqueue(this->cl.cCommandQueue);
+
+			this->simulation_step_counter++;
+		}
+	}
+
 	/**
 	 * start one simulation step (enqueue kernels)
 	 */
 	void simulationStep()
 	{
+		if (recorded_steps)
+		{
+			simulationSteps(1);
+			return;
+		}
+
 		/*
 		 * collision kernels are inserted as 1d kernels because they work cell wise without neighboring information
 		 */
 
+		if (active_tiles)
+		{
+			if (!new_active_tiles_list_valid || this->simulation_step_counter % LBM_AA_ACTIVE_TILES_REFRESH_INTERVAL == 0)
+				updateActiveTiles();
+
+			/*
+			 * nothing to simulate: the step counter is kept since its parity
+			 * selects the storage of the A-A pattern and no kernel swapped it.
+			 * the list is recomputed at the next step to catch new fluid cells.
+			 */
+			if (active_tiles_list_count == 0)
+			{
+				new_active_tiles_list_valid = false;
+				return;
+			}
+		}
+
 		if (this->simulation_step_counter & 1)
 		{
 #if !LBM_BETA_AA_KERNEL_AS_PROPAGATION
@@ -1052,7 +1856,7 @@ public:
 			// BETA KERNEL
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_Pre,	// kernel
 													cl::NullRange,				// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmBeta_Pre_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_Pre_WorkGroupSize)
 							);
 
@@ -1060,57 +1864,73 @@ public:
 
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_Main,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmBeta_Main_WorkGroupSize),
 													cl::NDRange(cKernelLbmBeta_Main_WorkGroupSize)
 							);
 
 			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToFluidNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize)
-							);
+			if (fused_flag_conversion)
+			{
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_FlagConversion,	// kernel
+														cl::NullRange,					// global work offset
+														getFlagConversionWorkGroupSize(cKernelLbmBeta_FlagConversion_WorkGroupSize),
+														cl::NDRange(cKernelLbmBeta_FlagConversion_WorkGroupSize)
+								);
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
+			else
+			{
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToFluidNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														getConversionWorkGroupSize(cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize, interface_cells_count),
+														cl::NDRange(cKernelLbmBeta_InterfaceToFluidNeighbors_WorkGroupSize)
+								);
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToGas,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmBeta_InterfaceToGas_WorkGroupSize)
-							);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToGas,	// kernel
+														cl::NullRange,					// global work offset
+														getConversionWorkGroupSize(cKernelLbmBeta_InterfaceToGas_WorkGroupSize, interface_cells_count),
+														cl::NDRange(cKernelLbmBeta_InterfaceToGas_WorkGroupSize)
+								);
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToGasNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize)
-							);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_InterfaceToGasNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														getConversionWorkGroupSize(cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize, interface_cells_count),
+														cl::NDRange(cKernelLbmBeta_InterfaceToGasNeighbors_WorkGroupSize)
+								);
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_GatherMass,	// kernel
-													cl::NullRange,				// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmBeta_GatherMass_WorkGroupSize)
-							);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_GatherMass,	// kernel
+														cl::NullRange,				// global work offset
+														this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmBeta_GatherMass_WorkGroupSize),
+														cl::NDRange(cKernelLbmBeta_GatherMass_WorkGroupSize)
+								);
+
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
 
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_GasToInterface,	// kernel
 													cl::NullRange,				// global work offset
-													global_work_group_size,
+													getConversionWorkGroupSize(cKernelLbmBeta_GasToInterface_WorkGroupSize, getMaxConvertedCells()),
 													cl::NDRange(cKernelLbmBeta_GasToInterface_WorkGroupSize)
 							);
 
 			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
+			if (interface_worklist)
+				updateInterfaceWorklist(cKernelLbmBeta_InterfaceList, cKernelLbmBeta_InterfaceList_WorkGroupSize, cMemInterfaceCells);
+
 #else
 //			std::cout << "beta propagation" << std::endl;
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmBeta_Propagation,     // kernel
 														cl::NullRange,                              // global work offset
-														global_work_group_size,
+														this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmBeta_Propagation_WorkGroupSize),
 														cl::NDRange(cKernelLbmBeta_Propagation_WorkGroupSize)
                                             );
 
@@ -1120,7 +1940,7 @@ public:
 												this->cMemDensityDistributions,
 												0,
 												0,
-												this->domain_cells_count*sizeof(T)*19
+												this->dd_buffer_bytes
                                             );
 
 			this->cl.cCommandQueue.enqueueCopyBuffer(	this->cMemNewFluidFraction,
@@ -1147,7 +1967,7 @@ public:
 //			std::cout << "alpha aa" << std::endl;
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_Pre,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmAlpha_Pre_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_Pre_WorkGroupSize)
 							);
 
@@ -1155,53 +1975,69 @@ public:
 
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_Main,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmAlpha_Main_WorkGroupSize),
 													cl::NDRange(cKernelLbmAlpha_Main_WorkGroupSize)
 							);
 
 			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToFluidNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToGas,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmAlpha_InterfaceToGas_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToGasNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			if (fused_flag_conversion)
+			{
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_FlagConversion,	// kernel
+														cl::NullRange,					// global work offset
+														getFlagConversionWorkGroupSize(cKernelLbmAlpha_FlagConversion_WorkGroupSize),
+														cl::NDRange(cKernelLbmAlpha_FlagConversion_WorkGroupSize)
+								);
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_GatherMass,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cl::NDRange(cKernelLbmAlpha_GatherMass_WorkGroupSize)
-							);
-
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
+			else
+			{
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToFluidNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														getConversionWorkGroupSize(cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize, interface_cells_count),
+														cl::NDRange(cKernelLbmAlpha_InterfaceToFluidNeighbors_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToGas,	// kernel
+														cl::NullRange,					// global work offset
+														getConversionWorkGroupSize(cKernelLbmAlpha_InterfaceToGas_WorkGroupSize, interface_cells_count),
+														cl::NDRange(cKernelLbmAlpha_InterfaceToGas_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_InterfaceToGasNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														getConversionWorkGroupSize(cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize, interface_cells_count),
+														cl::NDRange(cKernelLbmAlpha_InterfaceToGasNeighbors_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_GatherMass,	// kernel
+														cl::NullRange,					// global work offset
+														this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmAlpha_GatherMass_WorkGroupSize),
+														cl::NDRange(cKernelLbmAlpha_GatherMass_WorkGroupSize)
+								);
+
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_GasToInterface,	// kernel
 													cl::NullRange,					// global work offset
-													global_work_group_size,
+													getConversionWorkGroupSize(cKernelLbmAlpha_GasToInterface_WorkGroupSize, getMaxConvertedCells()),
 													cl::NDRange(cKernelLbmAlpha_GasToInterface_WorkGroupSize)
 							);
 
 			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
+			if (interface_worklist)
+				updateInterfaceWorklist(cKernelLbmAlpha_InterfaceList, cKernelLbmAlpha_InterfaceList_WorkGroupSize, cMemNewInterfaceCells);
+
 #else
 //			std::cout << "alpha propagation" << std::endl;
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbmAlpha_Propagation,    // kernel
                                                     cl::NullRange,                              // global work offset
-                    								global_work_group_size,
+                    								this->getPaddedGlobalWorkGroupSize(simulation_global_work_group_size, cKernelLbmAlpha_Propagation_WorkGroupSize),
                     								cl::NDRange(cKernelLbmAlpha_Propagation_WorkGroupSize)
                                             );
 
@@ -1211,7 +2047,7 @@ public:
 												this->cMemDensityDistributions,
 												0,
 												0,
-												this->domain_cells_count*sizeof(T)*19
+												this->dd_buffer_bytes
                                             );
 
 			this->cl.cCommandQueue.enqueueCopyBuffer(	this->cMemFluidFraction,
@@ -20,6 +20,7 @@
 #include "CLbmParameters.hpp"
 #include "CLbmOpenClInterface.hpp"
 #include "libopencl/CCLSkeleton.hpp"
+#include "libopencl/CCLEventGraph.hpp"
 #include "lib/CError.hpp"
 #include <typeinfo>
 #include <iomanip>
@@ -28,6 +29,41 @@
 
 #define LBM_AB_TEST_WITH_AA_1_KERNEL	0
 
+/**
+ * set to 1 to store the density distributions as half floats (deviation from the lattice weights)
+ */
+#ifndef LBM_AB_1_DD_HALF
+	#define LBM_AB_1_DD_HALF	0
+#endif
+
+/**
+ * set to 1 to compute the interface to fluid neighbors, interface to gas and interface to gas neighbors
+ * conversions with a single kernel which loads the flags of a tile and its halo to local memory
+ */
+#ifndef LBM_AB_1_FUSED_FLAG_CONVERSION
+	#define LBM_AB_1_FUSED_FLAG_CONVERSION	1
+#endif
+#define LBM_AB_1_FLAG_CONVERSION_TILE_SIZE	8
+
+/**
+ * set to 1 to launch the collision and propagation kernel with a 3D range and 3D work groups.
+ * each work group loads the flags and fluid fractions of its tile and a halo of one cell to local memory.
+ */
+#ifndef LBM_AB_1_TILED_3D
+	#define LBM_AB_1_TILED_3D	0
+#endif
+#define LBM_AB_1_TILE_SIZE_X	8
+#define LBM_AB_1_TILE_SIZE_Y	4
+#define LBM_AB_1_TILE_SIZE_Z	4
+
+/**
+ * set to 1 to enqueue the simulation kernels to an out of order queue with explicit event
+ * dependencies (if supported by the device). otherwise the in order queue is used.
+ */
+#ifndef LBM_AB_1_OUT_OF_ORDER_QUEUE
+	#define LBM_AB_1_OUT_OF_ORDER_QUEUE	1
+#endif
+
 /**
  * OpenCL implementation for lattice boltzmann method using the A-B pattern
  *
@@ -59,10 +95,16 @@ private:
 
 
 	cl::Kernel cKernelLbm_MassScale;
+	cl::Kernel cKernelLbm_FlagConversion;
 
 	cl::NDRange global_work_group_size;
 	size_t max_local_work_group_size;
 
+	bool tiled_3d;								///< true, if the collision and propagation kernel is launched with 3D work groups
+	cl::NDRange tiled_3d_global_work_group_size;	///< 3D range padded to a multiple of the tile size
+
+	CCLEventGraph cEventGraph;					///< submission of the simulation kernels with event dependencies
+
 
 	/*
 	 * work group sizes for opencl kernels
@@ -78,6 +120,7 @@ private:
 	cl::NDRange cKernelLbm_GatherMass_WorkGroupSize;
 
 	cl::NDRange cKernelLbm_MassScale_WorkGroupSize;
+	cl::NDRange cKernelLbm_FlagConversion_WorkGroupSize;
 
 #if LBM_AB_TEST_WITH_AA_1_KERNEL
 	cl::NDRange cKernelLbm_Alpha_Pre_WorkGroupSize;
@@ -98,6 +141,10 @@ private:
 	size_t cKernelLbm_GatherMass_MaxRegisters;
 
 	size_t cKernelLbm_MassScale_MaxRegisters;
+	size_t cKernelLbm_FlagConversion_MaxRegisters;
+
+	bool fused_flag_conversion;				///< true, if the flag conversions are computed by a single kernel
+	size_t flag_conversion_tiles_count;		///< number of tiles in domain for the fused flag conversion
 
 #if LBM_AB_TEST_WITH_AA_1_KERNEL
 	size_t cKernelLbm_Alpha_Pre_MaxRegisters;
@@ -164,33 +211,7 @@ public:
 
     void setKernelArguments()
     {
-		cKernelLbm_Init.setArg(4, this->params.inv_tau);
-		cKernelLbm_Init.setArg(5, this->params.inv_trt_tau);
-
-		cKernelLbm_Init.setArg(10, this->params.gravitation[0]);
-		cKernelLbm_Init.setArg(11, this->params.gravitation[1]);
-		cKernelLbm_Init.setArg(12, this->params.gravitation[2]);
-
-		cKernelLbm_Main.setArg(4, this->params.inv_tau);
-		cKernelLbm_Main.setArg(5, this->params.inv_trt_tau);
-
-		cKernelLbm_Main.setArg(10, this->params.gravitation[0]);
-		cKernelLbm_Main.setArg(11, this->params.gravitation[1]);
-		cKernelLbm_Main.setArg(12, this->params.gravitation[2]);
-
-		cKernelLbm_Main.setArg(13, this->params.mass_exchange_factor);
-
-#if LBM_AB_TEST_WITH_AA_1_KERNEL
-		cKernelLbm_Alpha_Pre.setArg(6, this->params.mass_exchange_factor);
-
-		cKernelLbm_InterfaceToFluidNeighbors.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_InterfaceToGas.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_GasToInterface.setArg(6, this->params.mass_exchange_factor);
-#else
-		cKernelLbm_InterfaceToFluidNeighbors.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_InterfaceToGas.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_GasToInterface.setArg(6, this->params.mass_exchange_factor);
-#endif
+		this->updateParamsBuffer();
 
 		CError_AppendReturnThis(this->params);
     }
@@ -234,12 +255,18 @@ public:
 	 */
 	void reload()
 	{
+		this->dd_half = LBM_AB_1_DD_HALF;
 		this->reloadInterface();
 
 		/*
 		 * ALLOCATE BUFFERS
 		 */
-		cMemNewDensityDistributions = cl::Buffer(this->cl.cContext, CL_MEM_READ_WRITE, sizeof(T)*this->domain_cells_count*this->SIZE_DD_HOST);
+		cMemNewDensityDistributions = this->createDDBuffer();
+
+		setupFusedFlagConversion();
+		setupTiled3D();
+
+		cEventGraph.init(this->cl, LBM_AB_1_OUT_OF_ORDER_QUEUE);
 
 		global_work_group_size = cl::NDRange(this->domain_cells_count);
 
@@ -248,6 +275,7 @@ public:
 			cKernelLbm_Init_WorkGroupSize = 0;
 
 			cKernelLbm_MassScale_WorkGroupSize = 0;
+			cKernelLbm_FlagConversion_WorkGroupSize = 0;
 
 			cKernelLbm_Main_WorkGroupSize = 0;
 			cKernelLbm_GasToInterface_WorkGroupSize = 0;
@@ -263,6 +291,9 @@ public:
 			if (this->verbose)
 				std::cout << "loading kernels with test value for local_work_group_size (highly experimental, most probably wont work)" << std::endl;
 
+			if (tiled_3d)
+				cKernelLbm_Main_WorkGroupSize = cl::NDRange(LBM_AB_1_TILE_SIZE_X, LBM_AB_1_TILE_SIZE_Y, LBM_AB_1_TILE_SIZE_Z);
+
 			createKernels(true);
 
 			if (this->verbose)
@@ -279,6 +310,7 @@ public:
  * with either the standard value (max_local_work_group_size) or with the value from the list
  */
 #define INIT_WORK_GROUP_SIZE(variable)										\
+			this->work_group_size_count++;									\
 			if (it != this->lbm_opencl_number_of_threads_list.end())		\
 			{																\
 				variable##_WorkGroupSize = (*it != 0 ? *it : max_local_work_group_size);	\
@@ -299,6 +331,7 @@ public:
 				variable##_MaxRegisters  = 0;								\
 			}																\
 
+			this->work_group_size_count = 0;
 			std::list<int>::iterator it = this->lbm_opencl_number_of_threads_list.begin();
 			std::list<int>::iterator ir = this->lbm_opencl_number_of_registers_list.begin();
 
@@ -316,14 +349,79 @@ public:
 #endif
 
 			INIT_WORK_GROUP_SIZE(cKernelLbm_MassScale);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_FlagConversion);
 #undef to_str
 #undef INIT_WORK_GROUP_SIZE
 
+#if LBM_AB_TEST_WITH_AA_1_KERNEL
+			// kernels which exchange data between the work items in local memory
+			this->checkPaddedWorkGroupSize(cKernelLbm_Alpha_Pre_WorkGroupSize, "kernel_lbm_alpha_pre");
+			if (this->error())
+				return;
+#endif
+
+			// the work group size of the tiled kernel is fixed by the tile size
+			if (tiled_3d)
+				cKernelLbm_Main_WorkGroupSize = cl::NDRange(LBM_AB_1_TILE_SIZE_X, LBM_AB_1_TILE_SIZE_Y, LBM_AB_1_TILE_SIZE_Z);
+
 			createKernels(false);
 		}
 	}
 
 
+	/**
+	 * check whether the flag conversions can be computed by the fused flag conversion kernel.
+	 *
+	 * the domain size has to be a multiple of the tile size.
+	 */
+	void setupFusedFlagConversion()
+	{
+		fused_flag_conversion = false;
+
+#if LBM_AB_1_FUSED_FLAG_CONVERSION && !LBM_AB_TEST_WITH_AA_1_KERNEL
+		if (	this->params.domain_cells[0] % LBM_AB_1_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[1] % LBM_AB_1_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[2] % LBM_AB_1_FLAG_CONVERSION_TILE_SIZE != 0
+		)
+		{
+			if (this->verbose)
+				std::cout << "fused flag conversion disabled: domain size is not a multiple of " << LBM_AB_1_FLAG_CONVERSION_TILE_SIZE << std::endl;
+			return;
+		}
+
+		fused_flag_conversion = true;
+		flag_conversion_tiles_count = this->domain_cells_count / (LBM_AB_1_FLAG_CONVERSION_TILE_SIZE*LBM_AB_1_FLAG_CONVERSION_TILE_SIZE*LBM_AB_1_FLAG_CONVERSION_TILE_SIZE);
+
+		this->cl_interface_program_defines << "#define FUSED_FLAG_CONVERSION	(1)" << std::endl;
+		this->cl_interface_program_defines << "#define FLAG_CONVERSION_TILE_SIZE	(" << LBM_AB_1_FLAG_CONVERSION_TILE_SIZE << ")" << std::endl;
+#endif
+	}
+
+	/**
+	 * setup the 3D range for the tiled collision and propagation kernel.
+	 *
+	 * the range is padded to a multiple of the tile size, thus any domain size is supported.
+	 */
+	void setupTiled3D()
+	{
+		tiled_3d = false;
+
+#if LBM_AB_1_TILED_3D && !LBM_AB_TEST_WITH_AA_1_KERNEL
+		tiled_3d = true;
+
+		tiled_3d_global_work_group_size = cl::NDRange(
+				((this->params.domain_cells[0] + LBM_AB_1_TILE_SIZE_X - 1) / LBM_AB_1_TILE_SIZE_X) * LBM_AB_1_TILE_SIZE_X,
+				((this->params.domain_cells[1] + LBM_AB_1_TILE_SIZE_Y - 1) / LBM_AB_1_TILE_SIZE_Y) * LBM_AB_1_TILE_SIZE_Y,
+				((this->params.domain_cells[2] + LBM_AB_1_TILE_SIZE_Z - 1) / LBM_AB_1_TILE_SIZE_Z) * LBM_AB_1_TILE_SIZE_Z
+			);
+
+		this->cl_interface_program_defines << "#define TILED_3D	(1)" << std::endl;
+		this->cl_interface_program_defines << "#define TILE_SIZE_X	(" << LBM_AB_1_TILE_SIZE_X << ")" << std::endl;
+		this->cl_interface_program_defines << "#define TILE_SIZE_Y	(" << LBM_AB_1_TILE_SIZE_Y << ")" << std::endl;
+		this->cl_interface_program_defines << "#define TILE_SIZE_Z	(" << LBM_AB_1_TILE_SIZE_Z << ")" << std::endl;
+#endif
+	}
+
 	void createKernels(bool test_local_work_group_size)
 	{
 		/*
@@ -353,25 +451,33 @@ public:
 		// mass scaling
 		CLBM_LOAD_PROGRAM(cProgram_MassScale, cKernelLbm_MassScale_WorkGroupSize, cKernelLbm_MassScale_MaxRegisters,	"data/cl_programs/lbm_mass_scale.cl");
 
+		// fused flag conversion
+		cl::Program cProgram_FlagConversion;
+		if (fused_flag_conversion)
+			loadProgram(cProgram_FlagConversion, cKernelLbm_FlagConversion_WorkGroupSize, cKernelLbm_FlagConversion_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/lbm_flag_conversion.cl", test_local_work_group_size);
+
+		// the velocity and density recomputation and the rescaling depend on the defines of the implementation
+		this->loadMacroscopicProgram();
+
+		// build all programs loaded so far at once before any kernel is created
+		this->finishProgramBuilds();
+		if (this->error())
+			return;
+
 
 		/**********************************************************
 		 * initialization kernel
 		 **********************************************************/
-		CLBM_CREATE_KERNEL_13(	cKernelLbm_Init, cProgram_Init, "kernel_lbm_init",
+		CLBM_CREATE_KERNEL_9(	cKernelLbm_Init, cProgram_Init, "kernel_lbm_init",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
-						this->cMemNewFluidFraction,
-
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2]
+						this->cMemNewFluidFraction
 		);
 
 
@@ -389,26 +495,19 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
-		CLBM_CREATE_KERNEL_14(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_alpha",
+		CLBM_CREATE_KERNEL_9(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_alpha",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
-						this->cMemNewFluidFraction,
-
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2],
-
-						this->params.mass_exchange_factor
+						this->cMemNewFluidFraction
 		);
 
 		CLBM_CREATE_KERNEL_2(	cKernelLbm_AA_Helper, cProgram_AA_Helper, "kernel_debug_beta_propagation",
@@ -424,7 +523,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS
@@ -435,7 +534,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS NEIGHBORS
@@ -464,27 +563,21 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 #else
-		CLBM_CREATE_KERNEL_15(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_coll_prop",
+		CLBM_CREATE_KERNEL_10(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_coll_prop",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
 						this->cMemNewFluidFraction,
 
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2],
-
-						this->params.mass_exchange_factor,
 						this->cMemNewDensityDistributions
 		);
 
@@ -497,7 +590,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS
@@ -508,7 +601,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS NEIGHBORS
@@ -537,7 +630,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 #endif
 
@@ -546,6 +639,61 @@ public:
 		 **********************************************************/
 		CLBM_CREATE_KERNEL_(	cKernelLbm_MassScale, cProgram_MassScale, "kernel_lbm_mass_scale");
 		cKernelLbm_MassScale.setArg(0, this->cMemFluidMass);
+
+		/**********************************************************
+		 * fused flag conversion kernel
+		 **********************************************************/
+		if (fused_flag_conversion)
+		{
+			CLBM_CREATE_KERNEL_3(	cKernelLbm_FlagConversion, cProgram_FlagConversion, "kernel_flag_conversion",
+							this->cMemNewCellFlags,
+							this->cMemNewFluidFraction,
+							this->cMemParams
+			);
+		}
+
+		/**********************************************************
+		 * recomputation of the velocity and density (LBM_LAZY_MACROSCOPIC)
+		 **********************************************************/
+		this->createInterfaceKernels();
+	}
+
+	/**
+	 * get memory reference to the OpenCL density distribution buffer of the current simulation step
+	 */
+	cl::Buffer &getDensityDistributionsMemObject()
+	{
+		if (this->simulation_step_counter & 1)
+			return cMemNewDensityDistributions;
+		else
+			return this->cMemDensityDistributions;
+	}
+
+	/**
+	 * get memory references to the OpenCL buffers written by the simulation step in progress
+	 */
+	cl::Buffer &getOutputDensityDistributionsMemObject()
+	{
+		if (this->simulation_step_counter & 1)
+			return this->cMemDensityDistributions;
+		else
+			return cMemNewDensityDistributions;
+	}
+
+	cl::Buffer &getOutputFlagsMemObject()
+	{
+		if (this->simulation_step_counter & 1)
+			return this->cMemCellFlags;
+		else
+			return this->cMemNewCellFlags;
+	}
+
+	cl::Buffer &getOutputFluidFractionMemObject()
+	{
+		if (this->simulation_step_counter & 1)
+			return this->cMemFluidFraction;
+		else
+			return this->cMemNewFluidFraction;
 	}
 
 	/**
@@ -559,10 +707,10 @@ public:
 		if (this->verbose)
 			std::cout << "Init Simulation: " << std::flush;
 
-		cKernelLbm_Init.setArg(13, this->fluid_init_flags);
+		cKernelLbm_Init.setArg(9, this->fluid_init_flags);
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Init,	// kernel
 														cl::NullRange,			// global work offset
-														global_work_group_size,
+														this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_Init_WorkGroupSize),
 														cKernelLbm_Init_WorkGroupSize
 						);
 
@@ -574,7 +722,7 @@ public:
 											cMemNewDensityDistributions,
 											0,
 											0,
-											this->domain_cells_count*this->SIZE_DD_HOST_BYTES
+											this->dd_buffer_bytes
                                         );
 
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -593,13 +741,16 @@ public:
 	{
 		cKernelLbm_MassScale.setArg(1, mass_scale_factor);
 
-		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_MassScale,	// kernel
-												cl::NullRange,				// global work offset
-												global_work_group_size,
-												cKernelLbm_MassScale_WorkGroupSize
+		// the mass scaling only depends on the fluid mass and not on the flags
+		cEventGraph.begin(this->cl.cCommandQueue);
+		cEventGraph.enqueueNDRangeKernel(	cKernelLbm_MassScale,	// kernel
+											cl::NullRange,			// global work offset
+											this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_MassScale_WorkGroupSize),
+											cKernelLbm_MassScale_WorkGroupSize,
+											CCLEventGraph::CBuffers()(this->cMemFluidMass),
+											CCLEventGraph::CBuffers()(this->cMemFluidMass)
 						);
-
-		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		cEventGraph.end(this->cl.cCommandQueue);
 	}
 
 	/**
@@ -619,7 +770,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Alpha_Pre,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_Alpha_Pre_WorkGroupSize),
 												cKernelLbm_Alpha_Pre_WorkGroupSize
 						);
 
@@ -631,7 +782,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
 												cl::NullRange,						// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_Main_WorkGroupSize),
 												cKernelLbm_Main_WorkGroupSize
 						);
 
@@ -644,7 +795,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize),
 												cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize
 						);
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -655,7 +806,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGas_WorkGroupSize),
 												cKernelLbm_InterfaceToGas_WorkGroupSize
 						);
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -668,7 +819,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
 												cl::NullRange,				// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GatherMass_WorkGroupSize),
 												cKernelLbm_GatherMass_WorkGroupSize
 						);
 
@@ -680,7 +831,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize),
 												cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize
 						);
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -691,7 +842,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GasToInterface_WorkGroupSize),
 												cKernelLbm_GasToInterface_WorkGroupSize
 						);
 
@@ -699,7 +850,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_AA_Helper,     // kernel
                                                 cl::NullRange,                              // global work offset
-                                                cl::NDRange(global_work_group_size_a[0]),
+                                                this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_AA_Helper_WorkGroupSize),
                                                 cKernelLbm_AA_Helper_WorkGroupSize
                                         );
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -708,7 +859,7 @@ public:
 												this->cMemDensityDistributions,
 												0,
 												0,
-												this->domain_cells_count*sizeof(T)*19
+												this->dd_buffer_bytes
 										);
 
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -735,262 +886,245 @@ public:
 	void simulationStep()
 	{
 		/*
-		 * collision kernels are inserted as 1d kernels because they work cell wise without neighboring information
+		 * the buffers are swapped each simulation step: the collision kernel reads the
+		 * current set and writes the new set, which is used by the flag conversions.
 		 */
+		cl::Buffer &cMemDD = getDensityDistributionsMemObject();
+		cl::Buffer &cMemFlags = this->getFlagsMemObject();
+		cl::Buffer &cMemFraction = this->getFluidFractionMemObject();
 
-		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		cl::Buffer &cMemOutDD = getOutputDensityDistributionsMemObject();
+		cl::Buffer &cMemOutFlags = getOutputFlagsMemObject();
+		cl::Buffer &cMemOutFraction = getOutputFluidFractionMemObject();
 
-		if (this->simulation_step_counter & 1)
-		{
-			/*
-			 * MAIN
-			 */
-			cKernelLbm_Main.setArg(0, cMemNewDensityDistributions);
-			cKernelLbm_Main.setArg(14, this->cMemDensityDistributions);
+		cl::Buffer &cMemMass = this->cMemFluidMass;
+		cl::Buffer &cMemVelocity = this->cMemVelocity;
+		cl::Buffer &cMemDensity = this->cMemDensity;
 
-			cKernelLbm_Main.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_Main.setArg(8, this->cMemCellFlags);
+		typedef CCLEventGraph::CBuffers B;
 
-			cKernelLbm_Main.setArg(7, this->cMemNewFluidFraction);
-			cKernelLbm_Main.setArg(9, this->cMemFluidFraction);
+		cEventGraph.begin(this->cl.cCommandQueue);
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
-													cl::NullRange,						// global work offset
-													global_work_group_size,
-													cKernelLbm_Main_WorkGroupSize
-							);
+		/*
+		 * MAIN
+		 */
+		setCollisionArguments();
+
+		cEventGraph.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
+											cl::NullRange,		// global work offset
+											(tiled_3d ? tiled_3d_global_work_group_size : this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_Main_WorkGroupSize)),
+											cKernelLbm_Main_WorkGroupSize,
+											B()(cMemDD)(cMemFlags)(cMemFraction)(cMemMass),
+											B()(cMemOutDD)(cMemOutFlags)(cMemOutFraction)(cMemMass)(cMemVelocity)(cMemDensity)
+						);
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		enqueueFlagConversion();
 
-			/*
-			 * INTERFACE TO FLUID NEIGHBORS
-			 */
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(1, this->cMemCellFlags);
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(5, this->cMemFluidFraction);
+		cEventGraph.end(this->cl.cCommandQueue);
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		this->simulation_step_counter++;
+	}
 
-			/*
-			 * INTERFACE TO GAS
-			 */
-			cKernelLbm_InterfaceToGas.setArg(1, this->cMemCellFlags);
-			cKernelLbm_InterfaceToGas.setArg(5, this->cMemFluidFraction);
+	/**
+	 * enqueue the collision and propagation of a subdomain (see setupSubdomain()) to the in order queue.
+	 *
+	 * the boundary layers, which are copied to the halo layers of the neighboring subdomains, are computed
+	 * first. 'boundary_event' is set after them, thus the copies can run while the interior layers are
+	 * computed. the ranges start at a global work offset, the padding of each range is moved to the halo
+	 * layers to compute each inner cell only once. simulationStepFlagConversion() finishes the simulation step.
+	 */
+	void enqueueCollisionBoundaryFirst(cl::Event &boundary_event)
+	{
+		setCollisionArguments();
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_InterfaceToGas_WorkGroupSize
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		size_t halo_layers = this->subdomain_halo_layers;
+		size_t layers = this->params.domain_cells[2];
 
-			/*
-			 * GATHER MASS
-			 */
+		// the ranges are computed in slices for the 3D range and in cells otherwise
+		size_t slice = (tiled_3d ? 1 : this->params.domain_cells[0]*this->params.domain_cells[1]);
+		size_t granularity = (tiled_3d ? LBM_AB_1_TILE_SIZE_Z : cKernelLbm_Main_WorkGroupSize[0]);
 
-			cKernelLbm_GatherMass.setArg(0, this->cMemCellFlags);
-			cKernelLbm_GatherMass.setArg(2, this->cMemFluidFraction);
+		size_t bottom_end = 2*halo_layers*slice;
+		size_t top_start = (layers - 2*halo_layers)*slice;
+		size_t inner_end = (layers - halo_layers)*slice;
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
-													cl::NullRange,				// global work offset
-													global_work_group_size,
-													cKernelLbm_GatherMass_WorkGroupSize
-							);
+		size_t bottom_size = ((halo_layers*slice + granularity - 1)/granularity)*granularity;
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		if (bottom_size > bottom_end || top_start < bottom_end + granularity)
+		{
+			// no interior range remains
+			enqueueCollisionRange(halo_layers*slice, inner_end - halo_layers*slice);
+			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueMarkerWithWaitList(NULL, &boundary_event));
+			return;
+		}
 
-			/*
-			 * INTERFACE TO GAS NEIGHBORS
-			 */
-			cKernelLbm_InterfaceToGasNeighbors.setArg(1, this->cMemCellFlags);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(5, this->cMemFluidFraction);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(6, this->cMemNewFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		size_t interior_size = ((top_start - bottom_end)/granularity)*granularity;
 
-			/*
-			 * GAS TO INTERFACE
-			 */
-			cKernelLbm_GasToInterface.setArg(0, this->cMemDensityDistributions);
-			cKernelLbm_GasToInterface.setArg(1, this->cMemCellFlags);
-			cKernelLbm_GasToInterface.setArg(5, this->cMemFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_GasToInterface_WorkGroupSize
-							);
+		enqueueCollisionRange(bottom_end - bottom_size, bottom_size);
+		enqueueCollisionRange(bottom_end + interior_size, inner_end - bottom_end - interior_size);
+		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueMarkerWithWaitList(NULL, &boundary_event));
+
+		enqueueCollisionRange(bottom_end, interior_size);
+	}
+
+	/**
+	 * finish the simulation step started by enqueueCollisionBoundaryFirst()
+	 */
+	void simulationStepFlagConversion()
+	{
+		cEventGraph.begin(this->cl.cCommandQueue);
+		enqueueFlagConversion();
+		cEventGraph.end(this->cl.cCommandQueue);
+
+		this->simulation_step_counter++;
+	}
+
+private:
+	/**
+	 * set the buffers of the simulation step to the collision and propagation kernel
+	 */
+	void setCollisionArguments()
+	{
+		cKernelLbm_Main.setArg(0, getDensityDistributionsMemObject());
+		cKernelLbm_Main.setArg(9, getOutputDensityDistributionsMemObject());
+
+		cKernelLbm_Main.setArg(1, this->getFlagsMemObject());
+		cKernelLbm_Main.setArg(7, getOutputFlagsMemObject());
 
-			////////////////////////////////////
-			#if 0
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-					this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemDensityDistributions,
-															this->cMemNewDensityDistributions,
-			                                                0,
-			                                                0,
-			                                                this->domain_cells_count*sizeof(T)*19
-			                                        );
-
-					this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemFluidFraction,
-															this->cMemNewFluidFraction,
-			                                                0,
-			                                                0,
-			                                                this->domain_cells_count*sizeof(T)
-			                                        );
-
-					this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemCellFlags,
-															this->cMemNewCellFlags,
-			                                                0,
-			                                                0,
-			                                                this->domain_cells_count*sizeof(T)
-			                                        );
-
-					this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-			#endif
-			////////////////////////////////////
+		cKernelLbm_Main.setArg(6, this->getFluidFractionMemObject());
+		cKernelLbm_Main.setArg(8, getOutputFluidFractionMemObject());
+	}
+
+	/**
+	 * enqueue the collision and propagation kernel for 'size' slices (3D range) or cells starting at 'first'
+	 */
+	void enqueueCollisionRange(size_t first, size_t size)
+	{
+		if (tiled_3d)
+		{
+			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
+													cl::NDRange(0, 0, first),	// global work offset
+													cl::NDRange(tiled_3d_global_work_group_size[0], tiled_3d_global_work_group_size[1], ((size + LBM_AB_1_TILE_SIZE_Z - 1)/LBM_AB_1_TILE_SIZE_Z)*LBM_AB_1_TILE_SIZE_Z),
+													cKernelLbm_Main_WorkGroupSize
+								));
 		}
 		else
 		{
-			// EVEN TIMESTEP
+			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
+													cl::NDRange(first),			// global work offset
+													this->getPaddedGlobalWorkGroupSize(cl::NDRange(size), cKernelLbm_Main_WorkGroupSize),
+													cKernelLbm_Main_WorkGroupSize
+								));
+		}
+	}
 
-			/*
-			 * MAIN
-			 */
+	/**
+	 * enqueue the flag conversions of the simulation step to the event graph
+	 */
+	void enqueueFlagConversion()
+	{
+		cl::Buffer &cMemFraction = this->getFluidFractionMemObject();
 
-			cKernelLbm_Main.setArg(0, this->cMemDensityDistributions);
-			cKernelLbm_Main.setArg(14, this->cMemNewDensityDistributions);
+		cl::Buffer &cMemOutDD = getOutputDensityDistributionsMemObject();
+		cl::Buffer &cMemOutFlags = getOutputFlagsMemObject();
+		cl::Buffer &cMemOutFraction = getOutputFluidFractionMemObject();
 
-			cKernelLbm_Main.setArg(1, this->cMemCellFlags);
-			cKernelLbm_Main.setArg(8, this->cMemNewCellFlags);
+		cl::Buffer &cMemMass = this->cMemFluidMass;
+		cl::Buffer &cMemVelocity = this->cMemVelocity;
+		cl::Buffer &cMemDensity = this->cMemDensity;
 
-			cKernelLbm_Main.setArg(7, this->cMemFluidFraction);
-			cKernelLbm_Main.setArg(9, this->cMemNewFluidFraction);
+		typedef CCLEventGraph::CBuffers B;
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
-													cl::NullRange,						// global work offset
-													global_work_group_size,
-													cKernelLbm_Main_WorkGroupSize
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		if (fused_flag_conversion)
+		{
+			/*
+			 * FUSED FLAG CONVERSION
+			 */
+			cKernelLbm_FlagConversion.setArg(0, cMemOutFlags);
+			cKernelLbm_FlagConversion.setArg(1, cMemOutFraction);
 
+			cEventGraph.enqueueNDRangeKernel(	cKernelLbm_FlagConversion,	// kernel
+												cl::NullRange,				// global work offset
+												cl::NDRange(flag_conversion_tiles_count*cKernelLbm_FlagConversion_WorkGroupSize[0]),
+												cKernelLbm_FlagConversion_WorkGroupSize,
+												B()(cMemOutFlags)(cMemOutFraction),
+												B()(cMemOutFlags)(cMemOutFraction)
+							);
+		}
+		else
+		{
 			/*
 			 * INTERFACE TO FLUID NEIGHBORS
 			 */
+			cKernelLbm_InterfaceToFluidNeighbors.setArg(1, cMemOutFlags);
+			cKernelLbm_InterfaceToFluidNeighbors.setArg(5, cMemOutFraction);
 
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(5, this->cMemNewFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize
+			cEventGraph.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
+												cl::NullRange,					// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize),
+												cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize,
+												B()(cMemOutFlags),
+												B()(cMemOutFlags)
 							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
 
 			/*
 			 * INTERFACE TO GAS
 			 */
+			cKernelLbm_InterfaceToGas.setArg(1, cMemOutFlags);
+			cKernelLbm_InterfaceToGas.setArg(5, cMemOutFraction);
 
-			cKernelLbm_InterfaceToGas.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_InterfaceToGas.setArg(5, this->cMemNewFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_InterfaceToGas_WorkGroupSize
+			cEventGraph.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
+												cl::NullRange,				// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_InterfaceToGas_WorkGroupSize),
+												cKernelLbm_InterfaceToGas_WorkGroupSize,
+												B()(cMemOutFlags)(cMemOutFraction)(cMemMass),
+												B()(cMemOutFlags)(cMemOutFraction)
 							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
-
 
 			/*
 			 * GATHER MASS
 			 */
-
-			cKernelLbm_GatherMass.setArg(0, this->cMemNewCellFlags);
-			cKernelLbm_GatherMass.setArg(2, this->cMemNewFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
-													cl::NullRange,				// global work offset
-													global_work_group_size,
-													cKernelLbm_GatherMass_WorkGroupSize
+			cKernelLbm_GatherMass.setArg(0, cMemOutFlags);
+			cKernelLbm_GatherMass.setArg(2, cMemOutFraction);
+
+			cEventGraph.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
+												cl::NullRange,			// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_GatherMass_WorkGroupSize),
+												cKernelLbm_GatherMass_WorkGroupSize,
+												B()(cMemOutFlags)(cMemOutFraction)(cMemMass),
+												B()(cMemMass)
 							);
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
-
 			/*
 			 * INTERFACE TO GAS NEIGHBORS
 			 */
+			cKernelLbm_InterfaceToGasNeighbors.setArg(1, cMemOutFlags);
+			cKernelLbm_InterfaceToGasNeighbors.setArg(5, cMemOutFraction);
+			cKernelLbm_InterfaceToGasNeighbors.setArg(6, cMemFraction);
 
-			cKernelLbm_InterfaceToGasNeighbors.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(5, this->cMemNewFluidFraction);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(6, this->cMemFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
-
-			/*
-			 * GAS TO INTERFACE
-			 */
-
-			cKernelLbm_GasToInterface.setArg(0, this->cMemNewDensityDistributions);
-			cKernelLbm_GasToInterface.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_GasToInterface.setArg(5, this->cMemNewFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
-													cl::NullRange,					// global work offset
-													global_work_group_size,
-													cKernelLbm_GasToInterface_WorkGroupSize
+			cEventGraph.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
+												cl::NullRange,						// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize),
+												cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize,
+												B()(cMemOutFlags)(cMemMass),
+												B()(cMemOutFlags)(cMemFraction)
 							);
-
-			////////////////////////////////////
-			#if 0
-				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-				this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemNewDensityDistributions,
-														this->cMemDensityDistributions,
-														0,
-														0,
-														this->domain_cells_count*sizeof(T)*19
-												);
-
-				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-				this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemNewFluidFraction,
-														this->cMemFluidFraction,
-														0,
-														0,
-														this->domain_cells_count*sizeof(T)
-												);
-
-				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-				this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemNewCellFlags,
-														this->cMemCellFlags,
-														0,
-														0,
-														this->domain_cells_count*sizeof(int)
-												);
-			#endif
-			////////////////////////////////////
 		}
 
-		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
-		this->simulation_step_counter++;
+		/*
+		 * GAS TO INTERFACE
+		 */
+		cKernelLbm_GasToInterface.setArg(0, cMemOutDD);
+		cKernelLbm_GasToInterface.setArg(1, cMemOutFlags);
+		cKernelLbm_GasToInterface.setArg(5, cMemOutFraction);
+
+		cEventGraph.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
+											cl::NullRange,				// global work offset
+											this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_GasToInterface_WorkGroupSize),
+											cKernelLbm_GasToInterface_WorkGroupSize,
+											B()(cMemOutDD)(cMemOutFlags)(cMemVelocity)(cMemDensity),
+											B()(cMemOutDD)(cMemOutFlags)(cMemOutFraction)(cMemMass)(cMemVelocity)(cMemDensity)
+						);
 	}
 #endif
 };
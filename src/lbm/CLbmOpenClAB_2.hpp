@@ -28,6 +28,22 @@
 
 #define LBM_AB_2_TEST_WITH_AA_1_KERNEL	0
 
+/**
+ * set to 1 to store the density distributions as half floats (deviation from the lattice weights)
+ */
+#ifndef LBM_AB_2_DD_HALF
+	#define LBM_AB_2_DD_HALF	0
+#endif
+
+/**
+ * set to 1 to compute the interface to fluid neighbors, interface to gas and interface to gas neighbors
+ * conversions with a single kernel which loads the flags of a tile and its halo to local memory
+ */
+#ifndef LBM_AB_2_FUSED_FLAG_CONVERSION
+	#define LBM_AB_2_FUSED_FLAG_CONVERSION	1
+#endif
+#define LBM_AB_2_FLAG_CONVERSION_TILE_SIZE	8
+
 /**
  * OpenCL implementation for lattice boltzmann method using the A-B pattern
  */
@@ -57,6 +73,7 @@ private:
 
 
 	cl::Kernel cKernelLbm_MassScale;
+	cl::Kernel cKernelLbm_FlagConversion;
 
 	size_t global_work_group_size_a[1];
 	size_t max_local_work_group_size;
@@ -76,6 +93,7 @@ private:
 	cl::NDRange cKernelLbm_GatherMass_WorkGroupSize;
 
 	cl::NDRange cKernelLbm_MassScale_WorkGroupSize;
+	cl::NDRange cKernelLbm_FlagConversion_WorkGroupSize;
 
 #if LBM_AB_2_TEST_WITH_AA_1_KERNEL
 	cl::NDRange cKernelLbm_Alpha_Pre_WorkGroupSize;
@@ -96,6 +114,10 @@ private:
 	size_t cKernelLbm_GatherMass_MaxRegisters;
 
 	size_t cKernelLbm_MassScale_MaxRegisters;
+	size_t cKernelLbm_FlagConversion_MaxRegisters;
+
+	bool fused_flag_conversion;				///< true, if the flag conversions are computed by a single kernel
+	size_t flag_conversion_tiles_count;		///< number of tiles in domain for the fused flag conversion
 
 #if LBM_AB_2_TEST_WITH_AA_1_KERNEL
 	size_t cKernelLbm_Alpha_Pre_MaxRegisters;
@@ -161,33 +183,7 @@ public:
 
     void setKernelArguments()
     {
-		cKernelLbm_Init.setArg(4, this->params.inv_tau);
-		cKernelLbm_Init.setArg(5, this->params.inv_trt_tau);
-
-		cKernelLbm_Init.setArg(10, this->params.gravitation[0]);
-		cKernelLbm_Init.setArg(11, this->params.gravitation[1]);
-		cKernelLbm_Init.setArg(12, this->params.gravitation[2]);
-
-		cKernelLbm_Main.setArg(4, this->params.inv_tau);
-		cKernelLbm_Main.setArg(5, this->params.inv_trt_tau);
-
-		cKernelLbm_Main.setArg(10, this->params.gravitation[0]);
-		cKernelLbm_Main.setArg(11, this->params.gravitation[1]);
-		cKernelLbm_Main.setArg(12, this->params.gravitation[2]);
-
-		cKernelLbm_Main.setArg(13, this->params.mass_exchange_factor);
-
-#if LBM_AB_2_TEST_WITH_AA_1_KERNEL
-		cKernelLbm_Alpha_Pre.setArg(6, this->params.mass_exchange_factor);
-
-		cKernelLbm_InterfaceToFluidNeighbors.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_InterfaceToGas.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_GasToInterface.setArg(6, this->params.mass_exchange_factor);
-#else
-		cKernelLbm_InterfaceToFluidNeighbors.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_InterfaceToGas.setArg(6, this->params.mass_exchange_factor);
-		cKernelLbm_GasToInterface.setArg(6, this->params.mass_exchange_factor);
-#endif
+		this->updateParamsBuffer();
 
 		CError_AppendReturnThis(this->params);
     }
@@ -231,12 +227,15 @@ public:
 	 */
 	void reload()
 	{
+		this->dd_half = LBM_AB_2_DD_HALF;
 		this->reloadInterface();
 
 		/*
 		 * ALLOCATE BUFFERS
 		 */
-		cMemNewDensityDistributions = cl::Buffer(this->cl.cContext, CL_MEM_READ_WRITE, sizeof(T)*this->domain_cells_count*this->SIZE_DD_HOST);
+		cMemNewDensityDistributions = this->createDDBuffer();
+
+		setupFusedFlagConversion();
 
 
 		global_work_group_size_a[0] = this->domain_cells_count;
@@ -246,6 +245,7 @@ public:
 			cKernelLbm_Init_WorkGroupSize = 0;
 
 			cKernelLbm_MassScale_WorkGroupSize = 0;
+			cKernelLbm_FlagConversion_WorkGroupSize = 0;
 
 			cKernelLbm_Main_WorkGroupSize = 0;
 			cKernelLbm_GasToInterface_WorkGroupSize = 0;
@@ -277,6 +277,7 @@ public:
  * with either the standard value (max_local_work_group_size) or with the value from the list
  */
 #define INIT_WORK_GROUP_SIZE(variable)										\
+			this->work_group_size_count++;									\
 			if (it != this->lbm_opencl_number_of_threads_list.end())		\
 			{																\
 				variable##_WorkGroupSize = (*it != 0 ? *it : max_local_work_group_size);	\
@@ -297,6 +298,7 @@ public:
 				variable##_MaxRegisters  = 0;								\
 			}
 
+			this->work_group_size_count = 0;
 			std::list<int>::iterator it = this->lbm_opencl_number_of_threads_list.begin();
 			std::list<int>::iterator ir = this->lbm_opencl_number_of_registers_list.begin();
 
@@ -314,14 +316,50 @@ public:
 #endif
 
 			INIT_WORK_GROUP_SIZE(cKernelLbm_MassScale);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_FlagConversion);
 #undef to_str
 #undef INIT_WORK_GROUP_SIZE
 
+#if LBM_AB_TEST_WITH_AA_1_KERNEL
+			// kernels which exchange data between the work items in local memory
+			this->checkPaddedWorkGroupSize(cKernelLbm_Alpha_Pre_WorkGroupSize, "kernel_lbm_alpha_pre");
+			if (this->error())
+				return;
+#endif
+
 			createKernels(false);
 		}
 	}
 
 
+	/**
+	 * check whether the flag conversions can be computed by the fused flag conversion kernel.
+	 *
+	 * the domain size has to be a multiple of the tile size.
+	 */
+	void setupFusedFlagConversion()
+	{
+		fused_flag_conversion = false;
+
+#if LBM_AB_2_FUSED_FLAG_CONVERSION && !LBM_AB_2_TEST_WITH_AA_1_KERNEL
+		if (	this->params.domain_cells[0] % LBM_AB_2_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[1] % LBM_AB_2_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[2] % LBM_AB_2_FLAG_CONVERSION_TILE_SIZE != 0
+		)
+		{
+			if (this->verbose)
+				std::cout << "fused flag conversion disabled: domain size is not a multiple of " << LBM_AB_2_FLAG_CONVERSION_TILE_SIZE << std::endl;
+			return;
+		}
+
+		fused_flag_conversion = true;
+		flag_conversion_tiles_count = this->domain_cells_count / (LBM_AB_2_FLAG_CONVERSION_TILE_SIZE*LBM_AB_2_FLAG_CONVERSION_TILE_SIZE*LBM_AB_2_FLAG_CONVERSION_TILE_SIZE);
+
+		this->cl_interface_program_defines << "#define FUSED_FLAG_CONVERSION	(1)" << std::endl;
+		this->cl_interface_program_defines << "#define FLAG_CONVERSION_TILE_SIZE	(" << LBM_AB_2_FLAG_CONVERSION_TILE_SIZE << ")" << std::endl;
+#endif
+	}
+
 	void createKernels(bool test_local_work_group_size)
 	{
 		/*
@@ -351,25 +389,33 @@ public:
 		// mass scaling
 		CLBM_LOAD_PROGRAM(cProgram_MassScale, cKernelLbm_MassScale_WorkGroupSize, cKernelLbm_MassScale_MaxRegisters,	"data/cl_programs/lbm_mass_scale.cl");
 
+		// fused flag conversion
+		cl::Program cProgram_FlagConversion;
+		if (fused_flag_conversion)
+			loadProgram(cProgram_FlagConversion, cKernelLbm_FlagConversion_WorkGroupSize, cKernelLbm_FlagConversion_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/lbm_flag_conversion.cl", test_local_work_group_size);
+
+		// the velocity and density recomputation and the rescaling depend on the defines of the implementation
+		this->loadMacroscopicProgram();
+
+		// build all programs loaded so far at once before any kernel is created
+		this->finishProgramBuilds();
+		if (this->error())
+			return;
+
 
 		/**********************************************************
 		 * initialization kernel
 		 **********************************************************/
-		CLBM_CREATE_KERNEL_13(	cKernelLbm_Init, cProgram_Init, "kernel_lbm_init",
+		CLBM_CREATE_KERNEL_9(	cKernelLbm_Init, cProgram_Init, "kernel_lbm_init",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
-						this->cMemNewFluidFraction,
-
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2]
+						this->cMemNewFluidFraction
 		);
 
 
@@ -387,26 +433,19 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
-		CLBM_CREATE_KERNEL_14(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_alpha",
+		CLBM_CREATE_KERNEL_9(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_alpha",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
-						this->cMemNewFluidFraction,
-
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2],
-
-						this->params.mass_exchange_factor
+						this->cMemNewFluidFraction
 		);
 
 		CLBM_CREATE_KERNEL_2(	cKernelLbm_AA_Helper, cProgram_AA_Helper, "kernel_debug_beta_propagation",
@@ -422,7 +461,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS
@@ -433,7 +472,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS NEIGHBORS
@@ -462,27 +501,21 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 #else
-		CLBM_CREATE_KERNEL_15(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_coll_prop",
+		CLBM_CREATE_KERNEL_10(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_coll_prop",
 						this->cMemDensityDistributions,
 						this->cMemCellFlags,
 						this->cMemVelocity,
 						this->cMemDensity,
-						this->params.inv_tau,
-						this->params.inv_trt_tau,
+						this->cMemParams,
 						this->cMemFluidMass,
 						this->cMemFluidFraction,
 						this->cMemNewCellFlags,
 						this->cMemNewFluidFraction,
 
-						this->params.gravitation[0],
-						this->params.gravitation[1],
-						this->params.gravitation[2],
-
-						this->params.mass_exchange_factor,
 						this->cMemNewDensityDistributions
 		);
 
@@ -495,7 +528,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS
@@ -506,7 +539,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 
 		// INTERFACE TO GAS NEIGHBORS
@@ -535,7 +568,7 @@ public:
 						this->cMemDensity,
 						this->cMemFluidMass,
 						this->cMemNewFluidFraction,
-						this->params.mass_exchange_factor
+						this->cMemParams
 		);
 #endif
 
@@ -544,6 +577,34 @@ public:
 		 **********************************************************/
 		CLBM_CREATE_KERNEL_(	cKernelLbm_MassScale, cProgram_MassScale, "kernel_lbm_mass_scale");
 		cKernelLbm_MassScale.setArg(0, this->cMemFluidMass);
+
+		/**********************************************************
+		 * fused flag conversion kernel
+		 **********************************************************/
+		if (fused_flag_conversion)
+		{
+			CLBM_CREATE_KERNEL_3(	cKernelLbm_FlagConversion, cProgram_FlagConversion, "kernel_flag_conversion",
+							this->cMemNewCellFlags,
+							this->cMemNewFluidFraction,
+							this->cMemParams
+			);
+		}
+
+		/**********************************************************
+		 * recomputation of the velocity and density (LBM_LAZY_MACROSCOPIC)
+		 **********************************************************/
+		this->createInterfaceKernels();
+	}
+
+	/**
+	 * get memory reference to the OpenCL density distribution buffer of the current simulation step
+	 */
+	cl::Buffer &getDensityDistributionsMemObject()
+	{
+		if (this->simulation_step_counter & 1)
+			return cMemNewDensityDistributions;
+		else
+			return this->cMemDensityDistributions;
 	}
 
 	/**
@@ -557,10 +618,10 @@ public:
 		if (this->verbose)
 			std::cout << "Init Simulation: " << std::flush;
 
-		cKernelLbm_Init.setArg(13, this->fluid_init_flags);
+		cKernelLbm_Init.setArg(9, this->fluid_init_flags);
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Init,	// kernel
 														cl::NullRange,			// global work offset
-														cl::NDRange(global_work_group_size_a[0]),
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_Init_WorkGroupSize),
 														cl::NDRange(cKernelLbm_Init_WorkGroupSize)
 						);
 
@@ -572,7 +633,7 @@ public:
 											cMemNewDensityDistributions,
 											0,
 											0,
-											this->domain_cells_count*this->SIZE_DD_HOST_BYTES
+											this->dd_buffer_bytes
                                         );
 
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -593,7 +654,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_MassScale,	// kernel
 												cl::NullRange,				// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_MassScale_WorkGroupSize),
 												cl::NDRange(cKernelLbm_MassScale_WorkGroupSize)
 						);
 
@@ -617,7 +678,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Alpha_Pre,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_Alpha_Pre_WorkGroupSize),
 												cl::NDRange(cKernelLbm_Alpha_Pre_WorkGroupSize)
 						);
 
@@ -629,7 +690,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
 												cl::NullRange,						// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_Main_WorkGroupSize),
 												cl::NDRange(cKernelLbm_Main_WorkGroupSize)
 						);
 
@@ -642,7 +703,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize),
 												cl::NDRange(cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize)
 						);
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -653,7 +714,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGas_WorkGroupSize),
 												cl::NDRange(cKernelLbm_InterfaceToGas_WorkGroupSize)
 						);
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -666,7 +727,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
 												cl::NullRange,				// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GatherMass_WorkGroupSize),
 												cl::NDRange(cKernelLbm_GatherMass_WorkGroupSize)
 						);
 
@@ -678,7 +739,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize),
 												cl::NDRange(cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize)
 						);
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -689,7 +750,7 @@ public:
 		 */
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
 												cl::NullRange,					// global work offset
-												cl::NDRange(global_work_group_size_a[0]),
+												this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GasToInterface_WorkGroupSize),
 												cl::NDRange(cKernelLbm_GasToInterface_WorkGroupSize)
 						);
 
@@ -697,7 +758,7 @@ public:
 
 		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_AA_Helper,     // kernel
                                                 cl::NullRange,                              // global work offset
-                                                cl::NDRange(global_work_group_size_a[0]),
+                                                this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_AA_Helper_WorkGroupSize),
                                                 cl::NDRange(cKernelLbm_AA_Helper_WorkGroupSize)
                                         );
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -706,7 +767,7 @@ public:
 												this->cMemDensityDistributions,
 												0,
 												0,
-												this->domain_cells_count*sizeof(T)*19
+												this->dd_buffer_bytes
 										);
 
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
@@ -744,76 +805,94 @@ public:
 			 * MAIN
 			 */
 			cKernelLbm_Main.setArg(0, cMemNewDensityDistributions);
-			cKernelLbm_Main.setArg(14, this->cMemDensityDistributions);
+			cKernelLbm_Main.setArg(9, this->cMemDensityDistributions);
 
 			cKernelLbm_Main.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_Main.setArg(8, this->cMemCellFlags);
+			cKernelLbm_Main.setArg(7, this->cMemCellFlags);
 
-			cKernelLbm_Main.setArg(7, this->cMemNewFluidFraction);
-			cKernelLbm_Main.setArg(9, this->cMemFluidFraction);
+			cKernelLbm_Main.setArg(6, this->cMemNewFluidFraction);
+			cKernelLbm_Main.setArg(8, this->cMemFluidFraction);
 
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
 													cl::NullRange,						// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
+													this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_Main_WorkGroupSize),
 													cl::NDRange(cKernelLbm_Main_WorkGroupSize)
 							);
 
 			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			/*
-			 * INTERFACE TO FLUID NEIGHBORS
-			 */
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(1, this->cMemCellFlags);
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(5, this->cMemFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
-
-			/*
-			 * INTERFACE TO GAS
-			 */
-			cKernelLbm_InterfaceToGas.setArg(1, this->cMemCellFlags);
-			cKernelLbm_InterfaceToGas.setArg(5, this->cMemFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
-													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_InterfaceToGas_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			if (fused_flag_conversion)
+			{
+				/*
+				 * FUSED FLAG CONVERSION
+				 */
+				cKernelLbm_FlagConversion.setArg(0, this->cMemCellFlags);
+				cKernelLbm_FlagConversion.setArg(1, this->cMemFluidFraction);
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_FlagConversion,	// kernel
+														cl::NullRange,					// global work offset
+														cl::NDRange(flag_conversion_tiles_count*cKernelLbm_FlagConversion_WorkGroupSize[0]),
+														cKernelLbm_FlagConversion_WorkGroupSize
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
+			else
+			{
+				/*
+				 * INTERFACE TO FLUID NEIGHBORS
+				 */
+				cKernelLbm_InterfaceToFluidNeighbors.setArg(1, this->cMemCellFlags);
+				cKernelLbm_InterfaceToFluidNeighbors.setArg(5, this->cMemFluidFraction);
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize),
+														cl::NDRange(cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			/*
-			 * GATHER MASS
-			 */
+				/*
+				 * INTERFACE TO GAS
+				 */
+				cKernelLbm_InterfaceToGas.setArg(1, this->cMemCellFlags);
+				cKernelLbm_InterfaceToGas.setArg(5, this->cMemFluidFraction);
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
+														cl::NullRange,					// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGas_WorkGroupSize),
+														cl::NDRange(cKernelLbm_InterfaceToGas_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			cKernelLbm_GatherMass.setArg(0, this->cMemCellFlags);
-			cKernelLbm_GatherMass.setArg(2, this->cMemFluidFraction);
+				/*
+				 * GATHER MASS
+				 */
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
-													cl::NullRange,				// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_GatherMass_WorkGroupSize)
-							);
+				cKernelLbm_GatherMass.setArg(0, this->cMemCellFlags);
+				cKernelLbm_GatherMass.setArg(2, this->cMemFluidFraction);
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
+														cl::NullRange,				// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GatherMass_WorkGroupSize),
+														cl::NDRange(cKernelLbm_GatherMass_WorkGroupSize)
+								);
 
-			/*
-			 * INTERFACE TO GAS NEIGHBORS
-			 */
-			cKernelLbm_InterfaceToGasNeighbors.setArg(1, this->cMemCellFlags);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(5, this->cMemFluidFraction);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(6, this->cMemNewFluidFraction);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				/*
+				 * INTERFACE TO GAS NEIGHBORS
+				 */
+				cKernelLbm_InterfaceToGasNeighbors.setArg(1, this->cMemCellFlags);
+				cKernelLbm_InterfaceToGasNeighbors.setArg(5, this->cMemFluidFraction);
+				cKernelLbm_InterfaceToGasNeighbors.setArg(6, this->cMemNewFluidFraction);
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize),
+														cl::NDRange(cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
 
 			/*
 			 * GAS TO INTERFACE
@@ -824,7 +903,7 @@ public:
 
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
 													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
+													this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GasToInterface_WorkGroupSize),
 													cl::NDRange(cKernelLbm_GasToInterface_WorkGroupSize)
 							);
 
@@ -835,7 +914,7 @@ public:
 															this->cMemNewDensityDistributions,
 			                                                0,
 			                                                0,
-			                                                this->domain_cells_count*sizeof(T)*19
+			                                                this->dd_buffer_bytes
 			                                        );
 
 					this->cl.cCommandQueue.enqueueCopyBuffer(		this->cMemFluidFraction,
@@ -865,83 +944,100 @@ public:
 			 */
 
 			cKernelLbm_Main.setArg(0, this->cMemDensityDistributions);
-			cKernelLbm_Main.setArg(14, this->cMemNewDensityDistributions);
+			cKernelLbm_Main.setArg(9, this->cMemNewDensityDistributions);
 
 			cKernelLbm_Main.setArg(1, this->cMemCellFlags);
-			cKernelLbm_Main.setArg(8, this->cMemNewCellFlags);
+			cKernelLbm_Main.setArg(7, this->cMemNewCellFlags);
 
-			cKernelLbm_Main.setArg(7, this->cMemFluidFraction);
-			cKernelLbm_Main.setArg(9, this->cMemNewFluidFraction);
+			cKernelLbm_Main.setArg(6, this->cMemFluidFraction);
+			cKernelLbm_Main.setArg(8, this->cMemNewFluidFraction);
 
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
 													cl::NullRange,						// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
+													this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_Main_WorkGroupSize),
 													cl::NDRange(cKernelLbm_Main_WorkGroupSize)
 							);
 			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			/*
-			 * INTERFACE TO FLUID NEIGHBORS
-			 */
-
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_InterfaceToFluidNeighbors.setArg(5, this->cMemNewFluidFraction);
-
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			if (fused_flag_conversion)
+			{
+				/*
+				 * FUSED FLAG CONVERSION
+				 */
+				cKernelLbm_FlagConversion.setArg(0, this->cMemNewCellFlags);
+				cKernelLbm_FlagConversion.setArg(1, this->cMemNewFluidFraction);
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_FlagConversion,	// kernel
+														cl::NullRange,					// global work offset
+														cl::NDRange(flag_conversion_tiles_count*cKernelLbm_FlagConversion_WorkGroupSize[0]),
+														cKernelLbm_FlagConversion_WorkGroupSize
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
+			else
+			{
+				/*
+				 * INTERFACE TO FLUID NEIGHBORS
+				 */
+
+				cKernelLbm_InterfaceToFluidNeighbors.setArg(1, this->cMemNewCellFlags);
+				cKernelLbm_InterfaceToFluidNeighbors.setArg(5, this->cMemNewFluidFraction);
+
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize),
+														cl::NDRange(cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
 
-			/*
-			 * INTERFACE TO GAS
-			 */
-
-			cKernelLbm_InterfaceToGas.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_InterfaceToGas.setArg(5, this->cMemNewFluidFraction);
+				/*
+				 * INTERFACE TO GAS
+				 */
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
-													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_InterfaceToGas_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				cKernelLbm_InterfaceToGas.setArg(1, this->cMemNewCellFlags);
+				cKernelLbm_InterfaceToGas.setArg(5, this->cMemNewFluidFraction);
 
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
+														cl::NullRange,					// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGas_WorkGroupSize),
+														cl::NDRange(cKernelLbm_InterfaceToGas_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
 
-			/*
-			 * GATHER MASS
-			 */
 
-			cKernelLbm_GatherMass.setArg(0, this->cMemNewCellFlags);
-			cKernelLbm_GatherMass.setArg(2, this->cMemNewFluidFraction);
+				/*
+				 * GATHER MASS
+				 */
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
-													cl::NullRange,				// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_GatherMass_WorkGroupSize)
-							);
+				cKernelLbm_GatherMass.setArg(0, this->cMemNewCellFlags);
+				cKernelLbm_GatherMass.setArg(2, this->cMemNewFluidFraction);
 
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
+														cl::NullRange,				// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GatherMass_WorkGroupSize),
+														cl::NDRange(cKernelLbm_GatherMass_WorkGroupSize)
+								);
 
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-			/*
-			 * INTERFACE TO GAS NEIGHBORS
-			 */
 
-			cKernelLbm_InterfaceToGasNeighbors.setArg(1, this->cMemNewCellFlags);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(5, this->cMemNewFluidFraction);
-			cKernelLbm_InterfaceToGasNeighbors.setArg(6, this->cMemFluidFraction);
+				/*
+				 * INTERFACE TO GAS NEIGHBORS
+				 */
 
-			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
-													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
-													cl::NDRange(cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize)
-							);
-			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+				cKernelLbm_InterfaceToGasNeighbors.setArg(1, this->cMemNewCellFlags);
+				cKernelLbm_InterfaceToGasNeighbors.setArg(5, this->cMemNewFluidFraction);
+				cKernelLbm_InterfaceToGasNeighbors.setArg(6, this->cMemFluidFraction);
 
+				this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
+														cl::NullRange,					// global work offset
+														this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize),
+														cl::NDRange(cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize)
+								);
+				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			}
 
 			/*
 			 * GAS TO INTERFACE
@@ -953,7 +1049,7 @@ public:
 
 			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
 													cl::NullRange,					// global work offset
-													cl::NDRange(global_work_group_size_a[0]),
+													this->getPaddedGlobalWorkGroupSize(cl::NDRange(global_work_group_size_a[0]), cKernelLbm_GasToInterface_WorkGroupSize),
 													cl::NDRange(cKernelLbm_GasToInterface_WorkGroupSize)
 							);
 
@@ -964,7 +1060,7 @@ public:
 														this->cMemDensityDistributions,
 														0,
 														0,
-														this->domain_cells_count*sizeof(T)*19
+														this->dd_buffer_bytes
 												);
 
 				this->cl.cCommandQueue.enqueueBarrierWithWaitList();
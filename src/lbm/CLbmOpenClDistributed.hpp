@@ -0,0 +1,522 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLBM_OPENCL_DISTRIBUTED_HPP
+#define CLBM_OPENCL_DISTRIBUTED_HPP
+
+#include "CLbmParameters.hpp"
+#include "CLbmOpenClInterface.hpp"
+#include "CLbmOpenClAB_1.hpp"
+#include "libopencl/CCLSkeleton.hpp"
+#include "lib/CTransport.hpp"
+#include "lib/CStopwatch.hpp"
+#include "lib/CError.hpp"
+#include <vector>
+#include <string.h>
+
+/**
+ * number of layers which each rank stores of its neighbor ranks.
+ *
+ * as for the multi device implementation, the halo layers are simulated redundantly to exchange them
+ * only once per simulation step.
+ */
+#ifndef LBM_DISTRIBUTED_HALO_LAYERS
+	#define LBM_DISTRIBUTED_HALO_LAYERS	6
+#endif
+
+/**
+ * OpenCL implementation for lattice boltzmann method distributed to several processes (ranks)
+ *
+ * each rank simulates a slab of the domain in z direction with the A-B implementation (version 1).
+ * the halo layers are transferred to the host after each simulation step and are exchanged with
+ * the neighbor ranks by the transport.
+ *
+ * all methods have to be called by all ranks in the same order because the reductions are collective.
+ */
+template <typename T>
+class CLbmOpenClDistributed	:
+	public CLbmOpenClInterface<T>
+{
+	using CLbmOpenClInterface<T>::initInterface;
+
+	typedef CLbmOpenClAB_1<T> CSubdomain;
+
+private:
+	CTransport &transport;				///< transport to communicate with the other ranks
+
+	CSubdomain *subdomain;				///< simulation of the slab of this rank
+	std::vector<int> rank_layers;		///< number of layers simulated by each rank (without halo layers)
+	std::vector<int> rank_offsets;		///< first layer of each rank in the global domain
+
+	std::vector<char> send_buffer;		///< host buffer for the layers sent to a neighbor
+	std::vector<char> recv_buffer;		///< host buffer for the layers received from a neighbor
+
+	double compute_time;				///< seconds spent in the simulation steps since the last reset
+	double exchange_time;				///< seconds spent in the halo exchange since the last reset
+	int timed_steps;					///< number of simulation steps since the last reset
+
+	size_t max_local_work_group_size;
+	T d_timestep_param;					///< timestep handed over to init() (-1 for automatic computation)
+
+public:
+	/**
+	 * Setup class with OpenCL skeleton and transport.
+	 *
+	 * No simulation kernels are loaded in this constructor!
+	 */
+	CLbmOpenClDistributed(	const CCLSkeleton &cClSkeleton,
+							CTransport &p_transport,
+							bool p_verbose = false
+	)	:
+		CLbmOpenClInterface<T>(cClSkeleton, p_verbose),
+		transport(p_transport),
+		subdomain(NULL)
+	{
+		resetTimings();
+	}
+
+	~CLbmOpenClDistributed()
+	{
+		delete subdomain;
+	}
+
+
+	/**
+	 * initialize simulation with given parameters
+	 */
+	void init(	CVector<3,int> &p_domain_cells,			///< domain cells in each dimension
+				T p_d_domain_x_length,					///< domain length in x direction
+				T p_d_viscosity,						///< viscocity of fluid
+				CVector<3,T> &p_d_gravitation,			///< gravitation
+				T p_max_sim_gravitation_length,			///< maximum length of gravitation to limit timestep
+				T p_d_timestep,							///< timestep for one simulation step - computed automagically
+				T p_mass_exchange_factor,				///< mass exchange
+
+				size_t p_max_local_work_group_size,		///< maximum count of computation kernels (threads) used on gpu
+
+				int init_flags,							///< flags for first initialization
+
+				std::list<int> &p_lbm_opencl_number_of_threads_list,		///< list with number of threads for each successively created kernel
+				std::list<int> &p_lbm_opencl_number_of_registers_list		///< list with number of registers for each thread threads for each successively created kernel
+		)
+	{
+		max_local_work_group_size = p_max_local_work_group_size;
+		d_timestep_param = p_d_timestep;
+
+		initInterface(			p_domain_cells,
+								p_d_domain_x_length,
+								p_d_viscosity,
+								p_d_gravitation,
+								p_max_sim_gravitation_length,
+								p_d_timestep,
+								p_mass_exchange_factor,
+								p_lbm_opencl_number_of_threads_list,
+								p_lbm_opencl_number_of_registers_list
+							);
+		if (this->error())
+			return;
+
+		this->domain_cells_count = this->params.domain_cells.elements();
+
+		if (transport.size*LBM_DISTRIBUTED_HALO_LAYERS > this->params.domain_cells[2])
+		{
+			this->error << "each of the " << transport.size << " ranks needs at least " << LBM_DISTRIBUTED_HALO_LAYERS << " layers in z direction" << std::endl;
+			return;
+		}
+
+#if LBM_DD_BLOCK_SIZE
+		// the layers have to start at a block boundary to transfer them at once
+		if (LBM_GHOST_LAYER || (this->params.domain_cells[0]*this->params.domain_cells[1]) % LBM_DD_BLOCK_SIZE != 0)
+		{
+			this->error << "the decomposed domain needs a slice size which is a multiple of the dd block size " << LBM_DD_BLOCK_SIZE << " and no ghost layer" << std::endl;
+			return;
+		}
+#endif
+
+		int layers = this->params.domain_cells[2] / transport.size;
+		int remaining_layers = this->params.domain_cells[2] % transport.size;
+
+		rank_layers.resize(transport.size);
+		rank_offsets.resize(transport.size);
+
+		int offset = 0;
+		for (int r = 0; r < transport.size; r++)
+		{
+			rank_layers[r] = layers + (r < remaining_layers ? 1 : 0);
+			rank_offsets[r] = offset;
+			offset += rank_layers[r];
+		}
+
+		this->setupInitFlags(init_flags);
+
+		reload();
+		if (this->error())
+			return;
+
+		resetFluid();
+	}
+
+	/**
+	 * create the subdomain of this rank
+	 */
+	void reload()
+	{
+		delete subdomain;
+
+		subdomain = new CSubdomain(this->cl, this->verbose);
+
+		subdomain->setupSubdomain(rank_offsets[transport.rank] - LBM_DISTRIBUTED_HALO_LAYERS, this->params.domain_cells[2], LBM_DISTRIBUTED_HALO_LAYERS);
+
+		CVector<3,int> domain_cells(this->params.domain_cells[0], this->params.domain_cells[1], rank_layers[transport.rank] + 2*LBM_DISTRIBUTED_HALO_LAYERS);
+
+		subdomain->init(	domain_cells,
+							this->params.d_domain_x_length,
+							this->params.d_viscosity,
+							this->params.d_gravitation,
+							this->params.max_sim_gravitation_length,
+							d_timestep_param,
+							this->params.mass_exchange_factor,
+							max_local_work_group_size,
+							this->fluid_init_flags,
+							this->lbm_opencl_number_of_threads_list,
+							this->lbm_opencl_number_of_registers_list
+						);
+		CError_AppendReturnThis((*subdomain));
+
+		subdomain->store_macroscopic = this->store_macroscopic;
+
+		// the timestep computed by the subdomain depends on the domain size
+		setKernelArguments();
+
+		size_t bytes = getLayerBytes()*LBM_DISTRIBUTED_HALO_LAYERS;
+		send_buffer.resize(bytes);
+		recv_buffer.resize(bytes);
+	}
+
+	/**
+	 * update the parametrization of the subdomain
+	 */
+	void setKernelArguments()
+	{
+		subdomain->params.copyParametrization(this->params);
+		subdomain->setKernelArguments();
+		CError_AppendReturnThis((*subdomain));
+	}
+
+	/**
+	 * store the velocity and density of all cells of the subdomain in each simulation step
+	 */
+	void setStoreMacroscopic(bool p_store_macroscopic)
+	{
+		this->store_macroscopic = p_store_macroscopic;
+
+		subdomain->setStoreMacroscopic(p_store_macroscopic);
+		CError_AppendReturnThis((*subdomain));
+	}
+
+	/**
+	 * reset the fluid to it's initial state
+	 */
+	void resetFluid()
+	{
+		if (this->error())
+			return;
+
+		// the halo layers are initialized by the subdomain itself
+		subdomain->setupInitFlags(this->fluid_init_flags);
+		subdomain->resetFluid();
+
+		resetTimings();
+		this->resetFluid_Interface();
+	}
+
+	/**
+	 * rescale the density distributions after a change of the timestep
+	 */
+	void rescaleDensityDistributions(T velocity_scale, T non_equilibrium_scale)
+	{
+		subdomain->rescaleDensityDistributions(velocity_scale, non_equilibrium_scale);
+	}
+
+	/**
+	 * scale the mass in each cell to stabilize the overall amount of mass in the simulation
+	 */
+	void scaleMass(T mass_scale_factor)
+	{
+		subdomain->scaleMass(mass_scale_factor);
+	}
+
+	/**
+	 * run one simulation step and exchange the halo layers with the neighbor ranks
+	 */
+	void simulationStep()
+	{
+		CStopwatch cStopwatch;
+
+		cStopwatch.start();
+		subdomain->simulationStep();
+		subdomain->wait();
+		cStopwatch.stop();
+		compute_time += cStopwatch();
+
+		cStopwatch.reset();
+		cStopwatch.start();
+
+		int prev = (transport.rank + transport.size - 1) % transport.size;
+		int next = (transport.rank + 1) % transport.size;
+		int layers = rank_layers[transport.rank];
+
+		// send the upper inner layers to the next rank and receive the lower halo layers from the previous rank
+		exchangeLayers(next, layers, prev, 0);
+
+		// send the lower inner layers to the previous rank and receive the upper halo layers from the next rank
+		exchangeLayers(prev, LBM_DISTRIBUTED_HALO_LAYERS, next, LBM_DISTRIBUTED_HALO_LAYERS + layers);
+
+		cStopwatch.stop();
+		exchange_time += cStopwatch();
+
+		timed_steps++;
+		this->simulation_step_counter++;
+	}
+
+	/**
+	 * wait until all kernels have finished
+	 */
+	void wait()
+	{
+		subdomain->wait();
+	}
+
+	/**
+	 * store the data of the global domain to host memory of rank 0
+	 *
+	 * the other ranks only store their own layers to 'dst'.
+	 */
+	void storeVelocity(T *dst)
+	{
+		storeGather(&CLbmOpenClInterface<T>::storeVelocity, dst, 3);
+	}
+
+	void storeDensity(T *dst)
+	{
+		storeGather(&CLbmOpenClInterface<T>::storeDensity, dst, 1);
+	}
+
+	void storeDensityDistributions(T *dst)
+	{
+		storeGather(&CLbmOpenClInterface<T>::storeDensityDistributions, dst, this->SIZE_DD_HOST);
+	}
+
+	void storeMass(T *dst)
+	{
+		storeGather(&CLbmOpenClInterface<T>::storeMass, dst, 1);
+	}
+
+	void storeFraction(T *dst)
+	{
+		storeGather(&CLbmOpenClInterface<T>::storeFraction, dst, 1);
+	}
+
+	void storeFlags(cl_int *dst)
+	{
+		storeGather(&CLbmOpenClInterface<T>::storeFlags, dst, 1);
+	}
+
+	/**
+	 * global reductions over all ranks (the subdomains skip their halo layers)
+	 */
+	T getMassReduction()
+	{
+		return (T)transport.allReduceSum(subdomain->getMassReduction());
+	}
+
+	float getVelocityChecksum()
+	{
+		return (float)transport.allReduceSum(subdomain->getVelocityChecksum());
+	}
+
+	float getDensityChecksum()
+	{
+		return (float)transport.allReduceSum(subdomain->getDensityChecksum());
+	}
+
+	T getMaxVelocity()
+	{
+		return (T)transport.allReduceMax(subdomain->getMaxVelocity());
+	}
+
+	/**
+	 * return the device memory footprint of the subdomain of this process
+	 */
+	size_t getDeviceMemoryFootprint()
+	{
+		return subdomain->getDeviceMemoryFootprint();
+	}
+
+	/**
+	 * reset the timings of the simulation steps
+	 */
+	void resetTimings()
+	{
+		compute_time = 0.0;
+		exchange_time = 0.0;
+		timed_steps = 0;
+	}
+
+	/**
+	 * print the timings of all ranks on rank 0 for scaling studies
+	 */
+	void printRankTimings()
+	{
+		double values[4] = {(double)rank_layers[transport.rank], (double)timed_steps, compute_time, exchange_time};
+
+		std::vector<double> rank_values(4*transport.size);
+		transport.gather(values, sizeof(values), &rank_values[0]);
+
+		if (transport.rank != 0)
+			return;
+
+		double slice_cells = (double)this->params.domain_cells[0]*(double)this->params.domain_cells[1];
+
+		for (int r = 0; r < transport.size; r++)
+		{
+			double *v = &rank_values[4*r];
+			double seconds = v[2] + v[3];
+
+			std::cout << "rank " << r << ": ";
+			std::cout << "layers: " << (int)v[0] << ", ";
+			std::cout << "compute: " << v[2] << "s, ";
+			std::cout << "exchange: " << v[3] << "s, ";
+			std::cout << "MLUPS: " << (seconds > 0.0 ? v[0]*slice_cells*v[1]*0.000001/seconds : 0.0) << std::endl;
+		}
+	}
+
+private:
+	/**
+	 * return the number of bytes of one layer of cell data
+	 */
+	size_t getLayerBytes()
+	{
+		size_t dd_bytes = (subdomain->dd_half ? sizeof(cl_half) : sizeof(T));
+		size_t cell_bytes = this->SIZE_DD_HOST*dd_bytes + sizeof(cl_int) + 6*sizeof(T);
+
+		return (size_t)this->params.domain_cells[0]*(size_t)this->params.domain_cells[1]*cell_bytes;
+	}
+
+	/**
+	 * send LBM_DISTRIBUTED_HALO_LAYERS layers starting at 'src_layer' to rank 'dst_rank' and
+	 * receive the layers from rank 'src_rank' to the layers starting at 'dst_layer'
+	 */
+	void exchangeLayers(int dst_rank, int src_layer, int src_rank, int dst_layer)
+	{
+		transferLayers(src_layer, LBM_DISTRIBUTED_HALO_LAYERS, &send_buffer[0], false);
+
+		transport.sendRecv(	dst_rank, &send_buffer[0], send_buffer.size(),
+							src_rank, &recv_buffer[0], recv_buffer.size());
+		if (transport.error())
+		{
+			this->error << transport.error.getString();
+			return;
+		}
+
+		transferLayers(dst_layer, LBM_DISTRIBUTED_HALO_LAYERS, &recv_buffer[0], true);
+	}
+
+	/**
+	 * read the cell data of 'layers' layers from the device to 'buffer' or write them from 'buffer' to the device
+	 */
+	void transferLayers(	int layer,			///< first layer of the subdomain
+							int layers,			///< number of layers
+							char *buffer,		///< host buffer with getLayerBytes()*layers bytes
+							bool write			///< true to write the buffer to the device
+	)
+	{
+		size_t slice_cells = this->params.domain_cells[0]*this->params.domain_cells[1];
+		size_t first_cell = layer*slice_cells;
+		size_t cells = layers*slice_cells;
+
+		size_t dd_bytes = (subdomain->dd_half ? sizeof(cl_half) : sizeof(T));
+
+#if LBM_DD_BLOCK_SIZE
+		// the layers start at a block boundary, thus all directions are stored contiguously
+		transferBuffer(subdomain->getDensityDistributionsMemObject(), subdomain->getDDBufferIndex(first_cell, 0)*dd_bytes, cells*this->SIZE_DD_HOST*dd_bytes, buffer, write);
+#else
+		for (size_t i = 0; i < this->SIZE_DD_HOST; i++)
+			transferBuffer(subdomain->getDensityDistributionsMemObject(), subdomain->getDDBufferIndex(first_cell, i)*dd_bytes, cells*dd_bytes, buffer, write);
+#endif
+
+		transferBuffer(subdomain->getFlagsMemObject(), first_cell*sizeof(cl_int), cells*sizeof(cl_int), buffer, write);
+		transferBuffer(subdomain->getFluidFractionMemObject(), first_cell*sizeof(T), cells*sizeof(T), buffer, write);
+		transferBuffer(subdomain->cMemFluidMass, first_cell*sizeof(T), cells*sizeof(T), buffer, write);
+		transferBuffer(subdomain->cMemDensity, first_cell*sizeof(T), cells*sizeof(T), buffer, write);
+
+		for (size_t c = 0; c < 3; c++)
+			transferBuffer(subdomain->cMemVelocity, (first_cell + c*subdomain->domain_cells_count)*sizeof(T), cells*sizeof(T), buffer, write);
+
+		subdomain->wait();
+	}
+
+	/**
+	 * enqueue the transfer of 'bytes' bytes and advance 'buffer'
+	 */
+	void transferBuffer(cl::Buffer &mem, size_t offset, size_t bytes, char *&buffer, bool write)
+	{
+		if (write)
+		{
+			CL_CHECK_ERROR(subdomain->cl.cCommandQueue.enqueueWriteBuffer(mem, CL_FALSE, offset, bytes, buffer));
+		}
+		else
+		{
+			CL_CHECK_ERROR(subdomain->cl.cCommandQueue.enqueueReadBuffer(mem, CL_FALSE, offset, bytes, buffer));
+		}
+
+		buffer += bytes;
+	}
+
+	/**
+	 * store the inner layers of the subdomain with 'store' and gather them on rank 0
+	 */
+	template <typename D>
+	void storeGather(	void (CLbmOpenClInterface<T>::*store)(D *),		///< store method of the subdomain
+						D *dst,								///< host memory for the global domain
+						int components						///< number of components stored with a stride of the domain cells
+	)
+	{
+		size_t slice_cells = this->params.domain_cells[0]*this->params.domain_cells[1];
+
+		std::vector<D> values(subdomain->domain_cells_count*components);
+		((*subdomain).*store)(&values[0]);
+
+		for (int c = 0; c < components; c++)
+		{
+			D *local = &values[c*subdomain->domain_cells_count + LBM_DISTRIBUTED_HALO_LAYERS*slice_cells];
+			size_t bytes = rank_layers[transport.rank]*slice_cells*sizeof(D);
+
+			memcpy(dst + c*this->domain_cells_count + rank_offsets[transport.rank]*slice_cells, local, bytes);
+
+			if (transport.rank != 0)
+			{
+				transport.send(0, local, bytes);
+				continue;
+			}
+
+			for (int r = 1; r < transport.size; r++)
+				transport.recv(r, dst + c*this->domain_cells_count + rank_offsets[r]*slice_cells, rank_layers[r]*slice_cells*sizeof(D));
+		}
+	}
+};
+
+#endif
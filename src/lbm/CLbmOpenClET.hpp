@@ -0,0 +1,740 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLBM_OPENCL_ET_OPEN_CL_HPP
+#define CLBM_OPENCL_ET_OPEN_CL_HPP
+
+#include "CLbmParameters.hpp"
+#include "CLbmOpenClInterface.hpp"
+#include "libopencl/CCLSkeleton.hpp"
+#include "lib/CError.hpp"
+#include <typeinfo>
+#include <iomanip>
+
+#include "lib/CStopwatch.hpp"
+
+/**
+ * set to 1 to store the density distributions as half floats (deviation from the lattice weights)
+ */
+#ifndef LBM_ET_DD_HALF
+	#define LBM_ET_DD_HALF	0
+#endif
+
+/**
+ * set to 1 to compute the interface to fluid neighbors, interface to gas and interface to gas neighbors
+ * conversions with a single kernel which loads the flags of a tile and its halo to local memory
+ */
+#ifndef LBM_ET_FUSED_FLAG_CONVERSION
+	#define LBM_ET_FUSED_FLAG_CONVERSION	1
+#endif
+#define LBM_ET_FLAG_CONVERSION_TILE_SIZE	8
+
+/**
+ * set to 1 to update the flags and fluid fractions in place: the collision kernel only reads them
+ * and a cell local kernel stores the new values afterwards. this avoids the buffers for the new
+ * flags and fluid fractions.
+ */
+#ifndef LBM_ET_IN_PLACE_CELL_STATE
+	#define LBM_ET_IN_PLACE_CELL_STATE	1
+#endif
+
+/**
+ * OpenCL implementation for lattice boltzmann method using the esoteric twist pattern
+ *
+ * the density distributions are read and written in place by the same kernel for each
+ * timestep, thus only a single density distribution buffer is allocated. with
+ * LBM_ET_IN_PLACE_CELL_STATE, the same holds for the flags and fluid fractions.
+ */
+template <typename T>
+class CLbmOpenClET	:
+	public CLbmOpenClInterface<T>
+{
+	using CLbmOpenClInterface<T>::initInterface;
+	using CLbmOpenClInterface<T>::loadProgram;
+
+private:
+	// initialization kernels
+	cl::Kernel cKernelLbm_Init;
+
+	// simulation kernels
+	cl::Kernel cKernelLbm_Pre;
+	cl::Kernel cKernelLbm_Main;
+	cl::Kernel cKernelLbm_GasToInterface;
+
+	cl::Kernel cKernelLbm_InterfaceToFluidNeighbors;
+	cl::Kernel cKernelLbm_InterfaceToGas;
+	cl::Kernel cKernelLbm_InterfaceToGasNeighbors;
+	cl::Kernel cKernelLbm_GatherMass;
+
+	cl::Kernel cKernelLbm_MassScale;
+	cl::Kernel cKernelLbm_FlagConversion;
+	cl::Kernel cKernelLbm_CellState;
+
+	cl::NDRange global_work_group_size;
+	size_t max_local_work_group_size;
+
+
+	/*
+	 * work group sizes for opencl kernels
+	 */
+	cl::NDRange cKernelLbm_Init_WorkGroupSize;
+
+	cl::NDRange cKernelLbm_Pre_WorkGroupSize;
+	cl::NDRange cKernelLbm_Main_WorkGroupSize;
+	cl::NDRange cKernelLbm_GasToInterface_WorkGroupSize;
+
+	cl::NDRange cKernelLbm_InterfaceToGas_WorkGroupSize;
+	cl::NDRange cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize;
+	cl::NDRange cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize;
+	cl::NDRange cKernelLbm_GatherMass_WorkGroupSize;
+
+	cl::NDRange cKernelLbm_MassScale_WorkGroupSize;
+	cl::NDRange cKernelLbm_FlagConversion_WorkGroupSize;
+	cl::NDRange cKernelLbm_CellState_WorkGroupSize;
+
+	/*
+	 * thread register limitations for opencl kernels
+	 */
+	size_t cKernelLbm_Init_MaxRegisters;
+
+	size_t cKernelLbm_Pre_MaxRegisters;
+	size_t cKernelLbm_Main_MaxRegisters;
+	size_t cKernelLbm_GasToInterface_MaxRegisters;
+
+	size_t cKernelLbm_InterfaceToGas_MaxRegisters;
+	size_t cKernelLbm_InterfaceToGasNeighbors_MaxRegisters;
+	size_t cKernelLbm_InterfaceToFluidNeighbors_MaxRegisters;
+	size_t cKernelLbm_GatherMass_MaxRegisters;
+
+	size_t cKernelLbm_MassScale_MaxRegisters;
+	size_t cKernelLbm_FlagConversion_MaxRegisters;
+	size_t cKernelLbm_CellState_MaxRegisters;
+
+	bool fused_flag_conversion;				///< true, if the flag conversions are computed by a single kernel
+	size_t flag_conversion_tiles_count;		///< number of tiles in domain for the fused flag conversion
+
+public:
+	/**
+	 * Setup class with OpenCL skeleton.
+	 *
+	 * No simulation kernels are loaded in this constructor!
+	 */
+	CLbmOpenClET(	const CCLSkeleton &cClSkeleton,
+					bool p_verbose = false
+	)	:
+		CLbmOpenClInterface<T>(cClSkeleton, p_verbose)
+	{
+	}
+
+
+	/**
+	 * initialize simulation with given parameters
+	 */
+	void init(	CVector<3,int> &p_domain_cells,			///< domain cells in each dimension
+				T p_d_domain_x_length,					///< domain length in x direction
+				T p_d_viscosity,						///< viscocity of fluid
+				CVector<3,T> &p_d_gravitation,			///< gravitation
+				T p_max_sim_gravitation_length,			///< maximum length of gravitation to limit timestep
+				T p_d_timestep,							///< timestep for one simulation step - computed automagically
+				T p_mass_exchange_factor,				///< mass exchange
+
+				size_t p_max_local_work_group_size,		///< maximum count of computation kernels (threads) used on gpu
+
+				int init_flags,							///< flags for first initialization
+
+				std::list<int> &p_lbm_opencl_number_of_threads_list,		///< list with number of threads for each successively created kernel
+				std::list<int> &p_lbm_opencl_number_of_registers_list		///< list with number of registers for each thread threads for each successively created kernel
+		)
+	{
+		max_local_work_group_size = p_max_local_work_group_size;
+
+		initInterface(			p_domain_cells,
+								p_d_domain_x_length,
+								p_d_viscosity,
+								p_d_gravitation,
+								p_max_sim_gravitation_length,
+								p_d_timestep,
+								p_mass_exchange_factor,
+								p_lbm_opencl_number_of_threads_list,
+								p_lbm_opencl_number_of_registers_list
+							);
+
+		reload();
+
+		this->setupInitFlags(init_flags);
+		resetFluid();
+	}
+
+
+
+    void setKernelArguments()
+    {
+		this->updateParamsBuffer();
+
+		CError_AppendReturnThis(this->params);
+    }
+
+
+	/**
+	 * return the maximum work group size which has to be a factor of domain_cells_count
+	 */
+	size_t getMaxWorkGroupSize(
+					size_t max_local_work_group_size,	///< desired local work group size
+					bool output_information = false		///< set to true, to be verbose
+	)
+	{
+		/**
+		 * return 32 cz. this is just for testing purposes
+		 */
+		if (max_local_work_group_size == 0)
+			return 32;
+
+		size_t local_work_group_size = max_local_work_group_size;
+
+		if (this->domain_cells_count < local_work_group_size)
+		{
+			local_work_group_size = this->domain_cells_count;
+			if (output_information)
+				std::cerr << "unable to use full local_work_group_size (" << max_local_work_group_size << ") for kernel => reducing to " << local_work_group_size << std::endl;
+		}
+
+		if (this->domain_cells_count % local_work_group_size != 0)
+		{
+			local_work_group_size = CMath::gcd(local_work_group_size, this->domain_cells_count);
+			if (output_information)
+				std::cerr << "unable to use full local_work_group_size (" << max_local_work_group_size << ") for kernel => reducing to " << local_work_group_size << std::endl;
+		}
+
+		return local_work_group_size;
+	}
+
+	/**
+	 * reload the simulation and kernels
+	 */
+	void reload()
+	{
+		this->dd_half = LBM_ET_DD_HALF;
+		this->in_place_cell_state = LBM_ET_IN_PLACE_CELL_STATE;
+		this->reloadInterface();
+
+		/*
+		 * the density distributions are stored in place in cMemDensityDistributions,
+		 * thus no additional density distribution buffer is allocated
+		 */
+		this->cl_interface_program_defines << "#define ESOTERIC_TWIST	(1)" << std::endl;
+
+		setupFusedFlagConversion();
+
+		global_work_group_size = cl::NDRange(this->domain_cells_count);
+
+		if (max_local_work_group_size == 0 && this->lbm_opencl_number_of_threads_list.empty())
+		{
+			cKernelLbm_Init_WorkGroupSize = 0;
+
+			cKernelLbm_MassScale_WorkGroupSize = 0;
+			cKernelLbm_FlagConversion_WorkGroupSize = 0;
+			cKernelLbm_CellState_WorkGroupSize = 0;
+
+			cKernelLbm_Pre_WorkGroupSize = 0;
+			cKernelLbm_Main_WorkGroupSize = 0;
+			cKernelLbm_GasToInterface_WorkGroupSize = 0;
+
+			cKernelLbm_InterfaceToGas_WorkGroupSize = 0;
+			cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize = 0;
+			cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize = 0;
+			cKernelLbm_GatherMass_WorkGroupSize = 0;
+			if (this->verbose)
+				std::cout << "loading kernels with test value for local_work_group_size (highly experimental, most probably wont work)" << std::endl;
+
+			createKernels(true);
+
+			if (this->verbose)
+				std::cout << "loading kernels..." << std::endl;
+
+			createKernels(false);
+		}
+		else
+		{
+#define to_str(x)	#x
+
+/**
+ * initialize the variable (postfixed appropriately with _WorkGroupSize and _MaxRegisters)
+ * with either the standard value (max_local_work_group_size) or with the value from the list
+ */
+#define INIT_WORK_GROUP_SIZE(variable)										\
+			this->work_group_size_count++;									\
+			if (it != this->lbm_opencl_number_of_threads_list.end())		\
+			{																\
+				variable##_WorkGroupSize = (*it != 0 ? *it : max_local_work_group_size);	\
+				it++;														\
+			}																\
+			else															\
+			{																\
+				variable##_WorkGroupSize = max_local_work_group_size;		\
+			}																\
+																			\
+			if (ir != this->lbm_opencl_number_of_registers_list.end())		\
+			{																\
+				variable##_MaxRegisters = (*ir != 0 ? *ir : 0);				\
+				ir++;														\
+			}																\
+			else															\
+			{																\
+				variable##_MaxRegisters  = 0;								\
+			}																\
+
+			this->work_group_size_count = 0;
+			std::list<int>::iterator it = this->lbm_opencl_number_of_threads_list.begin();
+			std::list<int>::iterator ir = this->lbm_opencl_number_of_registers_list.begin();
+
+			INIT_WORK_GROUP_SIZE(cKernelLbm_Init);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_Pre);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_Main);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_GasToInterface);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_InterfaceToGas);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_InterfaceToGasNeighbors);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_InterfaceToFluidNeighbors);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_GatherMass);
+
+
+			INIT_WORK_GROUP_SIZE(cKernelLbm_MassScale);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_FlagConversion);
+			INIT_WORK_GROUP_SIZE(cKernelLbm_CellState);
+#undef to_str
+#undef INIT_WORK_GROUP_SIZE
+
+			createKernels(false);
+		}
+	}
+
+
+	/**
+	 * check whether the flag conversions can be computed by the fused flag conversion kernel.
+	 *
+	 * the domain size has to be a multiple of the tile size.
+	 */
+	void setupFusedFlagConversion()
+	{
+		fused_flag_conversion = false;
+
+#if LBM_ET_FUSED_FLAG_CONVERSION
+		if (	this->params.domain_cells[0] % LBM_ET_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[1] % LBM_ET_FLAG_CONVERSION_TILE_SIZE != 0 ||
+				this->params.domain_cells[2] % LBM_ET_FLAG_CONVERSION_TILE_SIZE != 0
+		)
+		{
+			if (this->verbose)
+				std::cout << "fused flag conversion disabled: domain size is not a multiple of " << LBM_ET_FLAG_CONVERSION_TILE_SIZE << std::endl;
+			return;
+		}
+
+		fused_flag_conversion = true;
+		flag_conversion_tiles_count = this->domain_cells_count / (LBM_ET_FLAG_CONVERSION_TILE_SIZE*LBM_ET_FLAG_CONVERSION_TILE_SIZE*LBM_ET_FLAG_CONVERSION_TILE_SIZE);
+
+		this->cl_interface_program_defines << "#define FUSED_FLAG_CONVERSION	(1)" << std::endl;
+		this->cl_interface_program_defines << "#define FLAG_CONVERSION_TILE_SIZE	(" << LBM_ET_FLAG_CONVERSION_TILE_SIZE << ")" << std::endl;
+#endif
+	}
+
+	void createKernels(bool test_local_work_group_size)
+	{
+		/*
+		 * prepare CL Programs
+		 */
+
+		// initialization
+		CLBM_LOAD_PROGRAM(cProgram_Init, cKernelLbm_Init_WorkGroupSize, cKernelLbm_Init_MaxRegisters, "data/cl_programs/lbm_init.cl");
+
+		// interface conversions
+		CLBM_LOAD_PROGRAM(cProgram_InterfaceToGas,			cKernelLbm_InterfaceToGas_WorkGroupSize,			cKernelLbm_InterfaceToGas_MaxRegisters,				"data/cl_programs/lbm_interface_to_gas.cl");
+		CLBM_LOAD_PROGRAM(cProgram_InterfaceToGasNeighbors,	cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize,	cKernelLbm_InterfaceToGasNeighbors_MaxRegisters,	"data/cl_programs/lbm_interface_to_gas_neighbors.cl");
+		CLBM_LOAD_PROGRAM(cProgram_InterfaceToFluidNeighbors,	cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize,	cKernelLbm_InterfaceToFluidNeighbors_MaxRegisters,	"data/cl_programs/lbm_interface_to_fluid_neighbors.cl");
+		CLBM_LOAD_PROGRAM(cProgram_GatherMass,				cKernelLbm_GatherMass_WorkGroupSize, 				cKernelLbm_GatherMass_MaxRegisters,					"data/cl_programs/lbm_gather_mass.cl");
+
+		// collision and propagation kernel
+		CLBM_LOAD_PROGRAM(cProgram_Pre,				cKernelLbm_Pre_WorkGroupSize,				cKernelLbm_Pre_MaxRegisters,				"data/cl_programs/lbm_et_pre.cl");
+		CLBM_LOAD_PROGRAM(cProgram_Main,				cKernelLbm_Main_WorkGroupSize,				cKernelLbm_Main_MaxRegisters,				"data/cl_programs/lbm_et_coll_prop.cl");
+		CLBM_LOAD_PROGRAM(cProgram_GasToInterface,	cKernelLbm_GasToInterface_WorkGroupSize, 	cKernelLbm_GasToInterface_MaxRegisters, 	"data/cl_programs/lbm_et_flag_gas_to_interface.cl");
+
+		// mass scaling
+		CLBM_LOAD_PROGRAM(cProgram_MassScale, cKernelLbm_MassScale_WorkGroupSize, cKernelLbm_MassScale_MaxRegisters,	"data/cl_programs/lbm_mass_scale.cl");
+
+		// fused flag conversion
+		cl::Program cProgram_FlagConversion;
+		if (fused_flag_conversion)
+			loadProgram(cProgram_FlagConversion, cKernelLbm_FlagConversion_WorkGroupSize, cKernelLbm_FlagConversion_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/lbm_flag_conversion.cl", test_local_work_group_size);
+
+		// in place update of the flags and fluid fractions
+		cl::Program cProgram_CellState;
+		if (this->in_place_cell_state)
+			loadProgram(cProgram_CellState, cKernelLbm_CellState_WorkGroupSize, cKernelLbm_CellState_MaxRegisters, this->cl_interface_program_defines.str(), "data/cl_programs/lbm_et_cell_state.cl", test_local_work_group_size);
+
+		// the velocity and density recomputation and the rescaling depend on the defines of the implementation
+		this->loadMacroscopicProgram();
+
+		// build all programs loaded so far at once before any kernel is created
+		this->finishProgramBuilds();
+		if (this->error())
+			return;
+
+
+		/**********************************************************
+		 * initialization kernel
+		 **********************************************************/
+		CLBM_CREATE_KERNEL_9(	cKernelLbm_Init, cProgram_Init, "kernel_lbm_init",
+						this->cMemDensityDistributions,
+						this->cMemCellFlags,
+						this->cMemVelocity,
+						this->cMemDensity,
+						this->cMemParams,
+						this->cMemFluidMass,
+						this->cMemFluidFraction,
+						this->cMemNewCellFlags,
+						this->cMemNewFluidFraction
+		);
+
+
+		/**********************************************************
+		 * simulation kernels
+		 **********************************************************/
+
+		// PRE
+		CLBM_CREATE_KERNEL_7(	cKernelLbm_Pre, cProgram_Pre, "kernel_lbm_et_pre",
+						this->cMemDensityDistributions,
+						this->cMemCellFlags,
+						this->cMemVelocity,
+						this->cMemDensity,
+						this->cMemFluidMass,
+						this->cMemFluidFraction,
+						this->cMemParams
+		);
+		cKernelLbm_Pre.setArg(7, 0);	// et_swap
+
+		// MAIN
+		CLBM_CREATE_KERNEL_10(	cKernelLbm_Main, cProgram_Main, "kernel_lbm_et_coll_prop",
+						this->cMemDensityDistributions,
+						this->cMemCellFlags,
+						this->cMemVelocity,
+						this->cMemDensity,
+						this->cMemParams,
+						this->cMemFluidMass,
+						this->cMemFluidFraction,
+						this->cMemNewCellFlags,
+						this->cMemNewFluidFraction,
+
+						0		// et_swap
+		);
+
+
+		// INTERFACE TO FLUID NEIGHBORS
+		CLBM_CREATE_KERNEL_7(	cKernelLbm_InterfaceToFluidNeighbors, cProgram_InterfaceToFluidNeighbors, "kernel_interface_to_fluid_neighbors",
+						this->cMemDensityDistributions,
+						this->cMemNewCellFlags,
+						this->cMemVelocity,
+						this->cMemDensity,
+						this->cMemFluidMass,
+						this->cMemNewFluidFraction,
+						this->cMemParams
+		);
+
+		// INTERFACE TO GAS
+		CLBM_CREATE_KERNEL_7(	cKernelLbm_InterfaceToGas, cProgram_InterfaceToGas, "kernel_interface_to_gas",
+						this->cMemDensityDistributions,
+						this->cMemNewCellFlags,
+						this->cMemVelocity,
+						this->cMemDensity,
+						this->cMemFluidMass,
+						this->cMemNewFluidFraction,
+						this->cMemParams
+		);
+
+		// INTERFACE TO GAS NEIGHBORS
+		CLBM_CREATE_KERNEL_7(	cKernelLbm_InterfaceToGasNeighbors, cProgram_InterfaceToGasNeighbors, "kernel_interface_to_gas_neighbors",
+						this->cMemDensityDistributions,
+						this->cMemNewCellFlags,
+						this->cMemVelocity,
+						this->cMemDensity,
+						this->cMemFluidMass,
+						this->cMemNewFluidFraction,
+						this->cMemFluidFraction	// use fluid fraction as temporary buffer
+		);
+
+		// GATHER MASS
+		CLBM_CREATE_KERNEL_3(	cKernelLbm_GatherMass, cProgram_GatherMass, "kernel_gather_mass",
+						this->cMemNewCellFlags,
+						this->cMemFluidMass,
+						this->cMemFluidFraction
+		);
+
+		// GAS TO INTERFACE CONVERSION
+		CLBM_CREATE_KERNEL_7(	cKernelLbm_GasToInterface, cProgram_GasToInterface, "kernel_lbm_et_flag_gas_to_interface",
+						this->cMemDensityDistributions,
+						this->cMemNewCellFlags,
+						this->cMemVelocity,
+						this->cMemDensity,
+						this->cMemFluidMass,
+						this->cMemNewFluidFraction,
+						this->cMemParams
+		);
+		cKernelLbm_GasToInterface.setArg(7, 0);	// et_swap
+
+		/**********************************************************
+		 * mass scaling kernel
+		 **********************************************************/
+		CLBM_CREATE_KERNEL_(	cKernelLbm_MassScale, cProgram_MassScale, "kernel_lbm_mass_scale");
+		cKernelLbm_MassScale.setArg(0, this->cMemFluidMass);
+
+		/**********************************************************
+		 * fused flag conversion kernel
+		 **********************************************************/
+		if (fused_flag_conversion)
+		{
+			CLBM_CREATE_KERNEL_3(	cKernelLbm_FlagConversion, cProgram_FlagConversion, "kernel_flag_conversion",
+							this->cMemNewCellFlags,
+							this->cMemNewFluidFraction,
+							this->cMemParams
+			);
+		}
+
+		/**********************************************************
+		 * in place update of the flags and fluid fractions
+		 **********************************************************/
+		if (this->in_place_cell_state)
+		{
+			CLBM_CREATE_KERNEL_5(	cKernelLbm_CellState, cProgram_CellState, "kernel_lbm_et_cell_state",
+							this->cMemCellFlags,
+							this->cMemDensity,
+							this->cMemParams,
+							this->cMemFluidMass,
+							this->cMemFluidFraction
+			);
+		}
+
+		/**********************************************************
+		 * recomputation of the velocity and density (LBM_LAZY_MACROSCOPIC)
+		 **********************************************************/
+		this->createInterfaceKernels();
+	}
+
+	/**
+	 * reset the fluid to it's initial state
+	 */
+	void resetFluid()
+	{
+		if (this->error())
+			return;
+
+		if (this->verbose)
+			std::cout << "Init Simulation: " << std::flush;
+
+		cKernelLbm_Init.setArg(9, this->fluid_init_flags);
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Init,	// kernel
+														cl::NullRange,			// global work offset
+														this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_Init_WorkGroupSize),
+														cKernelLbm_Init_WorkGroupSize
+						);
+
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		this->resetFluid_Interface();
+
+		if (this->verbose)
+			std::cout << "OK" << std::endl;
+	}
+
+
+	/**
+	 * scale the mass in each cell to stabilize the overall amount of mass in the simulation
+	 */
+	void scaleMass(T mass_scale_factor)
+	{
+		cKernelLbm_MassScale.setArg(1, mass_scale_factor);
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_MassScale,	// kernel
+												cl::NullRange,				// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_MassScale_WorkGroupSize),
+												cKernelLbm_MassScale_WorkGroupSize
+						);
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+	}
+
+	/**
+	 * storage swap of the density distributions for the next simulation step (see simulationStep())
+	 */
+	cl_int getDDStorageSwap()
+	{
+		return (this->simulation_step_counter & 1);
+	}
+
+	/**
+	 * start one simulation step (enqueue kernels)
+	 *
+	 * the same kernels are used for each timestep. only the storage swap of the density
+	 * distributions as well as the flag and fluid fraction buffers alternate. with
+	 * in_place_cell_state, the current and next flag and fluid fraction buffers are the same.
+	 */
+	void simulationStep()
+	{
+		cl_int et_swap = (this->simulation_step_counter & 1);
+
+		// flags and fluid fractions of the current timestep
+		cl::Buffer &cMemCurrentFlags = (et_swap ? this->cMemNewCellFlags : this->cMemCellFlags);
+		cl::Buffer &cMemCurrentFluidFraction = (et_swap ? this->cMemNewFluidFraction : this->cMemFluidFraction);
+
+		// flags and fluid fractions of the next timestep
+		cl::Buffer &cMemNextFlags = (et_swap ? this->cMemCellFlags : this->cMemNewCellFlags);
+		cl::Buffer &cMemNextFluidFraction = (et_swap ? this->cMemFluidFraction : this->cMemNewFluidFraction);
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		/*
+		 * PRE
+		 */
+		cKernelLbm_Pre.setArg(1, cMemCurrentFlags);
+		cKernelLbm_Pre.setArg(5, cMemCurrentFluidFraction);
+		cKernelLbm_Pre.setArg(7, et_swap);
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Pre,	// kernel
+												cl::NullRange,					// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_Pre_WorkGroupSize),
+												cKernelLbm_Pre_WorkGroupSize
+						);
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		/*
+		 * MAIN
+		 */
+		cKernelLbm_Main.setArg(1, cMemCurrentFlags);
+		cKernelLbm_Main.setArg(7, cMemNextFlags);
+
+		cKernelLbm_Main.setArg(6, cMemCurrentFluidFraction);
+		cKernelLbm_Main.setArg(8, cMemNextFluidFraction);
+
+		cKernelLbm_Main.setArg(9, et_swap);
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_Main,	// kernel
+												cl::NullRange,						// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_Main_WorkGroupSize),
+												cKernelLbm_Main_WorkGroupSize
+						);
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		if (this->in_place_cell_state)
+		{
+			/*
+			 * CELL STATE
+			 */
+			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_CellState,	// kernel
+													cl::NullRange,						// global work offset
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_CellState_WorkGroupSize),
+													cKernelLbm_CellState_WorkGroupSize
+							);
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		}
+
+		if (fused_flag_conversion)
+		{
+			/*
+			 * FUSED FLAG CONVERSION
+			 */
+			cKernelLbm_FlagConversion.setArg(0, cMemNextFlags);
+			cKernelLbm_FlagConversion.setArg(1, cMemNextFluidFraction);
+
+			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_FlagConversion,	// kernel
+													cl::NullRange,					// global work offset
+													cl::NDRange(flag_conversion_tiles_count*cKernelLbm_FlagConversion_WorkGroupSize[0]),
+													cKernelLbm_FlagConversion_WorkGroupSize
+							);
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		}
+		else
+		{
+			/*
+			 * INTERFACE TO FLUID NEIGHBORS
+			 */
+			cKernelLbm_InterfaceToFluidNeighbors.setArg(1, cMemNextFlags);
+			cKernelLbm_InterfaceToFluidNeighbors.setArg(5, cMemNextFluidFraction);
+
+			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToFluidNeighbors,	// kernel
+													cl::NullRange,					// global work offset
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize),
+													cKernelLbm_InterfaceToFluidNeighbors_WorkGroupSize
+							);
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+			/*
+			 * INTERFACE TO GAS
+			 */
+			cKernelLbm_InterfaceToGas.setArg(1, cMemNextFlags);
+			cKernelLbm_InterfaceToGas.setArg(5, cMemNextFluidFraction);
+
+			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGas,	// kernel
+													cl::NullRange,					// global work offset
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_InterfaceToGas_WorkGroupSize),
+													cKernelLbm_InterfaceToGas_WorkGroupSize
+							);
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+			/*
+			 * GATHER MASS
+			 */
+			cKernelLbm_GatherMass.setArg(0, cMemNextFlags);
+			cKernelLbm_GatherMass.setArg(2, cMemNextFluidFraction);
+
+			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GatherMass,	// kernel
+													cl::NullRange,				// global work offset
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_GatherMass_WorkGroupSize),
+													cKernelLbm_GatherMass_WorkGroupSize
+							);
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+			/*
+			 * INTERFACE TO GAS NEIGHBORS
+			 */
+			cKernelLbm_InterfaceToGasNeighbors.setArg(1, cMemNextFlags);
+			cKernelLbm_InterfaceToGasNeighbors.setArg(5, cMemNextFluidFraction);
+			cKernelLbm_InterfaceToGasNeighbors.setArg(6, cMemCurrentFluidFraction);	// use fluid fraction as temporary buffer
+
+			this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_InterfaceToGasNeighbors,	// kernel
+													cl::NullRange,					// global work offset
+													this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize),
+													cKernelLbm_InterfaceToGasNeighbors_WorkGroupSize
+							);
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+		}
+
+		/*
+		 * GAS TO INTERFACE
+		 */
+		cKernelLbm_GasToInterface.setArg(1, cMemNextFlags);
+		cKernelLbm_GasToInterface.setArg(5, cMemNextFluidFraction);
+		cKernelLbm_GasToInterface.setArg(7, et_swap);
+
+		this->cl.cCommandQueue.enqueueNDRangeKernel(	cKernelLbm_GasToInterface,	// kernel
+												cl::NullRange,					// global work offset
+												this->getPaddedGlobalWorkGroupSize(global_work_group_size, cKernelLbm_GasToInterface_WorkGroupSize),
+												cKernelLbm_GasToInterface_WorkGroupSize
+						);
+
+		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		this->simulation_step_counter++;
+	}
+};
+
+#endif
@@ -24,10 +24,95 @@
 #include "libmath/CVector.hpp"
 #include "lib/CError.hpp"
 #include "lbm/CLbmParameters.hpp"
+#include "CL/cl_half.h"
 #include <typeinfo>
 #include <iomanip>
 #include <list>
+#include <fstream>
+#include <string.h>
+#include <set>
+#include <sys/stat.h>
+#include <sys/types.h>
 
+/**
+ * layout of the density distributions in the device buffers
+ *
+ * 0: structure of arrays (all cells of one direction are stored contiguously)
+ * >0: blocks of LBM_DD_BLOCK_SIZE cells with all 19 directions stored contiguously
+ */
+#ifndef LBM_DD_BLOCK_SIZE
+	#define LBM_DD_BLOCK_SIZE	0
+#endif
+
+/**
+ * ghost layer storage of the cell buffers
+ *
+ * the outermost cells of the domain are always obstacles, thus only these cells access neighbors across the
+ * domain boundaries. with LBM_GHOST_LAYER, all cell buffers are padded with ghost cells before and after the
+ * domain cells and the kernels access the neighbors with linear offsets instead of the DOMAIN_WRAP modulo.
+ */
+#ifndef LBM_GHOST_LAYER
+	#define LBM_GHOST_LAYER	0
+#endif
+
+/**
+ * ordering of the cells in the cell buffers
+ *
+ * 0: linear ordering (x running fastest)
+ * >0: bricks of LBM_CELL_BRICK_SIZE^3 cells are stored contiguously to keep the neighbors in z close in memory.
+ * the data handed out by the store* and loadFluidFraction* methods is always converted to the linear ordering.
+ */
+#ifndef LBM_CELL_BRICK_SIZE
+	#define LBM_CELL_BRICK_SIZE	0
+#endif
+
+#if LBM_GHOST_LAYER && LBM_CELL_BRICK_SIZE
+	#error "the ghost layer is only supported with the linear cell ordering"
+#endif
+
+/**
+ * lazy computation of the velocity and density fields
+ *
+ * the collision kernels only store the velocity and density of the cells which are read by the simulation
+ * (interface cells and their neighbors). the values of the other fluid cells are recomputed from the density
+ * distributions when they are requested by updateMacroscopic() or stored for every step with setStoreMacroscopic().
+ */
+#ifndef LBM_LAZY_MACROSCOPIC
+	#define LBM_LAZY_MACROSCOPIC	1
+#endif
+
+/**
+ * cache the device binaries of the OpenCL programs in LBM_PROGRAM_CACHE_DIR.
+ *
+ * the binaries are identified by a hash of the expanded program source (including all files included
+ * with #include "..."), the program defines, the build options, the device name and the driver version.
+ */
+#ifndef LBM_PROGRAM_CACHE
+	#define LBM_PROGRAM_CACHE	1
+#endif
+
+#ifndef LBM_PROGRAM_CACHE_DIR
+	#define LBM_PROGRAM_CACHE_DIR	"cache"
+#endif
+
+/**
+ * maximum work group size and number of work groups for the reductions (mass, checksums, maximum velocity).
+ * only LBM_REDUCTION_WORK_GROUPS partial results are transferred to the host.
+ */
+#define LBM_REDUCTION_WORK_GROUP_SIZE	256
+#define LBM_REDUCTION_WORK_GROUPS		64
+
+/**
+ * adaptive timestepping: the timestep is scaled to keep the maximum velocity (lattice units) close to
+ * LBM_ADAPTIVE_TIMESTEP_TARGET_VELOCITY. the scaling is limited to the range
+ * [LBM_ADAPTIVE_TIMESTEP_MIN_SCALE, LBM_ADAPTIVE_TIMESTEP_MAX_SCALE] of the timestep computed from the
+ * gravitation and changed at most by the factor LBM_ADAPTIVE_TIMESTEP_MAX_CHANGE for each update.
+ * the density distributions are rescaled to the new timestep (see rescaleDensityDistributions()).
+ */
+#define LBM_ADAPTIVE_TIMESTEP_TARGET_VELOCITY	0.1
+#define LBM_ADAPTIVE_TIMESTEP_MIN_SCALE			0.1
+#define LBM_ADAPTIVE_TIMESTEP_MAX_SCALE			2.0
+#define LBM_ADAPTIVE_TIMESTEP_MAX_CHANGE		1.1
 
 /**
  * \brief interface for lattice boltzmann simulation to implement different lattice boltzmann versions
@@ -82,12 +167,43 @@ public:
 	static const size_t SIZE_DD_HOST_BYTES = SIZE_DD_HOST*sizeof(T);
 
 	size_t domain_cells_count;
+	size_t ghost_cells;			///< number of ghost cells stored before and after the domain cells (LBM_GHOST_LAYER)
+	size_t dd_buffer_cells;		///< number of cells in the density distribution buffers (padded to the dd block size)
+	size_t dd_buffer_bytes;		///< size of the density distribution buffers in bytes
+
+	bool dd_half;				///< true, if the density distributions are stored as half floats (set by the implementation before reloadInterface())
+	bool in_place_cell_state;	///< true, if the flags and fluid fractions are updated in place without new buffers (set by the implementation before reloadInterface())
+	size_t device_memory_bytes;	///< size of the buffers allocated by createDDBuffer(), createCellBuffer() and createBuffer() in bytes
+
+	int subdomain_offset_z;		///< z coordinate of the first layer of the domain in the global domain (decomposed domain, see setupSubdomain())
+	int global_domain_cells_z;	///< number of layers of the global domain (0: the domain is not decomposed)
+	int subdomain_halo_layers;	///< number of layers at the bottom and top of the domain which are copies of the neighboring subdomains
 
 	std::ostringstream cl_interface_program_defines;
 
 	float simulation_mass_on_reset;		///< simulation mass on fluid reset
 
+	size_t adaptive_timestep_interval;	///< number of simulation steps between updates of the adaptive timestep (0: disabled)
+
+	/**
+	 * program which was loaded by loadProgram() and is built by finishProgramBuilds()
+	 */
+	struct CProgramBuild
+	{
+		cl::Program *program;			///< program handler of the caller
+		std::string filename;			///< filename of program
+		std::string source;				///< source handed over to the compiler
+		std::string build_parameters;	///< build options
+		std::string cache_filename;		///< filename of cached binary (empty if not cached)
+		bool from_cache;				///< true, if the program was created from the cached binary
+		cl_int err;						///< result of the build
+	};
+
+	std::vector<CProgramBuild> program_builds;	///< programs which still have to be built
+
 	std::list<int> lbm_opencl_number_of_threads_list;	///< list with number of threads for each successively created kernel
+	size_t work_group_size_count;		///< number of work group sizes (entries of lbm_opencl_number_of_threads_list) used by the implementation
+
 	std::list<int> lbm_opencl_number_of_registers_list;	///< list with number of registers for each thread threads for each successively created kernel
 
 
@@ -120,6 +236,22 @@ public:
 		INIT_CREATE_FILLED_CUBE				= (1<<6)
 	};
 
+	/**
+	 * indices of the simulation parameters in the constant parameter buffer
+	 */
+	enum
+	{
+		LBM_PARAM_INV_TAU				= 0,
+		LBM_PARAM_INV_TRT_TAU			= 1,
+		LBM_PARAM_GRAVITATION0			= 2,
+		LBM_PARAM_GRAVITATION1			= 3,
+		LBM_PARAM_GRAVITATION2			= 4,
+		LBM_PARAM_MASS_EXCHANGE_FACTOR	= 5,
+		LBM_PARAM_STORE_MACROSCOPIC		= 6,
+
+		LBM_PARAMS_COUNT				= 7
+	};
+
 
 
 	/**
@@ -137,6 +269,54 @@ public:
 	cl::Buffer cMemNewFluidFraction;		///< buffer with new fluid fractions
 	cl::Buffer cMemNewCellFlags;			///< buffer with new flags
 
+	std::vector<cl::Buffer> cMemGhostLayerBuffers;	///< buffers including the ghost cells of the cell buffers (LBM_GHOST_LAYER)
+
+	/**
+	 * simulation parameters which are read by the kernels from a constant buffer
+	 */
+	cl::Buffer cMemParams;					///< constant parameter buffer (LBM_PARAM_* indices)
+	T params_buffer_values[LBM_PARAMS_COUNT];	///< host copy of the values in the parameter buffer
+	bool params_buffer_valid;				///< false, if the parameter buffer has to be written
+	cl::Event params_buffer_write_event;	///< event of the last non-blocking write of the parameter buffer
+
+	/**
+	 * lazy velocity and density fields (LBM_LAZY_MACROSCOPIC)
+	 */
+	bool store_macroscopic;					///< true, if the collision kernels store the velocity and density of all cells
+	size_t macroscopic_step;				///< simulation step for which the velocity and density of all cells are valid
+	bool macroscopic_kernel;				///< true, if the kernel to recompute the velocity and density was created
+	cl::Program cProgram_Macroscopic;
+	cl::Kernel cKernelMacroscopic;
+	cl::NDRange cKernelMacroscopic_WorkGroupSize;
+
+	/**
+	 * rescaling of the density distributions for the adaptive timestep (see lbm_macroscopic.cl)
+	 */
+	bool timestep_rescale_kernel;			///< true, if the kernel to rescale the density distributions was created
+	cl::Kernel cKernelTimestepRescale;
+
+	/**
+	 * reductions
+	 */
+	bool reduction_kernels;				///< true, if the reductions are computed with the OpenCL reduction kernels
+	cl::Program cProgram_Reduction;
+	cl::Kernel cKernelReduction_Sum;
+	cl::Kernel cKernelReduction_MaskedSum;
+	cl::Kernel cKernelReduction_MaskedMaxLength2;
+	cl::NDRange cKernelReduction_WorkGroupSize;
+	cl::Buffer cMemReductionResults;		///< partial results of the reduction work groups
+	T reduction_results[LBM_REDUCTION_WORK_GROUPS];	///< host copy of the partial results
+
+#if LBM_CELL_BRICK_SIZE
+	/**
+	 * conversion to the linear cell ordering
+	 */
+	cl::Program cProgram_CellOrder;
+	cl::Kernel cKernelCellOrderToLinear;
+	cl::NDRange cKernelCellOrder_WorkGroupSize;
+	cl::Buffer cMemLinearOrder;				///< values of a cell buffer converted to the linear cell ordering
+#endif
+
 	/**
 	 * OpenCL interops to OpenGL context
 	 */
@@ -233,11 +413,12 @@ public:
 	void loadFluidFractionToRawFlatTexture()
 	{
 		std::vector<cl::Memory> glObjects(1, cMemFluidFractionFlatTexture);
+		cl::Buffer &cMemLinearFluidFraction = getLinearOrderMemObject(getFluidFractionMemObject(), 1, sizeof(T));
 
 		CL_CHECK_ERROR(cl.cCommandQueue.enqueueAcquireGLObjects(&glObjects));
 		cl.cCommandQueue.enqueueBarrierWithWaitList();
 
-		CL_CHECK_ERROR(cl.cCommandQueue.enqueueCopyBufferToImage(	getFluidFractionMemObject(),
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueCopyBufferToImage(	cMemLinearFluidFraction,
 													cMemFluidFractionFlatTexture,
 													0,
 													fluid_fraction_flat_texture_copy1_origin,
@@ -246,7 +427,7 @@ public:
 
 		if (fluid_fraction_flat_texture_copy2_region[0] != 0)
 		{
-			CL_CHECK_ERROR(cl.cCommandQueue.enqueueCopyBufferToImage(	getFluidFractionMemObject(),
+			CL_CHECK_ERROR(cl.cCommandQueue.enqueueCopyBufferToImage(	cMemLinearFluidFraction,
 														cMemFluidFractionFlatTexture,
 														0,
 														fluid_fraction_flat_texture_copy2_origin,
@@ -274,7 +455,7 @@ public:
 		const size_t origin[3] = {0,0,0};
 		const size_t domain_cells[3] = {domain_cells[0], domain_cells[1], domain_cells[2]};
 
-		CL_CHECK_ERROR(cl.cCommandQueue.enqueueCopyBufferToImage(	getFluidFractionMemObject(),
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueCopyBufferToImage(	getLinearOrderMemObject(getFluidFractionMemObject(), 1, sizeof(T)),
 													cMemFluidFractionTexture,
 													0,
 													origin, domain_cells));
@@ -297,7 +478,21 @@ public:
 	)	:
 		cl(cClSkeleton),
 		params(p_verbose),
-		verbose(p_verbose)
+		verbose(p_verbose),
+		dd_half(false),
+		in_place_cell_state(false),
+		device_memory_bytes(0),
+		subdomain_offset_z(0),
+		global_domain_cells_z(0),
+		subdomain_halo_layers(0),
+		adaptive_timestep_interval(0),
+		work_group_size_count(0),
+		params_buffer_valid(false),
+		store_macroscopic(false),
+		macroscopic_step(0),
+		macroscopic_kernel(false),
+		timestep_rescale_kernel(false),
+		reduction_kernels(false)
 	{
 	}
 
@@ -410,6 +605,38 @@ public:
 		setKernelArguments();
 	}
 
+	/**
+	 * setup the domain as a subdomain of a global domain which is decomposed to slabs in z direction
+	 *
+	 * the initialization uses the position of the cells in the global domain and the reductions skip the
+	 * halo layers. this method has to be called before the domain is initialized.
+	 */
+	void setupSubdomain(	int p_subdomain_offset_z,		///< z coordinate of the first layer (including halo layers) in the global domain
+							int p_global_domain_cells_z,	///< number of layers of the global domain
+							int p_subdomain_halo_layers		///< number of halo layers at the bottom and top of the domain
+	)
+	{
+		subdomain_offset_z = p_subdomain_offset_z;
+		global_domain_cells_z = p_global_domain_cells_z;
+		subdomain_halo_layers = p_subdomain_halo_layers;
+	}
+
+	/**
+	 * return the index of the first cell which is not part of the lower halo layers (see setupSubdomain())
+	 */
+	inline size_t getFirstInnerCell()
+	{
+		return (size_t)subdomain_halo_layers*params.domain_cells[0]*params.domain_cells[1];
+	}
+
+	/**
+	 * return the index after the last cell which is not part of the upper halo layers (see setupSubdomain())
+	 */
+	inline size_t getEndInnerCell()
+	{
+		return domain_cells_count - (size_t)subdomain_halo_layers*params.domain_cells[0]*params.domain_cells[1];
+	}
+
 	/**
 	 * reload method for interface
 	 *
@@ -419,18 +646,75 @@ public:
 	{
 		domain_cells_count = params.domain_cells.elements();
 
+#if LBM_CELL_BRICK_SIZE
+		if (	(LBM_CELL_BRICK_SIZE & (LBM_CELL_BRICK_SIZE-1)) != 0 ||
+				params.domain_cells[0] % LBM_CELL_BRICK_SIZE != 0 ||
+				params.domain_cells[1] % LBM_CELL_BRICK_SIZE != 0 ||
+				params.domain_cells[2] % LBM_CELL_BRICK_SIZE != 0
+		)
+		{
+			error << "the domain size has to be a multiple of the cell brick size " << LBM_CELL_BRICK_SIZE << " (power of two) in each dimension" << std::endl;
+			return;
+		}
+
+		// the halo layers of a subdomain have to be stored contiguously
+		if (subdomain_halo_layers != 0)
+		{
+			error << "subdomains are only supported with the linear cell ordering" << std::endl;
+			return;
+		}
+#endif
+
+#if LBM_GHOST_LAYER
+		// largest neighbor offset of the halo (2 cells) which is loaded by the flag conversion kernels
+		ghost_cells = 2*(params.domain_cells[0]*params.domain_cells[1] + params.domain_cells[0] + 1);
+#else
+		ghost_cells = 0;
+#endif
+
+#if LBM_DD_BLOCK_SIZE
+		dd_buffer_cells = ((domain_cells_count + 2*ghost_cells + LBM_DD_BLOCK_SIZE - 1) / LBM_DD_BLOCK_SIZE) * LBM_DD_BLOCK_SIZE;
+#else
+		dd_buffer_cells = domain_cells_count + 2*ghost_cells;
+#endif
+
+		dd_buffer_bytes = dd_buffer_cells*SIZE_DD_HOST*(dd_half ? sizeof(cl_half) : sizeof(T));
+
 		/*
 		 * ALLOCATE BUFFERS
 		 */
-		cl_int err;
-		cMemDensityDistributions = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(T)*domain_cells_count*SIZE_DD_HOST, NULL, &err);	CL_CHECK_ERROR(err);
-		cMemCellFlags = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(cl_int)*domain_cells_count, NULL, &err);		CL_CHECK_ERROR(err);
-		cMemVelocity = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(T)*domain_cells_count*3, NULL, &err);			CL_CHECK_ERROR(err);
-		cMemDensity = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(T)*domain_cells_count, NULL, &err);			CL_CHECK_ERROR(err);
-		cMemFluidMass = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(T)*domain_cells_count, NULL, &err);			CL_CHECK_ERROR(err);
-		cMemFluidFraction = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(T)*domain_cells_count, NULL, &err);		CL_CHECK_ERROR(err);
-		cMemNewFluidFraction = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(T)*domain_cells_count, NULL, &err);	CL_CHECK_ERROR(err);
-		cMemNewCellFlags = cl::Buffer(cl.cContext,	CL_MEM_READ_WRITE, sizeof(cl_int)*domain_cells_count, NULL, &err);	CL_CHECK_ERROR(err);
+		cMemGhostLayerBuffers.clear();
+		device_memory_bytes = 0;
+
+		cMemDensityDistributions = createDDBuffer();
+		cMemCellFlags = createCellBuffer(sizeof(cl_int), domain_cells_count);
+		cMemVelocity = createCellBuffer(sizeof(T), domain_cells_count*3);
+		cMemDensity = createCellBuffer(sizeof(T), domain_cells_count);
+		cMemFluidMass = createCellBuffer(sizeof(T), domain_cells_count);
+		cMemFluidFraction = createCellBuffer(sizeof(T), domain_cells_count);
+
+		if (in_place_cell_state)
+		{
+			// the new flags and fluid fractions are stored to the same buffers
+			cMemNewFluidFraction = cMemFluidFraction;
+			cMemNewCellFlags = cMemCellFlags;
+		}
+		else
+		{
+			cMemNewFluidFraction = createCellBuffer(sizeof(T), domain_cells_count);
+			cMemNewCellFlags = createCellBuffer(sizeof(cl_int), domain_cells_count);
+		}
+
+		cMemParams = createBuffer(CL_MEM_READ_ONLY, sizeof(T)*LBM_PARAMS_COUNT);
+
+		// allocated once by createInterfaceKernels()
+		cMemReductionResults = cl::Buffer();
+#if LBM_CELL_BRICK_SIZE
+		cMemLinearOrder = cl::Buffer();
+#endif
+
+		params_buffer_valid = false;
+		updateParamsBuffer();
 
 		/*
 		 * create #define precompiler directives for opencl kernels
@@ -439,6 +723,16 @@ public:
 		cl_interface_program_defines.clear();
 
 		cl_interface_program_defines << "#define SIZE_DD_HOST_BYTES (" << this->SIZE_DD_HOST_BYTES << ")" << std::endl;
+		cl_interface_program_defines << "#define DD_BLOCK_SIZE	(" << LBM_DD_BLOCK_SIZE << ")" << std::endl;
+		cl_interface_program_defines << "#define DD_HALF	(" << (dd_half ? 1 : 0) << ")" << std::endl;
+		cl_interface_program_defines << "#define IN_PLACE_CELL_STATE	(" << (in_place_cell_state ? 1 : 0) << ")" << std::endl;
+		cl_interface_program_defines << "#define DD_BUFFER_CELLS	(" << dd_buffer_cells << ")" << std::endl;
+		cl_interface_program_defines << "#define GHOST_LAYER	(" << LBM_GHOST_LAYER << ")" << std::endl;
+		cl_interface_program_defines << "#define GHOST_CELLS	(" << ghost_cells << ")" << std::endl;
+		cl_interface_program_defines << "#define CELL_BRICK_SIZE	(" << LBM_CELL_BRICK_SIZE << ")" << std::endl;
+		cl_interface_program_defines << "#define SUBDOMAIN_OFFSET_Z	(" << subdomain_offset_z << ")" << std::endl;
+		cl_interface_program_defines << "#define GLOBAL_DOMAIN_CELLS_Z	(" << (global_domain_cells_z != 0 ? global_domain_cells_z : params.domain_cells[2]) << ")" << std::endl;
+		cl_interface_program_defines << "#define SUBDOMAIN_HALO_LAYERS	(" << subdomain_halo_layers << ")" << std::endl;
 
 		if (typeid(T) == typeid(float))
 		{
@@ -481,6 +775,364 @@ public:
 
 		cl_interface_program_defines << "#define FLAG_OBSTACLE	(" << CLbmOpenClInterface<T>::LBM_FLAG_OBSTACLE << ")" << std::endl;
 
+		cl_interface_program_defines << "#define PARAM_INV_TAU	(" << LBM_PARAM_INV_TAU << ")" << std::endl;
+		cl_interface_program_defines << "#define PARAM_INV_TRT_TAU	(" << LBM_PARAM_INV_TRT_TAU << ")" << std::endl;
+		cl_interface_program_defines << "#define PARAM_GRAVITATION0	(" << LBM_PARAM_GRAVITATION0 << ")" << std::endl;
+		cl_interface_program_defines << "#define PARAM_GRAVITATION1	(" << LBM_PARAM_GRAVITATION1 << ")" << std::endl;
+		cl_interface_program_defines << "#define PARAM_GRAVITATION2	(" << LBM_PARAM_GRAVITATION2 << ")" << std::endl;
+		cl_interface_program_defines << "#define PARAM_MASS_EXCHANGE_FACTOR	(" << LBM_PARAM_MASS_EXCHANGE_FACTOR << ")" << std::endl;
+		cl_interface_program_defines << "#define PARAM_STORE_MACROSCOPIC	(" << LBM_PARAM_STORE_MACROSCOPIC << ")" << std::endl;
+
+		cl_interface_program_defines << "#define LAZY_MACROSCOPIC	(" << LBM_LAZY_MACROSCOPIC << ")" << std::endl;
+
+		macroscopic_kernel = false;
+		timestep_rescale_kernel = false;
+		reduction_kernels = false;
+
+		// only the defines of the interface are used, thus the programs are loaded before the implementations add their defines
+		loadReductionProgram();
+
+#if LBM_CELL_BRICK_SIZE
+		loadCellOrderProgram();
+#endif
+	}
+
+	/**
+	 * write the simulation parameters to the constant parameter buffer
+	 *
+	 * the buffer is only written if a value changed. the write is non-blocking, thus the kernels
+	 * enqueued afterwards use the new values without stalling the host.
+	 */
+	void updateParamsBuffer()
+	{
+		T values[LBM_PARAMS_COUNT];
+		values[LBM_PARAM_INV_TAU] = params.inv_tau;
+		values[LBM_PARAM_INV_TRT_TAU] = params.inv_trt_tau;
+		values[LBM_PARAM_GRAVITATION0] = params.gravitation[0];
+		values[LBM_PARAM_GRAVITATION1] = params.gravitation[1];
+		values[LBM_PARAM_GRAVITATION2] = params.gravitation[2];
+		values[LBM_PARAM_MASS_EXCHANGE_FACTOR] = params.mass_exchange_factor;
+		values[LBM_PARAM_STORE_MACROSCOPIC] = (store_macroscopic ? (T)1.0 : (T)0.0);
+
+		if (params_buffer_valid && memcmp(values, params_buffer_values, sizeof(values)) == 0)
+			return;
+
+		// the host copy is read by the previous write until it completed
+		if (params_buffer_write_event() != NULL)
+		{
+			CL_CHECK_ERROR(params_buffer_write_event.wait());
+		}
+
+		memcpy(params_buffer_values, values, sizeof(values));
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueWriteBuffer(cMemParams, CL_FALSE, 0, sizeof(values), params_buffer_values, NULL, &params_buffer_write_event));
+
+		params_buffer_valid = true;
+	}
+
+	/**
+	 * create a buffer for the density distributions
+	 *
+	 * with LBM_GHOST_LAYER, the buffer is initialized with zeros to avoid invalid values in the ghost cells.
+	 */
+	cl::Buffer createDDBuffer()
+	{
+		cl_int err;
+		cl::Buffer cMemBuffer(cl.cContext, CL_MEM_READ_WRITE, dd_buffer_bytes, NULL, &err);	CL_CHECK_ERROR(err);
+#if LBM_GHOST_LAYER
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueFillBuffer(cMemBuffer, (cl_uchar)0, 0, dd_buffer_bytes));
+#endif
+		device_memory_bytes += dd_buffer_bytes;
+		return cMemBuffer;
+	}
+
+	/**
+	 * create a buffer with 'bytes' bytes which is not stored for the domain cells (parameters, lists, partial results)
+	 */
+	cl::Buffer createBuffer(cl_mem_flags flags, size_t bytes, void *host_ptr = NULL)
+	{
+		cl_int err;
+		cl::Buffer cMemBuffer(cl.cContext, flags, bytes, host_ptr, &err);	CL_CHECK_ERROR(err);
+		device_memory_bytes += bytes;
+		return cMemBuffer;
+	}
+
+	/**
+	 * create a buffer for 'elements' values with 'element_bytes' bytes each which are stored for the domain cells
+	 *
+	 * with LBM_GHOST_LAYER, a sub-buffer of a zero initialized buffer with at least ghost_cells values before and
+	 * after the domain cells is returned. thus the kernels can access the ghost cells with negative indices.
+	 */
+	cl::Buffer createCellBuffer(size_t element_bytes, size_t elements)
+	{
+		cl_int err;
+#if LBM_GHOST_LAYER
+		// the origin of a sub-buffer has to be aligned to the base address alignment of the device
+		cl_uint base_addr_align_bits;
+		cl.cDevice.getInfo(CL_DEVICE_MEM_BASE_ADDR_ALIGN, &base_addr_align_bits);
+		size_t align_bytes = (base_addr_align_bits < 8 ? 1 : base_addr_align_bits/8);
+		size_t ghost_bytes = ((ghost_cells*element_bytes + align_bytes - 1) / align_bytes) * align_bytes;
+
+		cl::Buffer cMemGhostLayerBuffer(cl.cContext, CL_MEM_READ_WRITE, elements*element_bytes + 2*ghost_bytes, NULL, &err);	CL_CHECK_ERROR(err);
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueFillBuffer(cMemGhostLayerBuffer, (cl_uchar)0, 0, elements*element_bytes + 2*ghost_bytes));
+		cMemGhostLayerBuffers.push_back(cMemGhostLayerBuffer);
+
+		cl_buffer_region region = {ghost_bytes, elements*element_bytes};
+		cl::Buffer cMemBuffer = cMemGhostLayerBuffer.createSubBuffer(CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);	CL_CHECK_ERROR(err);
+		device_memory_bytes += elements*element_bytes + 2*ghost_bytes;
+#else
+		cl::Buffer cMemBuffer(cl.cContext, CL_MEM_READ_WRITE, elements*element_bytes, NULL, &err);	CL_CHECK_ERROR(err);
+		device_memory_bytes += elements*element_bytes;
+#endif
+		return cMemBuffer;
+	}
+
+	/**
+	 * load the program of the reduction kernels
+	 *
+	 * the program is built together with the programs of the implementation (see createInterfaceKernels())
+	 */
+	void loadReductionProgram()
+	{
+		// the tree reduction needs a power of two work group size
+		size_t max_work_group_size;
+		cl.cDevice.getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &max_work_group_size);
+
+		size_t work_group_size = 1;
+		while (work_group_size*2 <= CMath::min<size_t>(max_work_group_size, LBM_REDUCTION_WORK_GROUP_SIZE))
+			work_group_size *= 2;
+
+		cKernelReduction_WorkGroupSize = cl::NDRange(work_group_size);
+
+		loadProgram(cProgram_Reduction, cKernelReduction_WorkGroupSize, 0, cl_interface_program_defines.str(), "data/cl_programs/lbm_reduction.cl", false);
+	}
+
+#if LBM_CELL_BRICK_SIZE
+	/**
+	 * load the program to convert the cell buffers to the linear cell ordering
+	 */
+	void loadCellOrderProgram()
+	{
+		size_t max_work_group_size;
+		cl.cDevice.getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &max_work_group_size);
+
+		cKernelCellOrder_WorkGroupSize = cl::NDRange(CMath::min<size_t>(max_work_group_size, 128));
+
+		loadProgram(cProgram_CellOrder, cKernelCellOrder_WorkGroupSize, 0, cl_interface_program_defines.str(), "data/cl_programs/lbm_cell_order.cl", false);
+	}
+#endif
+
+	/**
+	 * load the program to recompute the velocity and density from the density distributions and
+	 * to rescale the density distributions for the adaptive timestep
+	 *
+	 * the kernels depend on the storage of the density distributions, thus this has to be called by the
+	 * implementations after adding their defines and before finishProgramBuilds().
+	 */
+	void loadMacroscopicProgram()
+	{
+		size_t max_work_group_size;
+		cl.cDevice.getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &max_work_group_size);
+
+		cKernelMacroscopic_WorkGroupSize = cl::NDRange(CMath::min<size_t>(max_work_group_size, 128));
+
+		loadProgram(cProgram_Macroscopic, cKernelMacroscopic_WorkGroupSize, 0, cl_interface_program_defines.str(), "data/cl_programs/lbm_macroscopic.cl", false);
+	}
+
+	/**
+	 * create the kernels and buffers of the interface (reductions, cell ordering, macroscopic values)
+	 *
+	 * the programs were loaded by reloadInterface() and loadMacroscopicProgram(), this has to be called
+	 * by the implementations after finishProgramBuilds().
+	 */
+	void createInterfaceKernels()
+	{
+		reduction_kernels = false;
+		macroscopic_kernel = false;
+		timestep_rescale_kernel = false;
+
+		if (error())
+			return;
+
+		cl_int err;
+		cKernelReduction_Sum = cl::Kernel(cProgram_Reduction, "kernel_reduction_sum", &err);							CL_CHECK_ERROR(err);
+		cKernelReduction_MaskedSum = cl::Kernel(cProgram_Reduction, "kernel_reduction_masked_sum", &err);				CL_CHECK_ERROR(err);
+		cKernelReduction_MaskedMaxLength2 = cl::Kernel(cProgram_Reduction, "kernel_reduction_masked_max_length2", &err);	CL_CHECK_ERROR(err);
+
+		// the kernels are created again for each work group size test, the buffers only once per reload
+		if (cMemReductionResults() == NULL)
+			cMemReductionResults = createBuffer(CL_MEM_READ_WRITE, sizeof(T)*LBM_REDUCTION_WORK_GROUPS);
+
+		reduction_kernels = true;
+
+#if LBM_CELL_BRICK_SIZE
+		cKernelCellOrderToLinear = cl::Kernel(cProgram_CellOrder, "kernel_cell_order_to_linear", &err);	CL_CHECK_ERROR(err);
+
+		// largest cell buffer: velocity
+		if (cMemLinearOrder() == NULL)
+			cMemLinearOrder = createBuffer(CL_MEM_READ_WRITE, sizeof(T)*domain_cells_count*3);
+#endif
+
+#if LBM_LAZY_MACROSCOPIC
+		cKernelMacroscopic = cl::Kernel(cProgram_Macroscopic, "kernel_lbm_macroscopic", &err);	CL_CHECK_ERROR(err);
+
+		macroscopic_kernel = true;
+#endif
+
+		cKernelTimestepRescale = cl::Kernel(cProgram_Macroscopic, "kernel_lbm_timestep_rescale", &err);	CL_CHECK_ERROR(err);
+
+		timestep_rescale_kernel = true;
+	}
+
+	/**
+	 * return the storage swap of the opposite density distribution directions for the current simulation step
+	 *
+	 * see lbm_macroscopic.cl, the implementations with an alternating storage override this method.
+	 */
+	virtual cl_int getDDStorageSwap()
+	{
+		return 0;
+	}
+
+	/**
+	 * recompute the velocity and density of the cells which were not stored by the collision kernels
+	 *
+	 * nothing is done if the values are already valid for the current simulation step.
+	 */
+	void updateMacroscopic()
+	{
+		if (!macroscopic_kernel || store_macroscopic || macroscopic_step == simulation_step_counter)
+			return;
+
+		cKernelMacroscopic.setArg(0, getDensityDistributionsMemObject());
+		cKernelMacroscopic.setArg(1, getFlagsMemObject());
+		cKernelMacroscopic.setArg(2, cMemVelocity);
+		cKernelMacroscopic.setArg(3, cMemDensity);
+		cKernelMacroscopic.setArg(4, getDDStorageSwap());
+		cKernelMacroscopic.setArg(5, cMemParams);
+
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueNDRangeKernel(	cKernelMacroscopic,	// kernel
+													cl::NullRange,				// global work offset
+													getPaddedGlobalWorkGroupSize(cl::NDRange(domain_cells_count), cKernelMacroscopic_WorkGroupSize),
+													cKernelMacroscopic_WorkGroupSize
+								));
+
+		macroscopic_step = simulation_step_counter;
+	}
+
+	/**
+	 * rescale the density distributions and velocities of the fluid and interface cells after a change of the timestep
+	 *
+	 * see kernel_lbm_timestep_rescale in lbm_macroscopic.cl, the multi device and distributed
+	 * implementations forward this to their subdomains.
+	 */
+	virtual void rescaleDensityDistributions(T velocity_scale, T non_equilibrium_scale)
+	{
+		if (!timestep_rescale_kernel)
+			return;
+
+		cKernelTimestepRescale.setArg(0, getDensityDistributionsMemObject());
+		cKernelTimestepRescale.setArg(1, getFlagsMemObject());
+		cKernelTimestepRescale.setArg(2, cMemVelocity);
+		cKernelTimestepRescale.setArg(3, getDDStorageSwap());
+		cKernelTimestepRescale.setArg(4, velocity_scale);
+		cKernelTimestepRescale.setArg(5, non_equilibrium_scale);
+
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueNDRangeKernel(	cKernelTimestepRescale,	// kernel
+													cl::NullRange,				// global work offset
+													getPaddedGlobalWorkGroupSize(cl::NDRange(domain_cells_count), cKernelMacroscopic_WorkGroupSize),
+													cKernelMacroscopic_WorkGroupSize
+								));
+	}
+
+	/**
+	 * store the velocity and density of all cells in each simulation step (e.g. for a consumer reading the fields every step)
+	 *
+	 * otherwise the values are only computed on demand by updateMacroscopic().
+	 */
+	virtual void setStoreMacroscopic(bool p_store_macroscopic)
+	{
+		// the already enqueued steps did not store the values of all cells
+		if (p_store_macroscopic)
+			updateMacroscopic();
+
+		store_macroscopic = p_store_macroscopic;
+		setKernelArguments();
+	}
+
+	/**
+	 * return a buffer with the values of the cell buffer 'cMemValues' in linear cell ordering
+	 *
+	 * with LBM_CELL_BRICK_SIZE, the values are converted to cMemLinearOrder. otherwise 'cMemValues' is returned.
+	 */
+	cl::Buffer &getLinearOrderMemObject(	cl::Buffer &cMemValues,	///< cell buffer
+											int components,			///< number of components of each value
+											size_t value_bytes		///< size of each component in bytes
+	)
+	{
+#if LBM_CELL_BRICK_SIZE
+		cKernelCellOrderToLinear.setArg(0, cMemValues);
+		cKernelCellOrderToLinear.setArg(1, cMemLinearOrder);
+		cKernelCellOrderToLinear.setArg(2, components);
+		cKernelCellOrderToLinear.setArg(3, (cl_int)(value_bytes/sizeof(cl_uint)));
+
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueNDRangeKernel(	cKernelCellOrderToLinear,	// kernel
+													cl::NullRange,		// global work offset
+													getPaddedGlobalWorkGroupSize(cl::NDRange(domain_cells_count), cKernelCellOrder_WorkGroupSize),
+													cKernelCellOrder_WorkGroupSize
+								));
+		return cMemLinearOrder;
+#else
+		return cMemValues;
+#endif
+	}
+
+	/**
+	 * run the reduction kernel and read the partial results of the work groups to reduction_results
+	 */
+	void enqueueReduction(cl::Kernel &cKernel)
+	{
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueNDRangeKernel(	cKernel,	// kernel
+													cl::NullRange,		// global work offset
+													cl::NDRange(LBM_REDUCTION_WORK_GROUPS*cKernelReduction_WorkGroupSize[0]),
+													cKernelReduction_WorkGroupSize
+								));
+
+		CL_CHECK_ERROR(cl.cCommandQueue.enqueueReadBuffer(
+											cMemReductionResults,
+											CL_TRUE,	// sync reading
+											0,
+											sizeof(T)*LBM_REDUCTION_WORK_GROUPS,
+											reduction_results));
+	}
+
+	/**
+	 * get memory reference to the OpenCL density distribution buffer of the current simulation step
+	 */
+	virtual cl::Buffer &getDensityDistributionsMemObject()
+	{
+		return cMemDensityDistributions;
+	}
+
+	/**
+	 * get memory reference to the OpenCL flag buffer of the current simulation step
+	 */
+	cl::Buffer &getFlagsMemObject()
+	{
+		if (simulation_step_counter & 1)
+			return cMemNewCellFlags;
+		else
+			return cMemCellFlags;
+	}
+
+	/**
+	 * return the size of all buffers allocated on the device in bytes
+	 *
+	 * with in_place_cell_state, no buffers for the new flags and fluid fractions are allocated.
+	 * the implementations without it (AA and AB) keep the double buffers of the flags and fluid fractions.
+	 */
+	virtual size_t getDeviceMemoryFootprint()
+	{
+		return device_memory_bytes;
 	}
 
 	/**
@@ -492,6 +1144,9 @@ public:
 	{
 		simulation_step_counter = 0;
 
+		// the initialization kernel stores the velocity and density of all cells
+		macroscopic_step = 0;
+
 		simulation_mass_on_reset = this->getMassReduction();
 	}
 
@@ -500,7 +1155,7 @@ public:
 	/**
 	 * wait until all kernels have finished
 	 */
-	void wait()
+	virtual void wait()
 	{
 		this->cl.cCommandQueue.finish();
 	}
@@ -509,14 +1164,16 @@ public:
 	 * store velocity and density values to host memory
 	 * this is useful for a host memory based visualization
 	 */
-	void storeVelocity(T *dst)
+	virtual void storeVelocity(T *dst)
 	{
 		size_t byte_size;
 		this->cMemVelocity.getInfo(CL_MEM_SIZE, &byte_size);
 
+		updateMacroscopic();
+
 		wait();
 		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
-											this->cMemVelocity,
+											this->getLinearOrderMemObject(this->cMemVelocity, 3, sizeof(T)),
 											CL_TRUE,	// sync reading
 											0,
 											byte_size,
@@ -527,14 +1184,16 @@ public:
 	/**
 	 * store the density to the allocated host memory 'dst'
 	 */
-	void storeDensity(T *dst)
+	virtual void storeDensity(T *dst)
 	{
 		size_t byte_size;
 		this->cMemDensity.getInfo(CL_MEM_SIZE, &byte_size);
 
+		updateMacroscopic();
+
 		wait();
 		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
-											this->cMemDensity,
+											this->getLinearOrderMemObject(this->cMemDensity, 1, sizeof(T)),
 											CL_TRUE,	// sync reading
 											0,
 											byte_size,
@@ -542,35 +1201,109 @@ public:
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
 	}
 
+	/**
+	 * return the index of the cell with the linear index 'cell' in the cell buffers (see LBM_CELL_BRICK_SIZE)
+	 */
+	inline size_t getCellBufferIndex(size_t cell)
+	{
+#if LBM_CELL_BRICK_SIZE
+		size_t x = cell % params.domain_cells[0];
+		size_t y = (cell / params.domain_cells[0]) % params.domain_cells[1];
+		size_t z = cell / (params.domain_cells[0]*params.domain_cells[1]);
+
+		size_t brick = ((z/LBM_CELL_BRICK_SIZE)*(params.domain_cells[1]/LBM_CELL_BRICK_SIZE) + y/LBM_CELL_BRICK_SIZE)*(params.domain_cells[0]/LBM_CELL_BRICK_SIZE) + x/LBM_CELL_BRICK_SIZE;
+
+		return	brick*(LBM_CELL_BRICK_SIZE*LBM_CELL_BRICK_SIZE*LBM_CELL_BRICK_SIZE) +
+				((z%LBM_CELL_BRICK_SIZE)*LBM_CELL_BRICK_SIZE + y%LBM_CELL_BRICK_SIZE)*LBM_CELL_BRICK_SIZE + x%LBM_CELL_BRICK_SIZE;
+#else
+		return cell;
+#endif
+	}
+
+	/**
+	 * return the index of the density distribution 'dd_id' of cell 'cell' in the density distribution buffers
+	 */
+	inline size_t getDDBufferIndex(size_t cell, size_t dd_id)
+	{
+		cell = getCellBufferIndex(cell) + ghost_cells;
+#if LBM_DD_BLOCK_SIZE
+		return (cell/LBM_DD_BLOCK_SIZE)*(LBM_DD_BLOCK_SIZE*SIZE_DD_HOST) + dd_id*LBM_DD_BLOCK_SIZE + (cell%LBM_DD_BLOCK_SIZE);
+#else
+		return cell + dd_id*dd_buffer_cells;
+#endif
+	}
+
+	/**
+	 * return the lattice weight of the density distribution 'dd_id'
+	 */
+	static inline T getDDWeight(size_t dd_id)
+	{
+		if (dd_id == 18)
+			return (T)(1.0/3.0);
+		if (dd_id < 4 || dd_id > 15)
+			return (T)(1.0/18.0);
+		return (T)(1.0/36.0);
+	}
+
 	/**
 	 * store the density distributions to the allocated host memory 'dst'
+	 *
+	 * the density distributions are always stored as structure of arrays (dst[cell + dd_id*domain_cells_count])
 	 */
-	void storeDensityDistributions(T *dst)
+	virtual void storeDensityDistributions(T *dst)
 	{
-		size_t byte_size;
-		this->cMemDensityDistributions.getInfo(CL_MEM_SIZE, &byte_size);
+		if (!dd_half && LBM_DD_BLOCK_SIZE == 0 && LBM_CELL_BRICK_SIZE == 0 && ghost_cells == 0)
+		{
+			wait();
+			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
+												this->getDensityDistributionsMemObject(),
+												CL_TRUE,	// sync reading
+												0,
+												dd_buffer_bytes,
+												dst));
+			this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+			return;
+		}
+
+		char *buffer_dd = new char[dd_buffer_bytes];
 
 		wait();
 		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
-											this->cMemDensityDistributions,
+											this->getDensityDistributionsMemObject(),
 											CL_TRUE,	// sync reading
 											0,
-											byte_size,
-											dst));
+											dd_buffer_bytes,
+											buffer_dd));
 		this->cl.cCommandQueue.enqueueBarrierWithWaitList();
+
+		// convert to structure of arrays with precision T
+		for (size_t i = 0; i < SIZE_DD_HOST; i++)
+		{
+			for (size_t cell = 0; cell < domain_cells_count; cell++)
+			{
+				size_t index = getDDBufferIndex(cell, i);
+
+				if (dd_half)
+					dst[cell + i*domain_cells_count] = (T)cl_half_to_float(((cl_half*)buffer_dd)[index]) + getDDWeight(i);
+				else
+					dst[cell + i*domain_cells_count] = ((T*)buffer_dd)[index];
+			}
+		}
+
+		delete [] buffer_dd;
 	}
 
 	/**
 	 * store the mass to the allocated host memory 'dst'
 	 */
-	void storeMass(T *dst)
+	virtual void storeMass(T *dst)
 	{
 		size_t byte_size;
 		this->cMemFluidMass.getInfo(CL_MEM_SIZE, &byte_size);
 
 		wait();
 		CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
-											this->cMemFluidMass,
+											this->getLinearOrderMemObject(this->cMemFluidMass, 1, sizeof(T)),
 											CL_TRUE,	// sync reading
 											0,
 											byte_size,
@@ -581,7 +1314,7 @@ public:
 	/**
 	 * store the fluid fraction to the allocated host memory 'dst'
 	 */
-	void storeFraction(T *dst)
+	virtual void storeFraction(T *dst)
 	{
 		size_t byte_size;
 		this->cMemFluidFraction.getInfo(CL_MEM_SIZE, &byte_size);
@@ -590,7 +1323,7 @@ public:
 		if (this->simulation_step_counter & 1)
 		{
 			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
-												this->cMemNewFluidFraction,
+												this->getLinearOrderMemObject(this->cMemNewFluidFraction, 1, sizeof(T)),
 												CL_TRUE,	// sync reading
 												0,
 												byte_size,
@@ -599,7 +1332,7 @@ public:
 		else
 		{
 			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
-												this->cMemFluidFraction,
+												this->getLinearOrderMemObject(this->cMemFluidFraction, 1, sizeof(T)),
 												CL_TRUE,	// sync reading
 												0,
 												byte_size,
@@ -612,7 +1345,7 @@ public:
 	/**
 	 * store the flags to the allocated host memory 'dst'
 	 */
-	void storeFlags(cl_int *dst)
+	virtual void storeFlags(cl_int *dst)
 	{
 		size_t byte_size;
 		this->cMemCellFlags.getInfo(CL_MEM_SIZE, &byte_size);
@@ -621,7 +1354,7 @@ public:
 		if (this->simulation_step_counter & 1)
 		{
 			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(
-												this->cMemNewCellFlags,
+												this->getLinearOrderMemObject(this->cMemNewCellFlags, 1, sizeof(cl_int)),
 												CL_TRUE,	// sync reading
 												0,
 												byte_size,
@@ -629,7 +1362,7 @@ public:
 		}
 		else
 		{
-			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(	this->cMemCellFlags,
+			CL_CHECK_ERROR(this->cl.cCommandQueue.enqueueReadBuffer(	this->getLinearOrderMemObject(this->cMemCellFlags, 1, sizeof(cl_int)),
 												CL_TRUE,	// sync reading
 												0,
 												byte_size,
@@ -643,16 +1376,27 @@ public:
 
 	/**
 	 * return the sum of all mass values
-	 *
-	 * TODO: speedup with OpenCL reduction
 	 */
-	T getMassReduction()
+	virtual T getMassReduction()
 	{
+		if (reduction_kernels)
+		{
+			cKernelReduction_Sum.setArg(0, cMemFluidMass);
+			cKernelReduction_Sum.setArg(1, cMemReductionResults);
+			enqueueReduction(cKernelReduction_Sum);
+
+			T sum = (T)0.0;
+			for (int i = 0; i < LBM_REDUCTION_WORK_GROUPS; i++)
+				sum += reduction_results[i];
+
+			return sum;
+		}
+
 		T *tmpbuffer = new T[this->params.domain_cells.elements()];
 		storeMass(tmpbuffer);
 
 		T sum = (T)0.0;
-		for (int a = 0; a < this->params.domain_cells.elements(); a++)
+		for (size_t a = getFirstInnerCell(); a < getEndInnerCell(); a++)
 			sum += tmpbuffer[a];
 
 		delete [] tmpbuffer;
@@ -660,11 +1404,35 @@ public:
 		return sum;
 	}
 
+	/**
+	 * return the sum over all components of the values of the fluid and interface cells with the reduction kernel
+	 */
+	float getMaskedSum(cl::Buffer &cMemValues, int components)
+	{
+		cKernelReduction_MaskedSum.setArg(0, cMemValues);
+		cKernelReduction_MaskedSum.setArg(1, getFlagsMemObject());
+		cKernelReduction_MaskedSum.setArg(2, cMemReductionResults);
+		cKernelReduction_MaskedSum.setArg(3, components);
+		enqueueReduction(cKernelReduction_MaskedSum);
+
+		float checksum = 0.0;
+		for (int i = 0; i < LBM_REDUCTION_WORK_GROUPS; i++)
+			checksum += reduction_results[i];
+
+		return checksum;
+	}
+
 	/**
 	 * return the checksum over the velocity field for all valid fluid cells (FLAG is FLIUD or INTERFACE)
 	 */
-	float getVelocityChecksum()
+	virtual float getVelocityChecksum()
 	{
+		if (reduction_kernels)
+		{
+			updateMacroscopic();
+			return getMaskedSum(cMemVelocity, 3);
+		}
+
 		float *velocity = new T[domain_cells_count*3];
 		storeVelocity(velocity);
 
@@ -677,7 +1445,7 @@ public:
 		T *velz = velocity+domain_cells_count*2;
 
 		float checksum = 0.0;
-		for (int a = 0; a < (int)domain_cells_count; a++)
+		for (size_t a = getFirstInnerCell(); a < getEndInnerCell(); a++)
 			if (flags[a] == CLbmOpenClInterface<T>::LBM_FLAG_FLUID || flags[a] == CLbmOpenClInterface<T>::LBM_FLAG_INTERFACE)
 				checksum += velx[a] + vely[a] + velz[a];
 
@@ -690,8 +1458,25 @@ public:
 	/**
 	 * return the maximum velocity of all fluid cells
 	 */
-	T getMaxVelocity()
+	virtual T getMaxVelocity()
 	{
+		if (reduction_kernels)
+		{
+			updateMacroscopic();
+
+			cKernelReduction_MaskedMaxLength2.setArg(0, cMemVelocity);
+			cKernelReduction_MaskedMaxLength2.setArg(1, getFlagsMemObject());
+			cKernelReduction_MaskedMaxLength2.setArg(2, cMemReductionResults);
+			enqueueReduction(cKernelReduction_MaskedMaxLength2);
+
+			T max_vel_2 = 0.0;
+			for (int i = 0; i < LBM_REDUCTION_WORK_GROUPS; i++)
+				if (max_vel_2 < reduction_results[i])
+					max_vel_2 = reduction_results[i];
+
+			return max_vel_2;
+		}
+
 		T *velocity = new T[params.domain_cells.elements()*3];
 		storeVelocity(velocity);
 
@@ -704,7 +1489,7 @@ public:
 		T *vely = velocity+params.domain_cells.elements();
 		T *velz = velocity+params.domain_cells.elements()*2;
 
-		for (int a = 0; a < params.domain_cells.elements(); a++)
+		for (size_t a = getFirstInnerCell(); a < getEndInnerCell(); a++)
 			if (flags[a] == CLbmOpenClInterface<T>::LBM_FLAG_FLUID || flags[a] == CLbmOpenClInterface<T>::LBM_FLAG_INTERFACE)
 			{
 				T cur_vel = velx[a]*velx[a] + vely[a]*vely[a] + velz[a]*velz[a];
@@ -721,8 +1506,14 @@ public:
 	/**
 	 * return the checksum over the density for all valid fluid cells (FLAG is FLIUD or INTERFACE)
 	 */
-	float getDensityChecksum()
+	virtual float getDensityChecksum()
 	{
+		if (reduction_kernels)
+		{
+			updateMacroscopic();
+			return getMaskedSum(cMemDensity, 1);
+		}
+
 		float *density = new T[domain_cells_count];
 		storeDensity(density);
 
@@ -731,7 +1522,7 @@ public:
 		wait();
 
 		float checksum = 0.0;
-		for (int a = 0; a < (int)domain_cells_count; a++)
+		for (size_t a = getFirstInnerCell(); a < getEndInnerCell(); a++)
 			if (flags[a] == CLbmOpenClInterface<T>::LBM_FLAG_FLUID || flags[a] == CLbmOpenClInterface<T>::LBM_FLAG_INTERFACE)
 				checksum += density[a];
 
@@ -742,6 +1533,75 @@ public:
 	}
 
 
+	/**
+	 * enable the adaptive timestepping with an update every 'interval' simulation steps (0 to disable)
+	 *
+	 * only supported for the automatically computed timestep
+	 */
+	void setupAdaptiveTimestep(size_t interval)
+	{
+		adaptive_timestep_interval = interval;
+
+		if (adaptive_timestep_interval != 0 && !params.compute_timestep)
+		{
+			if (verbose)
+				std::cout << "adaptive timestep disabled: the timestep was specified" << std::endl;
+			adaptive_timestep_interval = 0;
+		}
+
+		if (adaptive_timestep_interval == 0 && params.timestep_scale != (T)1.0)
+		{
+			T old_timestep = params.d_timestep;
+			T old_tau = params.tau;
+
+			params.setTimestepScale(1.0);
+			params.computeParametrization();
+			setKernelArguments();
+
+			rescaleDensityDistributions(params.d_timestep/old_timestep, (params.d_timestep*params.tau)/(old_timestep*old_tau));
+		}
+	}
+
+	/**
+	 * update the timestep based on the maximum velocity in the domain
+	 *
+	 * this method has to be called after each simulation step and does nothing
+	 * if the adaptive timestepping is disabled or no update is due.
+	 */
+	void updateAdaptiveTimestep()
+	{
+		if (adaptive_timestep_interval == 0 || simulation_step_counter % adaptive_timestep_interval != 0)
+			return;
+
+		// the lattice velocity is proportional to the timestep
+		T max_velocity = CMath::sqrt<T>(getMaxVelocity());
+
+		T change;
+		if (max_velocity*(T)LBM_ADAPTIVE_TIMESTEP_MAX_CHANGE < (T)LBM_ADAPTIVE_TIMESTEP_TARGET_VELOCITY)
+			change = LBM_ADAPTIVE_TIMESTEP_MAX_CHANGE;
+		else
+			change = CMath::max<T>((T)LBM_ADAPTIVE_TIMESTEP_TARGET_VELOCITY/max_velocity, (T)1.0/(T)LBM_ADAPTIVE_TIMESTEP_MAX_CHANGE);
+
+		T timestep_scale = CMath::min<T>(CMath::max<T>(params.timestep_scale*change, LBM_ADAPTIVE_TIMESTEP_MIN_SCALE), LBM_ADAPTIVE_TIMESTEP_MAX_SCALE);
+
+		// avoid recomputations for tiny changes
+		if (CMath::abs(timestep_scale - params.timestep_scale) < (T)0.01*params.timestep_scale)
+			return;
+
+		T old_timestep = params.d_timestep;
+		T old_tau = params.tau;
+
+		params.setTimestepScale(timestep_scale);
+		params.computeParametrization();
+		setKernelArguments();
+
+		// keep the physical velocity and the viscous stress of the current state
+		rescaleDensityDistributions(params.d_timestep/old_timestep, (params.d_timestep*params.tau)/(old_timestep*old_tau));
+
+		if (verbose)
+			std::cout << "adaptive timestep: max velocity " << max_velocity << ", timestep scale " << timestep_scale << ", timestep " << params.d_timestep << std::endl;
+	}
+
 	/**
 	 * setup the initialization flags
 	 */
@@ -755,7 +1615,8 @@ public:
 	/**
 	 * update the arguments for the kernels
 	 *
-	 * this method is usually called after updating gravitation, viscosity or other parameters or during the initialization/reset
+	 * this method is usually called after updating gravitation, viscosity or other parameters or during the initialization/reset.
+	 * the scalar parameters are read from the constant parameter buffer, thus implementations usually only call updateParamsBuffer().
 	 */
     virtual void setKernelArguments() = 0;
 
@@ -769,6 +1630,17 @@ public:
 	 */
 	virtual void simulationStep() = 0;
 
+	/**
+	 * start 'steps' simulation steps (enqueue kernels)
+	 *
+	 * implementations with a fixed sequence of kernel launches may replay the launches without any setup.
+	 */
+	virtual void simulationSteps(int steps)
+	{
+		for (int i = 0; i < steps; i++)
+			simulationStep();
+	}
+
 	/**
 	 * reload the simulation programs
 	 */
@@ -848,8 +1720,201 @@ public:
 	}
 #endif
 
+	/**
+	 * return the global work group size to launch a kernel with the local work group size
+	 * for all items of global_work_group_size.
+	 *
+	 * the global work group size is rounded up to a multiple of the local work group size, thus the
+	 * kernels have to skip the work items beyond the domain (see DOMAIN_RANGE_CHECK).
+	 */
+	static cl::NDRange getPaddedGlobalWorkGroupSize(	const cl::NDRange &global_work_group_size,	///< number of work items to launch
+														const cl::NDRange &local_work_group_size	///< local work group size of kernel
+	)
+	{
+		size_t local_size = local_work_group_size[0];
+		if (local_size == 0)
+			return global_work_group_size;
+
+		return cl::NDRange(((global_work_group_size[0] + local_size - 1) / local_size) * local_size);
+	}
+
+	/**
+	 * check the local work group size of a kernel which exchanges data between the work items in local memory.
+	 *
+	 * such kernels are launched with the padded global work group size as well. the work items beyond the
+	 * domain process the periodic continuation of the domain (see GET_PADDED_CELL_ID) and skip their stores.
+	 * with LBM_GHOST_LAYER they process the ghost cells instead, thus the padding and the adjacent cells
+	 * accessed by the padding work items have to fit into the ghost layer after the domain.
+	 */
+	void checkPaddedWorkGroupSize(	const cl::NDRange &local_work_group_size,	///< local work group size of kernel
+									const char *kernel_name						///< name of kernel for error output
+	)
+	{
+#if LBM_GHOST_LAYER
+		size_t local_size = local_work_group_size[0];
+		if (local_size > ghost_cells/2)
+			error << "local work group size " << local_size << " of " << kernel_name << " exceeds the ghost layer of " << ghost_cells/2 << " cells" << std::endl;
+#endif
+	}
+
+#if LBM_PROGRAM_CACHE
+	/**
+	 * append the content of the file to o_source and replace all #include "..." directives recursively
+	 * with the content of the included files. every file is expanded only once.
+	 *
+	 * this is only used to compute the hash of the program, the program is still built from the
+	 * original sources by the OpenCL compiler.
+	 */
+	bool expandProgramSource(	const std::string &filename,		///< filename of program or header
+								std::set<std::string> &expanded_files,	///< files which were already expanded
+								std::string &o_source				///< expanded source
+	)
+	{
+		if (!expanded_files.insert(filename).second)
+			return true;
+
+		std::ifstream file(filename.c_str());
+		if (!file.is_open())
+			return false;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t pos = line.find_first_not_of(" \t");
+			if (pos != std::string::npos && line.compare(pos, 8, "#include") == 0)
+			{
+				size_t start = line.find('"', pos);
+				size_t end = (start == std::string::npos ? std::string::npos : line.find('"', start+1));
+
+				if (end != std::string::npos)
+				{
+					if (!expandProgramSource(line.substr(start+1, end-start-1), expanded_files, o_source))
+						return false;
+					continue;
+				}
+			}
+
+			o_source += line;
+			o_source += "\n";
+		}
+
+		return true;
+	}
+
+	/**
+	 * 64 bit FNV-1a hash
+	 */
+	static unsigned long long hashString(	const std::string &data,
+											unsigned long long hash = 14695981039346656037ULL
+	)
+	{
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	/**
+	 * return the filename of the cached binary for the program or an empty string if the program
+	 * source could not be expanded
+	 */
+	std::string getProgramCacheFilename(	const char *filename,					///< filename of program
+											const std::string &source,				///< source handed over to the compiler
+											const std::string &ocl_build_parameters	///< build options
+	)
+	{
+		std::string expanded_source;
+		std::set<std::string> expanded_files;
+		if (!expandProgramSource(filename, expanded_files, expanded_source))
+			return "";
+
+		unsigned long long hash = hashString(expanded_source);
+		hash = hashString(source, hash);
+		hash = hashString(ocl_build_parameters, hash);
+		hash = hashString(this->cl.cDevice.template getInfo<CL_DEVICE_NAME>(), hash);
+		hash = hashString(this->cl.cDevice.template getInfo<CL_DRIVER_VERSION>(), hash);
+
+		// use the filename of the program without directory and extension as prefix for better readability
+		std::string name = filename;
+		size_t pos = name.find_last_of('/');
+		if (pos != std::string::npos)
+			name = name.substr(pos+1);
+		pos = name.find_last_of('.');
+		if (pos != std::string::npos)
+			name = name.substr(0, pos);
+
+		std::ostringstream cache_filename;
+		cache_filename << LBM_PROGRAM_CACHE_DIR << "/" << name << "_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+		return cache_filename.str();
+	}
+
+	/**
+	 * try to create the program from the cached binary. the program still has to be built.
+	 *
+	 * \return true, if the program was successfully created from the cached binary
+	 */
+	bool createProgramFromCache(	cl::Program &ccl_program,					///< reference to cl program handler to load program to
+									const std::string &cache_filename			///< filename of cached binary
+	)
+	{
+		std::ifstream file(cache_filename.c_str(), std::ios::in | std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		std::vector<unsigned char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (binary.empty())
+			return false;
+
+		cl::Program::Binaries binaries(1, binary);
+		std::vector<cl_int> binary_status;
+		cl_int err;
+
+		ccl_program = cl::Program(this->cl.cContext, std::vector<cl::Device>(1,this->cl.cDevice), binaries, &binary_status, &err);
+		return err == CL_SUCCESS && binary_status.size() == 1 && binary_status[0] == CL_SUCCESS;
+	}
+
+	/**
+	 * store the binary of the built program to the cache. failures are ignored since the program is
+	 * simply rebuilt from source on the next start.
+	 */
+	void storeProgramToCache(	cl::Program &ccl_program,					///< built program
+								const std::string &cache_filename			///< filename of cached binary
+	)
+	{
+		cl_int err;
+		cl::Program::Binaries binaries = ccl_program.getInfo<CL_PROGRAM_BINARIES>(&err);
+		if (err != CL_SUCCESS || binaries.size() != 1 || binaries[0].empty())
+			return;
+
+		mkdir(LBM_PROGRAM_CACHE_DIR, 0755);
+
+		// write to a temporary file first to avoid partially written binaries
+		std::string tmp_filename = cache_filename + ".tmp";
+		std::ofstream file(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return;
+
+		file.write((const char*)&binaries[0][0], binaries[0].size());
+		file.close();
+
+		if (file.fail())
+		{
+			remove(tmp_filename.c_str());
+			return;
+		}
+
+		rename(tmp_filename.c_str(), cache_filename.c_str());
+	}
+#endif
+
 	/**
 	 * utility fuction: load a program
+	 *
+	 * the program is only created here and built by finishProgramBuilds() concurrently with the other
+	 * programs loaded since the last call. finishProgramBuilds() has to be called before kernels are
+	 * created from the program and before ccl_program goes out of scope.
 	 */
 	void loadProgram(	cl::Program &ccl_program,					///< reference to cl program handler to load program to
 						const cl::NDRange &ccl_kernel_work_group_size,	///< work group size for initialization
@@ -867,38 +1932,95 @@ public:
 //		ccl_program_defines_param << "#define LOCAL_WORK_GROUP_SIZE	(" << getMaxWorkGroupSize(ccl_kernel_work_group_size, !test_local_work_group_size) << ")" << std::endl;
 		ccl_program_defines_param << "#define LOCAL_WORK_GROUP_SIZE	(" << ccl_kernel_work_group_size[0] << ")" << std::endl;
 
+		CProgramBuild program_build;
+		program_build.program = &ccl_program;
+		program_build.filename = filename;
+		program_build.from_cache = false;
+		program_build.err = CL_SUCCESS;
+
 		/*
 		 * load program by #include preprocessor directive
 		 */
-		std::string source = ccl_program_defines_param.str();
-		source += "\n";
-		source += "#include \"";
-		source += filename;
-		source += "\"";
-
-		ccl_program = cl::Program(this->cl.cContext, source);
-
-		std::string ocl_build_parameters = "";
-		ocl_build_parameters += "-I ./";
+		program_build.source = ccl_program_defines_param.str();
+		program_build.source += "\n";
+		program_build.source += "#include \"";
+		program_build.source += filename;
+		program_build.source += "\"";
+
+		program_build.build_parameters = "";
+		program_build.build_parameters += "-I ./";
 		if (ccl_kernel_max_registers != 0)
 		{
 			/* TODO: check for cl_nv_compiler_options extension */
 			std::stringstream out;
 			out << ccl_kernel_max_registers;
-			ocl_build_parameters += " -cl-nv-maxrregcount=";
-			ocl_build_parameters += out.str();
-			ocl_build_parameters += " ";
-			ocl_build_parameters += " -cl-nv-opt-level=0 ";
+			program_build.build_parameters += " -cl-nv-maxrregcount=";
+			program_build.build_parameters += out.str();
+			program_build.build_parameters += " ";
+			program_build.build_parameters += " -cl-nv-opt-level=0 ";
 		}
 
-		cl_int err = ccl_program.build(std::vector<cl::Device>(1,this->cl.cDevice), ocl_build_parameters.c_str());
-		if (err != CL_SUCCESS)
+#if LBM_PROGRAM_CACHE
+		program_build.cache_filename = getProgramCacheFilename(filename, program_build.source, program_build.build_parameters);
+
+		if (!program_build.cache_filename.empty() && createProgramFromCache(ccl_program, program_build.cache_filename))
 		{
-			this->error << "failed to compile " << filename << CError::endl;
-			this->error << ccl_program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(this->cl.cDevice) << CError::endl;
+			if (this->verbose)
+				std::cout << "using cached binary " << program_build.cache_filename << std::endl;
+			program_build.from_cache = true;
 		}
+#endif
+
+		if (!program_build.from_cache)
+			ccl_program = cl::Program(this->cl.cContext, program_build.source);
+
+		program_builds.push_back(program_build);
 	}
 
+	/**
+	 * build all programs loaded by loadProgram() since the last call.
+	 *
+	 * the programs are built concurrently by host threads, thus the time is bounded by the program
+	 * which takes longest to compile instead of the sum of all programs.
+	 */
+	void finishProgramBuilds()
+	{
+		if (program_builds.empty())
+			return;
+
+		std::vector<cl::Device> devices(1, this->cl.cDevice);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < (int)program_builds.size(); i++)
+			program_builds[i].err = program_builds[i].program->build(devices, program_builds[i].build_parameters.c_str());
+
+		for (size_t i = 0; i < program_builds.size(); i++)
+		{
+			CProgramBuild &program_build = program_builds[i];
+
+			// cached binary was not accepted by the driver => rebuild from source
+			if (program_build.err != CL_SUCCESS && program_build.from_cache)
+			{
+				*program_build.program = cl::Program(this->cl.cContext, program_build.source);
+				program_build.err = program_build.program->build(devices, program_build.build_parameters.c_str());
+				program_build.from_cache = false;
+			}
+
+			if (program_build.err != CL_SUCCESS)
+			{
+				this->error << "failed to compile " << program_build.filename << CError::endl;
+				this->error << program_build.program->template getBuildInfo<CL_PROGRAM_BUILD_LOG>(this->cl.cDevice) << CError::endl;
+				continue;
+			}
+
+#if LBM_PROGRAM_CACHE
+			if (!program_build.from_cache && !program_build.cache_filename.empty())
+				storeProgramToCache(*program_build.program, program_build.cache_filename);
+#endif
+		}
+
+		program_builds.clear();
+	}
 
 
 
@@ -1488,6 +2610,18 @@ public:
 
 
 
+#define CLBM_CREATE_KERNEL_5(ccl_kernel, ccl_program, function_name, a, b, c, d, e)	\
+		CLBM_CREATE_KERNEL_Header(ccl_kernel, ccl_program, function_name)		\
+																		\
+		ccl_kernel.setArg(0, a);										\
+		ccl_kernel.setArg(1, b);										\
+		ccl_kernel.setArg(2, c);										\
+		ccl_kernel.setArg(3, d);										\
+		ccl_kernel.setArg(4, e);										\
+																		\
+		CLBM_CREATE_KERNEL_Footer(ccl_kernel, ccl_program, function_name)
+
+
 #define CLBM_CREATE_KERNEL_7(ccl_kernel, ccl_program, function_name, a, b, c, d, e, f, g)	\
 		CLBM_CREATE_KERNEL_Header(ccl_kernel, ccl_program, function_name)		\
 																		\
@@ -1502,6 +2636,39 @@ public:
 		CLBM_CREATE_KERNEL_Footer(ccl_kernel, ccl_program, function_name)
 
 
+#define CLBM_CREATE_KERNEL_9(ccl_kernel, ccl_program, function_name, a, b, c, d, e, f, g, h, i)	\
+		CLBM_CREATE_KERNEL_Header(ccl_kernel, ccl_program, function_name)		\
+																		\
+		ccl_kernel.setArg(0, a);										\
+		ccl_kernel.setArg(1, b);										\
+		ccl_kernel.setArg(2, c);										\
+		ccl_kernel.setArg(3, d);										\
+		ccl_kernel.setArg(4, e);										\
+		ccl_kernel.setArg(5, f);										\
+		ccl_kernel.setArg(6, g);										\
+		ccl_kernel.setArg(7, h);										\
+		ccl_kernel.setArg(8, i);										\
+																		\
+		CLBM_CREATE_KERNEL_Footer(ccl_kernel, ccl_program, function_name)
+
+
+#define CLBM_CREATE_KERNEL_10(ccl_kernel, ccl_program, function_name, a, b, c, d, e, f, g, h, i, j)	\
+		CLBM_CREATE_KERNEL_Header(ccl_kernel, ccl_program, function_name)		\
+																		\
+		ccl_kernel.setArg(0, a);										\
+		ccl_kernel.setArg(1, b);										\
+		ccl_kernel.setArg(2, c);										\
+		ccl_kernel.setArg(3, d);										\
+		ccl_kernel.setArg(4, e);										\
+		ccl_kernel.setArg(5, f);										\
+		ccl_kernel.setArg(6, g);										\
+		ccl_kernel.setArg(7, h);										\
+		ccl_kernel.setArg(8, i);										\
+		ccl_kernel.setArg(9, j);										\
+																		\
+		CLBM_CREATE_KERNEL_Footer(ccl_kernel, ccl_program, function_name)
+
+
 #define CLBM_CREATE_KERNEL_13(ccl_kernel, ccl_program, function_name, a, b, c, d, e, f, g, h, i, j, k, l, m)	\
 		CLBM_CREATE_KERNEL_Header(ccl_kernel, ccl_program, function_name)	\
 																\
@@ -0,0 +1,781 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLBM_OPENCL_MULTI_DEVICE_HPP
+#define CLBM_OPENCL_MULTI_DEVICE_HPP
+
+#include "CLbmParameters.hpp"
+#include "CLbmOpenClInterface.hpp"
+#include "CLbmOpenClAB_1.hpp"
+#include "libopencl/CCLSkeleton.hpp"
+#include "lib/CError.hpp"
+#include <vector>
+#include <string.h>
+
+#if LBM_AB_TEST_WITH_AA_1_KERNEL
+	#error "the multi device implementation does not support LBM_AB_TEST_WITH_AA_1_KERNEL"
+#endif
+
+/**
+ * number of layers which each subdomain stores of each neighboring subdomain.
+ *
+ * the halo layers receive the results of the collision and propagation of the neighbors and the flag
+ * conversions are simulated redundantly, thus they have to be exchanged only once per simulation step.
+ * each kernel after the exchange which reads neighboring cells invalidates one more layer from the
+ * subdomain border (4 flag conversions, gas to interface) and the next collision reads one more layer.
+ */
+#ifndef LBM_MULTI_DEVICE_HALO_LAYERS
+	#define LBM_MULTI_DEVICE_HALO_LAYERS	6
+#endif
+
+/**
+ * number of simulation steps between rebalancing the subdomain sizes with the measured times (0: disabled)
+ */
+#ifndef LBM_MULTI_DEVICE_REBALANCE_INTERVAL
+	#define LBM_MULTI_DEVICE_REBALANCE_INTERVAL	200
+#endif
+
+/**
+ * minimum relative change of the size of a subdomain to rebalance the subdomains.
+ * rebalancing creates new subdomains and thus rebuilds the programs for the new domain sizes.
+ */
+#define LBM_MULTI_DEVICE_REBALANCE_THRESHOLD	0.1
+
+/**
+ * OpenCL implementation for lattice boltzmann method with a domain decomposition to several devices
+ *
+ * the domain is split to slabs in z direction. each slab (subdomain) is simulated by the A-B
+ * implementation (version 1) with its own buffers and command queue on its own device (or sub-device).
+ *
+ * in each simulation step, the collision and propagation of the boundary layers of each subdomain is
+ * computed first. these layers are copied to the halo layers of the neighboring subdomains with a second
+ * command queue of each device while the interior layers are computed. the flag conversions of a
+ * subdomain start after its halo layers were received and the neighbors have read its boundary layers.
+ */
+template <typename T>
+class CLbmOpenClMultiDevice	:
+	public CLbmOpenClInterface<T>
+{
+	using CLbmOpenClInterface<T>::initInterface;
+
+	typedef CLbmOpenClAB_1<T> CSubdomain;
+
+private:
+	int number_of_devices;						///< number of devices (and subdomains)
+	std::vector<CCLSkeleton> subdomain_cl;		///< OpenCL skeletons of the devices
+	std::vector<cl::CommandQueue> transfer_queues;	///< command queues of the devices for the halo exchange
+
+	std::vector<CSubdomain*> subdomains;		///< simulations of the subdomains
+	std::vector<int> subdomain_layers;			///< number of layers simulated by each subdomain (without halo layers)
+	std::vector<int> subdomain_offsets;			///< first layer of each subdomain in the global domain
+
+	std::vector<cl::Event> boundary_events;		///< events after the collision of the boundary layers of each subdomain
+	std::vector<cl::Event> exchange_events;		///< events after the copies to the halo layers of each subdomain
+
+	std::vector<std::vector<cl::Event> > step_start_events;	///< events before the computations of each subdomain since the last rebalancing (only with rebalancing)
+	std::vector<std::vector<cl::Event> > step_end_events;	///< events after the computations of each subdomain since the last rebalancing (only with rebalancing)
+
+	size_t max_local_work_group_size;
+	T d_timestep_param;							///< timestep handed over to init() (-1 for automatic computation)
+
+public:
+	/**
+	 * Setup class with OpenCL skeleton.
+	 *
+	 * No simulation kernels are loaded in this constructor!
+	 */
+	CLbmOpenClMultiDevice(	const CCLSkeleton &cClSkeleton,
+							int p_number_of_devices,
+							bool p_verbose = false
+	)	:
+		CLbmOpenClInterface<T>(cClSkeleton, p_verbose),
+		number_of_devices(p_number_of_devices)
+	{
+	}
+
+	~CLbmOpenClMultiDevice()
+	{
+		deleteSubdomains(subdomains);
+	}
+
+
+	/**
+	 * initialize simulation with given parameters
+	 */
+	void init(	CVector<3,int> &p_domain_cells,			///< domain cells in each dimension
+				T p_d_domain_x_length,					///< domain length in x direction
+				T p_d_viscosity,						///< viscocity of fluid
+				CVector<3,T> &p_d_gravitation,			///< gravitation
+				T p_max_sim_gravitation_length,			///< maximum length of gravitation to limit timestep
+				T p_d_timestep,							///< timestep for one simulation step - computed automagically
+				T p_mass_exchange_factor,				///< mass exchange
+
+				size_t p_max_local_work_group_size,		///< maximum count of computation kernels (threads) used on gpu
+
+				int init_flags,							///< flags for first initialization
+
+				std::list<int> &p_lbm_opencl_number_of_threads_list,		///< list with number of threads for each successively created kernel
+				std::list<int> &p_lbm_opencl_number_of_registers_list		///< list with number of registers for each thread threads for each successively created kernel
+		)
+	{
+		max_local_work_group_size = p_max_local_work_group_size;
+		d_timestep_param = p_d_timestep;
+
+		initInterface(			p_domain_cells,
+								p_d_domain_x_length,
+								p_d_viscosity,
+								p_d_gravitation,
+								p_max_sim_gravitation_length,
+								p_d_timestep,
+								p_mass_exchange_factor,
+								p_lbm_opencl_number_of_threads_list,
+								p_lbm_opencl_number_of_registers_list
+							);
+		if (this->error())
+			return;
+
+		this->domain_cells_count = this->params.domain_cells.elements();
+
+		if (number_of_devices < 1 || number_of_devices*LBM_MULTI_DEVICE_HALO_LAYERS > this->params.domain_cells[2])
+		{
+			this->error << "each of the " << number_of_devices << " subdomains needs at least " << LBM_MULTI_DEVICE_HALO_LAYERS << " layers in z direction" << std::endl;
+			return;
+		}
+
+#if LBM_DD_BLOCK_SIZE
+		// the layers have to start at a block boundary to copy them at once
+		if (LBM_GHOST_LAYER || (this->params.domain_cells[0]*this->params.domain_cells[1]) % LBM_DD_BLOCK_SIZE != 0)
+		{
+			this->error << "the decomposed domain needs a slice size which is a multiple of the dd block size " << LBM_DD_BLOCK_SIZE << " and no ghost layer" << std::endl;
+			return;
+		}
+#endif
+
+		this->cl.initMultiDeviceSkeletons(number_of_devices, subdomain_cl);
+		if (this->cl.error())
+		{
+			this->error << this->cl.error.getString();
+			return;
+		}
+
+		transfer_queues.clear();
+		for (int i = 0; i < number_of_devices; i++)
+		{
+			// keep the properties (e. g. profiling) of the queue of the device
+			cl_command_queue_properties properties;
+			CL_CHECK_ERROR(subdomain_cl[i].cCommandQueue.getInfo(CL_QUEUE_PROPERTIES, &properties));
+
+			cl_int err;
+			cl::CommandQueue queue(subdomain_cl[i].cContext, subdomain_cl[i].cDevice, properties, &err);
+			if (err != CL_SUCCESS)
+			{
+				this->error << "failed to create the transfer queue of device " << i << ": " << cclGetErrorString(err) << std::endl;
+				return;
+			}
+			transfer_queues.push_back(queue);
+		}
+
+		// start with subdomains of the same size
+		int layers = this->params.domain_cells[2] / number_of_devices;
+		int remaining_layers = this->params.domain_cells[2] % number_of_devices;
+
+		subdomain_layers.resize(number_of_devices);
+		for (int i = 0; i < number_of_devices; i++)
+			subdomain_layers[i] = layers + (i < remaining_layers ? 1 : 0);
+
+		reload();
+
+		this->setupInitFlags(init_flags);
+		resetFluid();
+	}
+
+	/**
+	 * create the subdomains with the sizes subdomain_layers
+	 */
+	void reload()
+	{
+		deleteSubdomains(subdomains);
+
+		subdomain_offsets = getOffsets(subdomain_layers);
+
+		for (int i = 0; i < number_of_devices; i++)
+		{
+			CSubdomain *subdomain = createSubdomain(i, subdomain_layers[i], subdomain_offsets[i]);
+			subdomains.push_back(subdomain);
+			CError_AppendReturnThis((*subdomain));
+		}
+
+		boundary_events.resize(number_of_devices);
+		exchange_events.resize(number_of_devices);
+
+		step_start_events.assign(number_of_devices, std::vector<cl::Event>());
+		step_end_events.assign(number_of_devices, std::vector<cl::Event>());
+	}
+
+	/**
+	 * update the parametrization of the subdomains
+	 */
+	void setKernelArguments()
+	{
+		for (size_t i = 0; i < subdomains.size(); i++)
+		{
+			CSubdomain &subdomain = *subdomains[i];
+			subdomain.params.copyParametrization(this->params);
+			subdomain.setKernelArguments();
+			CError_AppendReturnThis(subdomain);
+		}
+	}
+
+	/**
+	 * store the velocity and density of all cells of the subdomains in each simulation step
+	 */
+	void setStoreMacroscopic(bool p_store_macroscopic)
+	{
+		this->store_macroscopic = p_store_macroscopic;
+
+		for (size_t i = 0; i < subdomains.size(); i++)
+		{
+			subdomains[i]->setStoreMacroscopic(p_store_macroscopic);
+			CError_AppendReturnThis((*subdomains[i]));
+		}
+	}
+
+	/**
+	 * reset the fluid to it's initial state
+	 */
+	void resetFluid()
+	{
+		if (this->error())
+			return;
+
+		for (size_t i = 0; i < subdomains.size(); i++)
+		{
+			subdomains[i]->setupInitFlags(this->fluid_init_flags);
+			subdomains[i]->resetFluid();
+		}
+
+		// the halo layers are initialized by each subdomain itself
+		for (size_t i = 0; i < subdomains.size(); i++)
+		{
+			step_start_events[i].clear();
+			step_end_events[i].clear();
+		}
+
+		this->resetFluid_Interface();
+	}
+
+	/**
+	 * rescale the density distributions after a change of the timestep
+	 */
+	void rescaleDensityDistributions(T velocity_scale, T non_equilibrium_scale)
+	{
+		for (size_t i = 0; i < subdomains.size(); i++)
+			subdomains[i]->rescaleDensityDistributions(velocity_scale, non_equilibrium_scale);
+	}
+
+	/**
+	 * scale the mass in each cell to stabilize the overall amount of mass in the simulation
+	 */
+	void scaleMass(T mass_scale_factor)
+	{
+		for (size_t i = 0; i < subdomains.size(); i++)
+			subdomains[i]->scaleMass(mass_scale_factor);
+	}
+
+	/**
+	 * start one simulation step (enqueue kernels)
+	 */
+	void simulationStep()
+	{
+		int n = (int)subdomains.size();
+
+		/*
+		 * collision and propagation, the boundary layers first
+		 */
+		for (int i = 0; i < n; i++)
+		{
+			cl::CommandQueue &queue = subdomains[i]->cl.cCommandQueue;
+
+			if (LBM_MULTI_DEVICE_REBALANCE_INTERVAL != 0)
+			{
+				cl::Event start_event;
+				CL_CHECK_ERROR(queue.enqueueMarkerWithWaitList(NULL, &start_event));
+				step_start_events[i].push_back(start_event);
+			}
+
+			subdomains[i]->enqueueCollisionBoundaryFirst(boundary_events[i]);
+
+			if (LBM_MULTI_DEVICE_REBALANCE_INTERVAL != 0)
+			{
+				cl::Event end_event;
+				CL_CHECK_ERROR(queue.enqueueMarkerWithWaitList(NULL, &end_event));
+				step_end_events[i].push_back(end_event);
+			}
+
+			// start the computations before the next device is handled
+			queue.flush();
+		}
+
+		/*
+		 * copy the boundary layers of the neighbors to the halo layers while the interior layers are computed.
+		 * the copies also wait for the own boundary layers because their ranges are padded into the halo layers.
+		 */
+		for (int i = 0; i < n; i++)
+		{
+			int prev = (i+n-1) % n;
+			int next = (i+1) % n;
+
+			std::vector<cl::Event> wait_events;
+			wait_events.push_back(boundary_events[prev]);
+			wait_events.push_back(boundary_events[i]);
+			wait_events.push_back(boundary_events[next]);
+
+			cl::CommandQueue &queue = transfer_queues[i];
+
+			enqueueCopyLayers(*subdomains[prev], subdomain_layers[prev], *subdomains[i], 0, LBM_MULTI_DEVICE_HALO_LAYERS, true, queue, &wait_events);
+			enqueueCopyLayers(*subdomains[next], LBM_MULTI_DEVICE_HALO_LAYERS, *subdomains[i], LBM_MULTI_DEVICE_HALO_LAYERS + subdomain_layers[i], LBM_MULTI_DEVICE_HALO_LAYERS, true, queue, &wait_events);
+
+			CL_CHECK_ERROR(queue.enqueueMarkerWithWaitList(NULL, &exchange_events[i]));
+			queue.flush();
+		}
+
+		/*
+		 * flag conversions after the own halo layers were received and the neighbors have read the boundary layers
+		 */
+		for (int i = 0; i < n; i++)
+		{
+			cl::CommandQueue &queue = subdomains[i]->cl.cCommandQueue;
+
+			std::vector<cl::Event> wait_events;
+			wait_events.push_back(exchange_events[(i+n-1) % n]);
+			wait_events.push_back(exchange_events[i]);
+			wait_events.push_back(exchange_events[(i+1) % n]);
+			CL_CHECK_ERROR(queue.enqueueBarrierWithWaitList(&wait_events));
+
+			// the time waiting for the neighbors is not measured
+			if (LBM_MULTI_DEVICE_REBALANCE_INTERVAL != 0)
+			{
+				cl::Event start_event;
+				CL_CHECK_ERROR(queue.enqueueMarkerWithWaitList(NULL, &start_event));
+				step_start_events[i].push_back(start_event);
+			}
+
+			subdomains[i]->simulationStepFlagConversion();
+
+			if (LBM_MULTI_DEVICE_REBALANCE_INTERVAL != 0)
+			{
+				cl::Event end_event;
+				CL_CHECK_ERROR(queue.enqueueMarkerWithWaitList(NULL, &end_event));
+				step_end_events[i].push_back(end_event);
+			}
+
+			queue.flush();
+		}
+
+		this->simulation_step_counter++;
+
+		if (LBM_MULTI_DEVICE_REBALANCE_INTERVAL != 0 && this->simulation_step_counter % LBM_MULTI_DEVICE_REBALANCE_INTERVAL == 0)
+			rebalance();
+	}
+
+	/**
+	 * wait until all kernels of all devices have finished
+	 */
+	void wait()
+	{
+		for (size_t i = 0; i < subdomains.size(); i++)
+			subdomains[i]->wait();
+	}
+
+	/**
+	 * store the data of the subdomains to host memory
+	 */
+	void storeVelocity(T *dst)
+	{
+		storeSubdomains(&CLbmOpenClInterface<T>::storeVelocity, dst, 3);
+	}
+
+	void storeDensity(T *dst)
+	{
+		storeSubdomains(&CLbmOpenClInterface<T>::storeDensity, dst, 1);
+	}
+
+	void storeDensityDistributions(T *dst)
+	{
+		storeSubdomains(&CLbmOpenClInterface<T>::storeDensityDistributions, dst, this->SIZE_DD_HOST);
+	}
+
+	void storeMass(T *dst)
+	{
+		storeSubdomains(&CLbmOpenClInterface<T>::storeMass, dst, 1);
+	}
+
+	void storeFraction(T *dst)
+	{
+		storeSubdomains(&CLbmOpenClInterface<T>::storeFraction, dst, 1);
+	}
+
+	void storeFlags(cl_int *dst)
+	{
+		storeSubdomains(&CLbmOpenClInterface<T>::storeFlags, dst, 1);
+	}
+
+	/**
+	 * reductions over all subdomains (the subdomains skip their halo layers)
+	 */
+	T getMassReduction()
+	{
+		T sum = (T)0.0;
+		for (size_t i = 0; i < subdomains.size(); i++)
+			sum += subdomains[i]->getMassReduction();
+		return sum;
+	}
+
+	float getVelocityChecksum()
+	{
+		float checksum = 0.0;
+		for (size_t i = 0; i < subdomains.size(); i++)
+			checksum += subdomains[i]->getVelocityChecksum();
+		return checksum;
+	}
+
+	float getDensityChecksum()
+	{
+		float checksum = 0.0;
+		for (size_t i = 0; i < subdomains.size(); i++)
+			checksum += subdomains[i]->getDensityChecksum();
+		return checksum;
+	}
+
+	size_t getDeviceMemoryFootprint()
+	{
+		size_t bytes = 0;
+		for (size_t i = 0; i < subdomains.size(); i++)
+			bytes += subdomains[i]->getDeviceMemoryFootprint();
+		return bytes;
+	}
+
+	T getMaxVelocity()
+	{
+		T max_vel_2 = 0.0;
+		for (size_t i = 0; i < subdomains.size(); i++)
+		{
+			T vel_2 = subdomains[i]->getMaxVelocity();
+			if (max_vel_2 < vel_2)
+				max_vel_2 = vel_2;
+		}
+		return max_vel_2;
+	}
+
+private:
+	/**
+	 * return the first layer of each subdomain
+	 */
+	static std::vector<int> getOffsets(const std::vector<int> &layers)
+	{
+		std::vector<int> offsets(layers.size());
+
+		int offset = 0;
+		for (size_t i = 0; i < layers.size(); i++)
+		{
+			offsets[i] = offset;
+			offset += layers[i];
+		}
+		return offsets;
+	}
+
+	/**
+	 * create and initialize the subdomain with 'layers' layers starting at layer 'offset' on device 'device'
+	 */
+	CSubdomain *createSubdomain(int device, int layers, int offset)
+	{
+		CSubdomain *subdomain = new CSubdomain(subdomain_cl[device], this->verbose);
+
+		subdomain->setupSubdomain(offset - LBM_MULTI_DEVICE_HALO_LAYERS, this->params.domain_cells[2], LBM_MULTI_DEVICE_HALO_LAYERS);
+
+		CVector<3,int> domain_cells(this->params.domain_cells[0], this->params.domain_cells[1], layers + 2*LBM_MULTI_DEVICE_HALO_LAYERS);
+
+		subdomain->init(	domain_cells,
+							this->params.d_domain_x_length,
+							this->params.d_viscosity,
+							this->params.d_gravitation,
+							this->params.max_sim_gravitation_length,
+							d_timestep_param,
+							this->params.mass_exchange_factor,
+							max_local_work_group_size,
+							this->fluid_init_flags,
+							this->lbm_opencl_number_of_threads_list,
+							this->lbm_opencl_number_of_registers_list
+						);
+
+		// the timestep computed by the subdomain depends on the domain size
+		subdomain->params.copyParametrization(this->params);
+		subdomain->store_macroscopic = this->store_macroscopic;
+		subdomain->setKernelArguments();
+
+		return subdomain;
+	}
+
+	/**
+	 * delete the subdomains
+	 */
+	void deleteSubdomains(std::vector<CSubdomain*> &p_subdomains)
+	{
+		for (size_t i = 0; i < p_subdomains.size(); i++)
+			delete p_subdomains[i];
+		p_subdomains.clear();
+	}
+
+	/**
+	 * enqueue the copy of 'layers' layers of all cell data from the subdomain 'src' to the subdomain 'dst'
+	 *
+	 * the copies are enqueued to 'queue' and wait for 'wait_events'.
+	 */
+	void enqueueCopyLayers(	CSubdomain &src,		///< source subdomain
+							int src_layer,			///< first layer in the source subdomain
+							CSubdomain &dst,		///< destination subdomain
+							int dst_layer,			///< first layer in the destination subdomain
+							int layers,				///< number of layers
+							bool step_output,		///< copy the buffers written by the simulation step in progress
+							cl::CommandQueue &queue,	///< command queue of the device of 'dst'
+							const std::vector<cl::Event> *wait_events	///< events to wait for
+	)
+	{
+		cl::Buffer &src_dd = (step_output ? src.getOutputDensityDistributionsMemObject() : src.getDensityDistributionsMemObject());
+		cl::Buffer &dst_dd = (step_output ? dst.getOutputDensityDistributionsMemObject() : dst.getDensityDistributionsMemObject());
+		cl::Buffer &src_flags = (step_output ? src.getOutputFlagsMemObject() : src.getFlagsMemObject());
+		cl::Buffer &dst_flags = (step_output ? dst.getOutputFlagsMemObject() : dst.getFlagsMemObject());
+		cl::Buffer &src_fraction = (step_output ? src.getOutputFluidFractionMemObject() : src.getFluidFractionMemObject());
+		cl::Buffer &dst_fraction = (step_output ? dst.getOutputFluidFractionMemObject() : dst.getFluidFractionMemObject());
+
+		size_t slice_cells = this->params.domain_cells[0]*this->params.domain_cells[1];
+		size_t src_cell = src_layer*slice_cells;
+		size_t dst_cell = dst_layer*slice_cells;
+		size_t cells = layers*slice_cells;
+
+		/*
+		 * density distributions
+		 */
+		size_t dd_bytes = (src.dd_half ? sizeof(cl_half) : sizeof(T));
+
+#if LBM_DD_BLOCK_SIZE
+		// the layers start at a block boundary, thus all directions are stored contiguously
+		CL_CHECK_ERROR(queue.enqueueCopyBuffer(	src_dd,
+												dst_dd,
+												src.getDDBufferIndex(src_cell, 0)*dd_bytes,
+												dst.getDDBufferIndex(dst_cell, 0)*dd_bytes,
+												cells*this->SIZE_DD_HOST*dd_bytes,
+												wait_events));
+#else
+		for (size_t i = 0; i < this->SIZE_DD_HOST; i++)
+		{
+			CL_CHECK_ERROR(queue.enqueueCopyBuffer(	src_dd,
+													dst_dd,
+													src.getDDBufferIndex(src_cell, i)*dd_bytes,
+													dst.getDDBufferIndex(dst_cell, i)*dd_bytes,
+													cells*dd_bytes,
+													wait_events));
+		}
+#endif
+
+		/*
+		 * cell buffers
+		 */
+		CL_CHECK_ERROR(queue.enqueueCopyBuffer(src_flags, dst_flags, src_cell*sizeof(cl_int), dst_cell*sizeof(cl_int), cells*sizeof(cl_int), wait_events));
+		CL_CHECK_ERROR(queue.enqueueCopyBuffer(src_fraction, dst_fraction, src_cell*sizeof(T), dst_cell*sizeof(T), cells*sizeof(T), wait_events));
+		CL_CHECK_ERROR(queue.enqueueCopyBuffer(src.cMemFluidMass, dst.cMemFluidMass, src_cell*sizeof(T), dst_cell*sizeof(T), cells*sizeof(T), wait_events));
+		CL_CHECK_ERROR(queue.enqueueCopyBuffer(src.cMemDensity, dst.cMemDensity, src_cell*sizeof(T), dst_cell*sizeof(T), cells*sizeof(T), wait_events));
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			CL_CHECK_ERROR(queue.enqueueCopyBuffer(	src.cMemVelocity,
+													dst.cMemVelocity,
+													(src_cell + c*src.domain_cells_count)*sizeof(T),
+													(dst_cell + c*dst.domain_cells_count)*sizeof(T),
+													cells*sizeof(T),
+													wait_events));
+		}
+	}
+
+	/**
+	 * store the inner layers of the subdomains to 'dst' with the store method 'store' of the subdomains
+	 */
+	template <typename D>
+	void storeSubdomains(	void (CLbmOpenClInterface<T>::*store)(D *),		///< store method of the subdomains
+							D *dst,								///< host memory for the global domain
+							int components						///< number of components stored with a stride of the domain cells
+	)
+	{
+		size_t slice_cells = this->params.domain_cells[0]*this->params.domain_cells[1];
+
+		for (size_t i = 0; i < subdomains.size(); i++)
+		{
+			CSubdomain &subdomain = *subdomains[i];
+
+			D *values = new D[subdomain.domain_cells_count*components];
+			(subdomain.*store)(values);
+
+			for (int c = 0; c < components; c++)
+				memcpy(	dst + c*this->domain_cells_count + subdomain_offsets[i]*slice_cells,
+						values + c*subdomain.domain_cells_count + LBM_MULTI_DEVICE_HALO_LAYERS*slice_cells,
+						subdomain_layers[i]*slice_cells*sizeof(D));
+
+			delete [] values;
+		}
+	}
+
+	/**
+	 * resize the subdomains proportional to the simulation speed of the devices measured since the last rebalancing
+	 */
+	void rebalance()
+	{
+		wait();
+
+		int n = (int)subdomains.size();
+		int domain_layers = this->params.domain_cells[2];
+
+		// layers per second for each device
+		std::vector<double> speed(n);
+		double total_speed = 0.0;
+
+		for (int i = 0; i < n; i++)
+		{
+			double seconds = 0.0;
+			for (size_t s = 0; s < step_start_events[i].size(); s++)
+			{
+				cl_ulong start, end;
+				step_start_events[i][s].getProfilingInfo(CL_PROFILING_COMMAND_END, &start);
+				step_end_events[i][s].getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+				seconds += (double)(end - start)*0.000000001;
+			}
+
+			speed[i] = (seconds > 0.0 ? (double)subdomain_layers[i]/seconds : 0.0);
+			total_speed += speed[i];
+		}
+
+		// clear the events of all devices before returning to keep the event lists bounded
+		for (int i = 0; i < n; i++)
+		{
+			step_start_events[i].clear();
+			step_end_events[i].clear();
+		}
+
+		for (int i = 0; i < n; i++)
+			if (speed[i] <= 0.0)
+				return;
+
+		std::vector<int> new_layers(n);
+		int layers_sum = 0;
+		int largest = 0;
+		double max_change = 0.0;
+
+		for (int i = 0; i < n; i++)
+		{
+			new_layers[i] = (int)((double)domain_layers*speed[i]/total_speed);
+			if (new_layers[i] < LBM_MULTI_DEVICE_HALO_LAYERS)
+				new_layers[i] = LBM_MULTI_DEVICE_HALO_LAYERS;
+
+			layers_sum += new_layers[i];
+			if (new_layers[i] > new_layers[largest])
+				largest = i;
+		}
+
+		// the rounding errors are assigned to the largest subdomain
+		new_layers[largest] += domain_layers - layers_sum;
+		if (new_layers[largest] < LBM_MULTI_DEVICE_HALO_LAYERS)
+			return;
+
+		for (int i = 0; i < n; i++)
+		{
+			double change = CMath::abs((double)(new_layers[i] - subdomain_layers[i]))/(double)subdomain_layers[i];
+			if (max_change < change)
+				max_change = change;
+		}
+
+		if (max_change < LBM_MULTI_DEVICE_REBALANCE_THRESHOLD)
+			return;
+
+		if (this->verbose)
+		{
+			std::cout << "rebalancing subdomain layers:";
+			for (int i = 0; i < n; i++)
+				std::cout << " " << subdomain_layers[i] << "->" << new_layers[i];
+			std::cout << std::endl;
+		}
+
+		migrateSubdomains(new_layers);
+	}
+
+	/**
+	 * replace the subdomains by subdomains with the sizes 'new_layers' and copy the cell data
+	 */
+	void migrateSubdomains(const std::vector<int> &new_layers)
+	{
+		int n = (int)subdomains.size();
+		int domain_layers = this->params.domain_cells[2];
+
+		std::vector<int> new_offsets = getOffsets(new_layers);
+		std::vector<CSubdomain*> new_subdomains;
+
+		for (int i = 0; i < n; i++)
+		{
+			new_subdomains.push_back(createSubdomain(i, new_layers[i], new_offsets[i]));
+
+			if (new_subdomains[i]->error())
+			{
+				this->error << new_subdomains[i]->error.getString();
+				deleteSubdomains(new_subdomains);
+				return;
+			}
+
+			// select the buffers of the current simulation step
+			new_subdomains[i]->simulation_step_counter = this->simulation_step_counter;
+		}
+
+		/*
+		 * copy all layers (including the halo layers) from the subdomains which simulate these layers
+		 */
+		for (int k = 0; k < n; k++)
+		{
+			int local_layers = new_layers[k] + 2*LBM_MULTI_DEVICE_HALO_LAYERS;
+
+			for (int l = 0; l < local_layers; )
+			{
+				int global_layer = (new_offsets[k] - LBM_MULTI_DEVICE_HALO_LAYERS + l + domain_layers) % domain_layers;
+
+				int j = 0;
+				while (global_layer >= subdomain_offsets[j] + subdomain_layers[j])
+					j++;
+
+				int layers = CMath::min<int>(local_layers - l, subdomain_offsets[j] + subdomain_layers[j] - global_layer);
+
+				enqueueCopyLayers(*subdomains[j], LBM_MULTI_DEVICE_HALO_LAYERS + global_layer - subdomain_offsets[j], *new_subdomains[k], l, layers, false, new_subdomains[k]->cl.cCommandQueue, NULL);
+				l += layers;
+			}
+		}
+
+		for (int k = 0; k < n; k++)
+			new_subdomains[k]->wait();
+
+		deleteSubdomains(subdomains);
+
+		subdomains = new_subdomains;
+		subdomain_layers = new_layers;
+		subdomain_offsets = new_offsets;
+	}
+};
+
+#endif
@@ -60,6 +60,7 @@ public:
 	T d_cell_length;			///< length of cell
 	T d_timestep;				///< timestep
 	bool compute_timestep;		///< true, if the timestep should be computes
+	T timestep_scale;			///< scaling of the computed timestep (adaptive timestepping)
 
 	// simulation values (parametrized dimensionless)
 	T viscosity;				///< parametrized viscosity of fluid
@@ -146,6 +147,8 @@ public:
 			{
 				d_timestep = CMath::sqrt<T>((max_sim_gravitation_length_scaled * d_cell_length) / d_gravitation_length);
 			}
+
+			d_timestep *= timestep_scale;
 		}
 		else
 		{
@@ -202,6 +205,16 @@ public:
 		d_viscosity = p_d_viscosity;
 	}
 
+	/**
+	 * set the scaling of the computed timestep
+	 *
+	 * after this function, computeParametrization() has to be called!
+	 */
+	void setTimestepScale(T p_timestep_scale)
+	{
+		timestep_scale = p_timestep_scale;
+	}
+
 	/**
 	 * set mass exchange factors
 	 */
@@ -222,6 +235,33 @@ public:
 		d_cell_length = d_domain_x_length / (T)domain_cells[0];
 	}
 
+	/**
+	 * copy the parametrization of another domain, only the domain size is kept
+	 *
+	 * this is used for subdomains which have to use the parametrization of the global domain.
+	 */
+	void copyParametrization(const CLbmParameters<T> &p)
+	{
+		d_domain_x_length = p.d_domain_x_length;
+		d_gravitation = p.d_gravitation;
+		d_viscosity = p.d_viscosity;
+		mass_exchange_factor = p.mass_exchange_factor;
+
+		d_cell_length = p.d_cell_length;
+		d_timestep = p.d_timestep;
+		compute_timestep = p.compute_timestep;
+		timestep_scale = p.timestep_scale;
+
+		viscosity = p.viscosity;
+		tau = p.tau;
+		inv_tau = p.inv_tau;
+		inv_trt_tau = p.inv_trt_tau;
+		gravitation = p.gravitation;
+
+		max_sim_gravitation_length = p.max_sim_gravitation_length;
+		max_sim_gravitation_length_scaled = p.max_sim_gravitation_length_scaled;
+	}
+
 	/**
 	 * initialize skeleton
 	 */
@@ -249,6 +289,7 @@ public:
 
 		d_timestep = p_d_timestep;
 		compute_timestep = (p_d_timestep < 0);
+		timestep_scale = 1.0;
 
 		max_sim_gravitation_length = p_max_sim_gravitation_length;
 		max_sim_gravitation_length_scaled = max_sim_gravitation_length/(T)domain_cells.max();
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CTRANSPORT_HPP
+#define CTRANSPORT_HPP
+
+#include "lib/CError.hpp"
+#include <vector>
+#include <cstddef>
+#include <string.h>
+
+/**
+ * \brief interface for the communication between cooperating processes (ranks)
+ *
+ * a backend has to provide the point to point operations. the messages between two
+ * ranks have to be received in the order they were sent.
+ * the collective operations are built on the point to point operations and have to
+ * be called by all ranks.
+ */
+class CTransport
+{
+public:
+	CError error;	///< error handler
+
+	int rank;		///< rank of this process
+	int size;		///< number of processes
+
+	CTransport()	:
+		rank(0),
+		size(1)
+	{
+	}
+
+	virtual ~CTransport()
+	{
+	}
+
+	/**
+	 * send 'bytes' bytes to rank 'dst_rank' (blocking)
+	 */
+	virtual void send(int dst_rank, const void *data, size_t bytes) = 0;
+
+	/**
+	 * receive 'bytes' bytes from rank 'src_rank' (blocking)
+	 */
+	virtual void recv(int src_rank, void *data, size_t bytes) = 0;
+
+	/**
+	 * send to 'dst_rank' and receive from 'src_rank' at the same time
+	 *
+	 * this avoids deadlocks when all ranks send to their neighbors before receiving.
+	 */
+	virtual void sendRecv(	int dst_rank, const void *send_data, size_t send_bytes,
+							int src_rank, void *recv_data, size_t recv_bytes) = 0;
+
+	/**
+	 * gather 'bytes' bytes of each rank in the order of the ranks to 'dst' of rank 0
+	 */
+	void gather(const void *data, size_t bytes, void *dst)
+	{
+		if (rank != 0)
+		{
+			send(0, data, bytes);
+			return;
+		}
+
+		memcpy(dst, data, bytes);
+		for (int r = 1; r < size; r++)
+			recv(r, (char*)dst + r*bytes, bytes);
+	}
+
+	/**
+	 * send 'bytes' bytes of rank 0 to all ranks
+	 */
+	void broadcast(void *data, size_t bytes)
+	{
+		if (rank != 0)
+		{
+			recv(0, data, bytes);
+			return;
+		}
+
+		for (int r = 1; r < size; r++)
+			send(r, data, bytes);
+	}
+
+	/**
+	 * return the sum of 'value' over all ranks
+	 */
+	double allReduceSum(double value)
+	{
+		std::vector<double> values(size);
+		gather(&value, sizeof(double), &values[0]);
+
+		double sum = 0.0;
+		for (int r = 0; r < size; r++)
+			sum += values[r];
+
+		broadcast(&sum, sizeof(double));
+		return sum;
+	}
+
+	/**
+	 * return the maximum of 'value' over all ranks
+	 */
+	double allReduceMax(double value)
+	{
+		std::vector<double> values(size);
+		gather(&value, sizeof(double), &values[0]);
+
+		double max = values[0];
+		for (int r = 1; r < size; r++)
+			if (max < values[r])
+				max = values[r];
+
+		broadcast(&max, sizeof(double));
+		return max;
+	}
+
+	/**
+	 * wait until all ranks reached the barrier
+	 */
+	void barrier()
+	{
+		allReduceSum(0.0);
+	}
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CTRANSPORT_UNIX_SOCKET_HPP
+#define CTRANSPORT_UNIX_SOCKET_HPP
+
+#include "lib/CTransport.hpp"
+#include <vector>
+#include <sstream>
+#include <string.h>
+#include <errno.h>
+
+extern "C"
+{
+	#include <unistd.h>
+	#include <poll.h>
+	#include <sys/types.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <sys/wait.h>
+}
+
+/**
+ * \brief transport between processes on one machine with unix domain sockets
+ *
+ * init() forks the processes, thus it has to be called before any OpenCL context
+ * or thread is created. each pair of ranks is connected with its own socket.
+ */
+class CTransportUnixSocket	:
+	public CTransport
+{
+	std::vector<int> sockets;		///< socket connected to each rank (-1 for this rank)
+	std::vector<pid_t> children;	///< processes forked by rank 0
+	pid_t pid_of_rank_0;			///< process id of rank 0 to create unique socket paths
+
+	/**
+	 * return the path of the listening socket of rank 'r'
+	 */
+	std::string getSocketPath(int r)
+	{
+		std::ostringstream path;
+		path << "/tmp/lbm_transport_" << pid_of_rank_0 << "_" << r;
+		return path.str();
+	}
+
+public:
+	CTransportUnixSocket()	:
+		pid_of_rank_0(0)
+	{
+	}
+
+	~CTransportUnixSocket()
+	{
+		for (size_t i = 0; i < sockets.size(); i++)
+			if (sockets[i] >= 0)
+				close(sockets[i]);
+
+		// wait for the other ranks to finish
+		for (size_t i = 0; i < children.size(); i++)
+			waitpid(children[i], NULL, 0);
+	}
+
+	/**
+	 * fork 'p_size'-1 processes and connect all ranks
+	 *
+	 * the calling process becomes rank 0.
+	 */
+	void init(int p_size)
+	{
+		size = p_size;
+		rank = 0;
+		pid_of_rank_0 = getpid();
+
+		sockets.assign(size, -1);
+
+		/*
+		 * create the listening sockets before forking to make them available for all ranks
+		 */
+		std::vector<int> listen_sockets(size, -1);
+
+		for (int r = 0; r < size; r++)
+		{
+			listen_sockets[r] = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (listen_sockets[r] < 0)
+			{
+				error << "socket: " << strerror(errno) << std::endl;
+				return;
+			}
+
+			struct sockaddr_un addr = getAddress(r);
+			unlink(addr.sun_path);
+
+			if (bind(listen_sockets[r], (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_sockets[r], size) < 0)
+			{
+				error << "bind/listen " << addr.sun_path << ": " << strerror(errno) << std::endl;
+				return;
+			}
+		}
+
+		for (int r = 1; r < size; r++)
+		{
+			pid_t pid = fork();
+			if (pid < 0)
+			{
+				error << "fork: " << strerror(errno) << std::endl;
+				return;
+			}
+
+			if (pid == 0)
+			{
+				rank = r;
+				children.clear();
+				break;
+			}
+			children.push_back(pid);
+		}
+
+		for (int r = 0; r < size; r++)
+			if (r != rank)
+				close(listen_sockets[r]);
+
+		/*
+		 * connect to all lower ranks and accept the connections of all higher ranks
+		 */
+		for (int r = 0; r < rank; r++)
+		{
+			sockets[r] = socket(AF_UNIX, SOCK_STREAM, 0);
+
+			struct sockaddr_un addr = getAddress(r);
+			if (sockets[r] < 0 || connect(sockets[r], (struct sockaddr*)&addr, sizeof(addr)) < 0)
+			{
+				error << "connect " << addr.sun_path << ": " << strerror(errno) << std::endl;
+				return;
+			}
+			send(r, &rank, sizeof(int));
+		}
+
+		for (int i = rank+1; i < size; i++)
+		{
+			int s = accept(listen_sockets[rank], NULL, NULL);
+			if (s < 0)
+			{
+				error << "accept: " << strerror(errno) << std::endl;
+				return;
+			}
+
+			int r;
+			if (!readAll(s, &r, sizeof(int)) || r <= rank || r >= size)
+			{
+				error << "invalid rank received from connected process" << std::endl;
+				return;
+			}
+			sockets[r] = s;
+		}
+
+		close(listen_sockets[rank]);
+		unlink(getSocketPath(rank).c_str());
+	}
+
+	void send(int dst_rank, const void *data, size_t bytes)
+	{
+		if (!writeAll(sockets[dst_rank], data, bytes))
+			error << "send to rank " << dst_rank << ": " << strerror(errno) << std::endl;
+	}
+
+	void recv(int src_rank, void *data, size_t bytes)
+	{
+		if (!readAll(sockets[src_rank], data, bytes))
+			error << "recv from rank " << src_rank << ": " << strerror(errno) << std::endl;
+	}
+
+	void sendRecv(	int dst_rank, const void *send_data, size_t send_bytes,
+					int src_rank, void *recv_data, size_t recv_bytes)
+	{
+		if (dst_rank == rank && src_rank == rank)
+		{
+			memcpy(recv_data, send_data, send_bytes);
+			return;
+		}
+
+		const char *send_ptr = (const char*)send_data;
+		char *recv_ptr = (char*)recv_data;
+
+		while (send_bytes > 0 || recv_bytes > 0)
+		{
+			struct pollfd fds[2];
+			fds[0].fd = sockets[dst_rank];
+			fds[0].events = (send_bytes > 0 ? POLLOUT : 0);
+			fds[1].fd = sockets[src_rank];
+			fds[1].events = (recv_bytes > 0 ? POLLIN : 0);
+
+			if (poll(fds, 2, -1) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				error << "poll: " << strerror(errno) << std::endl;
+				return;
+			}
+
+			if (send_bytes > 0 && (fds[0].revents & (POLLOUT | POLLERR | POLLHUP)))
+			{
+				ssize_t n = ::send(fds[0].fd, send_ptr, send_bytes, MSG_DONTWAIT | MSG_NOSIGNAL);
+				if (n < 0 && errno != EAGAIN && errno != EINTR)
+				{
+					error << "send to rank " << dst_rank << ": " << strerror(errno) << std::endl;
+					return;
+				}
+				if (n > 0)
+				{
+					send_ptr += n;
+					send_bytes -= n;
+				}
+			}
+
+			if (recv_bytes > 0 && (fds[1].revents & (POLLIN | POLLERR | POLLHUP)))
+			{
+				ssize_t n = ::recv(fds[1].fd, recv_ptr, recv_bytes, MSG_DONTWAIT);
+				if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+				{
+					error << "recv from rank " << src_rank << ": " << (n == 0 ? "connection closed" : strerror(errno)) << std::endl;
+					return;
+				}
+				if (n > 0)
+				{
+					recv_ptr += n;
+					recv_bytes -= n;
+				}
+			}
+		}
+	}
+
+private:
+	struct sockaddr_un getAddress(int r)
+	{
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, getSocketPath(r).c_str(), sizeof(addr.sun_path)-1);
+		return addr;
+	}
+
+	bool writeAll(int s, const void *data, size_t bytes)
+	{
+		const char *ptr = (const char*)data;
+		while (bytes > 0)
+		{
+			ssize_t n = ::send(s, ptr, bytes, MSG_NOSIGNAL);
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			ptr += n;
+			bytes -= n;
+		}
+		return true;
+	}
+
+	bool readAll(int s, void *data, size_t bytes)
+	{
+		char *ptr = (char*)data;
+		while (bytes > 0)
+		{
+			ssize_t n = ::recv(s, ptr, bytes, 0);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				return false;
+			ptr += n;
+			bytes -= n;
+		}
+		return true;
+	}
+};
+
+#endif
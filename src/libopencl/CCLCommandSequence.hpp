@@ -0,0 +1,289 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CCL_COMMAND_SEQUENCE_HPP
+#define CCL_COMMAND_SEQUENCE_HPP
+
+#include "libopencl/CCLSkeleton.hpp"
+#include "libopencl/CCLErrors.hpp"
+#include <vector>
+#include <string>
+
+/**
+ * \brief recorded sequence of kernel launches which is replayed without any setup
+ *
+ * the kernels are launched in the order of recording, each kernel after the previous one
+ * finished. the kernel arguments are read when the sequence is finalized, thus the
+ * sequence has to be recorded again after changing any argument.
+ *
+ * if the runtime supports cl_khr_command_buffer, the sequence is recorded to a command
+ * buffer and replayed with one enqueue. otherwise the pre-built list of launches is
+ * enqueued to the in order queue.
+ *
+ * a command buffer without simultaneous use cannot be enqueued while a previous replay is
+ * pending. if the device does not support CL_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR, the
+ * sequence is recorded to two command buffers which are replayed alternately, and a replay
+ * waits for the previous replay of the same command buffer.
+ */
+class CCLCommandSequence
+{
+	/**
+	 * one kernel launch
+	 */
+	class CDispatch
+	{
+	public:
+		cl::Kernel kernel;
+		cl::NDRange global;
+		cl::NDRange local;
+	};
+
+	std::vector<CDispatch> dispatches;	///< list of launches
+
+#ifdef cl_khr_command_buffer
+	cl_command_buffer_khr command_buffers[2];	///< command buffers with the launches, NULL if not available
+	cl::Event replay_events[2];				///< last replay of each command buffer without simultaneous use
+	bool simultaneous_use;					///< true, if one command buffer is enqueued while it is pending
+	int next_command_buffer;				///< command buffer of the next replay
+
+	clCreateCommandBufferKHR_fn clCreateCommandBufferKHR_ptr;
+	clCommandNDRangeKernelKHR_fn clCommandNDRangeKernelKHR_ptr;
+	clFinalizeCommandBufferKHR_fn clFinalizeCommandBufferKHR_ptr;
+	clEnqueueCommandBufferKHR_fn clEnqueueCommandBufferKHR_ptr;
+	clReleaseCommandBufferKHR_fn clReleaseCommandBufferKHR_ptr;
+
+	/**
+	 * record all launches to a new command buffer, return NULL on failure
+	 */
+	cl_command_buffer_khr recordCommandBuffer(	cl_command_queue queue,
+												const cl_command_buffer_properties_khr *properties
+	)
+	{
+		cl_int err;
+		cl_command_buffer_khr command_buffer = clCreateCommandBufferKHR_ptr(1, &queue, properties, &err);
+		if (err != CL_SUCCESS)
+			return NULL;
+
+		// the commands of a command buffer are not ordered, thus each launch waits for the previous one
+		cl_sync_point_khr sync_point = 0;
+		for (size_t i = 0; i < dispatches.size(); i++)
+		{
+			CDispatch &d = dispatches[i];
+
+			err = clCommandNDRangeKernelKHR_ptr(	command_buffer, NULL, NULL, d.kernel(),
+													(cl_uint)d.global.dimensions(), NULL, d.global,
+													(d.local.dimensions() == 0 ? NULL : (const size_t*)d.local),
+													(i == 0 ? 0 : 1), (i == 0 ? NULL : &sync_point), &sync_point, NULL
+												);
+			if (err != CL_SUCCESS)
+				break;
+		}
+
+		if (err == CL_SUCCESS)
+			err = clFinalizeCommandBufferKHR_ptr(command_buffer);
+
+		if (err != CL_SUCCESS)
+		{
+			clReleaseCommandBufferKHR_ptr(command_buffer);
+			return NULL;
+		}
+
+		return command_buffer;
+	}
+
+	/**
+	 * release the command buffers after their pending replays
+	 */
+	void releaseCommandBuffers()
+	{
+		for (int b = 0; b < 2; b++)
+		{
+			if (replay_events[b]() != NULL)
+			{
+				replay_events[b].wait();
+				replay_events[b] = cl::Event();
+			}
+
+			if (command_buffers[b] != NULL)
+			{
+				clReleaseCommandBufferKHR_ptr(command_buffers[b]);
+				command_buffers[b] = NULL;
+			}
+		}
+	}
+#endif
+
+public:
+	bool finalized;		///< true, if the sequence is recorded and can be enqueued
+
+	CCLCommandSequence()	:
+		finalized(false)
+	{
+#ifdef cl_khr_command_buffer
+		command_buffers[0] = NULL;
+		command_buffers[1] = NULL;
+		simultaneous_use = false;
+		next_command_buffer = 0;
+#endif
+	}
+
+	~CCLCommandSequence()
+	{
+		clear();
+	}
+
+	/**
+	 * remove all recorded launches
+	 */
+	void clear()
+	{
+#ifdef cl_khr_command_buffer
+		releaseCommandBuffers();
+#endif
+		dispatches.clear();
+		finalized = false;
+	}
+
+	/**
+	 * append a kernel launch to the sequence
+	 */
+	void appendNDRangeKernel(	const cl::Kernel &kernel,
+								const cl::NDRange &global,
+								const cl::NDRange &local
+	)
+	{
+		CDispatch d;
+		d.kernel = kernel;
+		d.global = global;
+		d.local = local;
+		dispatches.push_back(d);
+	}
+
+	/**
+	 * finish the recording
+	 *
+	 * the command buffer is only created if 'enable_command_buffer' is true and the device supports it.
+	 */
+	void finalize(	CCLSkeleton &cl,				///< skeleton with the in order queue
+					bool enable_command_buffer		///< false to use the list of launches
+	)
+	{
+		finalized = true;
+
+#ifdef cl_khr_command_buffer
+		if (!enable_command_buffer)
+			return;
+
+		std::string extensions;
+		CL_CHECK_ERROR(cl.cDevice.getInfo(CL_DEVICE_EXTENSIONS, &extensions));
+		if (extensions.find("cl_khr_command_buffer") == std::string::npos)
+			return;
+
+		cl_platform_id platform = cl.cPlatform();
+		clCreateCommandBufferKHR_ptr = (clCreateCommandBufferKHR_fn)clGetExtensionFunctionAddressForPlatform(platform, "clCreateCommandBufferKHR");
+		clCommandNDRangeKernelKHR_ptr = (clCommandNDRangeKernelKHR_fn)clGetExtensionFunctionAddressForPlatform(platform, "clCommandNDRangeKernelKHR");
+		clFinalizeCommandBufferKHR_ptr = (clFinalizeCommandBufferKHR_fn)clGetExtensionFunctionAddressForPlatform(platform, "clFinalizeCommandBufferKHR");
+		clEnqueueCommandBufferKHR_ptr = (clEnqueueCommandBufferKHR_fn)clGetExtensionFunctionAddressForPlatform(platform, "clEnqueueCommandBufferKHR");
+		clReleaseCommandBufferKHR_ptr = (clReleaseCommandBufferKHR_fn)clGetExtensionFunctionAddressForPlatform(platform, "clReleaseCommandBufferKHR");
+
+		if (	clCreateCommandBufferKHR_ptr == NULL || clCommandNDRangeKernelKHR_ptr == NULL ||
+				clFinalizeCommandBufferKHR_ptr == NULL || clEnqueueCommandBufferKHR_ptr == NULL ||
+				clReleaseCommandBufferKHR_ptr == NULL
+		)
+			return;
+
+		cl_device_command_buffer_capabilities_khr capabilities = 0;
+		CL_CHECK_ERROR(cl.cDevice.getInfo(CL_DEVICE_COMMAND_BUFFER_CAPABILITIES_KHR, &capabilities));
+		simultaneous_use = (capabilities & CL_COMMAND_BUFFER_CAPABILITY_SIMULTANEOUS_USE_KHR) != 0;
+
+		cl_command_buffer_properties_khr properties[3] = {CL_COMMAND_BUFFER_FLAGS_KHR, CL_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR, 0};
+
+		cl_command_queue queue = cl.cCommandQueue();
+		for (int b = 0; b < (simultaneous_use ? 1 : 2); b++)
+		{
+			command_buffers[b] = recordCommandBuffer(queue, (simultaneous_use ? properties : NULL));
+			if (command_buffers[b] == NULL)
+			{
+				releaseCommandBuffers();
+				return;
+			}
+		}
+		next_command_buffer = 0;
+#else
+		(void)cl;
+		(void)enable_command_buffer;
+#endif
+	}
+
+	/**
+	 * return true, if the sequence is replayed with a command buffer
+	 */
+	bool isCommandBuffer()
+	{
+#ifdef cl_khr_command_buffer
+		return command_buffers[0] != NULL;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * enqueue all launches of the sequence to the in order queue
+	 */
+	void enqueue(cl::CommandQueue &cCommandQueue)
+	{
+#ifdef cl_khr_command_buffer
+		if (command_buffers[0] != NULL)
+		{
+			int b = next_command_buffer;
+			cl_command_queue queue = cCommandQueue();
+
+			if (simultaneous_use)
+			{
+				if (clEnqueueCommandBufferKHR_ptr(1, &queue, command_buffers[0], 0, NULL, NULL) == CL_SUCCESS)
+					return;
+			}
+			else
+			{
+				// the previous replay of this command buffer has to be finished
+				if (replay_events[b]() != NULL)
+				{
+					CL_CHECK_ERROR(replay_events[b].wait());
+				}
+
+				cl_event event;
+				if (clEnqueueCommandBufferKHR_ptr(1, &queue, command_buffers[b], 0, NULL, &event) == CL_SUCCESS)
+				{
+					replay_events[b] = cl::Event(event);
+					next_command_buffer = 1-b;
+					return;
+				}
+			}
+
+			// continue with the list of launches
+			releaseCommandBuffers();
+		}
+#endif
+
+		for (size_t i = 0; i < dispatches.size(); i++)
+		{
+			CDispatch &d = dispatches[i];
+			CL_CHECK_ERROR(cCommandQueue.enqueueNDRangeKernel(d.kernel, cl::NullRange, d.global, d.local));
+		}
+	}
+};
+
+#endif
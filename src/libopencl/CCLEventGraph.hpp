@@ -0,0 +1,190 @@
+/*
+ * Copyright 2010 Martin Schreiber
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CCL_EVENT_GRAPH_HPP
+#define CCL_EVENT_GRAPH_HPP
+
+#include "libopencl/CCLSkeleton.hpp"
+#include "libopencl/CCLErrors.hpp"
+#include <vector>
+#include <map>
+
+/**
+ * \brief submission of commands with explicit event dependencies
+ *
+ * the commands are enqueued to an out of order queue. each command only waits for the
+ * events of the last commands which wrote the buffers read or written by the command and
+ * of the commands which read the buffers written by the command.
+ *
+ * the commands of the graph are enclosed by begin() and end(), which synchronize the graph
+ * with the in order queue used for all other commands.
+ *
+ * if the device does not support out of order queues, the commands are enqueued to the in
+ * order queue without any events.
+ */
+class CCLEventGraph
+{
+public:
+	/**
+	 * list of buffers accessed by a command
+	 */
+	class CBuffers
+	{
+	public:
+		std::vector<cl_mem> buffers;
+
+		CBuffers &operator()(const cl::Buffer &buffer)
+		{
+			buffers.push_back(buffer());
+			return *this;
+		}
+	};
+
+private:
+	/**
+	 * events of the commands accessing a buffer
+	 */
+	class CBufferEvents
+	{
+	public:
+		std::vector<cl::Event> write_events;	///< event of the last command which wrote the buffer
+		std::vector<cl::Event> read_events;		///< events of the commands which read the buffer after the last write
+	};
+
+	std::map<cl_mem, CBufferEvents> buffer_events;
+	std::vector<cl::Event> begin_events;		///< events of the in order queue which all commands of the graph wait for
+
+public:
+	cl::CommandQueue cCommandQueue;	///< queue for the commands of the graph
+	bool out_of_order;				///< true, if the commands are enqueued to an out of order queue
+
+	CCLEventGraph()	:
+		out_of_order(false)
+	{
+	}
+
+	/**
+	 * create the out of order queue for the device of the skeleton
+	 */
+	void init(	CCLSkeleton &cl,			///< skeleton with the in order queue
+				bool enable_out_of_order	///< false to use the in order queue
+	)
+	{
+		cCommandQueue = cl.cCommandQueue;
+		out_of_order = false;
+		buffer_events.clear();
+
+		if (!enable_out_of_order)
+			return;
+
+		cl_command_queue_properties device_properties;
+		CL_CHECK_ERROR(cl.cDevice.getInfo(CL_DEVICE_QUEUE_PROPERTIES, &device_properties));
+
+		if (!(device_properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE))
+			return;
+
+		// keep the properties (e. g. profiling) of the in order queue
+		cl_command_queue_properties properties;
+		CL_CHECK_ERROR(cl.cCommandQueue.getInfo(CL_QUEUE_PROPERTIES, &properties));
+
+		cl_int err;
+		cl::CommandQueue cOutOfOrderQueue(cl.cContext, cl.cDevice, properties | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &err);
+		if (err != CL_SUCCESS)
+			return;
+
+		cCommandQueue = cOutOfOrderQueue;
+		out_of_order = true;
+	}
+
+	/**
+	 * start the submission of commands after the commands of the in order queue
+	 */
+	void begin(cl::CommandQueue &cInOrderQueue)
+	{
+		if (!out_of_order)
+			return;
+
+		begin_events.resize(1);
+		CL_CHECK_ERROR(cInOrderQueue.enqueueMarkerWithWaitList(NULL, &begin_events[0]));
+		cInOrderQueue.flush();
+	}
+
+	/**
+	 * enqueue a kernel which reads the buffers 'reads' and writes the buffers 'writes'
+	 */
+	void enqueueNDRangeKernel(	const cl::Kernel &kernel,
+								const cl::NDRange &offset,
+								const cl::NDRange &global,
+								const cl::NDRange &local,
+								const CBuffers &reads,
+								const CBuffers &writes
+	)
+	{
+		if (!out_of_order)
+		{
+			CL_CHECK_ERROR(cCommandQueue.enqueueNDRangeKernel(kernel, offset, global, local));
+			return;
+		}
+
+		std::vector<cl::Event> wait_events(begin_events);
+
+		for (size_t i = 0; i < reads.buffers.size(); i++)
+		{
+			CBufferEvents &b = buffer_events[reads.buffers[i]];
+			wait_events.insert(wait_events.end(), b.write_events.begin(), b.write_events.end());
+		}
+
+		for (size_t i = 0; i < writes.buffers.size(); i++)
+		{
+			CBufferEvents &b = buffer_events[writes.buffers[i]];
+			wait_events.insert(wait_events.end(), b.write_events.begin(), b.write_events.end());
+			wait_events.insert(wait_events.end(), b.read_events.begin(), b.read_events.end());
+		}
+
+		cl::Event event;
+		CL_CHECK_ERROR(cCommandQueue.enqueueNDRangeKernel(kernel, offset, global, local, &wait_events, &event));
+
+		for (size_t i = 0; i < reads.buffers.size(); i++)
+			buffer_events[reads.buffers[i]].read_events.push_back(event);
+
+		for (size_t i = 0; i < writes.buffers.size(); i++)
+		{
+			CBufferEvents &b = buffer_events[writes.buffers[i]];
+			b.write_events.assign(1, event);
+			b.read_events.clear();
+		}
+	}
+
+	/**
+	 * finish the submission: the following commands of the in order queue wait for all commands of the graph
+	 */
+	void end(cl::CommandQueue &cInOrderQueue)
+	{
+		if (!out_of_order)
+			return;
+
+		std::vector<cl::Event> end_events(1);
+		CL_CHECK_ERROR(cCommandQueue.enqueueMarkerWithWaitList(NULL, &end_events[0]));
+		cCommandQueue.flush();
+
+		CL_CHECK_ERROR(cInOrderQueue.enqueueBarrierWithWaitList(&end_events));
+
+		buffer_events.clear();
+		begin_events.clear();
+	}
+};
+
+#endif
@@ -556,6 +556,78 @@ public:
 	}
 
 
+	/**
+	 * initialize skeletons for 'p_devices' devices which share one new context
+	 *
+	 * the device of this skeleton is partitioned to sub-devices with the same number of compute units if
+	 * supported (e.g. CPUs). otherwise the first devices of the platform are used. each skeleton gets
+	 * its own command queue with profiling enabled to measure the execution times on each device.
+	 */
+	void initMultiDeviceSkeletons(	int p_devices,							///< number of devices
+									std::vector<CCLSkeleton> &o_skeletons	///< skeletons for the devices
+	)
+	{
+		std::vector<cl::Device> devices;
+		cl_int err;
+
+		cl_uint max_sub_devices = 0;
+		cDevice.getInfo(CL_DEVICE_PARTITION_MAX_SUB_DEVICES, &max_sub_devices);
+
+		if (p_devices > 1 && (int)max_sub_devices >= p_devices)
+		{
+			cl_uint compute_units;
+			cDevice.getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &compute_units);
+
+			cl_device_partition_property properties[3] = {
+						CL_DEVICE_PARTITION_EQUALLY, (cl_device_partition_property)(compute_units/p_devices),
+						0
+				};
+			err = cDevice.createSubDevices(properties, &devices);
+			CL_CHECK_ERROR(err);
+
+			if (err != CL_SUCCESS || (int)devices.size() < p_devices)
+			{
+				error << "unable to partition device to " << p_devices << " sub-devices" << std::endl;
+				return;
+			}
+
+			// the remaining compute units may create further sub-devices
+			devices.resize(p_devices);
+
+			if (verbose)
+				std::cout << "partitioned device to " << p_devices << " sub-devices with " << (compute_units/p_devices) << " compute units" << std::endl;
+		}
+		else
+		{
+			if ((int)cDevices.size() < p_devices)
+			{
+				error << "unable to use " << p_devices << " devices: device can not be partitioned and only " << cDevices.size() << " devices are available" << std::endl;
+				return;
+			}
+
+			devices.assign(cDevices.begin(), cDevices.begin() + p_devices);
+		}
+
+		cl_context_properties properties[4] = {CL_CONTEXT_PLATFORM, (cl_context_properties)cPlatform(), 0, 0};
+
+		cl::Context cMultiDeviceContext(devices, properties, 0, 0, &err);
+		CL_CHECK_ERROR(err);
+
+		o_skeletons.clear();
+		for (int i = 0; i < p_devices; i++)
+		{
+			CCLSkeleton cSkeleton(*this, verbose);
+
+			cSkeleton.cContext = cMultiDeviceContext;
+			cSkeleton.cDevice = devices[i];
+			cSkeleton.cCommandQueue = cl::CommandQueue(cMultiDeviceContext, devices[i], CL_QUEUE_PROFILING_ENABLE, &err);
+			CL_CHECK_ERROR(err);
+
+			o_skeletons.push_back(cSkeleton);
+		}
+	}
+
+
 
 #ifdef C_GL_TEXTURE_HPP
 
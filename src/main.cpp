@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <string>
 #include <list>
+#include <algorithm>
 
 
 #ifdef GL_INTEROP
@@ -36,9 +37,15 @@ extern "C" {
 #include "lbm/CLbmOpenClAB_1.hpp"
 #include "lbm/CLbmOpenClAB_2.hpp"
 #include "lbm/CLbmOpenClAB_1_shared_memory.hpp"
+#include "lbm/CLbmOpenClET.hpp"
+#include "lbm/CLbmOpenClMultiDevice.hpp"
+#include "lbm/CLbmOpenClDistributed.hpp"
+#include "lbm/CLbmNativeAA.hpp"
+#include "lbm/CLbmAutotuner.hpp"
 
 #include "libopencl/CCLSkeleton.hpp"
 #include "lib/CStopwatch.hpp"
+#include "lib/CTransportUnixSocket.hpp"
 
 #include "libmath/CVector.hpp"
 
@@ -119,6 +126,9 @@ int run(int argc, char *argv[])
 	bool load_gui = false;
 
 	int lbm_implementation_nr = 0;
+	bool autotune = false;
+	int number_of_devices = 2;
+	int number_of_processes = 2;
 
 //	bool pause = false;
 
@@ -136,8 +146,10 @@ int run(int argc, char *argv[])
 
 	int simulation_loops = 100;
 
+	int adaptive_timestep_interval = 0;
+
 	char optchar;
-	while ((optchar = getopt(argc, argv, "a:d:x:y:z:D:vr:q:k:G:pt:sP:l:u:ncgX:m:R:T:i:b:")) > 0)
+	while ((optchar = getopt(argc, argv, "a:A:d:x:y:z:D:vr:q:k:G:pt:sP:l:u:ncgX:m:R:T:i:b:M:W:")) > 0)
 	{
 		switch(optchar)
 		{
@@ -146,7 +158,14 @@ int run(int argc, char *argv[])
 				break;
 
 			case 'a':
-				lbm_implementation_nr = atoi(optarg);
+				if (strcmp(optarg, "auto") == 0)
+					autotune = true;
+				else
+					lbm_implementation_nr = atoi(optarg);
+				break;
+
+			case 'A':
+				adaptive_timestep_interval = atoi(optarg);
 				break;
 
 			case 'R':
@@ -224,6 +243,14 @@ int run(int argc, char *argv[])
 				gravitation[1] = atof(optarg);
 				break;
 
+			case 'M':
+				number_of_devices = atoi(optarg);
+				break;
+
+			case 'W':
+				number_of_processes = atoi(optarg);
+				break;
+
 			case 't':
 				timestep = atof(optarg);
 				break;
@@ -278,6 +305,15 @@ parameter_error:
 	std::cout << "		                           (1: A-B pattern ver. 1)" << std::endl;
 	std::cout << "		                           (2: A-B pattern ver. 2)" << std::endl;
 	std::cout << "		                           (3: A-B pattern ver. 1 and shared memory utilization)" << std::endl;
+	std::cout << "		                           (4: A-A pattern, native CPU implementation with OpenMP, -c not required)" << std::endl;
+	std::cout << "		                           (5: esoteric twist pattern, single density distribution buffer)" << std::endl;
+	std::cout << "		                           (6: A-B pattern ver. 1, domain decomposition to several devices)" << std::endl;
+	std::cout << "		                           (7: A-B pattern ver. 1, domain decomposition to several processes)" << std::endl;
+	std::cout << "		                           (auto: select the fastest OpenCL implementation and work group sizes, -T is ignored)" << std::endl;
+	std::cout << "		[-M number_of_devices]	(number of devices used by implementation 6, default: 2)" << std::endl;
+	std::cout << "		[-W number_of_processes]	(number of processes forked by implementation 7, default: 2)" << std::endl;
+	std::cout << std::endl;
+	std::cout << "		[-A interval]	(adapt the timestep to the maximum velocity every 'interval' simulation steps, default: 0 (disabled))" << std::endl;
 	std::cout << std::endl;
 	std::cout << "		[-R registers for OpenCL]	(comma separated list of number of registers per threads in OpenCL)" << std::endl;
 	std::cout << "		[-T work group threads]		(comma separated list of number of threads in OpenCL)" << std::endl;
@@ -292,6 +328,53 @@ parameter_error:
 
 parameter_error_ok:
 
+	// the native implementation runs without OpenCL
+	bool native_lbm = (lbm_implementation_nr == 4 && !autotune);
+
+	if (autotune && !load_opencl)
+	{
+		std::cerr << "Error: autotuning requires OpenCL (-c)" << std::endl;
+		return -1;
+	}
+
+	if (native_lbm && load_gui)
+	{
+		std::cerr << "Error: the GUI is not supported by the native CPU implementation" << std::endl;
+		return -1;
+	}
+
+	if (lbm_implementation_nr == 6 && !autotune && load_gui)
+	{
+		std::cerr << "Error: the GUI is not supported by the multi device implementation" << std::endl;
+		return -1;
+	}
+
+	/***************
+	 * PROCESSES
+	 ***************/
+
+	// the processes have to be forked before OpenCL is initialized
+	CTransportUnixSocket cTransport;
+
+	if (lbm_implementation_nr == 7 && !autotune)
+	{
+		if (load_gui || number_of_processes < 1)
+		{
+			std::cerr << "Error: the distributed implementation needs at least one process and does not support the GUI" << std::endl;
+			return -1;
+		}
+
+		cTransport.init(number_of_processes);
+		if (cTransport.error())
+		{
+			std::cerr << "Error: " << cTransport.error.getString();
+			return -1;
+		}
+
+		if (verbose)
+			std::cout << "rank " << cTransport.rank << " of " << cTransport.size << std::endl;
+	}
+
 	/***************
 	 * BALANCE BOARD
 	 ***************/
@@ -383,8 +466,9 @@ parameter_error_ok:
 	 * LBM SIMULATION
 	 **************************/
 	CLbmOpenClInterface<T> *cLbmOpenCl = NULL;
+	CLbmOpenClDistributed<T> *cLbmOpenClDistributed = NULL;
 
-	if (load_lbm_simulation && load_opencl)
+	if (load_lbm_simulation && (load_opencl || native_lbm))
 	{
 		std::cout << "Loading LBM OpenCL" << std::endl;
 
@@ -394,6 +478,39 @@ parameter_error_ok:
 		if (!number_of_registers_string.empty())
 			extract_comma_separated_integers(lbm_opencl_number_of_registers_list, number_of_registers_string);
 
+		if (init_flag < 0)
+		{
+			init_flag = 0;
+
+			init_flag |= CLbmOpenClInterface<T>::INIT_CREATE_BREAKING_DAM;
+		}
+
+		if (autotune)
+		{
+			CLbmAutotuner<T> cLbmAutotuner(*cCLSkeleton, verbose);
+
+			cLbmAutotuner.setup(
+							domain_cells,
+							domain_length_x,
+							viscosity,
+							gravitation,
+							max_sim_gravitation_length,
+							timestep,
+							mass_exchange_factor,
+							init_flag,
+							lbm_opencl_number_of_registers_list
+						);
+
+			if (cLbmAutotuner.error())
+			{
+				std::cerr << "Error: " << cLbmAutotuner.error.getString();
+				return -1;
+			}
+
+			lbm_implementation_nr = cLbmAutotuner.implementation_nr;
+			lbm_opencl_number_of_threads_list = cLbmAutotuner.number_of_threads_list;
+		}
+
 		switch(lbm_implementation_nr)
 		{
 			case 1:
@@ -411,22 +528,36 @@ parameter_error_ok:
 				cLbmOpenCl = new CLbmOpenClAB_1_shared_memory<T>(*cCLSkeleton, verbose);
 				break;
 
+			case 4:
+				// native OpenMP implementation of the A-A pattern (alternating alpha and beta steps in place)
+				cLbmOpenCl = new CLbmNativeAA<T>((cCLSkeleton != NULL ? *cCLSkeleton : CCLSkeleton(verbose)), verbose);
+				break;
+
+			case 5:
+				// esoteric twist pattern with in place streaming
+				cLbmOpenCl = new CLbmOpenClET<T>(*cCLSkeleton, verbose);
+				break;
+
+			case 6:
+				// domain decomposition to several devices
+				cLbmOpenCl = new CLbmOpenClMultiDevice<T>(*cCLSkeleton, number_of_devices, verbose);
+				break;
+
+			case 7:
+				// domain decomposition to several processes
+				cLbmOpenClDistributed = new CLbmOpenClDistributed<T>(*cCLSkeleton, cTransport, verbose);
+				cLbmOpenCl = cLbmOpenClDistributed;
+				break;
+
 			default:
 				// alpha-beta kernel
 				cLbmOpenCl = new CLbmOpenClAA<T>(*cCLSkeleton, verbose);
 		}
 
-		if (init_flag < 0)
-		{
-			init_flag = 0;
-
-			init_flag |= CLbmOpenClInterface<T>::INIT_CREATE_BREAKING_DAM;
-		}
-
 		if (verbose)
 			std::cout << "init flag: " << init_flag << std::endl;
 
-		if (computation_kernel_count == 0)
+		if (computation_kernel_count == 0 && cCLSkeleton != NULL)
 		{
 			int default_work_group_size;
 			cCLSkeleton->cDevice.getInfo(CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT, &default_work_group_size);
@@ -456,6 +587,14 @@ parameter_error_ok:
 			std::cerr << "Error: " << cLbmOpenCl->error.getString();
 			return -1;
 		}
+
+		if (verbose)
+		{
+			size_t device_memory_bytes = cLbmOpenCl->getDeviceMemoryFootprint();
+			std::cout << "device memory: " << device_memory_bytes << " bytes (" << (double)device_memory_bytes/(double)domain_cells.elements() << " bytes per cell)" << std::endl;
+		}
+
+		cLbmOpenCl->setupAdaptiveTimestep(adaptive_timestep_interval);
 	}
 
 	if (load_gui)
@@ -481,7 +620,7 @@ parameter_error_ok:
 	}
 	else
 	{
-		if (load_lbm_simulation && load_opencl)
+		if (load_lbm_simulation && (load_opencl || native_lbm))
 		{
 			CStopwatch cStopwatch;
 			cStopwatch.start();
@@ -490,7 +629,18 @@ parameter_error_ok:
 			{
 				if ((i&15) == 0)
 					std::cout << "." << std::flush;
+
+				// without adaptive timestep, the steps up to the next output are enqueued at once
+				if (adaptive_timestep_interval == 0)
+				{
+					int steps = std::min(16 - (i&15), simulation_loops - i);
+					cLbmOpenCl->simulationSteps(steps);
+					i += steps-1;
+					continue;
+				}
+
 				cLbmOpenCl->simulationStep();
+				cLbmOpenCl->updateAdaptiveTimestep();
 
 				/**
 				 * bunch of validation checks
@@ -513,6 +663,9 @@ parameter_error_ok:
 			std::cout << "FPS: " << fps << std::endl;
 			std::cout << "MLUPS: " << fps*((double)domain_cells.elements()*(double)0.000001) << std::endl;
 
+			if (cLbmOpenClDistributed != NULL)
+				cLbmOpenClDistributed->printRankTimings();
+
 			if (verbose)
 			{
 				std::cout << "velocity checksum: " << cLbmOpenCl->getVelocityChecksum() << std::endl;